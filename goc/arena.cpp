@@ -0,0 +1,27 @@
+#include "arena.h"
+#include <cstdint>
+
+Arena& Arena::global() {
+    static Arena arena;
+    return arena;
+}
+
+void* Arena::allocate(size_t size, size_t align) {
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(next) + align - 1) & ~(uintptr_t)(align - 1);
+    if (!next || aligned + size > reinterpret_cast<uintptr_t>(limit)) {
+        // Oversized requests get a block of their own and leave the current one open
+        if (size + align > kBlockSize) {
+            blocks.emplace_back(new char[size + align]);
+            used += size;
+            uintptr_t start = reinterpret_cast<uintptr_t>(blocks.back().get());
+            return reinterpret_cast<void*>((start + align - 1) & ~(uintptr_t)(align - 1));
+        }
+        blocks.emplace_back(new char[kBlockSize]);
+        next = blocks.back().get();
+        limit = next + kBlockSize;
+        aligned = (reinterpret_cast<uintptr_t>(next) + align - 1) & ~(uintptr_t)(align - 1);
+    }
+    next = reinterpret_cast<char*>(aligned + size);
+    used += size;
+    return reinterpret_cast<void*>(aligned);
+}
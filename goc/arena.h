@@ -0,0 +1,39 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump allocator. Objects are carved out of large blocks in allocation order
+// and are never freed one at a time; the blocks go back together when the
+// arena is destroyed.
+//
+// AST nodes live in the global arena (parser.h's makeNode), so a function's
+// nodes sit next to each other in the order the parser built them, and the
+// tree costs a handful of block allocations instead of one per node. Like
+// the interner it is process-wide and not synchronized: only the parser and
+// the passes over its tree allocate, all on one thread.
+class Arena {
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    static Arena& global();
+
+    void* allocate(size_t size, size_t align);
+
+    size_t bytesUsed() const { return used; }
+    size_t blockCount() const { return blocks.size(); }
+
+private:
+    static constexpr size_t kBlockSize = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* next = nullptr;
+    char* limit = nullptr;
+    size_t used = 0;
+};
+
+#endif // ARENA_H
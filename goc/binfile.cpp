@@ -0,0 +1,369 @@
+#include "binfile.h"
+#include "mappedfile.h"
+#include <cstring>
+#include <fstream>
+
+static const size_t kHeaderSize = 32;
+static const size_t kSectionEntrySize = 16;
+
+uint32_t crc32(const uint8_t* data, size_t size) {
+    static uint32_t table[256];
+    static bool initialized = false;
+    if (!initialized) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        initialized = true;
+    }
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// ---- Reading ----
+
+// Bounds-checked little-endian reads from a file image
+class ByteReader {
+public:
+    ByteReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    bool u32(uint32_t& value) { return bytes(&value, sizeof(value)); }
+    bool bytes(void* out, size_t n) {
+        if (n > size - pos) return false;
+        std::memcpy(out, data + pos, n);
+        pos += n;
+        return true;
+    }
+    bool str(std::string_view& out, uint32_t n) {
+        if (n > size - pos) return false;
+        out = std::string_view(reinterpret_cast<const char*>(data + pos), n);
+        pos += n;
+        return true;
+    }
+    bool skip(size_t n) {
+        if (n > size - pos) return false;
+        pos += n;
+        return true;
+    }
+    size_t offset() const { return pos; }
+    size_t remaining() const { return size - pos; }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+};
+
+static bool readStrings(ByteReader& in, std::vector<std::string_view>& strings) {
+    uint32_t count = 0;
+    if (!in.u32(count)) return false;
+    strings.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t len = 0;
+        std::string_view str;
+        if (!in.u32(len) || !in.str(str, len)) return false;
+        strings.push_back(str);
+    }
+    return true;
+}
+
+static bool readV1(const uint8_t* data, size_t file_size, BinaryView& view, std::string& error) {
+    ByteReader in(data, file_size);
+    if (!readStrings(in, view.strings)) {
+        error = "Failed to read string table";
+        return false;
+    }
+    uint32_t code_size = 0;
+    if (!in.u32(code_size)) {
+        error = "Failed to read bytecode size";
+        return false;
+    }
+    view.code = data + in.offset();
+    view.code_size = code_size;
+    if (!in.skip(code_size)) {
+        error = "Failed to read bytecode";
+        return false;
+    }
+
+    // Optional tagged blocks after the code (u32 tag, u32 size, payload)
+    uint32_t tag = 0, size = 0;
+    while (in.remaining() >= 8 && in.u32(tag) && in.u32(size)) {
+        const uint8_t* start = data + in.offset();
+        if (!in.skip(size)) {
+            error = "Truncated block after bytecode";
+            return false;
+        }
+        std::vector<uint8_t> payload(start, start + size);
+        if (tag == kProfileSiteTag) {
+            if (!parseProfileSites(payload, view.profile_sites)) {
+                error = "Invalid profile site table";
+                return false;
+            }
+        } else if (tag == kExceptionTableTag) {
+            if (!parseExceptionTable(payload, view.exception_regions)) {
+                error = "Invalid exception table";
+                return false;
+            }
+        } else {
+            view.dropped_blocks++;
+        }
+    }
+    view.version = 1;
+    return true;
+}
+
+static bool readSymbols(ByteReader& in, std::vector<FunctionSymbol>& symbols) {
+    uint32_t count = 0;
+    if (!in.u32(count)) return false;
+    symbols.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        FunctionSymbol symbol;
+        uint32_t len = 0;
+        std::string_view name;
+        if (!in.u32(symbol.address) || !in.u32(len) || !in.str(name, len)) return false;
+        symbol.name = std::string(name);
+        symbols.push_back(std::move(symbol));
+    }
+    return true;
+}
+
+static bool readConstants(ByteReader& in, std::vector<uint64_t>& constants) {
+    uint32_t count = 0, reserved = 0;
+    if (!in.u32(count) || !in.u32(reserved) || count > in.remaining() / sizeof(uint64_t)) return false;
+    constants.resize(count);
+    return in.bytes(constants.data(), count * sizeof(uint64_t));
+}
+
+static bool readV2(const uint8_t* data, size_t size, BinaryView& view, std::string& error) {
+    ByteReader in(data, size);
+    uint32_t magic = 0, flags = 0, section_count = 0, table_offset = 0, checksum = 0;
+    uint16_t version = 0, header_size = 0;
+    uint64_t file_size = 0;
+    if (!in.u32(magic) || !in.bytes(&version, 2) || !in.bytes(&header_size, 2) || !in.u32(flags) ||
+        !in.u32(section_count) || !in.u32(table_offset) || !in.u32(checksum) || !in.bytes(&file_size, 8)) {
+        error = "Truncated file header";
+        return false;
+    }
+    if (version != kBinaryVersion) {
+        error = "Unsupported .bin version " + std::to_string(version);
+        return false;
+    }
+    if (header_size < kHeaderSize || header_size > size || file_size != size) {
+        error = "Invalid file header (truncated file?)";
+        return false;
+    }
+    if (crc32(data + header_size, size - header_size) != checksum) {
+        error = "Checksum mismatch";
+        return false;
+    }
+    if (table_offset > size || section_count > (size - table_offset) / kSectionEntrySize) {
+        error = "Invalid section table";
+        return false;
+    }
+
+    bool has_code = false;
+    for (uint32_t i = 0; i < section_count; i++) {
+        uint32_t entry[4];  // type, alignment, offset, size
+        std::memcpy(entry, data + table_offset + i * kSectionEntrySize, sizeof(entry));
+        if (entry[2] > size || entry[3] > size - entry[2]) {
+            error = "Section " + std::to_string(i) + " lies outside the file";
+            return false;
+        }
+        const uint8_t* start = data + entry[2];
+        ByteReader section(start, entry[3]);
+        bool ok = true;
+        switch (static_cast<SectionType>(entry[0])) {
+            case SectionType::CODE:
+                view.code = start;
+                view.code_size = entry[3];
+                has_code = true;
+                break;
+            case SectionType::STRINGS:
+                ok = readStrings(section, view.strings);
+                break;
+            case SectionType::CONSTANTS:
+                ok = readConstants(section, view.constants);
+                break;
+            case SectionType::SYMBOLS:
+                ok = readSymbols(section, view.symbols);
+                break;
+            case SectionType::PROFILE_SITES:
+                ok = parseProfileSites(std::vector<uint8_t>(start, start + entry[3]), view.profile_sites);
+                break;
+            case SectionType::EXCEPTIONS:
+                ok = parseExceptionTable(std::vector<uint8_t>(start, start + entry[3]), view.exception_regions);
+                break;
+            case SectionType::DEBUG_LINES:
+                view.debug_lines = start;
+                view.debug_lines_size = entry[3];
+                break;
+            case SectionType::DATA:
+                ok = section.u32(view.data_cells);
+                break;
+            case SectionType::RELOCATIONS:
+                ok = parseRelocations(std::vector<uint8_t>(start, start + entry[3]), view.relocations);
+                break;
+            case SectionType::FLOAT_PARAMS:
+                ok = parseFloatParams(std::vector<uint8_t>(start, start + entry[3]), view.float_params);
+                break;
+            case SectionType::VM_STATE:
+                view.vm_state = start;
+                view.vm_state_size = entry[3];
+                break;
+            case SectionType::VM_MEMORY:
+                view.vm_memory = start;
+                view.vm_memory_size = entry[3];
+                break;
+            default:
+                view.dropped_blocks++;
+                break;
+        }
+        if (!ok) {
+            error = "Invalid section " + std::to_string(i) + " (type " + std::to_string(entry[0]) + ")";
+            return false;
+        }
+    }
+    if (!has_code) {
+        error = "No code section";
+        return false;
+    }
+    view.version = version;
+    view.compact_code = (flags & kBinaryFlagCompactCode) != 0;
+    view.object = (flags & kBinaryFlagObject) != 0;
+    view.snapshot = (flags & kBinaryFlagSnapshot) != 0;
+    return true;
+}
+
+bool parseBinary(const uint8_t* data, size_t size, BinaryView& view, std::string& error) {
+    view = BinaryView();
+    uint32_t magic = 0;
+    if (size >= sizeof(magic)) std::memcpy(&magic, data, sizeof(magic));
+    return magic == kBinaryMagic ? readV2(data, size, view, error) : readV1(data, size, view, error);
+}
+
+bool readBinary(const std::string& filename, BinaryImage& image, std::string& error) {
+    MappedFile file;
+    BinaryView view;
+    if (!file.open(filename, error) || !parseBinary(file.data(), file.size(), view, error)) return false;
+
+    image = BinaryImage();
+    image.version = view.version;
+    image.strings.assign(view.strings.begin(), view.strings.end());
+    image.code.assign(view.code, view.code + view.code_size);
+    image.compact_code = view.compact_code;
+    image.constants = std::move(view.constants);
+    image.symbols = std::move(view.symbols);
+    image.profile_sites = std::move(view.profile_sites);
+    image.exception_regions = std::move(view.exception_regions);
+    image.debug_lines.assign(view.debug_lines, view.debug_lines + view.debug_lines_size);
+    image.object = view.object;
+    image.data_cells = view.data_cells;
+    image.relocations = std::move(view.relocations);
+    image.float_params = std::move(view.float_params);
+    image.snapshot = view.snapshot;
+    image.vm_state.assign(view.vm_state, view.vm_state + view.vm_state_size);
+    image.vm_memory.assign(view.vm_memory, view.vm_memory + view.vm_memory_size);
+    image.dropped_blocks = view.dropped_blocks;
+    return true;
+}
+
+// ---- Writing ----
+
+static void put32(std::vector<uint8_t>& out, uint32_t value) {
+    uint8_t bytes[4];
+    std::memcpy(bytes, &value, 4);
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+static void putString(std::vector<uint8_t>& out, const std::string& str) {
+    put32(out, str.size());
+    out.insert(out.end(), str.begin(), str.end());
+}
+
+bool writeBinary(const std::string& filename, const BinaryImage& image) {
+    std::vector<std::pair<SectionType, std::vector<uint8_t>>> sections;
+    sections.push_back({SectionType::CODE, image.code});
+
+    std::vector<uint8_t> strings;
+    put32(strings, image.strings.size());
+    for (const auto& str : image.strings) putString(strings, str);
+    sections.push_back({SectionType::STRINGS, std::move(strings)});
+
+    if (!image.constants.empty()) {
+        // The 8-byte header keeps the entries 8-byte aligned
+        std::vector<uint8_t> constants;
+        put32(constants, image.constants.size());
+        put32(constants, 0);
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(image.constants.data());
+        constants.insert(constants.end(), bytes, bytes + image.constants.size() * sizeof(uint64_t));
+        sections.push_back({SectionType::CONSTANTS, std::move(constants)});
+    }
+    if (!image.symbols.empty()) {
+        std::vector<uint8_t> symbols;
+        put32(symbols, image.symbols.size());
+        for (const auto& symbol : image.symbols) {
+            put32(symbols, symbol.address);
+            putString(symbols, symbol.name);
+        }
+        sections.push_back({SectionType::SYMBOLS, std::move(symbols)});
+    }
+    if (!image.profile_sites.empty()) {
+        sections.push_back({SectionType::PROFILE_SITES, encodeProfileSites(image.profile_sites)});
+    }
+    if (!image.exception_regions.empty()) {
+        sections.push_back({SectionType::EXCEPTIONS, encodeExceptionTable(image.exception_regions)});
+    }
+    if (!image.debug_lines.empty()) {
+        sections.push_back({SectionType::DEBUG_LINES, image.debug_lines});
+    }
+    if (image.object) {
+        std::vector<uint8_t> data;
+        put32(data, image.data_cells);
+        sections.push_back({SectionType::DATA, std::move(data)});
+        sections.push_back({SectionType::RELOCATIONS, encodeRelocations(image.relocations)});
+        if (!image.float_params.empty()) {
+            sections.push_back({SectionType::FLOAT_PARAMS, encodeFloatParams(image.float_params)});
+        }
+    }
+    if (image.snapshot) {
+        sections.push_back({SectionType::VM_STATE, image.vm_state});
+        sections.push_back({SectionType::VM_MEMORY, image.vm_memory});
+    }
+
+    // Header, table, then each section padded to the alignment
+    auto align = [](size_t n) { return (n + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment; };
+    std::vector<uint8_t> file(align(kHeaderSize + sections.size() * kSectionEntrySize), 0);
+    for (size_t i = 0; i < sections.size(); i++) {
+        uint32_t entry[4] = {static_cast<uint32_t>(sections[i].first), kSectionAlignment,
+                             static_cast<uint32_t>(file.size()), static_cast<uint32_t>(sections[i].second.size())};
+        std::memcpy(file.data() + kHeaderSize + i * kSectionEntrySize, entry, sizeof(entry));
+        file.insert(file.end(), sections[i].second.begin(), sections[i].second.end());
+        file.resize(align(file.size()), 0);
+    }
+
+    uint32_t magic = kBinaryMagic;
+    uint32_t flags = (image.compact_code ? kBinaryFlagCompactCode : 0) | (image.object ? kBinaryFlagObject : 0) |
+                     (image.snapshot ? kBinaryFlagSnapshot : 0);
+    uint32_t section_count = sections.size(), table_offset = kHeaderSize;
+    uint16_t version = kBinaryVersion, header_size = kHeaderSize;
+    uint32_t checksum = crc32(file.data() + kHeaderSize, file.size() - kHeaderSize);
+    uint64_t file_size = file.size();
+    uint8_t* header = file.data();
+    std::memcpy(header, &magic, 4);
+    std::memcpy(header + 4, &version, 2);
+    std::memcpy(header + 6, &header_size, 2);
+    std::memcpy(header + 8, &flags, 4);
+    std::memcpy(header + 12, &section_count, 4);
+    std::memcpy(header + 16, &table_offset, 4);
+    std::memcpy(header + 20, &checksum, 4);
+    std::memcpy(header + 24, &file_size, 8);
+
+    // Never in place: a VM may be running the old file from its mapping
+    return replaceFile(filename, file.data(), file.size());
+}
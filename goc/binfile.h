@@ -0,0 +1,115 @@
+#ifndef BINFILE_H
+#define BINFILE_H
+
+#include "debuginfo.h"
+#include "object.h"
+#include "profile.h"
+#include "unwind.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// .bin container shared by the compiler, the VM and gocopt.
+//
+// v1 (read only): u32 string count, strings (u32 length + bytes), u32 code
+// size, the code, then optional tagged blocks (see profile.h).
+//
+// v2: a header, a section table and the sections. Every section starts on a
+// 16-byte boundary so it can be used in place from a mapped file.
+//   header (32 bytes): u32 magic "GOCB", u16 version, u16 header size,
+//                      u32 flags, u32 section count, u32 section table offset,
+//                      u32 CRC-32 of everything after the header, u64 file size
+//   table entry:       u32 type, u32 alignment, u32 offset, u32 size
+// Readers skip sections of types they do not know. A v1 file cannot start
+// with the magic: its string count would be over a billion.
+
+const uint32_t kBinaryMagic = 0x42434F47;  // "GOCB"
+const uint16_t kBinaryVersion = 2;
+const uint32_t kSectionAlignment = 16;
+
+// Header flags
+const uint32_t kBinaryFlagCompactCode = 1;  // CODE uses the compact encoding (encoding.h)
+const uint32_t kBinaryFlagObject = 2;       // Relocatable object for goclink (object.h), not runnable
+const uint32_t kBinaryFlagSnapshot = 4;     // Paused VM state (snapshot.h), run with vm --restore
+
+enum class SectionType : uint32_t {
+    CODE          = 1,
+    STRINGS       = 2,  // u32 count, then u32 length + bytes per string
+    CONSTANTS     = 3,  // u32 count, u32 reserved, then 8-byte entries (encoding.h)
+    DATA          = 4,  // Objects: u32 static memory cells used
+    SYMBOLS       = 5,  // Function entry points: u32 count, then u32 address, u32 length + name
+    DEBUG_LINES   = 6,  // Payload as in debuginfo.h
+    IMPORTS       = 7,  // Native functions the code calls
+    PROFILE_SITES = 8,  // Payload as in profile.h
+    EXCEPTIONS    = 9,  // Payload as in unwind.h
+    RELOCATIONS   = 10, // Objects: payload as in object.h
+    VM_STATE      = 11, // Snapshots: payload as in snapshot.h
+    VM_MEMORY     = 12, // Snapshots: payload as in snapshot.h
+    FLOAT_PARAMS  = 13  // Objects: payload as in object.h
+};
+
+struct FunctionSymbol {
+    uint32_t address;
+    std::string name;  // Mangled label name
+};
+
+// Contents of a .bin file
+struct BinaryImage {
+    uint16_t version = kBinaryVersion;  // Format the file was read from
+    std::vector<std::string> strings;
+    std::vector<uint8_t> code;
+    bool compact_code = false;          // Always false for v1
+    std::vector<uint64_t> constants;    // Pool read by LOAD_CONST / FLOAD_CONST
+    std::vector<FunctionSymbol> symbols;
+    std::vector<ProfileSite> profile_sites;
+    std::vector<ExceptionRegion> exception_regions;
+    std::vector<uint8_t> debug_lines;   // DEBUG_LINES payload, decoded by whoever needs it
+    bool object = false;                // Relocatable object (object.h)
+    uint32_t data_cells = 0;            // Objects: static memory cells used
+    std::vector<Relocation> relocations;
+    std::vector<FloatParamCells> float_params;
+    bool snapshot = false;              // Paused VM state (snapshot.h)
+    std::vector<uint8_t> vm_state;      // VM_STATE and VM_MEMORY payloads
+    std::vector<uint8_t> vm_memory;
+    size_t dropped_blocks = 0;  // Blocks or sections of unknown type
+};
+
+// A .bin file in memory: code, strings and the debug lines point into the
+// file's bytes, which must outlive the view. The small tables are decoded.
+struct BinaryView {
+    uint16_t version = kBinaryVersion;
+    const uint8_t* code = nullptr;
+    size_t code_size = 0;
+    bool compact_code = false;
+    std::vector<std::string_view> strings;
+    std::vector<uint64_t> constants;
+    std::vector<FunctionSymbol> symbols;
+    std::vector<ProfileSite> profile_sites;
+    std::vector<ExceptionRegion> exception_regions;
+    const uint8_t* debug_lines = nullptr;
+    size_t debug_lines_size = 0;
+    bool object = false;
+    uint32_t data_cells = 0;
+    std::vector<Relocation> relocations;
+    std::vector<FloatParamCells> float_params;
+    bool snapshot = false;
+    const uint8_t* vm_state = nullptr;
+    size_t vm_state_size = 0;
+    const uint8_t* vm_memory = nullptr;
+    size_t vm_memory_size = 0;
+    size_t dropped_blocks = 0;
+};
+
+// Validate and index a v1 or v2 file without copying it (the VM runs a
+// mapped file this way); false with `error` if it is malformed
+bool parseBinary(const uint8_t* data, size_t size, BinaryView& view, std::string& error);
+
+// Read a v1 or v2 file into an owned image; false with `error` if it is malformed
+bool readBinary(const std::string& filename, BinaryImage& image, std::string& error);
+// Always writes v2
+bool writeBinary(const std::string& filename, const BinaryImage& image);
+
+uint32_t crc32(const uint8_t* data, size_t size);
+
+#endif // BINFILE_H
@@ -4,8 +4,21 @@
 #include <iomanip>
 #include <cstring>
 #include <algorithm>
+#include <tuple>
+#include <map>
+#include <stdexcept>
+// Specialization limits: total AST nodes that may be cloned, and clones per function
+static const size_t kSpecializationBudget = 4000;
+static const int kMaxSpecializationsPerFunction = 8;
+// Largest argument count the VM memo cache keys on (matches VirtualMachine::kMaxMemoArgs)
+static const size_t kMaxMemoArgs = 4;
+// Static memory cells the VM provides at startup; unchecked accesses must stay below this
+static const int32_t kStaticMemoryCells = 1024;
+
 CodeGenerator::CodeGenerator() 
-    : current_offset(0), next_memory_addr(0), label_counter(0) {
+    : current_offset(0), next_memory_addr(0), optimize(true),
+      current_function_returns_float(false), current_function_memoized(false),
+      has_profile(false) {
 }
 
 std::vector<uint8_t> CodeGenerator::generate(const Program& program) {
@@ -13,18 +26,57 @@ std::vector<uint8_t> CodeGenerator::generate(const Program& program) {
     symbols.clear();
     current_offset = 0;
     next_memory_addr = 0;
-    label_counter = 0;
+    labels.clear();
+    function_labels.clear();
+    compact_code = false;
+    constants.clear();
+    specialized_functions.clear();
+    specialized_calls.clear();
+    function_templates.clear();
+    template_calls.clear();
+    instantiated_templates.clear();
+    template_instances.clear();
+    pending_instances.clear();
+    signatures.clear();
+    current_function_returns_float = false;
+    current_float_param_cells.clear();
+    try_regions.clear();
+    pending_handlers.clear();
+    active_try_handlers.clear();
+    active_exceptions.clear();
+    memoized_functions.clear();
+    current_function_memoized = false;
+    known_ranges.clear();
+    profile_sites.clear();
+    function_ranges.clear();
+    line_entries.clear();
+    data_operands.clear();
+    string_operands.clear();
+    relocations.clear();
+    recording.reset();
+    cacheable_functions.clear();
+    functions_reused = 0;
+    
+    if (optimize) {
+        specializeFunctions(program);
+        selectMemoizedFunctions(program);
+    }
     
     genProgram(program);
+    if (has_profile) {
+        layoutFunctionsHotFirst();
+    }
     fixupLabels();
     
     return bytecode;
 }
 
 void CodeGenerator::genProgram(const Program& prog) {
-    // Emit entry point that calls main and halts
-    emitJump(Opcode::CALL, "main");
-    emit(Opcode::HALT);
+    // Emit entry point that calls main and halts (goclink adds it for objects)
+    if (!object_mode) {
+        emitJump(Opcode::CALL, functionLabel("main"));
+        emit(Opcode::HALT);
+    }
     
     // Collect class/struct names for constructor detection
     for (const auto& node : prog.top) {
@@ -35,6 +87,73 @@ void CodeGenerator::genProgram(const Program& prog) {
         } else if (node->kind == ASTNodeKind::STRUCT_DECL) {
             auto strct = static_cast<StructDecl*>(node.get());
             if (strct) class_names.insert(strct->structName);
+        } else if (node->kind == ASTNodeKind::TEMPLATE_DECL) {
+            auto tmpl = static_cast<const TemplateDecl*>(node.get());
+            const ASTNode* decl = tmpl->declaration.get();
+            if (!decl) continue;
+            if (decl->kind == ASTNodeKind::FUNC_DECL) {
+                function_templates[static_cast<const FunctionDecl*>(decl)->funcName] = tmpl;
+            } else if (decl->kind == ASTNodeKind::CLASS_DECL) {
+                class_names.insert(static_cast<const ClassDecl*>(decl)->className);
+            } else if (decl->kind == ASTNodeKind::STRUCT_DECL) {
+                class_names.insert(static_cast<const StructDecl*>(decl)->structName);
+            }
+        }
+    }
+
+    // Declare every function up front so calls know how to pass float arguments
+    for (const auto& node : prog.top) {
+        if (!node) continue;
+        if (node->kind == ASTNodeKind::FUNC_DECL) {
+            auto f = static_cast<const FunctionDecl*>(node.get());
+            declareFunction(f, mangleFunctionName(f->funcName, f->params.size()));
+        } else if (node->kind == ASTNodeKind::CLASS_DECL) {
+            auto cls = static_cast<const ClassDecl*>(node.get());
+            for (const auto& m : cls->members) {
+                if (m && m->kind == ASTNodeKind::FUNC_DECL) {
+                    declareFunction(static_cast<const FunctionDecl*>(m.get()),
+                                    cls->className + "::" + static_cast<const FunctionDecl*>(m.get())->funcName);
+                }
+            }
+        }
+    }
+    for (const auto& spec : specialized_functions) {
+        declareFunction(static_cast<const FunctionDecl*>(spec.second.get()), spec.first);
+    }
+
+    // Function cache: the program-wide decisions every function's code depends
+    // on. Profile-guided builds lay out branches by the profile and skip it.
+    if (cache && source_tokens && !has_profile) {
+        ContentHash hash;
+        hash.add(kCacheFormatVersion).add(optimize).add(object_mode);
+        std::map<std::string, const FunctionSignature*> sorted_signatures;
+        for (const auto& [name, sig] : signatures) sorted_signatures[name] = &sig;
+        for (const auto& [name, sig] : sorted_signatures) {
+            hash.add(name).add(sig->returns_float).add(sig->float_param_cells.size());
+            for (int cell : sig->float_param_cells) hash.add(static_cast<uint64_t>(cell));
+        }
+        auto addNames = [&hash](std::vector<std::string> names) {
+            std::sort(names.begin(), names.end());
+            hash.add(names.size());
+            for (const auto& name : names) hash.add(name);
+        };
+        addNames({class_names.begin(), class_names.end()});
+        addNames({memoized_functions.begin(), memoized_functions.end()});
+        std::vector<std::string> templates;
+        for (const auto& entry : function_templates) templates.push_back("f:" + entry.first);
+        addNames(templates);
+        program_hash = hash.value();
+        
+        for (const auto& node : prog.top) {
+            if (node && node->kind == ASTNodeKind::FUNC_DECL) {
+                cacheable_functions.insert(static_cast<const FunctionDecl*>(node.get()));
+            } else if (node && node->kind == ASTNodeKind::CLASS_DECL) {
+                for (const auto& m : static_cast<const ClassDecl*>(node.get())->members) {
+                    if (m && m->kind == ASTNodeKind::FUNC_DECL) {
+                        cacheable_functions.insert(static_cast<const FunctionDecl*>(m.get()));
+                    }
+                }
+            }
         }
     }
 
@@ -59,10 +178,332 @@ void CodeGenerator::genProgram(const Program& prog) {
             genStatement(node.get());
         }
     }
+
+    // Specialized clones go after the originals
+    for (const auto& spec : specialized_functions) {
+        genFunctionDecl(static_cast<const FunctionDecl*>(spec.second.get()), spec.first);
+    }
+
+    // Template instances, including those first used by other instances
+    for (size_t i = 0; i < pending_instances.size(); i++) {
+        std::string label = pending_instances[i].first;
+        const FunctionDecl* func = pending_instances[i].second;
+        genFunctionDecl(func, label);
+    }
+    genPendingHandlers();
+}
+
+// Clone functions for call sites that pass constant arguments to parameters the
+// callee branches on. The constant is substituted into the clone, which is then
+// folded and pruned, and the call site is redirected to the clone. Clones are
+// scanned for calls too, but calls back into a function they were cloned from
+// (recursion) stay on the generic version, so each (function, constants) pair
+// is cloned at most once and recursion does not unroll into a chain of clones.
+void CodeGenerator::specializeFunctions(const Program& prog) {
+    // Candidate callees: top-level functions with a body, unambiguous by name and arity
+    std::unordered_map<std::string, const FunctionDecl*> functions;
+    std::unordered_set<std::string> ambiguous;
+    struct PendingBody {
+        const ASTNode* body;
+        std::vector<const FunctionDecl*> cloned_from;  // Sources of the clone this body belongs to
+    };
+    std::vector<PendingBody> worklist;
+    for (const auto& node : prog.top) {
+        if (!node) continue;
+        if (node->kind == ASTNodeKind::FUNC_DECL) {
+            auto f = static_cast<const FunctionDecl*>(node.get());
+            if (!f->body) continue;
+            std::string key = mangleFunctionName(f->funcName, f->params.size());
+            if (functions.count(key)) ambiguous.insert(key);
+            functions[key] = f;
+            worklist.push_back({f->body.get(), {}});
+        } else if (node->kind == ASTNodeKind::CLASS_DECL) {
+            for (const auto& m : static_cast<const ClassDecl*>(node.get())->members) {
+                if (m && m->kind == ASTNodeKind::FUNC_DECL) {
+                    worklist.push_back({static_cast<const FunctionDecl*>(m.get())->body.get(), {}});
+                }
+            }
+        }
+    }
+
+    std::unordered_map<std::string, size_t> clone_index;          // clone key -> specialized_functions index
+    std::unordered_map<const FunctionDecl*, int> clone_counts;
+    size_t budget = kSpecializationBudget;
+
+    while (!worklist.empty()) {
+        PendingBody pending = std::move(worklist.back());
+        worklist.pop_back();
+
+        std::vector<const CallExpr*> calls;
+        collectCalls(pending.body, calls);
+        for (const CallExpr* call : calls) {
+            auto id = static_cast<const Identifier*>(call->callee.get());
+            std::string key = mangleFunctionName(id->name, call->args.size());
+            auto fit = functions.find(key);
+            if (fit == functions.end() || ambiguous.count(key)) continue;
+            const FunctionDecl* func = fit->second;
+            if (std::find(pending.cloned_from.begin(), pending.cloned_from.end(), func) !=
+                pending.cloned_from.end()) continue;
+            
+            // Don't spend code size on functions the profile never saw called
+            const ProfileCounts* calls_seen = profileCounts(ProfileSiteKind::FUNCTION, func->line, func->column);
+            if (calls_seen && calls_seen->count == 0) continue;
+
+            // Constant arguments bound to unmodified int parameters that drive a branch
+            std::vector<std::pair<size_t, int32_t>> consts;
+            for (size_t i = 0; i < call->args.size(); i++) {
+                const auto& param = func->params[i];
+                int32_t value;
+                if (param.second.empty() || isFloatType(param.first)) continue;
+                if (std::find(param.first.begin(), param.first.end(), "*") != param.first.end() ||
+                    std::find(param.first.begin(), param.first.end(), "&") != param.first.end() ||
+                    std::find(param.first.begin(), param.first.end(), "[]") != param.first.end()) continue;
+                if (!evaluateConstant(call->args[i].get(), value)) continue;
+                if (isModified(func->body.get(), param.second)) continue;
+                if (!isUsedInCondition(func->body.get(), param.second)) continue;
+                consts.push_back({i, value});
+            }
+            if (consts.empty()) continue;
+
+            std::string clone_name = key;
+            for (const auto& c : consts) {
+                clone_name += "_K" + std::to_string(c.first) + "_" +
+                              (c.second < 0 ? "m" + std::to_string(-static_cast<int64_t>(c.second))
+                                            : std::to_string(c.second));
+            }
+
+            SpecializedCall target;
+            target.name = clone_name;
+            for (size_t i = 0, c = 0; i < call->args.size(); i++) {
+                if (c < consts.size() && consts[c].first == i) { c++; continue; }
+                target.kept_args.push_back(i);
+            }
+
+            if (clone_index.count(clone_name)) {
+                specialized_calls[call] = target;
+                continue;
+            }
+            if (clone_counts[func] >= kMaxSpecializationsPerFunction) continue;
+
+            ASTNodePtr clone = cloneNode(func);
+            auto clone_func = static_cast<FunctionDecl*>(clone.get());
+            for (auto c = consts.rbegin(); c != consts.rend(); ++c) {
+                substituteIdentifier(clone_func->body, func->params[c->first].second, c->second);
+                clone_func->params.erase(clone_func->params.begin() + c->first);
+            }
+            while (foldConstants(clone_func->body) | eliminateDeadBranches(clone_func->body)) {}
+
+            size_t size = countNodes(clone.get());
+            if (size > budget) continue;
+            budget -= size;
+            clone_counts[func]++;
+
+            clone_index[clone_name] = specialized_functions.size();
+            specialized_calls[call] = target;
+            PendingBody clone_body{clone_func->body.get(), pending.cloned_from};
+            clone_body.cloned_from.push_back(func);
+            worklist.push_back(std::move(clone_body));
+            specialized_functions.push_back({clone_name, std::move(clone)});
+        }
+    }
+}
+
+// Label a call resolves to, taking specialization into account
+std::string CodeGenerator::callTargetName(const CallExpr* call) const {
+    auto spec = specialized_calls.find(call);
+    if (spec != specialized_calls.end()) return spec->second.name;
+    auto id = static_cast<const Identifier*>(call->callee.get());
+    return mangleFunctionName(id->name, call->args.size());
+}
+
+// Label a call resolves to, instantiating a function template if needed
+std::string CodeGenerator::resolveCall(const CallExpr* call) {
+    if (isTemplateCall(call)) return instantiateFunctionTemplate(call);
+    return callTargetName(call);
+}
+
+// Calls to a function template; a plain function of the same name and arity
+// wins unless template arguments are given explicitly
+bool CodeGenerator::isTemplateCall(const CallExpr* call) const {
+    if (!call->callee || call->callee->kind != ASTNodeKind::IDENTIFIER) return false;
+    auto id = static_cast<const Identifier*>(call->callee.get());
+    if (!function_templates.count(id->name)) return false;
+    return !call->templateArgs.empty() || !signatures.count(mangleFunctionName(id->name, call->args.size()));
+}
+
+std::string CodeGenerator::instantiateFunctionTemplate(const CallExpr* call) {
+    auto known = template_calls.find(call);
+    if (known != template_calls.end()) return known->second;
+
+    auto id = static_cast<const Identifier*>(call->callee.get());
+    const TemplateDecl* tmpl = function_templates.at(id->name);
+    auto func = static_cast<const FunctionDecl*>(tmpl->declaration.get());
+
+    // Explicit arguments first, then deduce the rest from int/float call arguments
+    TemplateBindings bindings;
+    for (size_t i = 0; i < call->templateArgs.size() && i < tmpl->params.size(); i++) {
+        bindings[tmpl->params[i]] = call->templateArgs[i];
+    }
+    for (size_t i = 0; i < func->params.size() && i < call->args.size(); i++) {
+        for (const auto& token : func->params[i].first) {
+            if (std::find(tmpl->params.begin(), tmpl->params.end(), token) != tmpl->params.end() &&
+                !bindings.count(token)) {
+                bindings[token] = {isFloatExpr(call->args[i].get()) ? "float" : "int"};
+            }
+        }
+    }
+
+    std::string suffix = "_T";
+    for (const auto& param : tmpl->params) {
+        auto& arg = bindings[param];
+        if (arg.empty()) {
+            std::cerr << "Warning: Could not deduce template argument '" << param << "' of '"
+                      << id->name << "', using int\n";
+            arg = {"int"};
+        }
+        int32_t value;
+        Literal literal(arg[0], 0, 0);
+        if (arg.size() == 1 && evaluateConstant(&literal, value)) {
+            suffix += value < 0 ? "m" + std::to_string(-static_cast<int64_t>(value)) : std::to_string(value);
+        } else {
+            suffix += mangleTypeName(arg);
+        }
+    }
+
+    ASTNodePtr clone = cloneNode(func);
+    auto instance = static_cast<FunctionDecl*>(clone.get());
+    substituteTypeNames(instance, bindings);
+    // Non-type parameters become constants (fixed array sizes, loop bounds)
+    for (const auto& param : tmpl->params) {
+        int32_t value;
+        Literal literal(bindings[param][0], 0, 0);
+        if (bindings[param].size() == 1 && evaluateConstant(&literal, value)) {
+            substituteIdentifier(instance->body, param, value);
+        }
+    }
+    if (optimize) {
+        while (foldConstants(instance->body) | eliminateDeadBranches(instance->body)) {}
+    }
+
+    std::string label = mangleFunctionName(func->funcName + suffix, instance->params);
+    template_calls[call] = label;
+    if (instantiated_templates.insert(label).second) {
+        declareFunction(instance, label);
+        pending_instances.push_back({label, instance});
+        template_instances.push_back(std::move(clone));
+    }
+    return label;
+}
+
+// Record how a function takes and returns floats (see FunctionSignature)
+void CodeGenerator::declareFunction(const FunctionDecl* func, const std::string& label) {
+    auto isFloatValue = [](const std::vector<std::string>& tokens) {
+        return isFloatType(tokens) && std::find(tokens.begin(), tokens.end(), "*") == tokens.end() &&
+               std::find(tokens.begin(), tokens.end(), "[]") == tokens.end();
+    };
+    FunctionSignature sig;
+    sig.returns_float = isFloatValue(func->returnTypeTokens);
+    for (const auto& param : func->params) {
+        sig.float_param_cells.push_back(isFloatValue(param.first) ? next_memory_addr++ : -1);
+    }
+    signatures[label] = sig;
+}
+
+// Static base address of `sub`'s array if its index provably stays within bounds
+bool CodeGenerator::uncheckedArrayBase(const ArraySubscript* sub, const RangeMap& ranges, int32_t& base) {
+    if (!optimize || !sub->array || sub->array->kind != ASTNodeKind::IDENTIFIER) return false;
+    Symbol* sym = findSymbol(static_cast<const Identifier*>(sub->array.get())->symbol);
+    if (!sym || sym->type != Symbol::VARIABLE || !sym->is_array || sym->is_heap_allocated ||
+        sym->array_size <= 0) return false;
+    bool fits = sym->offset + sym->array_size <= kStaticMemoryCells;
+    if (recording && sym->offset >= recording->data_start) {
+        // Depends on where the function's cells land, which a cache hit rechecks
+        recording->limit_checks.push_back({static_cast<uint32_t>(sym->offset + sym->array_size - recording->data_start), fits});
+    }
+    if (!fits) return false;
+    ValueRange index;
+    if (!evaluateRange(sub->index.get(), ranges, index)) return false;
+    if (index.lo < 0 || index.hi >= sym->array_size) return false;
+    base = sym->offset;
+    return true;
+}
+
+// True if a divisor can never be zero (int or float)
+bool CodeGenerator::isNonZeroDivisor(const ASTNode* node) {
+    if (!optimize || !node) return false;
+    if (node->kind == ASTNodeKind::LITERAL && isFloatExpr(node)) {
+        return std::strtof(static_cast<const Literal*>(node)->value.c_str(), nullptr) != 0.0f;
+    }
+    if (isFloatExpr(node)) return false;
+    ValueRange range;
+    return evaluateRange(node, known_ranges, range) && (range.lo > 0 || range.hi < 0);
+}
+
+// Pick functions for MEMO_ENTER/MEMO_STORE: pure integer functions that
+// (directly or through other pure functions) call themselves. Non-recursive
+// functions are left alone since the cache lookup would cost more than it saves.
+void CodeGenerator::selectMemoizedFunctions(const Program& prog) {
+    std::unordered_map<std::string, std::vector<std::string>> callees;
+    std::unordered_set<std::string> ambiguous;
+    auto consider = [&](const FunctionDecl* func, const std::string& name) {
+        if (callees.count(name)) ambiguous.insert(name);
+        std::vector<const CallExpr*> calls;
+        if (func->params.empty() || func->params.size() > kMaxMemoArgs ||
+            !isPureIntegerFunction(func, calls)) {
+            ambiguous.insert(name);
+            return;
+        }
+        auto& targets = callees[name];
+        for (const CallExpr* call : calls) targets.push_back(callTargetName(call));
+    };
+    for (const auto& node : prog.top) {
+        if (node && node->kind == ASTNodeKind::FUNC_DECL) {
+            auto func = static_cast<const FunctionDecl*>(node.get());
+            if (func->funcName != "main") consider(func, mangleFunctionName(func->funcName, func->params.size()));
+        }
+    }
+    for (const auto& spec : specialized_functions) {
+        consider(static_cast<const FunctionDecl*>(spec.second.get()), spec.first);
+    }
+    for (const auto& name : ambiguous) callees.erase(name);
+
+    // Drop functions that call anything impure until nothing changes
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = callees.begin(); it != callees.end(); ) {
+            bool pure = std::all_of(it->second.begin(), it->second.end(),
+                                    [&](const std::string& t) { return callees.count(t) > 0; });
+            if (pure) {
+                ++it;
+            } else {
+                it = callees.erase(it);
+                changed = true;
+            }
+        }
+    }
+
+    for (const auto& entry : callees) {
+        // Depth-first search for a path back to the function itself
+        std::vector<std::string> pending(entry.second.begin(), entry.second.end());
+        std::unordered_set<std::string> seen;
+        while (!pending.empty()) {
+            std::string name = pending.back();
+            pending.pop_back();
+            if (name == entry.first) {
+                memoized_functions.insert(entry.first);
+                break;
+            }
+            if (!seen.insert(name).second) continue;
+            const auto& next = callees.at(name);
+            pending.insert(pending.end(), next.begin(), next.end());
+        }
+    }
 }
 
 void CodeGenerator::genStatement(const ASTNode* node) {
     if (!node) return;
+    recordLine(node->line);
     
     switch (node->kind) {
         case ASTNodeKind::VAR_DECL:
@@ -86,6 +527,12 @@ void CodeGenerator::genStatement(const ASTNode* node) {
         case ASTNodeKind::RETURN:
             genReturn(static_cast<const ReturnStmt*>(node));
             break;
+        case ASTNodeKind::TRY:
+            genTry(static_cast<const TryStmt*>(node));
+            break;
+        case ASTNodeKind::THROW:
+            genThrow(static_cast<const ThrowStmt*>(node));
+            break;
         case ASTNodeKind::EXPR_STMT: {
             auto expr = static_cast<const ExprStmt*>(node);
             if (expr->expr) {
@@ -134,7 +581,7 @@ void CodeGenerator::genVarDecl(const VarDecl* decl) {
         // Check if initializer is a "new" expression (heap allocation)
         if (decl->init->kind == ASTNodeKind::UNARY_OP) {
             auto unop = static_cast<const UnaryOp*>(decl->init.get());
-            if (unop->op == "new") {
+            if (unop->opKind == OpKind::NEW) {
                 is_heap_array = true;
             }
         }
@@ -145,9 +592,18 @@ void CodeGenerator::genVarDecl(const VarDecl* decl) {
     // Detect float/double variable type (non-pointer, non-array)
     bool is_float_var = !is_pointer && !is_array && isFloatType(decl->typeTokens);
     
+    // Fixed-size arrays get one cell per element
+    int32_t array_size = 0;
+    if (decl->isArray && !is_heap_array &&
+        !(evaluateConstant(decl->arraySize.get(), array_size) && array_size > 0)) {
+        array_size = 0;
+    }
+    
     // Allocate memory address for this variable
-    int addr = next_memory_addr++;
+    int addr = next_memory_addr;
+    next_memory_addr += array_size > 0 ? array_size : 1;
     addVariable(decl->varName, addr, is_array, is_heap_array, is_float_var);
+    symbols[internSymbol(decl->varName)].array_size = array_size;
     
     // If there's an initializer, evaluate it and store
     if (decl->init) {
@@ -158,11 +614,11 @@ void CodeGenerator::genVarDecl(const VarDecl* decl) {
                 emit(Opcode::INT_TO_FP);
             }
             emit(Opcode::FSTORE);
-            emitInt32(addr);
+            emitAddress(addr);
         } else {
             genExpression(decl->init.get());
             emit(Opcode::PUSH);
-            emitInt32(addr);
+            emitAddress(addr);
             emit(Opcode::STORE);
         }
     }
@@ -175,19 +631,55 @@ void CodeGenerator::genFunctionDecl(const FunctionDecl* func) {
 }
 
 void CodeGenerator::genFunctionDecl(const FunctionDecl* func, const std::string& nameOverride) {
+    // Prototypes only declare the signature; the definition may be in another object
+    if (!func->body) return;
     // Define function label
     // DEBUG: // std::cerr << "DBG genFunctionDecl: defining label '" << nameOverride 
 // DEBUG_CONT:               << "' at address " << currentAddress() << std::endl;
-    defineLabel(nameOverride);
+    size_t start = currentAddress();
+    defineLabel(functionLabel(nameOverride));
+    addProfileSite(ProfileSiteKind::FUNCTION, func, start);
+    recordLine(func->line);
+    
+    bool record = false;
+    if (!recording && cacheable_functions.count(func) && func->tokenEnd > func->tokenBegin &&
+        func->tokenEnd <= source_tokens->size()) {
+        uint64_t key = functionKey(func, nameOverride);
+        if (replayFunction(key, func)) {
+            function_ranges.push_back({start, currentAddress(), func->line, func->column});
+            return;
+        }
+        recording = std::make_unique<FunctionRecording>();
+        recording->key = key;
+        recording->start = currentAddress();
+        recording->first_label = static_cast<int>(labels.size());
+        recording->data_start = next_memory_addr;
+        recording->data_operands = data_operands.size();
+        recording->string_operands = string_operands.size();
+        recording->profile_sites = profile_sites.size();
+        recording->try_regions = try_regions.size();
+        recording->signatures = signatures.size();
+        recording->pending_instances = pending_instances.size();
+        recording->instantiated_templates = instantiated_templates.size();
+        record = true;
+    }
     
     // Function prologue
     emit(Opcode::PUSH_BP);
+    current_function_memoized = memoized_functions.count(nameOverride) > 0;
+    if (current_function_memoized) {
+        emit(Opcode::MEMO_ENTER);
+        emitInt32(static_cast<int32_t>(func->params.size()));
+    }
     
     // Parameters are on stack below saved BP
     // After PUSH_BP, stack layout:
     // [... caller stuff, arg1, arg2, saved_BP] <- BP points here
     // So: BP-1 = saved_BP, BP-2 = arg2, BP-3 = arg1
     // Parameters need negative offsets relative to BP
+    auto sig = signatures.find(nameOverride);
+    current_function_returns_float = sig != signatures.end() && sig->second.returns_float;
+    current_float_param_cells.clear();
     int param_count = func->params.size();
     for (int i = 0; i < param_count; i++) {
         // First param is at BP-(param_count+1), last param at BP-2
@@ -207,7 +699,16 @@ void CodeGenerator::genFunctionDecl(const FunctionDecl* func, const std::string&
         sym.type = Symbol::PARAMETER;
         sym.offset = offset;
         sym.is_array = is_pointer;  // Pointers and arrays treated same
-        symbols[func->params[i].second] = sym;
+        if (sig != signatures.end() && sig->second.float_param_cells[i] >= 0) {
+            // Float parameters live in their own cell, the stack slot is a placeholder
+            sym.type = Symbol::VARIABLE;
+            sym.offset = sig->second.float_param_cells[i];
+            sym.is_float = true;
+            current_float_param_cells.push_back(sym.offset);
+        }
+        SymbolId id = internSymbol(func->params[i].second);
+        symbols[id] = sym;
+        noteSymbolDefinition(id);
         
         // DEBUG: // std::cerr << "DBG addParam: '" << func->params[i].second 
 // DEBUG_CONT:                   << "' offset=" << offset << " is_array=" << is_pointer << std::endl;
@@ -218,9 +719,27 @@ void CodeGenerator::genFunctionDecl(const FunctionDecl* func, const std::string&
         genStatement(func->body.get());
     }
     
-    // Function epilogue (if no explicit return)
+    // Function epilogue (if no explicit return); every call leaves one result
+    if (current_function_returns_float) {
+        emit(Opcode::FPUSH);
+        emitFloat32(0.0f);
+    }
+    emit(Opcode::PUSH);
+    emitInt32(0);
+    if (current_function_memoized) {
+        emit(Opcode::MEMO_STORE);
+    }
     emit(Opcode::POP_BP);
     emit(Opcode::RET);
+    genPendingHandlers();
+    current_function_memoized = false;
+    current_function_returns_float = false;
+    current_float_param_cells.clear();
+    function_ranges.push_back({start, currentAddress(), func->line, func->column});
+    if (record) {
+        storeFunction(func);
+        recording.reset();
+    }
 }
 
 void CodeGenerator::genBlock(const BlockStmt* block) {
@@ -230,13 +749,28 @@ void CodeGenerator::genBlock(const BlockStmt* block) {
 }
 
 void CodeGenerator::genIf(const IfStmt* ifstmt) {
-    std::string else_label = makeLabel("else");
-    std::string end_label = makeLabel("endif");
+    int else_label = makeLabel();
+    int end_label = makeLabel();
     
     // Evaluate condition
     genExpression(ifstmt->cond.get());
     
+    const ProfileCounts* counts = profileCounts(ProfileSiteKind::BRANCH, ifstmt->line, ifstmt->column);
+    if (ifstmt->elseBranch && counts && counts->false_count > counts->count) {
+        // The profile favours the else branch: make it the fall-through path
+        int then_label = makeLabel();
+        addProfileSite(ProfileSiteKind::BRANCH, ifstmt, currentAddress());
+        emitJump(Opcode::JNZ, then_label);
+        genStatement(ifstmt->elseBranch.get());
+        emitJump(Opcode::JMP, end_label);
+        defineLabel(then_label);
+        genStatement(ifstmt->thenBranch.get());
+        defineLabel(end_label);
+        return;
+    }
+    
     // Jump to else if condition is zero (false)
+    addProfileSite(ProfileSiteKind::BRANCH, ifstmt, currentAddress());
     emitJump(Opcode::JZ, else_label);
     
     // Then branch
@@ -253,8 +787,22 @@ void CodeGenerator::genIf(const IfStmt* ifstmt) {
 }
 
 void CodeGenerator::genWhile(const WhileStmt* whilestmt) {
-    std::string loop_start = makeLabel("while_start");
-    std::string loop_end = makeLabel("while_end");
+    int loop_start = makeLabel();
+    int loop_end = makeLabel();
+    
+    const ProfileCounts* counts = profileCounts(ProfileSiteKind::LOOP, whilestmt->line, whilestmt->column);
+    if (counts && counts->count > counts->false_count) {
+        // Hot loop: test at the bottom so an iteration takes one jump instead of two
+        int loop_cond = makeLabel();
+        emitJump(Opcode::JMP, loop_cond);
+        defineLabel(loop_start);
+        genStatement(whilestmt->body.get());
+        defineLabel(loop_cond);
+        genExpression(whilestmt->cond.get());
+        addProfileSite(ProfileSiteKind::LOOP, whilestmt, currentAddress());
+        emitJump(Opcode::JNZ, loop_start);
+        return;
+    }
     
     defineLabel(loop_start);
     
@@ -262,6 +810,7 @@ void CodeGenerator::genWhile(const WhileStmt* whilestmt) {
     genExpression(whilestmt->cond.get());
     
     // Exit loop if condition is false
+    addProfileSite(ProfileSiteKind::LOOP, whilestmt, currentAddress());
     emitJump(Opcode::JZ, loop_end);
     
     // Loop body
@@ -274,24 +823,54 @@ void CodeGenerator::genWhile(const WhileStmt* whilestmt) {
 }
 
 void CodeGenerator::genFor(const ForStmt* forstmt) {
-    std::string loop_start = makeLabel("for_start");
-    std::string loop_end = makeLabel("for_end");
+    int loop_start = makeLabel();
+    int loop_end = makeLabel();
+    int loop_cond = makeLabel();
     
     // Initialization
     if (forstmt->init) {
         genStatement(forstmt->init.get());
     }
     
+    // Hot loops (per profile) test at the bottom so an iteration takes one jump instead of two
+    const ProfileCounts* counts = profileCounts(ProfileSiteKind::LOOP, forstmt->line, forstmt->column);
+    bool rotated = forstmt->cond && counts && counts->count > counts->false_count;
+    if (rotated) {
+        emitJump(Opcode::JMP, loop_cond);
+    }
+    
     defineLabel(loop_start);
     
     // Condition
-    if (forstmt->cond) {
+    if (forstmt->cond && !rotated) {
         genExpression(forstmt->cond.get());
+        addProfileSite(ProfileSiteKind::LOOP, forstmt, currentAddress());
         emitJump(Opcode::JZ, loop_end);
     }
     
-    // Body
+    // Body: if the induction variable provably stays in range, the body may use
+    // unchecked indexing and division based on it
+    std::string var;
+    ValueRange range;
+    RangeMap saved_ranges;
+    bool proven = false;
+    if (optimize && inductionVariableRange(forstmt, var, range.lo, range.hi)) {
+        RangeMap body_ranges = known_ranges;
+        body_ranges[var] = range;
+        proven = preservesRanges(forstmt->body.get(), body_ranges,
+            [this](const ArraySubscript* sub, const RangeMap& ranges) {
+                int32_t base;
+                return uncheckedArrayBase(sub, ranges, base);
+            });
+        if (proven) {
+            saved_ranges = known_ranges;
+            known_ranges = body_ranges;
+        }
+    }
     genStatement(forstmt->body.get());
+    if (proven) {
+        known_ranges = saved_ranges;
+    }
     
     // Post-expression
     if (forstmt->post) {
@@ -300,18 +879,176 @@ void CodeGenerator::genFor(const ForStmt* forstmt) {
         else emit(Opcode::POP); // Discard result
     }
     
-    emitJump(Opcode::JMP, loop_start);
+    if (rotated) {
+        defineLabel(loop_cond);
+        genExpression(forstmt->cond.get());
+        addProfileSite(ProfileSiteKind::LOOP, forstmt, currentAddress());
+        emitJump(Opcode::JNZ, loop_start);
+    } else {
+        emitJump(Opcode::JMP, loop_start);
+    }
     defineLabel(loop_end);
 }
 
 void CodeGenerator::genReturn(const ReturnStmt* ret) {
     if (ret->expr) {
         genExpression(ret->expr.get());
+        bool is_float = isFloatExpr(ret->expr.get());
+        if (current_function_returns_float && !is_float) {
+            emit(Opcode::INT_TO_FP);
+        } else if (!current_function_returns_float && is_float) {
+            emit(Opcode::FP_TO_INT);
+        }
+    } else if (current_function_returns_float) {
+        emit(Opcode::FPUSH);
+        emitFloat32(0.0f);
+    }
+    if (!ret->expr || current_function_returns_float) {
+        // Float results stay on the FPU; the int stack still gets a result slot
+        emit(Opcode::PUSH);
+        emitInt32(0);
+    }
+    if (current_function_memoized) {
+        emit(Opcode::MEMO_STORE);
     }
     emit(Opcode::POP_BP);
     emit(Opcode::RET);
 }
 
+// The try body is emitted inline with nothing around it; only the exception
+// table knows about the region, so the non-throwing path runs no extra code
+void CodeGenerator::genTry(const TryStmt* stmt) {
+    int start = makeLabel();
+    int end = makeLabel();
+    int handler = makeLabel();
+    defineLabel(start);
+    std::vector<int> enclosing = active_try_handlers;
+    active_try_handlers.push_back(handler);
+    genStatement(stmt->body.get());
+    active_try_handlers.pop_back();
+    defineLabel(end);
+    try_regions.push_back({start, end, handler});  // Inner regions complete first
+    pending_handlers.push_back({stmt, handler, end, enclosing});
+}
+
+void CodeGenerator::genThrow(const ThrowStmt* stmt) {
+    if (!stmt->expr) {
+        // Rethrow the exception being handled
+        if (active_exceptions.empty()) {
+            std::cerr << "Warning: 'throw;' outside a catch handler\n";
+            emit(Opcode::PUSH);
+            emitInt32(0);
+            emit(Opcode::PUSH);
+            emitInt32(kExceptionInt);
+        } else {
+            emit(Opcode::LOAD);
+            emitAddress(active_exceptions.back().first);
+            emit(Opcode::LOAD);
+            emitAddress(active_exceptions.back().second);
+        }
+        emit(Opcode::THROW);
+        return;
+    }
+    genExpression(stmt->expr.get());
+    if (isFloatExpr(stmt->expr.get())) {
+        emit(Opcode::FP_TO_INT);
+    }
+    bool is_string = stmt->expr->kind == ASTNodeKind::LITERAL &&
+                     static_cast<const Literal*>(stmt->expr.get())->litType == TokenType::STRING;
+    emit(Opcode::PUSH);
+    emitInt32(is_string ? kExceptionString : kExceptionInt);
+    emit(Opcode::THROW);
+}
+
+// Landing pads of the try statements seen so far. The unwinder enters with the
+// value and type tag on the stack; clauses are tried in order and an unmatched
+// exception is thrown on to the next enclosing region. Since handlers are out of
+// line, their code gets regions of its own for the try bodies around the original.
+void CodeGenerator::genPendingHandlers() {
+    for (size_t i = 0; i < pending_handlers.size(); i++) {
+        PendingHandler pending = pending_handlers[i];  // Nested tries may add handlers
+        std::vector<int> saved_handlers = active_try_handlers;
+        active_try_handlers = pending.enclosing;
+        defineLabel(pending.handler);
+        int value_cell = next_memory_addr++;
+        int tag_cell = next_memory_addr++;
+        emit(Opcode::PUSH);
+        emitAddress(tag_cell);
+        emit(Opcode::STORE);
+        emit(Opcode::PUSH);
+        emitAddress(value_cell);
+        emit(Opcode::STORE);
+        active_exceptions.push_back({value_cell, tag_cell});
+        
+        bool caught_all = false;
+        for (const auto& clause : pending.stmt->handlers) {
+            int next = makeLabel();
+            const auto& type = clause.typeTokens;
+            if (!type.empty()) {
+                bool is_string = std::find(type.begin(), type.end(), "string") != type.end() ||
+                                 std::find(type.begin(), type.end(), "std::string") != type.end() ||
+                                 (std::find(type.begin(), type.end(), "char") != type.end() &&
+                                  std::find(type.begin(), type.end(), "*") != type.end());
+                emit(Opcode::LOAD);
+                emitAddress(tag_cell);
+                emit(Opcode::PUSH);
+                emitInt32(is_string ? kExceptionString : kExceptionInt);
+                emit(Opcode::SUB);
+                emitJump(Opcode::JNZ, next);
+            }
+            if (!clause.varName.empty()) {
+                int addr = next_memory_addr++;
+                bool is_float = isFloatType(type);
+                addVariable(clause.varName, addr, false, false, is_float);
+                emit(Opcode::LOAD);
+                emitAddress(value_cell);
+                if (is_float) {
+                    emit(Opcode::INT_TO_FP);
+                    emit(Opcode::FSTORE);
+                    emitAddress(addr);
+                } else {
+                    emit(Opcode::PUSH);
+                    emitAddress(addr);
+                    emit(Opcode::STORE);
+                }
+            }
+            genStatement(clause.body.get());
+            emitJump(Opcode::JMP, pending.resume);
+            defineLabel(next);
+            if (type.empty()) {
+                caught_all = true;
+                break;
+            }
+        }
+        if (!caught_all) {
+            emit(Opcode::LOAD);
+            emitAddress(value_cell);
+            emit(Opcode::LOAD);
+            emitAddress(tag_cell);
+            emit(Opcode::THROW);
+        }
+        active_exceptions.pop_back();
+        active_try_handlers = saved_handlers;
+        
+        int end = makeLabel();
+        defineLabel(end);
+        for (auto outer = pending.enclosing.rbegin(); outer != pending.enclosing.rend(); ++outer) {
+            try_regions.push_back({pending.handler, end, *outer});
+        }
+    }
+    pending_handlers.clear();
+}
+
+std::vector<ExceptionRegion> CodeGenerator::exceptionTable() const {
+    std::vector<ExceptionRegion> table;
+    for (const auto& region : try_regions) {
+        table.push_back({static_cast<uint32_t>(labels[region.start].address),
+                         static_cast<uint32_t>(labels[region.end].address),
+                         static_cast<uint32_t>(labels[region.handler].address)});
+    }
+    return table;
+}
+
 void CodeGenerator::genExpression(const ASTNode* node) {
     if (!node) return;
     
@@ -352,11 +1089,11 @@ void CodeGenerator::genExpression(const ASTNode* node) {
 
 void CodeGenerator::genBinaryOp(const BinaryOp* binop) {
     // Special handling for assignment
-    if (binop->op == "=") {
+    if (binop->opKind == OpKind::ASSIGN) {
         // Handle pointer dereference assignment: *ptr = value
         if (binop->left->kind == ASTNodeKind::UNARY_OP) {
             auto unop = static_cast<const UnaryOp*>(binop->left.get());
-            if (unop->op == "*") {
+            if (unop->opKind == OpKind::STAR) {
                 // Dereference on left side of assignment
                 // Evaluate right side first
                 genExpression(binop->right.get());
@@ -379,10 +1116,19 @@ void CodeGenerator::genBinaryOp(const BinaryOp* binop) {
             genExpression(binop->right.get());
             emit(Opcode::DUP); // Keep value for result
             
+            int32_t base;
+            if (uncheckedArrayBase(sub, known_ranges, base)) {
+                // Index proven within a static array: Stack: [value, value, index]
+                genExpression(sub->index.get());
+                emit(Opcode::STORE_IDX_NOCHECK);
+                emitAddress(base);
+                return;
+            }
+            
             // Calculate array element address
             if (sub->array->kind == ASTNodeKind::IDENTIFIER) {
                 auto id = static_cast<const Identifier*>(sub->array.get());
-                auto sym = findSymbol(id->name);
+                auto sym = findSymbol(id->symbol);
                 
                 if (sym) {
                     // Push base address
@@ -392,14 +1138,14 @@ void CodeGenerator::genBinaryOp(const BinaryOp* binop) {
                     } else if (sym->type == Symbol::VARIABLE && sym->is_heap_allocated) {
                         // Heap arrays: load the heap pointer
                         emit(Opcode::LOAD);
-                        emitInt32(sym->offset);
+                        emitAddress(sym->offset);
                     } else if (sym->type == Symbol::VARIABLE && sym->is_array) {
                         // Stack arrays: use the stack address
                         emit(Opcode::PUSH);
-                        emitInt32(sym->offset);
+                        emitAddress(sym->offset);
                     } else {
                         emit(Opcode::PUSH);
-                        emitInt32(sym->offset);
+                        emitAddress(sym->offset);
                     }
                     genExpression(sub->index.get());
                     emit(Opcode::ADD);
@@ -414,7 +1160,7 @@ void CodeGenerator::genBinaryOp(const BinaryOp* binop) {
         // Left side must be identifier
         if (binop->left->kind == ASTNodeKind::IDENTIFIER) {
             auto id = static_cast<const Identifier*>(binop->left.get());
-            auto sym = findSymbol(id->name);
+            auto sym = findSymbol(id->symbol);
             
             // Evaluate right side - leaves value on stack
             genExpression(binop->right.get());
@@ -427,7 +1173,7 @@ void CodeGenerator::genBinaryOp(const BinaryOp* binop) {
                     }
                     emit(Opcode::FDUP);              // keep copy for expression result
                     emit(Opcode::FSTORE);
-                    emitInt32(sym->offset);
+                    emitAddress(sym->offset);
                 } else if (sym->type == Symbol::PARAMETER) {
                     // Parameters use BP-relative addressing
                     emit(Opcode::DUP); // Keep value for expression result
@@ -438,7 +1184,7 @@ void CodeGenerator::genBinaryOp(const BinaryOp* binop) {
                     // Stack: [value]
                     emit(Opcode::DUP); // Stack: [value, value]
                     emit(Opcode::PUSH);
-                    emitInt32(sym->offset); // Stack: [value, value, addr]
+                    emitAddress(sym->offset); // Stack: [value, value, addr]
                     emit(Opcode::STORE);
                 }
             }
@@ -447,7 +1193,7 @@ void CodeGenerator::genBinaryOp(const BinaryOp* binop) {
     }
     
     // Handle << operator (stream output operator)
-    if (binop->op == "<<") {
+    if (binop->opKind == OpKind::SHL) {
         // Special-case: chained cout << a << b << endl
         // If left is identifier std::cout or a chain starting from it, handle print
         const ASTNode* cur = binop;
@@ -473,7 +1219,7 @@ void CodeGenerator::genBinaryOp(const BinaryOp* binop) {
                 if (lit->litType == TokenType::STRING) {
                     int str_id = addString(lit->value);
                     emit(Opcode::PUSH_STR);
-                    emitInt32(str_id);
+                    emitStringId(str_id);
                     emit(Opcode::PRINT_STR);
                 } else {
                     genExpression(binop->right.get());
@@ -497,7 +1243,7 @@ void CodeGenerator::genBinaryOp(const BinaryOp* binop) {
             if (lit->litType == TokenType::STRING) {
                 int str_id = addString(lit->value);
                 emit(Opcode::PUSH_STR);
-                emitInt32(str_id);
+                emitStringId(str_id);
                 emit(Opcode::PRINT_STR);
                 emit(Opcode::PUSH);
                 emitInt32(0);
@@ -513,14 +1259,14 @@ void CodeGenerator::genBinaryOp(const BinaryOp* binop) {
     }
     
     // Handle >> operator (stream input operator) 
-    if (binop->op == ">>") {
+    if (binop->opKind == OpKind::SHR) {
         // For cin >> variable: input to right side variable
         emit(Opcode::INPUT);
         
         // Store to variable if right is identifier
         if (binop->right->kind == ASTNodeKind::IDENTIFIER) {
             auto id = static_cast<const Identifier*>(binop->right.get());
-            auto sym = findSymbol(id->name);
+            auto sym = findSymbol(id->symbol);
             if (sym) {
                 if (sym->type == Symbol::PARAMETER) {
                     // Parameters use BP-relative addressing
@@ -529,7 +1275,7 @@ void CodeGenerator::genBinaryOp(const BinaryOp* binop) {
                 } else {
                     // Variables use absolute addressing
                     emit(Opcode::PUSH);
-                    emitInt32(sym->offset);
+                    emitAddress(sym->offset);
                     emit(Opcode::STORE);
                 }
             }
@@ -538,7 +1284,7 @@ void CodeGenerator::genBinaryOp(const BinaryOp* binop) {
             auto sub = static_cast<const ArraySubscript*>(binop->right.get());
             if (sub->array->kind == ASTNodeKind::IDENTIFIER) {
                 auto id = static_cast<const Identifier*>(sub->array.get());
-                auto sym = findSymbol(id->name);
+                auto sym = findSymbol(id->symbol);
                 
                 if (sym) {
                     // Push base address
@@ -547,13 +1293,13 @@ void CodeGenerator::genBinaryOp(const BinaryOp* binop) {
                         emitInt32(sym->offset);
                     } else if (sym->type == Symbol::VARIABLE && sym->is_heap_allocated) {
                         emit(Opcode::LOAD);
-                        emitInt32(sym->offset);
+                        emitAddress(sym->offset);
                     } else if (sym->type == Symbol::VARIABLE && sym->is_array) {
                         emit(Opcode::PUSH);
-                        emitInt32(sym->offset);
+                        emitAddress(sym->offset);
                     } else {
                         emit(Opcode::PUSH);
-                        emitInt32(sym->offset);
+                        emitAddress(sym->offset);
                     }
                     
                     // Push index and add to get element address
@@ -579,50 +1325,50 @@ void CodeGenerator::genBinaryOp(const BinaryOp* binop) {
     bool rightIsFloat = isFloatExpr(binop->right.get());
     bool eitherFloat = leftIsFloat || rightIsFloat;
     
-    if (eitherFloat && (binop->op == "+" || binop->op == "-" ||
-                        binop->op == "*" || binop->op == "/")) {
+    if (eitherFloat && (binop->opKind == OpKind::PLUS || binop->opKind == OpKind::MINUS ||
+                        binop->opKind == OpKind::STAR || binop->opKind == OpKind::SLASH)) {
         genExpression(binop->left.get());
         if (!leftIsFloat) emit(Opcode::INT_TO_FP);
         genExpression(binop->right.get());
         if (!rightIsFloat) emit(Opcode::INT_TO_FP);
-        if (binop->op == "+") emit(Opcode::FADD);
-        else if (binop->op == "-") emit(Opcode::FSUB);
-        else if (binop->op == "*") emit(Opcode::FMUL);
-        else emit(Opcode::FDIV);
+        if (binop->opKind == OpKind::PLUS) emit(Opcode::FADD);
+        else if (binop->opKind == OpKind::MINUS) emit(Opcode::FSUB);
+        else if (binop->opKind == OpKind::STAR) emit(Opcode::FMUL);
+        else emit(isNonZeroDivisor(binop->right.get()) ? Opcode::FDIV_NOCHECK : Opcode::FDIV);
         return;
     }
     
     // --- Float comparisons (result is int 0/1 on int stack) ---
-    if (eitherFloat && (binop->op == "<"  || binop->op == ">" ||
-                        binop->op == "<=" || binop->op == ">=" ||
-                        binop->op == "==" || binop->op == "!=")) {
+    if (eitherFloat && (binop->opKind == OpKind::LESS  || binop->opKind == OpKind::GREATER ||
+                        binop->opKind == OpKind::LESS_EQUAL || binop->opKind == OpKind::GREATER_EQUAL ||
+                        binop->opKind == OpKind::EQUAL || binop->opKind == OpKind::NOT_EQUAL)) {
         genExpression(binop->left.get());
         if (!leftIsFloat) emit(Opcode::INT_TO_FP);
         genExpression(binop->right.get());
         if (!rightIsFloat) emit(Opcode::INT_TO_FP);
         
-        std::string true_label = makeLabel("fcmp_true");
-        std::string end_label  = makeLabel("fcmp_end");
+        int true_label = makeLabel();
+        int end_label = makeLabel();
         
-        if (binop->op == "==" || binop->op == "!=") {
+        if (binop->opKind == OpKind::EQUAL || binop->opKind == OpKind::NOT_EQUAL) {
             // Use FSUB + FP_TO_INT + JZ
             emit(Opcode::FSUB);
             emit(Opcode::FP_TO_INT);
             emit(Opcode::DUP);
             emitJump(Opcode::JZ, true_label);
             emit(Opcode::POP);
-            emit(Opcode::PUSH); emitInt32(binop->op == "==" ? 0 : 1);
+            emit(Opcode::PUSH); emitInt32(binop->opKind == OpKind::EQUAL ? 0 : 1);
             emitJump(Opcode::JMP, end_label);
             defineLabel(true_label);
             emit(Opcode::POP);
-            emit(Opcode::PUSH); emitInt32(binop->op == "==" ? 1 : 0);
+            emit(Opcode::PUSH); emitInt32(binop->opKind == OpKind::EQUAL ? 1 : 0);
             defineLabel(end_label);
         } else {
             // Use FCMP (sets cmp_flag) + conditional jump
             emit(Opcode::FCMP);
-            Opcode jmpOp = (binop->op == "<")  ? Opcode::JL  :
-                           (binop->op == ">")  ? Opcode::JG  :
-                           (binop->op == "<=") ? Opcode::JLE : Opcode::JGE;
+            Opcode jmpOp = (binop->opKind == OpKind::LESS)  ? Opcode::JL  :
+                           (binop->opKind == OpKind::GREATER)  ? Opcode::JG  :
+                           (binop->opKind == OpKind::LESS_EQUAL) ? Opcode::JLE : Opcode::JGE;
             emitJump(jmpOp, true_label);
             emit(Opcode::PUSH); emitInt32(0);
             emitJump(Opcode::JMP, end_label);
@@ -636,205 +1382,168 @@ void CodeGenerator::genBinaryOp(const BinaryOp* binop) {
     genExpression(binop->left.get());
     genExpression(binop->right.get());
     
-    if (binop->op == "+") {
-        emit(Opcode::ADD);
-    } else if (binop->op == "-") {
-        emit(Opcode::SUB);
-    } else if (binop->op == "*") {
-        emit(Opcode::MUL);
-    } else if (binop->op == "/") {
-        emit(Opcode::DIV);
-    } else if (binop->op == "%") {
-        emit(Opcode::MOD);
-    } else if (binop->op == "<") {
-        emit(Opcode::CMP);
-        std::string true_label = makeLabel("cmp_true");
-        std::string end_label = makeLabel("cmp_end");
-        emitJump(Opcode::JL, true_label);
-        emit(Opcode::PUSH);
-        emitInt32(0);
-        emitJump(Opcode::JMP, end_label);
-        defineLabel(true_label);
-        emit(Opcode::PUSH);
-        emitInt32(1);
-        defineLabel(end_label);
-    } else if (binop->op == ">") {
-        emit(Opcode::CMP);
-        std::string true_label = makeLabel("cmp_true");
-        std::string end_label = makeLabel("cmp_end");
-        emitJump(Opcode::JG, true_label);
-        emit(Opcode::PUSH);
-        emitInt32(0);
-        emitJump(Opcode::JMP, end_label);
-        defineLabel(true_label);
-        emit(Opcode::PUSH);
-        emitInt32(1);
-        defineLabel(end_label);
-    } else if (binop->op == "<=") {
-        emit(Opcode::CMP);
-        std::string true_label = makeLabel("cmp_true");
-        std::string end_label = makeLabel("cmp_end");
-        emitJump(Opcode::JLE, true_label);
-        emit(Opcode::PUSH);
-        emitInt32(0);
-        emitJump(Opcode::JMP, end_label);
-        defineLabel(true_label);
-        emit(Opcode::PUSH);
-        emitInt32(1);
-        defineLabel(end_label);
-    } else if (binop->op == ">=") {
-        emit(Opcode::CMP);
-        std::string true_label = makeLabel("cmp_true");
-        std::string end_label = makeLabel("cmp_end");
-        emitJump(Opcode::JGE, true_label);
-        emit(Opcode::PUSH);
-        emitInt32(0);
-        emitJump(Opcode::JMP, end_label);
-        defineLabel(true_label);
-        emit(Opcode::PUSH);
-        emitInt32(1);
-        defineLabel(end_label);
-    } else if (binop->op == "==") {
-        // For equality, we need cmp_flag == 0
-        // Use SUB and check if result is 0
-        emit(Opcode::SUB);
-        std::string true_label = makeLabel("cmp_true");
-        std::string end_label = makeLabel("cmp_end");
-        emit(Opcode::DUP);  // Duplicate result
-        emitJump(Opcode::JZ, true_label);  // Jump if zero (equal)
-        emit(Opcode::POP);  // Pop the duplicate
-        emit(Opcode::PUSH);
-        emitInt32(0);
-        emitJump(Opcode::JMP, end_label);
-        defineLabel(true_label);
-        emit(Opcode::POP);  // Pop the duplicate
-        emit(Opcode::PUSH);
-        emitInt32(1);
-        defineLabel(end_label);
-    } else if (binop->op == "!=") {
-        // For inequality, result != 0
-        emit(Opcode::SUB);
-        std::string true_label = makeLabel("cmp_true");
-        std::string end_label = makeLabel("cmp_end");
-        emit(Opcode::DUP);
-        emitJump(Opcode::JZ, true_label);  // Jump if zero (equal -> false for !=)
-        emit(Opcode::POP);
-        emit(Opcode::PUSH);
-        emitInt32(1);  // Not equal -> true
-        emitJump(Opcode::JMP, end_label);
-        defineLabel(true_label);
-        emit(Opcode::POP);
-        emit(Opcode::PUSH);
-        emitInt32(0);  // Equal -> false
-        defineLabel(end_label);
-    } else {
-        // Unknown operator - just evaluate operands and push 0
-        emit(Opcode::POP);
-        emit(Opcode::POP);
-        emit(Opcode::PUSH);
-        emitInt32(0);
+    switch (binop->opKind) {
+        case OpKind::PLUS:
+            emit(Opcode::ADD);
+            break;
+        case OpKind::MINUS:
+            emit(Opcode::SUB);
+            break;
+        case OpKind::STAR:
+            emit(Opcode::MUL);
+            break;
+        case OpKind::SLASH:
+            emit(isNonZeroDivisor(binop->right.get()) ? Opcode::DIV_NOCHECK : Opcode::DIV);
+            break;
+        case OpKind::PERCENT:
+            emit(isNonZeroDivisor(binop->right.get()) ? Opcode::MOD_NOCHECK : Opcode::MOD);
+            break;
+        case OpKind::LESS:
+        case OpKind::GREATER:
+        case OpKind::LESS_EQUAL:
+        case OpKind::GREATER_EQUAL: {
+            emit(Opcode::CMP);
+            int true_label = makeLabel();
+            int end_label = makeLabel();
+            Opcode jmpOp = (binop->opKind == OpKind::LESS)    ? Opcode::JL  :
+                           (binop->opKind == OpKind::GREATER) ? Opcode::JG  :
+                           (binop->opKind == OpKind::LESS_EQUAL) ? Opcode::JLE : Opcode::JGE;
+            emitJump(jmpOp, true_label);
+            emit(Opcode::PUSH);
+            emitInt32(0);
+            emitJump(Opcode::JMP, end_label);
+            defineLabel(true_label);
+            emit(Opcode::PUSH);
+            emitInt32(1);
+            defineLabel(end_label);
+            break;
+        }
+        case OpKind::EQUAL:
+        case OpKind::NOT_EQUAL: {
+            // Equal when the difference is zero
+            emit(Opcode::SUB);
+            int true_label = makeLabel();
+            int end_label = makeLabel();
+            emit(Opcode::DUP);  // Duplicate result
+            emitJump(Opcode::JZ, true_label);  // Jump if zero (equal)
+            emit(Opcode::POP);  // Pop the duplicate
+            emit(Opcode::PUSH);
+            emitInt32(binop->opKind == OpKind::EQUAL ? 0 : 1);
+            emitJump(Opcode::JMP, end_label);
+            defineLabel(true_label);
+            emit(Opcode::POP);  // Pop the duplicate
+            emit(Opcode::PUSH);
+            emitInt32(binop->opKind == OpKind::EQUAL ? 1 : 0);
+            defineLabel(end_label);
+            break;
+        }
+        default:
+            // Unknown operator - just evaluate operands and push 0
+            emit(Opcode::POP);
+            emit(Opcode::POP);
+            emit(Opcode::PUSH);
+            emitInt32(0);
+            break;
     }
 }
 
 void CodeGenerator::genUnaryOp(const UnaryOp* unop) {
-    if (unop->op == "new") {
-        // new operator: allocate heap memory
-        // Operand should be a type or size expression
-        // For "new int[size]" we get the size, for "new int" we allocate 1
-        if (unop->operand->kind == ASTNodeKind::ARRAY_SUBSCRIPT) {
-            // new int[size] - array allocation
-            auto sub = static_cast<const ArraySubscript*>(unop->operand.get());
-            genExpression(sub->index.get());  // Push size
-            emit(Opcode::ALLOC);
-        } else {
-            // new int - single allocation
-            emit(Opcode::PUSH);
-            emitInt32(1);  // Allocate 1 cell
-            emit(Opcode::ALLOC);
-        }
-        return;
-    }
-    
-    if (unop->op == "delete") {
-        // delete operator: free heap memory
-        genExpression(unop->operand.get());  // Push address
-        emit(Opcode::FREE);
-        // Push dummy value since it's an expression
-        emit(Opcode::PUSH);
-        emitInt32(0);
-        return;
-    }
-    
-    if (unop->op == "&") {
-        // Address-of operator: return memory address of variable
-        if (unop->operand->kind == ASTNodeKind::IDENTIFIER) {
-            auto id = static_cast<const Identifier*>(unop->operand.get());
-            auto sym = findSymbol(id->name);
-            if (sym && sym->type == Symbol::VARIABLE) {
-                // Push the address (offset) of the variable
+    switch (unop->opKind) {
+        case OpKind::NEW: {
+            // new operator: allocate heap memory
+            // Operand should be a type or size expression
+            // For "new int[size]" we get the size, for "new int" we allocate 1
+            if (unop->operand->kind == ASTNodeKind::ARRAY_SUBSCRIPT) {
+                // new int[size] - array allocation
+                auto sub = static_cast<const ArraySubscript*>(unop->operand.get());
+                genExpression(sub->index.get());  // Push size
+                emit(Opcode::ALLOC);
+            } else {
+                // new int - single allocation
                 emit(Opcode::PUSH);
-                emitInt32(sym->offset);
-                return;
+                emitInt32(1);  // Allocate 1 cell
+                emit(Opcode::ALLOC);
             }
-        } else if (unop->operand->kind == ASTNodeKind::ARRAY_SUBSCRIPT) {
-            // Address-of array element: &arr[index]
-            auto sub = static_cast<const ArraySubscript*>(unop->operand.get());
-            if (sub->array->kind == ASTNodeKind::IDENTIFIER) {
-                auto id = static_cast<const Identifier*>(sub->array.get());
-                auto sym = findSymbol(id->name);
+            return;
+        }
+        case OpKind::DELETE: {
+            // delete operator: free heap memory
+            genExpression(unop->operand.get());  // Push address
+            emit(Opcode::FREE);
+            // Push dummy value since it's an expression
+            emit(Opcode::PUSH);
+            emitInt32(0);
+            return;
+        }
+        case OpKind::AMP: {
+            // Address-of operator: return memory address of variable
+            if (unop->operand->kind == ASTNodeKind::IDENTIFIER) {
+                auto id = static_cast<const Identifier*>(unop->operand.get());
+                auto sym = findSymbol(id->symbol);
+                if (sym && sym->type == Symbol::VARIABLE) {
+                    // Push the address (offset) of the variable
+                    emit(Opcode::PUSH);
+                    emitAddress(sym->offset);
+                    return;
+                }
+            } else if (unop->operand->kind == ASTNodeKind::ARRAY_SUBSCRIPT) {
+                // Address-of array element: &arr[index]
+                auto sub = static_cast<const ArraySubscript*>(unop->operand.get());
+                if (sub->array->kind == ASTNodeKind::IDENTIFIER) {
+                    auto id = static_cast<const Identifier*>(sub->array.get());
+                    auto sym = findSymbol(id->symbol);
                 
-                if (sym) {
-                    // Push base address
-                    if (sym->type == Symbol::PARAMETER && sym->is_array) {
-                        emit(Opcode::LOAD_BP);
-                        emitInt32(sym->offset);
-                    } else if (sym->type == Symbol::VARIABLE && sym->is_heap_allocated) {
-                        emit(Opcode::LOAD);
-                        emitInt32(sym->offset);
-                    } else if (sym->type == Symbol::VARIABLE && sym->is_array) {
-                        emit(Opcode::PUSH);
-                        emitInt32(sym->offset);
-                    } else {
-                        emit(Opcode::PUSH);
-                        emitInt32(sym->offset);
-                    }
+                    if (sym) {
+                        // Push base address
+                        if (sym->type == Symbol::PARAMETER && sym->is_array) {
+                            emit(Opcode::LOAD_BP);
+                            emitInt32(sym->offset);
+                        } else if (sym->type == Symbol::VARIABLE && sym->is_heap_allocated) {
+                            emit(Opcode::LOAD);
+                            emitAddress(sym->offset);
+                        } else if (sym->type == Symbol::VARIABLE && sym->is_array) {
+                            emit(Opcode::PUSH);
+                            emitAddress(sym->offset);
+                        } else {
+                            emit(Opcode::PUSH);
+                            emitAddress(sym->offset);
+                        }
                     
-                    // Push index and add to get element address
-                    genExpression(sub->index.get());
-                    emit(Opcode::ADD);
-                    return;
+                        // Push index and add to get element address
+                        genExpression(sub->index.get());
+                        emit(Opcode::ADD);
+                        return;
+                    }
                 }
             }
-        }
-        // Default: push 0 for unsupported address-of
-        emit(Opcode::PUSH);
-        emitInt32(0);
-        return;
-    }
-    
-    if (unop->op == "*") {
-        // Dereference operator: load value from address in operand
-        genExpression(unop->operand.get()); // This should push an address
-        // Now we have address on stack, load value from that address
-        emit(Opcode::LOAD_INDIRECT);
-        return;
-    }
-    
-    // Other unary operators
-    genExpression(unop->operand.get());
-    
-    if (unop->op == "-") {
-        if (isFloatExpr(unop->operand.get())) {
-            emit(Opcode::FNEG);
-        } else {
-            // Negate: push 0, swap, subtract
+            // Default: push 0 for unsupported address-of
             emit(Opcode::PUSH);
             emitInt32(0);
-            emit(Opcode::SWAP);
-            emit(Opcode::SUB);
+            return;
         }
-    } else if (unop->op == "+") {
-        // Unary plus does nothing
+        case OpKind::STAR: {
+            // Dereference operator: load value from address in operand
+            genExpression(unop->operand.get()); // This should push an address
+            // Now we have address on stack, load value from that address
+            emit(Opcode::LOAD_INDIRECT);
+            return;
+        }
+        case OpKind::MINUS:
+            genExpression(unop->operand.get());
+            if (isFloatExpr(unop->operand.get())) {
+                emit(Opcode::FNEG);
+            } else {
+                // Negate: push 0, swap, subtract
+                emit(Opcode::PUSH);
+                emitInt32(0);
+                emit(Opcode::SWAP);
+                emit(Opcode::SUB);
+            }
+            return;
+        default:
+            // Unary plus and other operators just evaluate the operand
+            genExpression(unop->operand.get());
+            return;
     }
 }
 
@@ -886,7 +1595,7 @@ void CodeGenerator::genCall(const CallExpr* call) {
             // Print newline
             int str_id = addString("\n");
             emit(Opcode::PUSH);
-            emitInt32(str_id);
+            emitStringId(str_id);
             emit(Opcode::PRINT_STR);
             emit(Opcode::PUSH);
             emitInt32(0);
@@ -894,27 +1603,64 @@ void CodeGenerator::genCall(const CallExpr* call) {
         }
         
         // Regular function call - push arguments first
-        int arg_count = call->args.size();
-        for (const auto& arg : call->args) {
-            genExpression(arg.get());
+        std::vector<const ASTNode*> args;
+        std::string mangled_name = resolveCall(call);
+        auto spec = specialized_calls.find(call);
+        if (spec != specialized_calls.end()) {
+            // Specialized clone: constant arguments are baked into the callee
+            for (size_t i : spec->second.kept_args) args.push_back(call->args[i].get());
+        } else {
+            for (const auto& arg : call->args) args.push_back(arg.get());
+        }
+        int arg_count = args.size();
+        auto sig = signatures.find(mangled_name);
+        // The callee may reenter this function and overwrite its float parameters
+        std::vector<int> saved_cells = current_float_param_cells;
+        for (int cell : saved_cells) {
+            emit(Opcode::FSAVE);
+            emitAddress(cell);
+        }
+        std::vector<int> float_cells;
+        for (int i = 0; i < arg_count; i++) {
+            genExpression(args[i]);
+            bool is_float = isFloatExpr(args[i]);
+            if (sig != signatures.end() && i < static_cast<int>(sig->second.float_param_cells.size()) &&
+                sig->second.float_param_cells[i] >= 0) {
+                if (!is_float) emit(Opcode::INT_TO_FP);
+                emit(Opcode::PUSH);
+                emitInt32(0);
+                float_cells.push_back(sig->second.float_param_cells[i]);
+            } else if (is_float) {
+                emit(Opcode::FP_TO_INT);
+            }
+        }
+        // Store float arguments only once all arguments are evaluated, so nested
+        // calls to the same function cannot overwrite them
+        for (auto cell = float_cells.rbegin(); cell != float_cells.rend(); ++cell) {
+            emit(Opcode::FSTORE);
+            emitAddress(*cell);
         }
-        
-        // Use name mangling for function calls
-        std::string mangled_name = mangleFunctionName(id->name, arg_count);
         // DEBUG: // std::cerr << "DBG genCall: calling '" << id->name << "' with " << arg_count 
 // DEBUG_CONT:                   << " args -> mangled: '" << mangled_name << "'" << std::endl;
-        emitJump(Opcode::CALL, mangled_name);
+        emitJump(Opcode::CALL, functionLabel(mangled_name));
         
         // Clean up arguments from stack after return
-        // Stack layout after RET: [arg1, arg2, ..., argN, retval]
+        // Stack layout after RET: [arg1, arg2, ..., argN, saved_BP, retval]
         // We want: [retval]
-        if (arg_count > 0) {
-            // Stack after CALL: [arg1, ..., argN, retval]
-            // Remove arguments while preserving retval using SWAP+POP per argument.
-            for (int i = 0; i < arg_count; i++) {
-                emit(Opcode::SWAP);
-                emit(Opcode::POP);
-            }
+        // Remove arguments and the saved BP while preserving retval using SWAP+POP.
+        for (int i = 0; i < arg_count + 1; i++) {
+            emit(Opcode::SWAP);
+            emit(Opcode::POP);
+        }
+        bool returns_float = sig != signatures.end() && sig->second.returns_float;
+        if (returns_float) {
+            emit(Opcode::POP);  // The result is on the FPU
+        }
+        // Stack: [saved cells..., retval]
+        for (auto cell = saved_cells.rbegin(); cell != saved_cells.rend(); ++cell) {
+            if (!returns_float) emit(Opcode::SWAP);
+            emit(Opcode::FRESTORE);
+            emitAddress(*cell);
         }
     }
 }
@@ -924,7 +1670,7 @@ void CodeGenerator::genLiteral(const Literal* lit) {
     if (lit->litType == TokenType::STRING) {
         int str_id = addString(lit->value);
         emit(Opcode::PUSH_STR);
-        emitInt32(str_id);
+        emitStringId(str_id);
         return;
     }
     
@@ -982,19 +1728,19 @@ void CodeGenerator::genIdentifier(const Identifier* id) {
             if (sym->is_float) {
                 // Float variable: load from float_memory to FPU stack
                 emit(Opcode::FLOAD);
-                emitInt32(sym->offset);
+                emitAddress(sym->offset);
             } else if (sym->is_heap_allocated) {
                 // Heap-allocated arrays: load the heap pointer
                 emit(Opcode::LOAD);
-                emitInt32(sym->offset);
+                emitAddress(sym->offset);
             } else if (sym->is_array) {
                 // Stack arrays: push the stack address (pointer decay)
                 emit(Opcode::PUSH);
-                emitInt32(sym->offset);
+                emitAddress(sym->offset);
             } else {
                 // Regular variables: load the value
                 emit(Opcode::LOAD);
-                emitInt32(sym->offset);
+                emitAddress(sym->offset);
             }
         } else if (sym->type == Symbol::PARAMETER) {
             if (sym->is_array) {
@@ -1043,6 +1789,19 @@ void CodeGenerator::emitInt32At(size_t pos, int32_t value) {
     bytecode[pos+3] = (value >> 24) & 0xFF;
 }
 
+// Static memory cell operand; objects relocate it by their data base, and
+// cached functions by their first cell
+void CodeGenerator::emitAddress(int32_t addr) {
+    data_operands.push_back(currentAddress());
+    emitInt32(addr);
+}
+
+// String table index operand; objects map it into the merged string table
+void CodeGenerator::emitStringId(int32_t id) {
+    string_operands.push_back(currentAddress());
+    emitInt32(id);
+}
+
 void CodeGenerator::emitFloat32(float value) {
     uint8_t bytes[4];
     std::memcpy(bytes, &value, sizeof(float));
@@ -1080,16 +1839,16 @@ bool CodeGenerator::isFloatExpr(const ASTNode* node) {
         }
         case ASTNodeKind::IDENTIFIER: {
             auto id = static_cast<const Identifier*>(node);
-            auto sym = findSymbol(id->name);
+            auto sym = findSymbol(id->symbol);
             return sym && sym->is_float;
         }
         case ASTNodeKind::BINARY_OP: {
             auto bin = static_cast<const BinaryOp*>(node);
             // Assignment result type follows the left-hand side
-            if (bin->op == "=") {
+            if (bin->opKind == OpKind::ASSIGN) {
                 if (bin->left->kind == ASTNodeKind::IDENTIFIER) {
                     auto id = static_cast<const Identifier*>(bin->left.get());
-                    auto sym = findSymbol(id->name);
+                    auto sym = findSymbol(id->symbol);
                     return sym && sym->is_float;
                 }
                 return false;
@@ -1100,58 +1859,146 @@ bool CodeGenerator::isFloatExpr(const ASTNode* node) {
             auto un = static_cast<const UnaryOp*>(node);
             return isFloatExpr(un->operand.get());
         }
+        case ASTNodeKind::CALL: {
+            auto call = static_cast<const CallExpr*>(node);
+            if (!call->callee || call->callee->kind != ASTNodeKind::IDENTIFIER) return false;
+            auto sig = signatures.find(resolveCall(call));
+            return sig != signatures.end() && sig->second.returns_float;
+        }
         default:
             return false;
     }
 }
 
 // Label management
-std::string CodeGenerator::makeLabel(const std::string& prefix) {
-    return prefix + "_" + std::to_string(label_counter++);
+int CodeGenerator::makeLabel() {
+    labels.emplace_back();
+    return static_cast<int>(labels.size()) - 1;
+}
+
+int CodeGenerator::functionLabel(const std::string& name) {
+    auto it = function_labels.find(name);
+    if (it != function_labels.end()) return it->second;
+    int label = makeLabel();
+    function_labels[name] = label;
+    return label;
 }
 
-void CodeGenerator::defineLabel(const std::string& label) {
+void CodeGenerator::defineLabel(int label) {
     labels[label].address = currentAddress();
     labels[label].defined = true;
+    if (recording) recording->defined_labels.push_back(label);
 }
 
-void CodeGenerator::emitJump(Opcode op, const std::string& label) {
+void CodeGenerator::emitJump(Opcode op, int label) {
     emit(op);
     labels[label].fixup_positions.push_back(currentAddress());
+    if (recording) recording->jumps.push_back({currentAddress(), label});
     emitInt32(0); // Placeholder
 }
 
+// Patch jump operands, then relax: re-encode the code compactly (encoding.h)
+// with each jump as short as its final distance allows and wide constants in
+// the pool, and move labels and profile sites to the new offsets.
+// Objects stay wide; every operand that depends on placement becomes a relocation.
 void CodeGenerator::fixupLabels() {
-    for (auto& [name, label] : labels) {
-        if (!label.defined) {
-            std::cerr << "Error: Undefined label: " << name << "\n";
+    if (object_mode) {
+        fixupObjectLabels();
+        return;
+    }
+    // A CALL left pointing at address 0 would rerun the program from the start
+    std::vector<std::string> undefined;
+    for (const auto& [name, label] : function_labels) {
+        if (!labels[label].defined && !labels[label].fixup_positions.empty()) undefined.push_back(name);
+    }
+    if (!undefined.empty()) {
+        std::sort(undefined.begin(), undefined.end());
+        std::string names;
+        for (const auto& name : undefined) names += (names.empty() ? "" : ", ") + name;
+        throw std::runtime_error("Undefined label: " + names);
+    }
+    for (const Label& label : labels) {
+        if (!label.defined) continue;
+        for (size_t pos : label.fixup_positions) {
+            emitInt32At(pos, label.address);
+        }
+    }
+    
+    std::vector<uint8_t> compact;
+    std::unordered_map<uint32_t, uint32_t> new_offset;
+    std::string error;
+    constants.clear();
+    if (!compactCode(bytecode, compact, new_offset, constants, error)) {
+        std::cerr << "Error: " << error << "; keeping the wide encoding\n";
+        return;
+    }
+    for (Label& label : labels) {
+        if (label.defined) label.address = static_cast<int>(new_offset.at(label.address));
+        label.fixup_positions.clear();
+    }
+    for (auto& site : profile_sites) site.offset = new_offset.at(site.offset);
+    for (auto& entry : line_entries) entry.offset = new_offset.at(entry.offset);
+    bytecode = std::move(compact);
+    compact_code = true;
+}
+
+void CodeGenerator::fixupObjectLabels() {
+    std::unordered_map<int, std::pair<std::string, int32_t>> external_params;  // Cell -> function, parameter
+    std::vector<std::string> label_names(labels.size());
+    for (const auto& [name, label] : function_labels) label_names[label] = name;
+    for (size_t id = 0; id < labels.size(); id++) {
+        const Label& label = labels[id];
+        if (label.defined) {
+            for (size_t pos : label.fixup_positions) {
+                emitInt32At(pos, label.address);
+                relocations.push_back({static_cast<uint32_t>(pos), RelocationKind::CODE, ""});
+            }
             continue;
         }
-        
+        if (label.fixup_positions.empty()) continue;
+        if (label_names[id].empty()) {
+            throw std::runtime_error("Undefined local label " + std::to_string(id) + " in object code");
+        }
         for (size_t pos : label.fixup_positions) {
-            emitInt32At(pos, label.address);
+            relocations.push_back({static_cast<uint32_t>(pos), RelocationKind::SYMBOL, label_names[id]});
+        }
+        // Float arguments belong in the cells the defining object reads them from;
+        // the cells declared here for the prototype are only placeholders
+        auto sig = signatures.find(label_names[id]);
+        if (sig == signatures.end()) continue;
+        for (size_t i = 0; i < sig->second.float_param_cells.size(); i++) {
+            int cell = sig->second.float_param_cells[i];
+            if (cell >= 0) external_params[cell] = {label_names[id], static_cast<int32_t>(i)};
         }
     }
+    for (size_t pos : data_operands) {
+        int32_t cell;
+        std::memcpy(&cell, bytecode.data() + pos, 4);
+        auto param = external_params.find(cell);
+        if (param == external_params.end()) {
+            relocations.push_back({static_cast<uint32_t>(pos), RelocationKind::DATA, ""});
+            continue;
+        }
+        emitInt32At(pos, param->second.second);
+        relocations.push_back({static_cast<uint32_t>(pos), RelocationKind::PARAM, param->second.first});
+    }
+    for (size_t pos : string_operands) relocations.push_back({static_cast<uint32_t>(pos), RelocationKind::STRING, ""});
+    std::sort(relocations.begin(), relocations.end(),
+              [](const Relocation& a, const Relocation& b) { return a.offset < b.offset; });
 }
 
 // String table
 int CodeGenerator::addString(const std::string& str) {
-    // Check if string already exists
-    for (size_t i = 0; i < string_table.size(); i++) {
-        if (string_table[i] == str) {
-            // DEBUG: // std::cerr << "DBG addString: existing id=" << i << " str='" << str << "'\n";
-            return i;
-        }
-    }
-    // Add new string
+    auto it = string_ids.find(str);
+    if (it != string_ids.end()) return it->second;
+    int id = string_table.size();
     string_table.push_back(str);
-    int id = string_table.size() - 1;
-    // DEBUG: // std::cerr << "DBG addString: new id=" << id << " str='" << str << "'\n";
+    string_ids[str] = id;
     return id;
 }
 
 // Name mangling for function overloading
-std::string CodeGenerator::mangleFunctionName(const std::string& name, int param_count) {
+std::string CodeGenerator::mangleFunctionName(const std::string& name, int param_count) const {
     // Simple name mangling: name_Pcount
     // e.g., foo_P2 for foo with 2 parameters
     if (param_count == 0) {
@@ -1161,7 +2008,7 @@ std::string CodeGenerator::mangleFunctionName(const std::string& name, int param
 }
 
 std::string CodeGenerator::mangleFunctionName(const std::string& name, 
-    const std::vector<std::pair<std::vector<std::string>, std::string>>& params) {
+    const std::vector<std::pair<std::vector<std::string>, std::string>>& params) const {
     // More sophisticated mangling based on parameter types
     // Format: name_P<count>_<type1>_<type2>...
     if (params.empty()) {
@@ -1171,27 +2018,32 @@ std::string CodeGenerator::mangleFunctionName(const std::string& name,
     std::string mangled = name + "_P" + std::to_string(params.size());
     for (const auto& param : params) {
         if (!param.first.empty()) {
-            // Use first token of type (simplified)
-            std::string type = param.first[0];
-            // Shorten common types
-            if (type == "int") type = "i";
-            else if (type == "float") type = "f";
-            else if (type == "double") type = "d";
-            else if (type == "char") type = "c";
-            else if (type == "bool") type = "b";
-            else if (type == "void") type = "v";
-            else if (type == "std") type = "s";
-            // For pointers/references
-            if (param.first.size() > 1) {
-                if (param.first.back() == "*") type += "p";
-                if (param.first.back() == "&") type += "r";
-            }
-            mangled += "_" + type;
+            mangled += "_" + mangleTypeName(param.first);
         }
     }
     return mangled;
 }
 
+std::string CodeGenerator::mangleTypeName(const std::vector<std::string>& typeTokens) {
+    if (typeTokens.empty()) return "";
+    // Use first token of type (simplified)
+    std::string type = typeTokens[0];
+    // Shorten common types
+    if (type == "int") type = "i";
+    else if (type == "float") type = "f";
+    else if (type == "double") type = "d";
+    else if (type == "char") type = "c";
+    else if (type == "bool") type = "b";
+    else if (type == "void") type = "v";
+    else if (type == "std") type = "s";
+    // For pointers/references
+    if (typeTokens.size() > 1) {
+        if (typeTokens.back() == "*") type += "p";
+        if (typeTokens.back() == "&") type += "r";
+    }
+    return type;
+}
+
 // Symbol table
 void CodeGenerator::addVariable(const std::string& name, int offset, bool is_array, bool is_heap_allocated, bool is_float) {
     Symbol sym;
@@ -1200,7 +2052,9 @@ void CodeGenerator::addVariable(const std::string& name, int offset, bool is_arr
     sym.is_array = is_array;
     sym.is_heap_allocated = is_heap_allocated;
     sym.is_float = is_float;
-    symbols[name] = sym;
+    SymbolId id = internSymbol(name);
+    symbols[id] = sym;
+    noteSymbolDefinition(id);
     
     // DEBUG: // std::cerr << "DBG addVariable: '" << name << "' offset=" << offset 
 // DEBUG_CONT:               << " is_array=" << is_array << std::endl;
@@ -1213,7 +2067,9 @@ void CodeGenerator::addParameter(const std::string& name, int offset) {
     sym.is_array = false;  // Will be updated for pointer/array params
     sym.is_heap_allocated = false;
     sym.is_float = false;
-    symbols[name] = sym;
+    SymbolId id = internSymbol(name);
+    symbols[id] = sym;
+    noteSymbolDefinition(id);
 }
 
 void CodeGenerator::addFunction(const std::string& name, int address, int param_count) {
@@ -1224,85 +2080,419 @@ void CodeGenerator::addFunction(const std::string& name, int address, int param_
     sym.is_array = false;
     sym.is_heap_allocated = false;
     sym.is_float = false;
-    symbols[name] = sym;
+    SymbolId id = internSymbol(name);
+    symbols[id] = sym;
+    noteSymbolDefinition(id);
 }
 
-Symbol* CodeGenerator::findSymbol(const std::string& name) {
-    auto it = symbols.find(name);
+Symbol* CodeGenerator::findSymbol(SymbolId id) {
+    auto it = symbols.find(id);
+    if (recording && recording->seen_symbols.insert(id).second) {
+        // First use of a name the function has not defined itself
+        recording->lookups.push_back({id, it != symbols.end() ? std::optional<Symbol>(it->second) : std::nullopt});
+    }
     if (it != symbols.end()) {
         return &it->second;
     }
     return nullptr;
 }
 
-bool CodeGenerator::saveToFile(const std::string& filename) {
-    std::ofstream file(filename, std::ios::binary);
-    if (!file) {
-        std::cerr << "Error: Could not open file: " << filename << "\n";
-        return false;
+void CodeGenerator::addProfileSite(ProfileSiteKind kind, const ASTNode* node, size_t offset) {
+    profile_sites.push_back({static_cast<uint32_t>(offset), kind, node->line, node->column});
+}
+
+// Start a line table entry here; a statement nested at the same offset
+// (the first statement of a block) replaces its parent's entry
+void CodeGenerator::recordLine(int line) {
+    if (recording && line > 0) recording->lines.push_back({currentAddress(), line});
+    recordLineAt(static_cast<uint32_t>(currentAddress()), line);
+}
+
+void CodeGenerator::recordLineAt(uint32_t offset, int line) {
+    if (line <= 0) return;
+    if (!line_entries.empty() && line_entries.back().offset == offset) {
+        line_entries.back().line = line;
+        if (line_entries.size() > 1 && line_entries[line_entries.size() - 2].line == line) line_entries.pop_back();
+        return;
+    }
+    if (!line_entries.empty() && line_entries.back().line == line) return;
+    line_entries.push_back({offset, line});
+}
+
+// ---- Function layer of the compilation cache ----
+
+static CachedSymbol toCachedSymbol(const std::string& name, const std::optional<Symbol>& sym, int data_start) {
+    CachedSymbol cached;
+    cached.name = name;
+    cached.present = sym.has_value();
+    if (!sym) return cached;
+    cached.type = static_cast<uint8_t>(sym->type);
+    cached.flags = (sym->is_array ? 1 : 0) | (sym->is_heap_allocated ? 2 : 0) | (sym->is_float ? 4 : 0);
+    cached.offset = sym->offset;
+    cached.address = sym->address;
+    cached.param_count = sym->param_count;
+    cached.array_size = sym->array_size;
+    if (data_start >= 0 && sym->type == Symbol::VARIABLE && sym->offset >= data_start) {
+        cached.local = true;
+        cached.offset -= data_start;
+    }
+    return cached;
+}
+
+static std::optional<Symbol> fromCachedSymbol(const CachedSymbol& cached, int data_start) {
+    if (!cached.present) return std::nullopt;
+    Symbol sym;
+    sym.type = static_cast<Symbol::Type>(cached.type);
+    sym.offset = cached.offset + (cached.local ? data_start : 0);
+    sym.address = cached.address;
+    sym.param_count = cached.param_count;
+    sym.is_array = cached.flags & 1;
+    sym.is_heap_allocated = cached.flags & 2;
+    sym.is_float = cached.flags & 4;
+    sym.array_size = cached.array_size;
+    return sym;
+}
+
+static bool sameSymbol(const std::optional<Symbol>& a, const std::optional<Symbol>& b) {
+    if (!a || !b) return !a && !b;
+    return a->type == b->type && a->offset == b->offset && a->address == b->address &&
+           a->param_count == b->param_count && a->is_array == b->is_array &&
+           a->is_heap_allocated == b->is_heap_allocated && a->is_float == b->is_float &&
+           a->array_size == b->array_size;
+}
+
+// The function's tokens with lines relative to its first (so code above it
+// can grow or shrink), the program-wide decisions and its specialized calls
+uint64_t CodeGenerator::functionKey(const FunctionDecl* func, const std::string& name) const {
+    ContentHash hash;
+    hash.add(program_hash).add(name);
+    const std::vector<Token>& tokens = *source_tokens;
+    int first_line = tokens[func->tokenBegin].line;
+    for (size_t i = func->tokenBegin; i < func->tokenEnd; i++) {
+        const Token& token = tokens[i];
+        hash.add(static_cast<uint64_t>(token.type)).add(token.value);
+        hash.add(static_cast<uint64_t>(token.line - first_line)).add(static_cast<uint64_t>(token.column));
+    }
+    hash.add(static_cast<uint64_t>(func->line - first_line)).add(static_cast<uint64_t>(func->column));
+    std::vector<const CallExpr*> calls;
+    collectCalls(func->body.get(), calls);
+    for (size_t i = 0; i < calls.size(); i++) {
+        auto spec = specialized_calls.find(calls[i]);
+        if (spec == specialized_calls.end()) continue;
+        hash.add(i).add(spec->second.name).add(spec->second.kept_args.size());
+        for (size_t arg : spec->second.kept_args) hash.add(arg);
+    }
+    return hash.value();
+}
+
+void CodeGenerator::noteSymbolDefinition(SymbolId id) {
+    if (!recording) return;
+    recording->seen_symbols.insert(id);
+    recording->defined_symbols.push_back(id);
+}
+
+// Copy a cached body in if every outer symbol it was generated against is
+// unchanged, then re-resolve its labels, strings and static cells
+bool CodeGenerator::replayFunction(uint64_t key, const FunctionDecl* func) {
+    std::vector<uint8_t> data;
+    CachedFunction cached;
+    if (!cache->load(key, "fn", data) || !parseCachedFunction(data, cached)) return false;
+    for (const auto& lookup : cached.lookups) {
+        auto it = symbols.find(internSymbol(lookup.name));
+        std::optional<Symbol> current;
+        if (it != symbols.end()) current = it->second;
+        if (!sameSymbol(current, fromCachedSymbol(lookup, 0))) return false;
+    }
+    int data_start = next_memory_addr;
+    for (const auto& check : cached.limit_checks) {
+        if ((data_start + static_cast<int64_t>(check.end) <= kStaticMemoryCells) != check.fits) return false;
     }
     
-    // Write string table size
-    uint32_t str_count = string_table.size();
-    // DEBUG: // std::cerr << "DBG saveToFile: str_count=" << str_count << "\n";
-    file.write(reinterpret_cast<const char*>(&str_count), sizeof(str_count));
+    size_t base = currentAddress();
+    bytecode.insert(bytecode.end(), cached.code.begin(), cached.code.end());
+    for (uint32_t offset : cached.data_operands) {
+        int32_t cell;
+        std::memcpy(&cell, bytecode.data() + base + offset, 4);
+        emitInt32At(base + offset, cell + data_start);
+        data_operands.push_back(base + offset);
+    }
+    for (uint32_t offset : cached.outer_operands) data_operands.push_back(base + offset);
+    for (uint32_t offset : cached.string_operands) {
+        int32_t index;
+        std::memcpy(&index, bytecode.data() + base + offset, 4);
+        emitInt32At(base + offset, addString(cached.strings[index]));
+        string_operands.push_back(base + offset);
+    }
     
-    // Write each string (length + data)
-    for (const auto& str : string_table) {
-        uint32_t len = str.length();
-        file.write(reinterpret_cast<const char*>(&len), sizeof(len));
-        file.write(str.data(), len);
+    std::vector<int> local(cached.local_labels);
+    for (int& label : local) label = makeLabel();
+    for (const auto& fixup : cached.fixups) {
+        int label = fixup.label >= 0 ? local[fixup.label] : functionLabel(fixup.function);
+        labels[label].fixup_positions.push_back(base + fixup.offset);
+    }
+    for (const auto& def : cached.labels) {
+        labels[local[def.label]].address = static_cast<int>(base + def.offset);
+        labels[local[def.label]].defined = true;
+    }
+    for (const auto& region : cached.try_regions) {
+        try_regions.push_back({local[region.start], local[region.end], local[region.handler]});
     }
+    for (const auto& site : cached.profile_sites) {
+        profile_sites.push_back({static_cast<uint32_t>(base + site.offset), static_cast<ProfileSiteKind>(site.kind),
+                                 func->line + site.line, site.column});
+    }
+    for (const auto& line : cached.lines) recordLineAt(static_cast<uint32_t>(base + line.offset), func->line + line.line);
+    for (const auto& def : cached.definitions) symbols[internSymbol(def.name)] = *fromCachedSymbol(def, data_start);
+    next_memory_addr += cached.data_cells;
+    functions_reused++;
+    return true;
+}
+
+// Save what generating `func` added to the shared tables, with its own cells,
+// labels and strings made relative so a replay can place them anywhere
+void CodeGenerator::storeFunction(const FunctionDecl* func) {
+    const FunctionRecording& rec = *recording;
+    // New template instances and signatures are side effects a replay cannot repeat
+    if (signatures.size() != rec.signatures || pending_instances.size() != rec.pending_instances ||
+        instantiated_templates.size() != rec.instantiated_templates) {
+        return;
+    }
+    
+    CachedFunction cached;
+    cached.code.assign(bytecode.begin() + rec.start, bytecode.end());
+    auto operand = [&cached](uint32_t offset) {
+        int32_t value;
+        std::memcpy(&value, cached.code.data() + offset, 4);
+        return value;
+    };
+    auto setOperand = [&cached](uint32_t offset, int32_t value) {
+        std::memcpy(cached.code.data() + offset, &value, 4);
+    };
+    for (size_t i = rec.data_operands; i < data_operands.size(); i++) {
+        uint32_t offset = static_cast<uint32_t>(data_operands[i] - rec.start);
+        int32_t cell = operand(offset);
+        if (cell >= rec.data_start) {
+            setOperand(offset, cell - rec.data_start);
+            cached.data_operands.push_back(offset);
+        } else {
+            cached.outer_operands.push_back(offset);
+        }
+    }
+    std::unordered_map<int32_t, int32_t> string_index;
+    for (size_t i = rec.string_operands; i < string_operands.size(); i++) {
+        uint32_t offset = static_cast<uint32_t>(string_operands[i] - rec.start);
+        int32_t id = operand(offset);
+        auto [it, added] = string_index.emplace(id, static_cast<int32_t>(cached.strings.size()));
+        if (added) cached.strings.push_back(string_table[id]);
+        setOperand(offset, it->second);
+        cached.string_operands.push_back(offset);
+    }
+    
+    // Labels created by this function are numbered locally; calls go by name
+    std::unordered_map<int, std::string> function_names;
+    for (const auto& [name, label] : function_labels) function_names[label] = name;
+    std::unordered_map<int, int32_t> local;
+    auto localLabel = [&](int label) -> int32_t {
+        if (label < rec.first_label || function_names.count(label)) return -1;
+        return local.emplace(label, static_cast<int32_t>(local.size())).first->second;
+    };
+    for (const auto& [pos, label] : rec.jumps) {
+        uint32_t offset = static_cast<uint32_t>(pos - rec.start);
+        auto name = function_names.find(label);
+        if (name != function_names.end()) {
+            // A template instance exists only if some function instantiated it,
+            // and a replay cannot count on that one still doing so
+            if (instantiated_templates.count(name->second)) return;
+            cached.fixups.push_back({offset, -1, name->second});
+            continue;
+        }
+        int32_t index = localLabel(label);
+        if (index < 0) return;
+        cached.fixups.push_back({offset, index, ""});
+    }
+    for (int label : rec.defined_labels) {
+        int32_t index = localLabel(label);
+        if (index < 0) return;
+        cached.labels.push_back({static_cast<uint32_t>(index), static_cast<uint32_t>(labels[label].address - rec.start)});
+    }
+    for (size_t i = rec.try_regions; i < try_regions.size(); i++) {
+        int32_t start = localLabel(try_regions[i].start);
+        int32_t end = localLabel(try_regions[i].end);
+        int32_t handler = localLabel(try_regions[i].handler);
+        if (start < 0 || end < 0 || handler < 0) return;
+        cached.try_regions.push_back({static_cast<uint32_t>(start), static_cast<uint32_t>(end), static_cast<uint32_t>(handler)});
+    }
+    cached.local_labels = static_cast<uint32_t>(local.size());
+    
+    for (size_t i = rec.profile_sites; i < profile_sites.size(); i++) {
+        const ProfileSite& site = profile_sites[i];
+        cached.profile_sites.push_back({static_cast<uint32_t>(site.offset - rec.start), static_cast<uint32_t>(site.kind),
+                                        site.line - func->line, site.column});
+    }
+    for (const auto& [pos, line] : rec.lines) {
+        cached.lines.push_back({static_cast<uint32_t>(pos - rec.start), line - func->line});
+    }
+    cached.limit_checks = rec.limit_checks;
+    for (const auto& [id, sym] : rec.lookups) cached.lookups.push_back(toCachedSymbol(symbolName(id), sym, -1));
+    std::unordered_set<SymbolId> stored;
+    for (SymbolId id : rec.defined_symbols) {
+        if (stored.insert(id).second) cached.definitions.push_back(toCachedSymbol(symbolName(id), symbols.at(id), rec.data_start));
+    }
+    cached.data_cells = static_cast<uint32_t>(next_memory_addr - rec.data_start);
+    cache->store(rec.key, "fn", encodeCachedFunction(cached));
+}
+
+const ProfileCounts* CodeGenerator::profileCounts(ProfileSiteKind kind, int line, int column) const {
+    if (!has_profile) return nullptr;
+    auto it = profile.find({kind, line, column});
+    return it != profile.end() ? &it->second : nullptr;
+}
+
+// Reorder emitted functions by descending call count so hot code is packed
+// together. Code outside functions (the entry stub) keeps its place at the front.
+// Must run before fixupLabels(): label addresses and fixup positions are remapped.
+void CodeGenerator::layoutFunctionsHotFirst() {
+    struct Segment {
+        size_t start;
+        size_t end;
+        uint64_t calls;
+        size_t new_start;
+    };
+    std::vector<FunctionRange> ranges = function_ranges;
+    std::sort(ranges.begin(), ranges.end(),
+              [](const FunctionRange& a, const FunctionRange& b) { return a.start < b.start; });
+    
+    std::vector<Segment> segments;   // in original order
+    std::vector<size_t> functions;   // indices of function segments
+    size_t pos = 0;
+    for (const auto& r : ranges) {
+        if (r.start > pos) segments.push_back({pos, r.start, 0, 0});
+        const ProfileCounts* counts = profileCounts(ProfileSiteKind::FUNCTION, r.line, r.column);
+        functions.push_back(segments.size());
+        segments.push_back({r.start, r.end, counts ? counts->count : 0, 0});
+        pos = r.end;
+    }
+    if (pos < bytecode.size()) segments.push_back({pos, bytecode.size(), 0, 0});
+    
+    std::vector<size_t> order;
+    for (size_t i = 0; i < segments.size(); i++) {
+        if (std::find(functions.begin(), functions.end(), i) == functions.end()) order.push_back(i);
+    }
+    std::stable_sort(functions.begin(), functions.end(),
+                     [&](size_t a, size_t b) { return segments[a].calls > segments[b].calls; });
+    order.insert(order.end(), functions.begin(), functions.end());
     
-    // Write bytecode size
-    uint32_t code_size = bytecode.size();
-    file.write(reinterpret_cast<const char*>(&code_size), sizeof(code_size));
+    std::vector<uint8_t> laid_out;
+    laid_out.reserve(bytecode.size());
+    for (size_t i : order) {
+        segments[i].new_start = laid_out.size();
+        laid_out.insert(laid_out.end(), bytecode.begin() + segments[i].start, bytecode.begin() + segments[i].end);
+    }
     
-    // Write bytecode
-    file.write(reinterpret_cast<const char*>(bytecode.data()), bytecode.size());
+    auto remap = [&](size_t offset) {
+        for (const auto& seg : segments) {
+            if (offset >= seg.start && offset < seg.end) return seg.new_start + (offset - seg.start);
+        }
+        return offset;  // end of code
+    };
+    for (auto& label : labels) {
+        if (label.defined) label.address = static_cast<int>(remap(label.address));
+        for (auto& fixup : label.fixup_positions) fixup = remap(fixup);
+    }
+    for (auto& site : profile_sites) site.offset = static_cast<uint32_t>(remap(site.offset));
+    for (auto& pos : data_operands) pos = remap(pos);
+    for (auto& pos : string_operands) pos = remap(pos);
+    for (auto& entry : line_entries) entry.offset = static_cast<uint32_t>(remap(entry.offset));
+    std::stable_sort(line_entries.begin(), line_entries.end(),
+                     [](const LineEntry& a, const LineEntry& b) { return a.offset < b.offset; });
+    for (auto& r : function_ranges) {
+        size_t size = r.end - r.start;
+        r.start = remap(r.start);
+        r.end = r.start + size;
+    }
+    bytecode = std::move(laid_out);
+}
+
+bool CodeGenerator::saveToFile(const std::string& filename) {
+    BinaryImage image;
+    image.strings = string_table;
+    image.code = bytecode;
+    image.compact_code = compact_code;
+    image.constants = constants.values();
+    if (!line_entries.empty()) image.debug_lines = encodeLineTable({{source_file}, line_entries});
+    image.profile_sites = profile_sites;
+    image.exception_regions = exceptionTable();
+    if (object_mode) {
+        image.object = true;
+        image.relocations = relocations;
+        image.data_cells = static_cast<uint32_t>(next_memory_addr);
+    }
+
+    // Function symbols: every declared function that was emitted, by address
+    for (const auto& sig : signatures) {
+        auto label = function_labels.find(sig.first);
+        if (label != function_labels.end() && labels[label->second].defined) {
+            image.symbols.push_back({static_cast<uint32_t>(labels[label->second].address), sig.first});
+            const auto& cells = sig.second.float_param_cells;
+            if (object_mode && std::any_of(cells.begin(), cells.end(), [](int cell) { return cell >= 0; })) {
+                image.float_params.push_back({sig.first, {cells.begin(), cells.end()}});
+            }
+        }
+    }
+    std::sort(image.symbols.begin(), image.symbols.end(), [](const FunctionSymbol& a, const FunctionSymbol& b) {
+        return std::tie(a.address, a.name) < std::tie(b.address, b.name);
+    });
+    std::sort(image.float_params.begin(), image.float_params.end(),
+              [](const FloatParamCells& a, const FloatParamCells& b) { return a.symbol < b.symbol; });
+
+    if (!writeBinary(filename, image)) {
+        std::cerr << "Error: Could not write file: " << filename << "\n";
+        return false;
+    }
     return true;
 }
 
 void CodeGenerator::dumpBytecode() const {
     std::cout << "\n=== Function Labels (Name Mangling) ===\n";
-    for (const auto& label : labels) {
-        if (label.second.defined) {
-            std::cout << "  " << label.first << " @ address " << label.second.address << std::endl;
+    std::map<std::string, int> sorted(function_labels.begin(), function_labels.end());
+    for (const auto& [name, label] : sorted) {
+        if (labels[label].defined) {
+            std::cout << "  " << name << " @ address " << labels[label].address << std::endl;
+        }
+    }
+    
+    if (!constants.values().empty()) {
+        std::cout << "\n=== Constant Pool ===\n";
+        for (size_t i = 0; i < constants.values().size(); i++) {
+            uint64_t bits = constants.values()[i];
+            std::cout << "  #" << i << " = " << constantAsInt(bits) << " / " << constantAsFloat(bits) << "\n";
         }
     }
     
     std::cout << "\n=== Generated Bytecode ===\n";
-    std::cout << "Size: " << bytecode.size() << " bytes\n\n";
+    std::cout << "Size: " << bytecode.size() << " bytes" << (compact_code ? " (compact)" : "") << "\n\n";
     
     for (size_t i = 0; i < bytecode.size(); ) {
         std::cout << std::setw(4) << std::setfill('0') << i << ": ";
-        std::cout << std::hex << std::setw(2) << std::setfill('0') 
-                  << static_cast<int>(bytecode[i]);
-        
-        Opcode op = static_cast<Opcode>(bytecode[i]);
-        i++;
+        Instruction instr;
+        if (!decodeInstruction(bytecode.data(), bytecode.size(), i, compact_code, instr)) {
+            std::cout << std::hex << std::setw(2) << std::setfill('0')
+                      << static_cast<int>(bytecode[i]) << std::dec << " ??\n";
+            i++;
+            continue;
+        }
         
-        // Show operands for instructions that have them
-        if (op == Opcode::PUSH || op == Opcode::JMP || op == Opcode::JZ || 
-            op == Opcode::JNZ || op == Opcode::JL || op == Opcode::JG ||
-            op == Opcode::JLE || op == Opcode::JGE || op == Opcode::CALL) {
-            if (i + 4 <= bytecode.size()) {
-                int32_t value = bytecode[i] | (bytecode[i+1] << 8) | 
-                               (bytecode[i+2] << 16) | (bytecode[i+3] << 24);
-                std::cout << " " << std::hex << std::setw(2) << std::setfill('0')
-                         << static_cast<int>(bytecode[i]) << " "
-                         << std::hex << std::setw(2) << std::setfill('0')
-                         << static_cast<int>(bytecode[i+1]) << " "
-                         << std::hex << std::setw(2) << std::setfill('0')
-                         << static_cast<int>(bytecode[i+2]) << " "
-                         << std::hex << std::setw(2) << std::setfill('0')
-                         << static_cast<int>(bytecode[i+3]);
-                std::cout << " (" << std::dec << value << ")";
-                i += 4;
-            }
+        // Raw bytes, then the decoded operand for instructions that have one
+        for (uint32_t k = 0; k < instr.size; k++) {
+            std::cout << (k ? " " : "") << std::hex << std::setw(2) << std::setfill('0')
+                      << static_cast<int>(bytecode[i + k]);
+        }
+        if (operandKind(instr.op) != OperandKind::NONE && operandKind(instr.op) != OperandKind::FLOAT) {
+            std::cout << " (" << std::dec << instr.operand << ")";
         }
         
         std::cout << std::dec << "\n";
+        i += instr.size;
     }
     std::cout << "\n";
 }
@@ -1320,9 +2510,18 @@ void CodeGenerator::genArraySubscript(const ArraySubscript* sub) {
     // Calculate address: base + index
     // Leaves address on stack
     
+    int32_t base;
+    if (uncheckedArrayBase(sub, known_ranges, base)) {
+        // Index proven within a static array
+        genExpression(sub->index.get());
+        emit(Opcode::LOAD_IDX_NOCHECK);
+        emitAddress(base);
+        return;
+    }
+    
     if (sub->array->kind == ASTNodeKind::IDENTIFIER) {
         auto id = static_cast<const Identifier*>(sub->array.get());
-        auto sym = findSymbol(id->name);
+        auto sym = findSymbol(id->symbol);
         
         if (sym) {
             // Push base address
@@ -1333,15 +2532,15 @@ void CodeGenerator::genArraySubscript(const ArraySubscript* sub) {
             } else if (sym->type == Symbol::VARIABLE && sym->is_heap_allocated) {
                 // For heap-allocated arrays: load the heap address from variable
                 emit(Opcode::LOAD);
-                emitInt32(sym->offset);
+                emitAddress(sym->offset);
             } else if (sym->type == Symbol::VARIABLE && sym->is_array) {
                 // For stack arrays: use the stack address
                 emit(Opcode::PUSH);
-                emitInt32(sym->offset);
+                emitAddress(sym->offset);
             } else {
                 // For regular variables/parameters
                 emit(Opcode::PUSH);
-                emitInt32(sym->offset);
+                emitAddress(sym->offset);
             }
             
             // Evaluate and push index
@@ -2,11 +2,18 @@
 #define CODEGEN_H
 
 #include "parser.h"
+#include "optimizer.h"
+#include "binfile.h"
+#include "encoding.h"
+#include "object.h"
+#include "compilecache.h"
 #include <vector>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <cstdint>
+#include <memory>
+#include <optional>
 
 enum class Opcode : uint8_t {
     PUSH        = 0x01,
@@ -43,6 +50,21 @@ enum class Opcode : uint8_t {
     STORE_INDIRECT = 0x28,  // Pop addr, pop value, store mem[addr] = value
     ALLOC       = 0x29,     // Pop size, allocate heap memory, push address
     FREE        = 0x2A,     // Pop address, free heap memory
+    MEMO_ENTER  = 0x2B,     // read argc(int32); return cached result for the current args, if any
+    MEMO_STORE  = 0x2C,     // cache the result on top of stack for the args seen by MEMO_ENTER
+    THROW       = 0x2D,     // pop type tag, pop value; unwind to the handler in the exception table
+    LOAD_CONST  = 0x2E,     // read pool index, push the constant as an int
+
+    // Unchecked variants, emitted only where range analysis proves them safe
+    DIV_NOCHECK       = 0x40,  // DIV without the zero-divisor check
+    MOD_NOCHECK       = 0x41,  // MOD without the zero-divisor check
+    FDIV_NOCHECK      = 0x42,  // FDIV without the 0.0f check
+    LOAD_IDX_NOCHECK  = 0x43,  // read base(int32), pop index, push mem[base+index] (no bounds check)
+    STORE_IDX_NOCHECK = 0x44,  // read base(int32), pop index, pop value, mem[base+index] = value
+
+    // Float parameter cells kept across a call that may reenter the caller
+    FSAVE       = 0x48,  // read addr(int32), push the bits of float_memory[addr] to the int stack
+    FRESTORE    = 0x49,  // read addr(int32), pop the int stack into float_memory[addr] as bits
 
     // FPU (x87-style circular register stack, 8 slots)
     FPUSH       = 0x30,  // 4-byte float immediate → push to FPU stack
@@ -59,6 +81,18 @@ enum class Opcode : uint8_t {
     FDUP        = 0x3B,  // push copy of ST0
     INT_TO_FP   = 0x3C,  // pop int stack, convert, push to FPU
     FP_TO_INT   = 0x3D,  // pop FPU, truncate, push to int stack
+    FLOAD_CONST = 0x3E,  // read pool index, push the constant to the FPU
+
+    // Compact short forms with a one-byte operand (see encoding.h)
+    PUSH_I8     = 0x50,
+    LOAD_U8     = 0x51,
+    JMP_S8      = 0x58,
+    JZ_S8       = 0x59,
+    JNZ_S8      = 0x5A,
+    JL_S8       = 0x5B,
+    JG_S8       = 0x5C,
+    JLE_S8      = 0x5D,
+    JGE_S8      = 0x5E,
 
     HALT        = 0xFF
 };
@@ -66,13 +100,14 @@ enum class Opcode : uint8_t {
 // Symbol information
 struct Symbol {
     enum Type { VARIABLE, FUNCTION, PARAMETER };
-    Type type;
-    int offset;      // Stack offset for variables/params
-    int address;     // Code address for functions
-    int param_count; // For functions
-    bool is_array;   // True if this is an array or pointer
-    bool is_heap_allocated; // True if allocated with "new"
-    bool is_float;   // True if this is a float/double variable
+    Type type = VARIABLE;
+    int offset = 0;      // Stack offset for variables/params
+    int address = 0;     // Code address for functions
+    int param_count = 0; // For functions
+    bool is_array = false;   // True if this is an array or pointer
+    bool is_heap_allocated = false; // True if allocated with "new"
+    bool is_float = false;   // True if this is a float/double variable
+    int array_size = 0;      // Element count of a fixed-size static array (0 if unknown)
 };
 
 class CodeGenerator {
@@ -91,13 +126,158 @@ public:
     // Display bytecode (for debugging)
     void dumpBytecode() const;
     
+    // Enable/disable AST optimization passes (on by default)
+    void setOptimize(bool enabled) { optimize = enabled; }
+    
+    // Profile from `vm --profile-out`, used for code layout and specialization
+    void setProfile(const ProfileData& data) { profile = data; has_profile = true; }
+    
+    // Source file named in the line table
+    void setSourceFile(const std::string& file) { source_file = file; }
+    
+    // Emit a relocatable object for goclink (object.h) instead of a program
+    void setObjectMode(bool enabled) { object_mode = enabled; }
+    
+    // Reuse and fill the function layer of a compilation cache (compilecache.h);
+    // `tokens` are the ones the program was parsed from
+    void setCache(CompileCache* c, const std::vector<Token>* tokens) { cache = c; source_tokens = tokens; }
+    size_t cachedFunctions() const { return functions_reused; }
+    
 private:
     std::vector<uint8_t> bytecode;
-    std::unordered_map<std::string, Symbol> symbols;
+    std::unordered_map<SymbolId, Symbol> symbols;   // By interned name
     std::unordered_set<std::string> class_names;  // Track class/struct names
     std::vector<std::string> string_table;        // String literals
+    std::unordered_map<std::string, int> string_ids;  // Index into string_table
+    ConstantPool constants;                       // Filled by fixupLabels when compacting
     int current_offset;     // Current stack offset
     int next_memory_addr;   // Next available memory address
+    bool optimize;
+    
+    // Function specialization: clones of functions with constant arguments
+    struct SpecializedCall {
+        std::string name;              // Mangled name of the clone
+        std::vector<size_t> kept_args; // Indices of arguments still passed at runtime
+    };
+    std::vector<std::pair<std::string, ASTNodePtr>> specialized_functions;
+    std::unordered_map<const CallExpr*, SpecializedCall> specialized_calls;
+    
+    // Templates: one clone per distinct argument list, generated after the rest of the program
+    std::unordered_map<std::string, const TemplateDecl*> function_templates;
+    std::unordered_map<const CallExpr*, std::string> template_calls;          // call -> instance label
+    std::unordered_set<std::string> instantiated_templates;
+    std::vector<ASTNodePtr> template_instances;                                 // Owns the substituted clones
+    std::vector<std::pair<std::string, const FunctionDecl*>> pending_instances; // Functions still to generate
+    
+    // Float parameters are passed in a static float cell per parameter (the int
+    // stack gets a placeholder) and float results are left on the FPU. A call
+    // that may reenter the caller overwrites its cells, so callers with float
+    // parameters keep them on the int stack across every call (FSAVE/FRESTORE).
+    struct FunctionSignature {
+        std::vector<int> float_param_cells; // Per parameter: float cell, or -1 for an int parameter
+        bool returns_float = false;
+    };
+    std::unordered_map<std::string, FunctionSignature> signatures;
+    bool current_function_returns_float;
+    std::vector<int> current_float_param_cells;  // Cells of the function being generated
+    
+    // Exception handling: try regions by label (resolved when saving), with their
+    // handlers generated after the epilogue of the enclosing function
+    struct TryRegion {
+        int start;
+        int end;
+        int handler;
+    };
+    struct PendingHandler {
+        const TryStmt* stmt;
+        int handler;
+        int resume;   // Code after the try statement
+        std::vector<int> enclosing;  // Handlers of the try bodies around it, outermost first
+    };
+    std::vector<TryRegion> try_regions;
+    std::vector<PendingHandler> pending_handlers;
+    std::vector<int> active_try_handlers;                // Try bodies being generated, outermost first
+    std::vector<std::pair<int, int>> active_exceptions;  // Value/tag cells of the handlers being generated
+    
+    // Memoization: pure recursive functions whose results the VM caches
+    std::unordered_set<std::string> memoized_functions;
+    bool current_function_memoized;
+    
+    // Range analysis: induction variable ranges of the loops being generated
+    RangeMap known_ranges;
+    
+    // Profile-guided optimization
+    struct FunctionRange {
+        size_t start;   // Bytecode range of one emitted function
+        size_t end;
+        int line;       // Source position of its declaration (profile key)
+        int column;
+    };
+    std::vector<ProfileSite> profile_sites;    // Saved after the code for `vm --profile-out`
+    std::vector<FunctionRange> function_ranges;
+    ProfileData profile;
+    bool has_profile;
+    bool compact_code = false;  // Set once fixupLabels has relaxed the code
+    void addProfileSite(ProfileSiteKind kind, const ASTNode* node, size_t offset);
+    const ProfileCounts* profileCounts(ProfileSiteKind kind, int line, int column) const;
+    void layoutFunctionsHotFirst();
+    
+    // Debug line table (debuginfo.h), remapped along with the profile sites
+    std::string source_file;
+    std::vector<LineEntry> line_entries;
+    void recordLine(int line);
+    
+    // Object mode: operand positions the linker relocates (object.h)
+    bool object_mode = false;
+    std::vector<size_t> data_operands;
+    std::vector<size_t> string_operands;
+    std::vector<Relocation> relocations;   // Built by fixupLabels
+    
+    // Function layer of the compilation cache: a function generated on a miss
+    // is recorded (everything it adds to the shared tables, and every outer
+    // symbol it looked up) and stored; a hit replays the record instead
+    struct FunctionRecording {
+        uint64_t key;
+        size_t start;            // First byte after the entry label
+        int first_label;
+        int data_start;
+        size_t data_operands;    // Table sizes at the start
+        size_t string_operands;
+        size_t profile_sites;
+        size_t try_regions;
+        size_t signatures;
+        size_t pending_instances;
+        size_t instantiated_templates;
+        std::vector<std::pair<size_t, int>> jumps;
+        std::vector<int> defined_labels;
+        std::vector<std::pair<size_t, int>> lines;
+        std::vector<CachedFunction::LimitCheck> limit_checks;
+        std::unordered_set<SymbolId> seen_symbols;
+        std::vector<std::pair<SymbolId, std::optional<Symbol>>> lookups;
+        std::vector<SymbolId> defined_symbols;
+    };
+    CompileCache* cache = nullptr;
+    const std::vector<Token>* source_tokens = nullptr;
+    uint64_t program_hash = 0;
+    std::unordered_set<const FunctionDecl*> cacheable_functions;
+    std::unique_ptr<FunctionRecording> recording;
+    size_t functions_reused = 0;
+    uint64_t functionKey(const FunctionDecl* func, const std::string& name) const;
+    bool replayFunction(uint64_t key, const FunctionDecl* func);
+    void storeFunction(const FunctionDecl* func);
+    void noteSymbolDefinition(SymbolId id);
+    void recordLineAt(uint32_t offset, int line);
+    
+    // Optimization passes
+    void specializeFunctions(const Program& prog);
+    void selectMemoizedFunctions(const Program& prog);
+    std::string callTargetName(const CallExpr* call) const;
+    std::string resolveCall(const CallExpr* call);
+    bool isTemplateCall(const CallExpr* call) const;
+    std::string instantiateFunctionTemplate(const CallExpr* call);
+    void declareFunction(const FunctionDecl* func, const std::string& label);
+    bool uncheckedArrayBase(const ArraySubscript* sub, const RangeMap& ranges, int32_t& base);
+    bool isNonZeroDivisor(const ASTNode* node);
     
     // Code generation for different AST nodes
     void genProgram(const Program& prog);
@@ -111,6 +291,10 @@ private:
     void genWhile(const WhileStmt* whilestmt);
     void genFor(const ForStmt* forstmt);
     void genReturn(const ReturnStmt* ret);
+    void genTry(const TryStmt* stmt);
+    void genThrow(const ThrowStmt* stmt);
+    void genPendingHandlers();
+    std::vector<ExceptionRegion> exceptionTable() const;
     void genBinaryOp(const BinaryOp* binop);
     void genUnaryOp(const UnaryOp* unop);
     void genCall(const CallExpr* call);
@@ -123,28 +307,34 @@ private:
     void emitByte(uint8_t byte);
     void emitInt32(int32_t value);
     void emitInt32At(size_t pos, int32_t value);
+    void emitAddress(int32_t addr);
+    void emitStringId(int32_t id);
     size_t currentAddress() const { return bytecode.size(); }
     
-    // Label management for jumps
+    // Label management for jumps: labels are IDs into `labels`; functions are
+    // labelled by mangled name through function_labels
     struct Label {
         std::vector<size_t> fixup_positions;
-        int address;
-        bool defined;
+        int address = 0;
+        bool defined = false;
     };
-    std::unordered_map<std::string, Label> labels;
-    int label_counter;
+    std::vector<Label> labels;
+    std::unordered_map<std::string, int> function_labels;
     
-    std::string makeLabel(const std::string& prefix);
-    void defineLabel(const std::string& label);
-    void emitJump(Opcode op, const std::string& label);
+    int makeLabel();
+    int functionLabel(const std::string& name);
+    void defineLabel(int label);
+    void emitJump(Opcode op, int label);
     void fixupLabels();
+    void fixupObjectLabels();
     
     // String table management
     int addString(const std::string& str);
     
     // Name mangling for function overloading
-    std::string mangleFunctionName(const std::string& name, int param_count);
-    std::string mangleFunctionName(const std::string& name, const std::vector<std::pair<std::vector<std::string>, std::string>>& params);
+    static std::string mangleTypeName(const std::vector<std::string>& typeTokens);
+    std::string mangleFunctionName(const std::string& name, int param_count) const;
+    std::string mangleFunctionName(const std::string& name, const std::vector<std::pair<std::vector<std::string>, std::string>>& params) const;
     
     // Symbol table management
     void enterScope();
@@ -152,7 +342,8 @@ private:
     void addVariable(const std::string& name, int offset, bool is_array = false, bool is_heap_allocated = false, bool is_float = false);
     void addParameter(const std::string& name, int offset);
     void addFunction(const std::string& name, int address, int param_count);
-    Symbol* findSymbol(const std::string& name);
+    Symbol* findSymbol(SymbolId id);
+    Symbol* findSymbol(const std::string& name) { return findSymbol(internSymbol(name)); }
 
     // Float helpers
     static bool isFloatLiteralStr(const std::string& s);
@@ -0,0 +1,282 @@
+#include "compilecache.h"
+#include "mappedfile.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+// ---- Hashing ----
+
+ContentHash& ContentHash::add(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        state ^= bytes[i];
+        state *= 1099511628211ull;
+    }
+    return *this;
+}
+
+ContentHash& ContentHash::add(std::string_view str) {
+    add(static_cast<uint64_t>(str.size()));
+    return add(str.data(), str.size());
+}
+
+ContentHash& ContentHash::add(uint64_t value) {
+    return add(&value, sizeof(value));
+}
+
+// ---- Function entries ----
+
+namespace {
+
+class Writer {
+public:
+    std::vector<uint8_t> out;
+    void u32(uint32_t value) {
+        uint8_t bytes[4];
+        std::memcpy(bytes, &value, 4);
+        out.insert(out.end(), bytes, bytes + 4);
+    }
+    void str(const std::string& value) {
+        u32(value.size());
+        out.insert(out.end(), value.begin(), value.end());
+    }
+    void symbol(const CachedSymbol& sym) {
+        str(sym.name);
+        out.push_back(sym.present);
+        out.push_back(sym.local);
+        out.push_back(sym.type);
+        out.push_back(sym.flags);
+        u32(sym.offset);
+        u32(sym.address);
+        u32(sym.param_count);
+        u32(sym.array_size);
+    }
+};
+
+class Reader {
+public:
+    Reader(const std::vector<uint8_t>& data) : data(data) {}
+    bool ok = true;
+    bool done() const { return ok && pos == data.size(); }
+    uint32_t u32() {
+        uint32_t value = 0;
+        if (data.size() - pos < 4) {
+            ok = false;
+            return 0;
+        }
+        std::memcpy(&value, data.data() + pos, 4);
+        pos += 4;
+        return value;
+    }
+    int32_t i32() { return static_cast<int32_t>(u32()); }
+    void bytes(std::vector<uint8_t>& out, uint32_t n) {
+        if (!ok) return;
+        out.assign(data.begin() + pos, data.begin() + pos + n);
+        pos += n;
+    }
+    uint8_t u8() {
+        if (pos >= data.size()) {
+            ok = false;
+            return 0;
+        }
+        return data[pos++];
+    }
+    std::string str() {
+        uint32_t size = u32();
+        if (!ok || size > data.size() - pos) {
+            ok = false;
+            return "";
+        }
+        std::string value(reinterpret_cast<const char*>(data.data() + pos), size);
+        pos += size;
+        return value;
+    }
+    // Element count for a table; rejects counts the remaining bytes cannot hold
+    uint32_t count() {
+        uint32_t n = u32();
+        if (n > data.size() - pos) ok = false;
+        return ok ? n : 0;
+    }
+    CachedSymbol symbol() {
+        CachedSymbol sym;
+        sym.name = str();
+        sym.present = u8() != 0;
+        sym.local = u8() != 0;
+        sym.type = u8();
+        sym.flags = u8();
+        sym.offset = i32();
+        sym.address = i32();
+        sym.param_count = i32();
+        sym.array_size = i32();
+        return sym;
+    }
+
+private:
+    const std::vector<uint8_t>& data;
+    size_t pos = 0;
+};
+
+}  // namespace
+
+std::vector<uint8_t> encodeCachedFunction(const CachedFunction& function) {
+    Writer w;
+    w.u32(function.code.size());
+    w.out.insert(w.out.end(), function.code.begin(), function.code.end());
+    w.u32(function.data_operands.size());
+    for (uint32_t offset : function.data_operands) w.u32(offset);
+    w.u32(function.outer_operands.size());
+    for (uint32_t offset : function.outer_operands) w.u32(offset);
+    w.u32(function.string_operands.size());
+    for (uint32_t offset : function.string_operands) w.u32(offset);
+    w.u32(function.strings.size());
+    for (const auto& str : function.strings) w.str(str);
+    w.u32(function.data_cells);
+    w.u32(function.local_labels);
+    w.u32(function.fixups.size());
+    for (const auto& fixup : function.fixups) {
+        w.u32(fixup.offset);
+        w.u32(fixup.label);
+        w.str(fixup.function);
+    }
+    w.u32(function.labels.size());
+    for (const auto& label : function.labels) {
+        w.u32(label.label);
+        w.u32(label.offset);
+    }
+    w.u32(function.try_regions.size());
+    for (const auto& region : function.try_regions) {
+        w.u32(region.start);
+        w.u32(region.end);
+        w.u32(region.handler);
+    }
+    w.u32(function.profile_sites.size());
+    for (const auto& site : function.profile_sites) {
+        w.u32(site.offset);
+        w.u32(site.kind);
+        w.u32(site.line);
+        w.u32(site.column);
+    }
+    w.u32(function.lines.size());
+    for (const auto& line : function.lines) {
+        w.u32(line.offset);
+        w.u32(line.line);
+    }
+    w.u32(function.limit_checks.size());
+    for (const auto& check : function.limit_checks) {
+        w.u32(check.end);
+        w.u32(check.fits);
+    }
+    w.u32(function.lookups.size());
+    for (const auto& sym : function.lookups) w.symbol(sym);
+    w.u32(function.definitions.size());
+    for (const auto& sym : function.definitions) w.symbol(sym);
+    return w.out;
+}
+
+bool parseCachedFunction(const std::vector<uint8_t>& payload, CachedFunction& function) {
+    Reader r(payload);
+    function = CachedFunction();
+    r.bytes(function.code, r.count());
+    for (uint32_t i = 0, n = r.count(); i < n; i++) function.data_operands.push_back(r.u32());
+    for (uint32_t i = 0, n = r.count(); i < n; i++) function.outer_operands.push_back(r.u32());
+    for (uint32_t i = 0, n = r.count(); i < n; i++) function.string_operands.push_back(r.u32());
+    for (uint32_t i = 0, n = r.count(); i < n; i++) function.strings.push_back(r.str());
+    function.data_cells = r.u32();
+    function.local_labels = r.u32();
+    for (uint32_t i = 0, n = r.count(); i < n; i++) {
+        CachedFunction::Fixup fixup;
+        fixup.offset = r.u32();
+        fixup.label = r.i32();
+        fixup.function = r.str();
+        function.fixups.push_back(std::move(fixup));
+    }
+    for (uint32_t i = 0, n = r.count(); i < n; i++) {
+        CachedFunction::LabelDef label;
+        label.label = r.u32();
+        label.offset = r.u32();
+        function.labels.push_back(label);
+    }
+    for (uint32_t i = 0, n = r.count(); i < n; i++) {
+        CachedFunction::TryRegion region;
+        region.start = r.u32();
+        region.end = r.u32();
+        region.handler = r.u32();
+        function.try_regions.push_back(region);
+    }
+    for (uint32_t i = 0, n = r.count(); i < n; i++) {
+        CachedFunction::Site site;
+        site.offset = r.u32();
+        site.kind = r.u32();
+        site.line = r.i32();
+        site.column = r.i32();
+        function.profile_sites.push_back(site);
+    }
+    for (uint32_t i = 0, n = r.count(); i < n; i++) {
+        CachedFunction::Line line;
+        line.offset = r.u32();
+        line.line = r.i32();
+        function.lines.push_back(line);
+    }
+    for (uint32_t i = 0, n = r.count(); i < n; i++) {
+        CachedFunction::LimitCheck check;
+        check.end = r.u32();
+        check.fits = r.u32() != 0;
+        function.limit_checks.push_back(check);
+    }
+    for (uint32_t i = 0, n = r.count(); i < n; i++) function.lookups.push_back(r.symbol());
+    for (uint32_t i = 0, n = r.count(); i < n; i++) function.definitions.push_back(r.symbol());
+    if (!r.done()) return false;
+
+    // Everything the entry points at must lie inside it
+    auto operandFits = [&](uint32_t offset) { return offset <= function.code.size() && function.code.size() - offset >= 4; };
+    for (uint32_t offset : function.data_operands) if (!operandFits(offset)) return false;
+    for (uint32_t offset : function.outer_operands) if (!operandFits(offset)) return false;
+    for (uint32_t offset : function.string_operands) {
+        if (!operandFits(offset)) return false;
+        int32_t index;
+        std::memcpy(&index, function.code.data() + offset, 4);
+        if (index < 0 || static_cast<size_t>(index) >= function.strings.size()) return false;
+    }
+    for (const auto& fixup : function.fixups) {
+        if (!operandFits(fixup.offset) || fixup.label >= static_cast<int32_t>(function.local_labels) ||
+            (fixup.label < 0 && fixup.function.empty())) return false;
+    }
+    for (const auto& label : function.labels) {
+        if (label.label >= function.local_labels || label.offset > function.code.size()) return false;
+    }
+    for (const auto& region : function.try_regions) {
+        if (region.start >= function.local_labels || region.end >= function.local_labels ||
+            region.handler >= function.local_labels) return false;
+    }
+    return true;
+}
+
+// ---- Storage ----
+
+CompileCache::CompileCache(const std::string& dir) : directory(dir) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+}
+
+std::string CompileCache::entryPath(uint64_t key, const char* kind) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.", static_cast<unsigned long long>(key));
+    return directory + "/" + name + kind;
+}
+
+bool CompileCache::load(uint64_t key, const char* kind, std::vector<uint8_t>& data) {
+    std::ifstream in(entryPath(key, kind), std::ios::binary);
+    if (!in) {
+        miss_count++;
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    hit_count++;
+    return true;
+}
+
+bool CompileCache::store(uint64_t key, const char* kind, const std::vector<uint8_t>& data) {
+    return replaceFile(entryPath(key, kind), data.data(), data.size());
+}
@@ -0,0 +1,119 @@
+#ifndef COMPILECACHE_H
+#define COMPILECACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Persistent compilation cache (goc --cache-dir=<dir>).
+//
+// Two layers, both content-addressed by a 64-bit FNV-1a hash:
+//   <key>.bin  the finished output, keyed by the source, the compiler
+//              version, the flags and the profile
+//   <key>.fn   one function's bytecode before label resolution (CachedFunction),
+//              keyed by the function's token range and the program-wide facts
+//              its code depends on. After an edit only the changed functions
+//              are generated again; the others are copied in with their
+//              labels, strings and static memory cells re-resolved.
+// Entries are written to a temporary file and renamed into place, so
+// compilers sharing a directory never read a partial entry.
+
+const uint32_t kCacheFormatVersion = 4;  // Bump when codegen output changes
+
+class ContentHash {
+public:
+    ContentHash& add(const void* data, size_t size);
+    ContentHash& add(std::string_view str);  // Length-prefixed
+    ContentHash& add(uint64_t value);
+    uint64_t value() const { return state; }
+
+private:
+    uint64_t state = 14695981039346656037ull;
+};
+
+// A symbol table entry the cached code depends on or defines
+struct CachedSymbol {
+    std::string name;
+    bool present = true;   // Lookups: false if the name was not defined
+    bool local = false;    // Offset is relative to the function's first static cell
+    uint8_t type = 0;
+    uint8_t flags = 0;     // is_array, is_heap_allocated, is_float
+    int32_t offset = 0;
+    int32_t address = 0;
+    int32_t param_count = 0;
+    int32_t array_size = 0;
+};
+
+// One function body in the wide encoding. Offsets are relative to the start
+// of the body; local labels are numbered from 0 in order of creation.
+struct CachedFunction {
+    struct Fixup {
+        uint32_t offset;
+        int32_t label;         // Local label, or -1 for a call to `function`
+        std::string function;
+    };
+    struct LabelDef {
+        uint32_t label;
+        uint32_t offset;
+    };
+    struct TryRegion {
+        uint32_t start;        // Local labels
+        uint32_t end;
+        uint32_t handler;
+    };
+    struct Site {
+        uint32_t offset;
+        uint32_t kind;
+        int32_t line;          // Relative to the declaration's line
+        int32_t column;
+    };
+    struct Line {
+        uint32_t offset;
+        int32_t line;          // Relative to the declaration's line
+    };
+    struct LimitCheck {
+        uint32_t end;          // End of a local array, relative to the first cell
+        bool fits;             // Whether it was within the VM's initial static memory
+    };
+
+    std::vector<uint8_t> code;
+    std::vector<uint32_t> data_operands;    // Operands holding a local cell
+    std::vector<uint32_t> outer_operands;   // Operands holding a cell allocated before the function
+    std::vector<uint32_t> string_operands;  // Operands holding an index into `strings`
+    std::vector<std::string> strings;
+    uint32_t data_cells = 0;                // Static cells the function allocates
+    uint32_t local_labels = 0;
+    std::vector<Fixup> fixups;
+    std::vector<LabelDef> labels;
+    std::vector<TryRegion> try_regions;
+    std::vector<Site> profile_sites;
+    std::vector<Line> lines;                // recordLine calls, in order
+    std::vector<LimitCheck> limit_checks;
+    std::vector<CachedSymbol> lookups;      // Outer symbols the code was generated against
+    std::vector<CachedSymbol> definitions;  // Symbols the function leaves defined
+};
+
+std::vector<uint8_t> encodeCachedFunction(const CachedFunction& function);
+bool parseCachedFunction(const std::vector<uint8_t>& payload, CachedFunction& function);
+
+class CompileCache {
+public:
+    explicit CompileCache(const std::string& directory);
+
+    // Entry `key` of a kind ("bin" or "fn"); false if missing or unreadable
+    bool load(uint64_t key, const char* kind, std::vector<uint8_t>& data);
+    bool store(uint64_t key, const char* kind, const std::vector<uint8_t>& data);
+
+    size_t hits() const { return hit_count; }
+    size_t misses() const { return miss_count; }
+
+private:
+    std::string directory;
+    size_t hit_count = 0;
+    size_t miss_count = 0;
+    std::string entryPath(uint64_t key, const char* kind) const;
+};
+
+#endif // COMPILECACHE_H
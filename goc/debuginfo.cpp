@@ -0,0 +1,57 @@
+#include "debuginfo.h"
+#include "encoding.h"
+#include <algorithm>
+
+std::vector<uint8_t> encodeLineTable(const LineTable& table) {
+    std::vector<uint8_t> payload;
+    appendSLEB128(payload, static_cast<int32_t>(table.files.size()));
+    for (const auto& file : table.files) {
+        appendSLEB128(payload, static_cast<int32_t>(file.size()));
+        payload.insert(payload.end(), file.begin(), file.end());
+    }
+    appendSLEB128(payload, static_cast<int32_t>(table.entries.size()));
+    LineEntry prev{0, 0};
+    for (const auto& entry : table.entries) {
+        appendSLEB128(payload, static_cast<int32_t>(entry.offset - prev.offset));
+        appendSLEB128(payload, entry.line - prev.line);
+        appendSLEB128(payload, static_cast<int32_t>(entry.file));
+        prev = entry;
+    }
+    return payload;
+}
+
+bool parseLineTable(const std::vector<uint8_t>& payload, LineTable& table) {
+    size_t pos = 0;
+    int32_t file_count = 0, count = 0;
+    if (!readSLEB128(payload.data(), payload.size(), pos, file_count) || file_count < 0) return false;
+    table.files.clear();
+    for (int32_t i = 0; i < file_count; i++) {
+        int32_t length = 0;
+        if (!readSLEB128(payload.data(), payload.size(), pos, length) || length < 0 ||
+            static_cast<size_t>(length) > payload.size() - pos) return false;
+        table.files.emplace_back(reinterpret_cast<const char*>(payload.data() + pos), length);
+        pos += length;
+    }
+    if (!readSLEB128(payload.data(), payload.size(), pos, count) || count < 0) return false;
+
+    table.entries.clear();
+    LineEntry entry{0, 0};
+    for (int32_t i = 0; i < count; i++) {
+        int32_t offset_delta = 0, line_delta = 0, file = 0;
+        if (!readSLEB128(payload.data(), payload.size(), pos, offset_delta) || offset_delta < 0 ||
+            !readSLEB128(payload.data(), payload.size(), pos, line_delta) ||
+            !readSLEB128(payload.data(), payload.size(), pos, file) || file < 0 || file >= file_count) return false;
+        entry.offset += offset_delta;
+        entry.line += line_delta;
+        entry.file = static_cast<uint32_t>(file);
+        table.entries.push_back(entry);
+    }
+    return pos == payload.size();
+}
+
+const LineEntry* findLine(const LineTable& table, uint32_t offset) {
+    auto it = std::upper_bound(table.entries.begin(), table.entries.end(), offset,
+                               [](uint32_t value, const LineEntry& entry) { return value < entry.offset; });
+    if (it == table.entries.begin()) return nullptr;
+    return &*std::prev(it);
+}
@@ -0,0 +1,38 @@
+#ifndef DEBUGINFO_H
+#define DEBUGINFO_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Source line table shared by the compiler, the VM and gocopt.
+//
+// The compiler records the source line at the start of every statement and
+// function, and stores the table in the DEBUG_LINES section of the .bin file
+// (binfile.h). The VM keeps the section undecoded until an error, --stats or
+// a profile needs a source position. Function names come from the SYMBOLS
+// section.
+
+// Code from `offset` up to the next entry's offset belongs to `line` of
+// files[file] (a linked program has code from several files)
+struct LineEntry {
+    uint32_t offset;
+    int32_t line;
+    uint32_t file = 0;
+};
+
+struct LineTable {
+    std::vector<std::string> files;
+    std::vector<LineEntry> entries;  // Ascending offsets
+};
+
+// Payload: LEB128 file count, then LEB128 length + name per file, LEB128 entry
+// count, then per entry the offset and line as LEB128 deltas from the previous
+// entry and the file index
+std::vector<uint8_t> encodeLineTable(const LineTable& table);
+bool parseLineTable(const std::vector<uint8_t>& payload, LineTable& table);
+
+// Entry covering `offset`, or null if it precedes the first one
+const LineEntry* findLine(const LineTable& table, uint32_t offset);
+
+#endif // DEBUGINFO_H
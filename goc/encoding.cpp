@@ -0,0 +1,327 @@
+#include "encoding.h"
+#include "vm.h"
+#include <cstring>
+
+bool isKnownOpcode(uint8_t op) {
+    switch (static_cast<VMOpcode>(op)) {
+        case VMOpcode::PUSH: case VMOpcode::POP: case VMOpcode::ADD: case VMOpcode::SUB:
+        case VMOpcode::MUL: case VMOpcode::DIV: case VMOpcode::MOD: case VMOpcode::DUP:
+        case VMOpcode::SWAP: case VMOpcode::PRINT: case VMOpcode::PRINT_STR: case VMOpcode::INPUT_STR:
+        case VMOpcode::INPUT: case VMOpcode::JMP: case VMOpcode::JZ: case VMOpcode::JNZ:
+        case VMOpcode::JL: case VMOpcode::JG: case VMOpcode::JLE: case VMOpcode::JGE:
+        case VMOpcode::CMP: case VMOpcode::CALL: case VMOpcode::RET: case VMOpcode::LOAD:
+        case VMOpcode::STORE: case VMOpcode::LOAD_BP: case VMOpcode::STORE_BP: case VMOpcode::PUSH_BP:
+        case VMOpcode::POP_BP: case VMOpcode::PUSH_STR: case VMOpcode::LOAD_INDIRECT:
+        case VMOpcode::STORE_INDIRECT: case VMOpcode::ALLOC: case VMOpcode::FREE:
+        case VMOpcode::MEMO_ENTER: case VMOpcode::MEMO_STORE: case VMOpcode::THROW:
+        case VMOpcode::LOAD_CONST: case VMOpcode::FLOAD_CONST:
+        case VMOpcode::DIV_NOCHECK: case VMOpcode::MOD_NOCHECK: case VMOpcode::FDIV_NOCHECK:
+        case VMOpcode::LOAD_IDX_NOCHECK: case VMOpcode::STORE_IDX_NOCHECK:
+        case VMOpcode::FSAVE: case VMOpcode::FRESTORE:
+        case VMOpcode::FPUSH: case VMOpcode::FPOP: case VMOpcode::FADD: case VMOpcode::FSUB:
+        case VMOpcode::FMUL: case VMOpcode::FDIV: case VMOpcode::FLOAD: case VMOpcode::FSTORE:
+        case VMOpcode::FPRINT: case VMOpcode::FCMP: case VMOpcode::FNEG: case VMOpcode::FDUP:
+        case VMOpcode::INT_TO_FP: case VMOpcode::FP_TO_INT:
+        case VMOpcode::PUSH_I8: case VMOpcode::LOAD_U8:
+        case VMOpcode::JMP_S8: case VMOpcode::JZ_S8: case VMOpcode::JNZ_S8: case VMOpcode::JL_S8:
+        case VMOpcode::JG_S8: case VMOpcode::JLE_S8: case VMOpcode::JGE_S8:
+        case VMOpcode::HALT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+OperandKind operandKind(uint8_t op) {
+    switch (static_cast<VMOpcode>(op)) {
+        case VMOpcode::PUSH: case VMOpcode::LOAD: case VMOpcode::LOAD_BP: case VMOpcode::STORE_BP:
+        case VMOpcode::PUSH_STR: case VMOpcode::FLOAD: case VMOpcode::FSTORE: case VMOpcode::MEMO_ENTER:
+        case VMOpcode::LOAD_IDX_NOCHECK: case VMOpcode::STORE_IDX_NOCHECK:
+        case VMOpcode::LOAD_CONST: case VMOpcode::FLOAD_CONST: case VMOpcode::FSAVE: case VMOpcode::FRESTORE:
+            return OperandKind::INT;
+        case VMOpcode::JMP: case VMOpcode::JZ: case VMOpcode::JNZ: case VMOpcode::JL:
+        case VMOpcode::JG: case VMOpcode::JLE: case VMOpcode::JGE: case VMOpcode::CALL:
+            return OperandKind::TARGET;
+        case VMOpcode::FPUSH:
+            return OperandKind::FLOAT;
+        case VMOpcode::PUSH_I8: case VMOpcode::LOAD_U8:
+            return OperandKind::BYTE;
+        case VMOpcode::JMP_S8: case VMOpcode::JZ_S8: case VMOpcode::JNZ_S8: case VMOpcode::JL_S8:
+        case VMOpcode::JG_S8: case VMOpcode::JLE_S8: case VMOpcode::JGE_S8:
+            return OperandKind::SHORT_TARGET;
+        default:
+            return OperandKind::NONE;
+    }
+}
+
+// The short jumps are numbered in the order of JMP..JGE
+static const uint8_t kShortJumpBase = static_cast<uint8_t>(VMOpcode::JMP_S8);
+static const uint8_t kWideJumpBase = static_cast<uint8_t>(VMOpcode::JMP);
+
+uint8_t wideOpcode(uint8_t op) {
+    switch (static_cast<VMOpcode>(op)) {
+        case VMOpcode::PUSH_I8: return static_cast<uint8_t>(VMOpcode::PUSH);
+        case VMOpcode::LOAD_U8: return static_cast<uint8_t>(VMOpcode::LOAD);
+        default: break;
+    }
+    if (operandKind(op) == OperandKind::SHORT_TARGET) return op - kShortJumpBase + kWideJumpBase;
+    return op;
+}
+
+void appendSLEB128(std::vector<uint8_t>& out, int32_t value) {
+    int64_t v = value;
+    while (true) {
+        uint8_t byte = v & 0x7F;
+        v >>= 7;
+        bool done = (v == 0 && !(byte & 0x40)) || (v == -1 && (byte & 0x40));
+        out.push_back(done ? byte : (byte | 0x80));
+        if (done) return;
+    }
+}
+
+bool readSLEB128(const uint8_t* code, size_t size, size_t& pos, int32_t& value) {
+    int64_t result = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        if (pos >= size || shift >= 35) return false;
+        byte = code[pos++];
+        result |= static_cast<int64_t>(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    if (shift < 64 && (byte & 0x40)) result |= -(static_cast<int64_t>(1) << shift);
+    value = static_cast<int32_t>(result);
+    return true;
+}
+
+static size_t sleb128Size(int32_t value) {
+    size_t n = 1;
+    while (value >= 64 || value < -64) {
+        value >>= 7;
+        n++;
+    }
+    return n;
+}
+
+uint32_t ConstantPool::add(uint64_t bits) {
+    auto it = index.find(bits);
+    if (it != index.end()) return it->second;
+    uint32_t id = static_cast<uint32_t>(entries.size());
+    entries.push_back(bits);
+    index[bits] = id;
+    return id;
+}
+
+uint32_t ConstantPool::addInt(int64_t value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return add(bits);
+}
+
+uint32_t ConstantPool::addFloat(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return add(bits);
+}
+
+void ConstantPool::clear() {
+    entries.clear();
+    index.clear();
+}
+
+int64_t constantAsInt(uint64_t bits) {
+    int64_t value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+double constantAsFloat(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+bool decodeInstruction(const uint8_t* code, size_t size, size_t pos, bool compact, Instruction& out) {
+    if (pos >= size || !isKnownOpcode(code[pos])) return false;
+    out.op = code[pos];
+    out.operand = 0;
+    size_t p = pos + 1;
+    switch (operandKind(out.op)) {
+        case OperandKind::NONE:
+            break;
+        case OperandKind::INT:
+        case OperandKind::TARGET:
+            if (compact) {
+                if (!readSLEB128(code, size, p, out.operand)) return false;
+                break;
+            }
+            [[fallthrough]];  // 4 bytes in the wide encoding
+        case OperandKind::FLOAT:
+            if (size - p < 4) return false;
+            std::memcpy(&out.operand, code + p, 4);
+            p += 4;
+            break;
+        case OperandKind::BYTE:
+            if (p >= size) return false;
+            out.operand = out.op == static_cast<uint8_t>(VMOpcode::PUSH_I8) ? static_cast<int8_t>(code[p])
+                                                                            : code[p];
+            p++;
+            break;
+        case OperandKind::SHORT_TARGET:
+            if (p >= size) return false;
+            out.operand = static_cast<int32_t>(p + 1) + static_cast<int8_t>(code[p]);
+            p++;
+            break;
+    }
+    out.size = static_cast<uint32_t>(p - pos);
+    return true;
+}
+
+bool compactCode(const std::vector<uint8_t>& wide, std::vector<uint8_t>& compact,
+                 std::unordered_map<uint32_t, uint32_t>& new_offset, ConstantPool& pool, std::string& error,
+                 const std::unordered_set<uint32_t>& checked) {
+    std::vector<Instruction> instrs;
+    std::vector<uint32_t> old_offset;
+    std::unordered_map<uint32_t, size_t> index_of;  // Old offset -> instruction index
+    for (size_t pos = 0; pos < wide.size(); ) {
+        Instruction instr;
+        if (!decodeInstruction(wide.data(), wide.size(), pos, false, instr)) {
+            error = "Cannot decode instruction at offset " + std::to_string(pos);
+            return false;
+        }
+        index_of[pos] = instrs.size();
+        old_offset.push_back(pos);
+        instrs.push_back(instr);
+        pos += instr.size;
+    }
+    size_t n = instrs.size();
+    index_of[wide.size()] = n;
+
+    std::vector<size_t> target(n, 0);
+    for (size_t i = 0; i < n; i++) {
+        if (operandKind(instrs[i].op) != OperandKind::TARGET) continue;
+        auto it = index_of.find(static_cast<uint32_t>(instrs[i].operand));
+        if (it == index_of.end()) {
+            error = "Jump at offset " + std::to_string(old_offset[i]) + " does not target an instruction";
+            return false;
+        }
+        target[i] = it->second;
+    }
+
+    auto isCall = [&](size_t i) { return instrs[i].op == static_cast<uint8_t>(VMOpcode::CALL); };
+    auto hasShortForm = [&](size_t i) {
+        VMOpcode op = static_cast<VMOpcode>(instrs[i].op);
+        return (op == VMOpcode::PUSH && instrs[i].operand >= -128 && instrs[i].operand <= 127) ||
+               (op == VMOpcode::LOAD && instrs[i].operand >= 0 && instrs[i].operand <= 255);
+    };
+    auto isJump = [&](size_t i) { return operandKind(instrs[i].op) == OperandKind::TARGET && !isCall(i); };
+    auto isChecked = [&](size_t i) {
+        VMOpcode op = static_cast<VMOpcode>(instrs[i].op);
+        return (op == VMOpcode::LOAD_IDX_NOCHECK || op == VMOpcode::STORE_IDX_NOCHECK) && checked.count(old_offset[i]);
+    };
+
+    // Pool index for FPUSH and for PUSH values that are shorter as an index
+    std::vector<int64_t> constant(n, -1);
+    for (size_t i = 0; i < n; i++) {
+        VMOpcode op = static_cast<VMOpcode>(instrs[i].op);
+        if (op == VMOpcode::FPUSH) {
+            float value;
+            std::memcpy(&value, &instrs[i].operand, sizeof(value));
+            constant[i] = pool.addFloat(value);
+        } else if (op == VMOpcode::PUSH && !hasShortForm(i) && sleb128Size(instrs[i].operand) > 2) {
+            constant[i] = pool.addInt(instrs[i].operand);
+            if (sleb128Size(static_cast<int32_t>(constant[i])) >= sleb128Size(instrs[i].operand)) constant[i] = -1;
+        }
+    }
+
+    // Sizes only grow (jumps go from short to long, LEB128 targets get longer
+    // as the code behind them does), so this terminates
+    std::vector<bool> is_long(n, false);
+    std::vector<uint32_t> size(n), offset(n + 1, 0);
+    for (size_t i = 0; i < n; i++) {
+        switch (operandKind(instrs[i].op)) {
+            case OperandKind::NONE: size[i] = 1; break;
+            case OperandKind::TARGET: size[i] = 2; break;  // Short jump, or CALL with a 1-byte target
+            default:
+                if (isChecked(i)) size[i] = 1 + sleb128Size(instrs[i].operand) + 2;  // PUSH base; ADD; *_INDIRECT
+                else if (constant[i] >= 0) size[i] = 1 + sleb128Size(static_cast<int32_t>(constant[i]));
+                else size[i] = hasShortForm(i) ? 2 : 1 + sleb128Size(instrs[i].operand);
+                break;
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < n; i++) offset[i + 1] = offset[i] + size[i];
+        for (size_t i = 0; i < n; i++) {
+            if (operandKind(instrs[i].op) != OperandKind::TARGET) continue;
+            if (isJump(i) && !is_long[i]) {
+                int64_t delta = static_cast<int64_t>(offset[target[i]]) - (offset[i] + 2);
+                if (delta >= -128 && delta <= 127) continue;
+                is_long[i] = true;
+            }
+            uint32_t wanted = 1 + sleb128Size(static_cast<int32_t>(offset[target[i]]));
+            if (wanted != size[i]) {
+                size[i] = wanted;
+                changed = true;
+            }
+        }
+    }
+
+    compact.clear();
+    compact.reserve(offset[n]);
+    new_offset.clear();
+    for (size_t i = 0; i < n; i++) {
+        const Instruction& instr = instrs[i];
+        VMOpcode op = static_cast<VMOpcode>(instr.op);
+        new_offset[old_offset[i]] = offset[i];
+        if (constant[i] >= 0) {
+            compact.push_back(static_cast<uint8_t>(op == VMOpcode::FPUSH ? VMOpcode::FLOAD_CONST : VMOpcode::LOAD_CONST));
+            appendSLEB128(compact, static_cast<int32_t>(constant[i]));
+            continue;
+        }
+        if (isChecked(i)) {
+            compact.push_back(static_cast<uint8_t>(VMOpcode::PUSH));
+            appendSLEB128(compact, instr.operand);
+            compact.push_back(static_cast<uint8_t>(VMOpcode::ADD));
+            compact.push_back(static_cast<uint8_t>(op == VMOpcode::LOAD_IDX_NOCHECK ? VMOpcode::LOAD_INDIRECT
+                                                                                    : VMOpcode::STORE_INDIRECT));
+            continue;
+        }
+        switch (operandKind(instr.op)) {
+            case OperandKind::NONE:
+                compact.push_back(instr.op);
+                break;
+            case OperandKind::FLOAT: {
+                compact.push_back(instr.op);
+                uint8_t bytes[4];
+                std::memcpy(bytes, &instr.operand, 4);
+                compact.insert(compact.end(), bytes, bytes + 4);
+                break;
+            }
+            case OperandKind::TARGET:
+                if (isJump(i) && !is_long[i]) {
+                    compact.push_back(instr.op - kWideJumpBase + kShortJumpBase);
+                    compact.push_back(static_cast<uint8_t>(static_cast<int8_t>(offset[target[i]] - (offset[i] + 2))));
+                } else {
+                    compact.push_back(instr.op);
+                    appendSLEB128(compact, static_cast<int32_t>(offset[target[i]]));
+                }
+                break;
+            default:
+                if (hasShortForm(i) && op == VMOpcode::PUSH) {
+                    compact.push_back(static_cast<uint8_t>(VMOpcode::PUSH_I8));
+                    compact.push_back(static_cast<uint8_t>(static_cast<int8_t>(instr.operand)));
+                } else if (hasShortForm(i)) {
+                    compact.push_back(static_cast<uint8_t>(VMOpcode::LOAD_U8));
+                    compact.push_back(static_cast<uint8_t>(instr.operand));
+                } else {
+                    compact.push_back(instr.op);
+                    appendSLEB128(compact, instr.operand);
+                }
+                break;
+        }
+    }
+    new_offset[static_cast<uint32_t>(wide.size())] = offset[n];
+    return true;
+}
@@ -0,0 +1,83 @@
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Instruction encodings shared by the compiler, the VM and gocopt.
+//
+// Wide: every operand is 4 little-endian bytes, and jumps and CALL hold
+// absolute code offsets. v1 files use it, and the compiler emits it until
+// its labels are resolved.
+//
+// Compact: v2 files whose header has kBinaryFlagCompactCode. Operands are
+// signed LEB128, except FPUSH, which keeps its 4-byte float. The short forms
+// take a single byte:
+//   PUSH_I8 value     -128..127
+//   LOAD_U8 address   0..255
+//   J*_S8 delta       target relative to the end of the jump, -128..127
+// Only compactCode produces short forms.
+//
+// Constants: compactCode moves FPUSH values and PUSH values whose LEB128 form
+// would be longer than a pool index into a ConstantPool, and replaces the
+// instruction with FLOAD_CONST / LOAD_CONST index.
+
+enum class OperandKind : uint8_t {
+    NONE,
+    INT,          // Wide: 4 bytes; compact: LEB128
+    TARGET,       // Code offset of a jump or CALL; encoded like INT
+    FLOAT,        // 4 bytes in both encodings
+    BYTE,         // PUSH_I8 (signed) and LOAD_U8 (unsigned)
+    SHORT_TARGET  // One signed byte relative to the end of the jump
+};
+
+bool isKnownOpcode(uint8_t op);
+OperandKind operandKind(uint8_t op);
+// Wide opcode a short form stands for; other opcodes are returned unchanged
+uint8_t wideOpcode(uint8_t op);
+
+struct Instruction {
+    uint8_t op;       // As encoded (short forms included)
+    int32_t operand;  // Absolute offset for jumps; bit pattern of FPUSH's float
+    uint32_t size;
+};
+
+// 8-byte constant pool entries (ints as i64, floats as f64), deduplicated by
+// bit pattern. Written as the CONSTANTS section of a .bin file.
+class ConstantPool {
+public:
+    uint32_t addInt(int64_t value);
+    uint32_t addFloat(double value);
+    const std::vector<uint64_t>& values() const { return entries; }
+    void clear();
+
+private:
+    uint32_t add(uint64_t bits);
+    std::vector<uint64_t> entries;
+    std::unordered_map<uint64_t, uint32_t> index;
+};
+
+int64_t constantAsInt(uint64_t bits);
+double constantAsFloat(uint64_t bits);
+
+// False if the bytes at `pos` are not a complete instruction
+bool decodeInstruction(const uint8_t* code, size_t size, size_t pos, bool compact, Instruction& out);
+
+void appendSLEB128(std::vector<uint8_t>& out, int32_t value);
+bool readSLEB128(const uint8_t* code, size_t size, size_t& pos, int32_t& value);
+
+// Re-encode wide code in the compact form. Every jump starts out short and is
+// widened when its target is out of reach, until no size changes. `new_offset`
+// maps each instruction start (and the end of the code) to its new position.
+// Constants are added to `pool`. The LOAD_IDX_NOCHECK/STORE_IDX_NOCHECK
+// instructions at the offsets in `checked` become the bounds-checked
+// `PUSH base; ADD; LOAD_INDIRECT/STORE_INDIRECT`.
+bool compactCode(const std::vector<uint8_t>& wide, std::vector<uint8_t>& compact,
+                 std::unordered_map<uint32_t, uint32_t>& new_offset, ConstantPool& pool, std::string& error,
+                 const std::unordered_set<uint32_t>& checked = {});
+
+#endif // ENCODING_H
@@ -0,0 +1,84 @@
+#include "linker.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+void printGoclinkHelp() {
+    std::cout << "Usage: goclink [options] <object.o>...\n"
+              << "Options:\n"
+              << "  -h, --help            Show this help message\n"
+              << "  -o, --output <file>   Write the linked program to file (default: a.bin)\n"
+              << "  -s, --stats           Show link statistics\n"
+              << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    bool show_help = false;
+    bool show_stats = false;
+    std::vector<std::string> input_files;
+    std::string output_file = "a.bin";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            show_help = true;
+        } else if (arg == "-s" || arg == "--stats") {
+            show_stats = true;
+        } else if (arg == "-o" || arg == "--output") {
+            if (i + 1 < argc) {
+                output_file = argv[++i];
+            } else {
+                std::cerr << "Error: missing filename after -o option\n";
+                return 1;
+            }
+        } else if (arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << "\n";
+            printGoclinkHelp();
+            return 1;
+        } else {
+            input_files.push_back(arg);
+        }
+    }
+
+    if (show_help) {
+        printGoclinkHelp();
+        return 0;
+    }
+    if (input_files.empty()) {
+        std::cerr << "Error: No object files specified\n";
+        printGoclinkHelp();
+        return 1;
+    }
+
+    Linker linker;
+    std::string error;
+    for (const std::string& file : input_files) {
+        if (!linker.addObject(file, error)) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+    }
+
+    BinaryImage program;
+    if (!linker.link(program, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+    if (!writeBinary(output_file, program)) {
+        std::cerr << "Error: could not write " << output_file << "\n";
+        return 1;
+    }
+
+    if (show_stats) {
+        const LinkStats& stats = linker.stats();
+        std::cout << "=== goclink Statistics ===\n"
+                  << "Objects: " << stats.objects << "\n"
+                  << "Symbols: " << stats.symbols << "\n"
+                  << "Relocations applied: " << stats.relocations << "\n"
+                  << "Strings: " << stats.strings_before << " -> " << stats.strings_after << "\n"
+                  << "Static memory cells: " << stats.data_cells << "\n"
+                  << "Checked array accesses: " << stats.checked_accesses << "\n"
+                  << "Code size: " << stats.bytes_before << " -> " << stats.bytes_after << " bytes\n";
+    }
+    return 0;
+}
@@ -0,0 +1,501 @@
+#include "gocopt.h"
+#include "vm.h"
+#include "encoding.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+// ---- Opcode properties ----
+
+// Operand size in the wide encoding the optimizer lays code out in
+static bool hasOperand(VMOpcode op) {
+    return operandKind(static_cast<uint8_t>(op)) != OperandKind::NONE;
+}
+
+static bool isJump(VMOpcode op) {
+    return op == VMOpcode::JMP || op == VMOpcode::JZ || op == VMOpcode::JNZ || op == VMOpcode::JL ||
+           op == VMOpcode::JG || op == VMOpcode::JLE || op == VMOpcode::JGE;
+}
+
+static bool fallsThrough(VMOpcode op) {
+    return op != VMOpcode::JMP && op != VMOpcode::RET && op != VMOpcode::HALT && op != VMOpcode::THROW;
+}
+
+// Effect on the integer stack of straight-line instructions. Returns false for
+// instructions that end a backwards scan (control flow, calls, frame setup, reordering).
+static bool stackEffect(VMOpcode op, int& pops, int& pushes) {
+    switch (op) {
+        case VMOpcode::PUSH: case VMOpcode::LOAD: case VMOpcode::LOAD_BP: case VMOpcode::PUSH_STR:
+        case VMOpcode::INPUT: case VMOpcode::INPUT_STR: case VMOpcode::FP_TO_INT: case VMOpcode::FSAVE:
+            pops = 0; pushes = 1; return true;
+        case VMOpcode::POP: case VMOpcode::PRINT: case VMOpcode::PRINT_STR: case VMOpcode::STORE_BP:
+        case VMOpcode::FREE: case VMOpcode::INT_TO_FP: case VMOpcode::FRESTORE:
+            pops = 1; pushes = 0; return true;
+        case VMOpcode::ADD: case VMOpcode::SUB: case VMOpcode::MUL: case VMOpcode::DIV:
+        case VMOpcode::MOD: case VMOpcode::DIV_NOCHECK: case VMOpcode::MOD_NOCHECK:
+            pops = 2; pushes = 1; return true;
+        case VMOpcode::CMP: case VMOpcode::STORE: case VMOpcode::STORE_INDIRECT:
+        case VMOpcode::STORE_IDX_NOCHECK:
+            pops = 2; pushes = 0; return true;
+        case VMOpcode::LOAD_INDIRECT: case VMOpcode::ALLOC: case VMOpcode::LOAD_IDX_NOCHECK:
+            pops = 1; pushes = 1; return true;
+        case VMOpcode::POP_BP: case VMOpcode::MEMO_STORE:
+        case VMOpcode::FPUSH: case VMOpcode::FPOP: case VMOpcode::FADD: case VMOpcode::FSUB:
+        case VMOpcode::FMUL: case VMOpcode::FDIV: case VMOpcode::FDIV_NOCHECK: case VMOpcode::FLOAD:
+        case VMOpcode::FSTORE: case VMOpcode::FPRINT: case VMOpcode::FCMP: case VMOpcode::FNEG:
+        case VMOpcode::FDUP:
+            pops = 0; pushes = 0; return true;
+        default:
+            return false;
+    }
+}
+
+// ---- Optimizer ----
+
+BytecodeOptimizer::BytecodeOptimizer(BinaryImage& img) : image(img) {}
+
+bool BytecodeOptimizer::run(std::string& error) {
+    counters = GocoptStats();
+    counters.bytes_before = image.code.size();
+    if (image.object) {
+        error = "Input is an object file; link it with goclink first";
+        return false;
+    }
+    if (image.snapshot) {
+        error = "Input is a VM snapshot; optimize the program before taking it";
+        return false;
+    }
+    if (!decode(error)) return false;
+    counters.functions = reachableFunctions().size() - 1;  // minus the entry stub
+
+    while (mergeIdenticalFunctions() | propagateConstants()) {}
+    removeUnusedStrings();
+    compact();
+
+    counters.bytes_after = image.code.size();
+    return true;
+}
+
+// Decode everything reachable from offset 0 by following fall-through, jumps and calls
+bool BytecodeOptimizer::decode(std::string& error) {
+    instrs.clear();
+    jump_targets.clear();
+    std::vector<uint32_t> worklist = {0};
+    // Landing pads are only reached through the exception table
+    for (const auto& region : image.exception_regions) {
+        jump_targets.insert(region.handler);
+        worklist.push_back(region.handler);
+    }
+    while (!worklist.empty()) {
+        uint32_t offset = worklist.back();
+        worklist.pop_back();
+        if (instrs.count(offset)) continue;
+        if (offset >= image.code.size()) {
+            error = "Control flow leaves the code at offset " + std::to_string(offset);
+            return false;
+        }
+        Instruction decoded;
+        if (!decodeInstruction(image.code.data(), image.code.size(), offset, image.compact_code, decoded)) {
+            error = (isKnownOpcode(image.code[offset]) ? "Truncated instruction at offset "
+                                                       : "Unknown opcode " + std::to_string(image.code[offset]) +
+                                                             " at offset ") +
+                    std::to_string(offset);
+            return false;
+        }
+        // Short forms are handled as their wide opcode with an absolute operand,
+        // and pool loads as the PUSH / FPUSH of the constant
+        Instr instr{wideOpcode(decoded.op), decoded.operand, decoded.size};
+        VMOpcode op = static_cast<VMOpcode>(instr.op);
+        if (op == VMOpcode::LOAD_CONST || op == VMOpcode::FLOAD_CONST) {
+            if (instr.operand < 0 || static_cast<size_t>(instr.operand) >= image.constants.size()) {
+                error = "Invalid constant pool index at offset " + std::to_string(offset);
+                return false;
+            }
+            uint64_t bits = image.constants[instr.operand];
+            if (op == VMOpcode::LOAD_CONST) {
+                instr.op = static_cast<uint8_t>(VMOpcode::PUSH);
+                instr.operand = static_cast<int32_t>(constantAsInt(bits));
+            } else {
+                float value = static_cast<float>(constantAsFloat(bits));
+                instr.op = static_cast<uint8_t>(VMOpcode::FPUSH);
+                std::memcpy(&instr.operand, &value, sizeof(value));
+            }
+            op = static_cast<VMOpcode>(instr.op);
+        }
+        instrs[offset] = instr;
+
+        if (isJump(op)) {
+            jump_targets.insert(static_cast<uint32_t>(instr.operand));
+            worklist.push_back(static_cast<uint32_t>(instr.operand));
+        } else if (op == VMOpcode::CALL) {
+            worklist.push_back(static_cast<uint32_t>(instr.operand));
+        }
+        if (fallsThrough(op)) worklist.push_back(offset + instr.size);
+    }
+
+    // Instructions must not overlap (jumps into the middle of an instruction)
+    uint32_t end = 0;
+    for (const auto& [offset, instr] : instrs) {
+        if (offset < end) {
+            error = "Overlapping instructions at offset " + std::to_string(offset);
+            return false;
+        }
+        end = offset + instr.size;
+    }
+    return true;
+}
+
+// Offset 0 (the entry stub) plus every function reachable from it through CALLs
+std::set<uint32_t> BytecodeOptimizer::reachableFunctions() const {
+    std::set<uint32_t> functions = {0};
+    std::vector<uint32_t> worklist = {0};
+    while (!worklist.empty()) {
+        uint32_t entry = worklist.back();
+        worklist.pop_back();
+        for (uint32_t offset : functionBody(entry)) {
+            const Instr& instr = instrs.at(offset);
+            if (static_cast<VMOpcode>(instr.op) == VMOpcode::CALL &&
+                functions.insert(static_cast<uint32_t>(instr.operand)).second) {
+                worklist.push_back(static_cast<uint32_t>(instr.operand));
+            }
+        }
+    }
+    return functions;
+}
+
+// Instructions reachable from `entry` without entering callees, in address order.
+// Handlers of try regions starting in the function belong to it as well.
+std::vector<uint32_t> BytecodeOptimizer::functionBody(uint32_t entry) const {
+    std::set<uint32_t> body;
+    std::vector<uint32_t> worklist = {entry};
+    while (!worklist.empty()) {
+        while (!worklist.empty()) {
+            uint32_t offset = worklist.back();
+            worklist.pop_back();
+            if (!body.insert(offset).second) continue;
+            const Instr& instr = instrs.at(offset);
+            VMOpcode op = static_cast<VMOpcode>(instr.op);
+            if (isJump(op)) worklist.push_back(static_cast<uint32_t>(instr.operand));
+            if (fallsThrough(op)) worklist.push_back(offset + instr.size);
+        }
+        for (const auto& region : image.exception_regions) {
+            if (body.count(region.start) && !body.count(region.handler)) worklist.push_back(region.handler);
+        }
+    }
+    return std::vector<uint32_t>(body.begin(), body.end());
+}
+
+// Walk back from `call` inside its basic block to the instruction that pushed the
+// stack slot `depth` entries below the top; true if that was a PUSH of a constant
+bool BytecodeOptimizer::findArgumentConstant(uint32_t call, int depth, int32_t& value) const {
+    auto it = instrs.find(call);
+    while (it != instrs.begin()) {
+        uint32_t current = it->first;
+        if (jump_targets.count(current)) return false;  // another path may reach this point
+        auto prev = std::prev(it);
+        if (prev->first + prev->second.size != current) return false;
+        VMOpcode op = static_cast<VMOpcode>(prev->second.op);
+        int pops, pushes;
+        if (!stackEffect(op, pops, pushes)) return false;
+        if (depth < pushes) {
+            if (op == VMOpcode::PUSH) {
+                value = prev->second.operand;
+                return true;
+            }
+            return false;
+        }
+        depth += pops - pushes;
+        it = prev;
+    }
+    return false;
+}
+
+// Replace parameter loads with constants when every call site passes the same
+// constant (or, for recursive calls, passes the parameter through unchanged)
+bool BytecodeOptimizer::propagateConstants() {
+    std::set<uint32_t> functions = reachableFunctions();
+
+    // Call sites per callee and the function each instruction belongs to
+    std::map<uint32_t, std::vector<uint32_t>> call_sites;
+    std::unordered_map<uint32_t, uint32_t> owner;
+    std::set<uint32_t> shared;
+    for (uint32_t entry : functions) {
+        for (uint32_t offset : functionBody(entry)) {
+            auto [slot, inserted] = owner.emplace(offset, entry);
+            if (!inserted && slot->second != entry) {
+                shared.insert(entry);
+                shared.insert(slot->second);
+            }
+            const Instr& instr = instrs.at(offset);
+            if (static_cast<VMOpcode>(instr.op) == VMOpcode::CALL) {
+                call_sites[static_cast<uint32_t>(instr.operand)].push_back(offset);
+            }
+        }
+    }
+
+    bool changed = false;
+    for (uint32_t entry : functions) {
+        // Only functions entered exclusively through CALL have known arguments
+        if (entry == 0 || shared.count(entry) || jump_targets.count(entry)) continue;
+        auto before = instrs.find(entry);
+        if (before != instrs.begin()) {
+            auto prev = std::prev(before);
+            if (prev->first + prev->second.size == entry && owner.count(prev->first) &&
+                fallsThrough(static_cast<VMOpcode>(prev->second.op))) continue;
+        }
+
+        std::vector<uint32_t> body = functionBody(entry);
+        std::map<int32_t, std::vector<uint32_t>> loads;  // BP offset -> LOAD_BP instructions
+        std::set<int32_t> stores;
+        for (uint32_t offset : body) {
+            const Instr& instr = instrs.at(offset);
+            VMOpcode op = static_cast<VMOpcode>(instr.op);
+            if (op == VMOpcode::LOAD_BP && instr.operand <= -2) loads[instr.operand].push_back(offset);
+            if (op == VMOpcode::STORE_BP) stores.insert(instr.operand);
+        }
+
+        for (const auto& [bp_offset, load_sites] : loads) {
+            if (stores.count(bp_offset)) continue;
+            int depth = -bp_offset - 2;  // BP-2 is the last argument, i.e. the top of stack at CALL
+            bool known = false, consistent = true;
+            int32_t constant = 0;
+            for (uint32_t call : call_sites[entry]) {
+                int32_t value;
+                if (findArgumentConstant(call, depth, value)) {
+                    if (known && value != constant) { consistent = false; break; }
+                    known = true;
+                    constant = value;
+                    continue;
+                }
+                // A recursive call passing the same parameter through keeps it constant
+                bool pass_through = false;
+                if (owner[call] == entry) {
+                    auto it = instrs.find(call);
+                    if (it != instrs.begin() && !jump_targets.count(call)) {
+                        auto prev = std::prev(it);
+                        pass_through = depth == 0 && prev->first + prev->second.size == call &&
+                                       static_cast<VMOpcode>(prev->second.op) == VMOpcode::LOAD_BP &&
+                                       prev->second.operand == bp_offset;
+                    }
+                }
+                if (!pass_through) { consistent = false; break; }
+            }
+            if (!known || !consistent) continue;
+
+            for (uint32_t offset : load_sites) {
+                Instr& instr = instrs.at(offset);
+                instr.op = static_cast<uint8_t>(VMOpcode::PUSH);
+                instr.operand = constant;
+                counters.constants_propagated++;
+            }
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// Functions with the same instructions (jumps compared relative to the function,
+// calls by target) are merged: callers of duplicates are redirected to one copy
+bool BytecodeOptimizer::mergeIdenticalFunctions() {
+    std::set<uint32_t> functions = reachableFunctions();
+    std::map<std::vector<int64_t>, uint32_t> canonical;
+    std::unordered_map<uint32_t, uint32_t> redirect;
+
+    for (uint32_t entry : functions) {
+        if (entry == 0 || jump_targets.count(entry)) continue;
+        std::vector<uint32_t> body = functionBody(entry);
+        if (body.empty() || body.front() != entry) continue;
+
+        std::vector<int64_t> signature;
+        bool mergeable = std::none_of(image.exception_regions.begin(), image.exception_regions.end(),
+                                      [&](const ExceptionRegion& r) {
+                                          return std::binary_search(body.begin(), body.end(), r.start);
+                                      });
+        for (uint32_t offset : body) {
+            if (!mergeable) break;
+            const Instr& instr = instrs.at(offset);
+            VMOpcode op = static_cast<VMOpcode>(instr.op);
+            signature.push_back(instr.op);
+            if (isJump(op)) {
+                auto target = std::lower_bound(body.begin(), body.end(), static_cast<uint32_t>(instr.operand));
+                if (target == body.end() || *target != static_cast<uint32_t>(instr.operand)) {
+                    mergeable = false;
+                    break;
+                }
+                signature.push_back(target - body.begin());
+            } else if (hasOperand(op)) {
+                signature.push_back(instr.operand);
+            }
+            // Layout matters for fall-through: record gaps between instructions
+            signature.push_back(offset - entry);
+        }
+        if (!mergeable) continue;
+
+        auto [slot, inserted] = canonical.emplace(signature, entry);
+        if (!inserted) redirect[entry] = slot->second;
+    }
+
+    if (redirect.empty()) return false;
+    for (auto& [offset, instr] : instrs) {
+        if (static_cast<VMOpcode>(instr.op) != VMOpcode::CALL) continue;
+        auto it = redirect.find(static_cast<uint32_t>(instr.operand));
+        if (it != redirect.end()) instr.operand = static_cast<int32_t>(it->second);
+    }
+    counters.functions_merged += redirect.size();
+    return true;
+}
+
+// Drop strings no reachable instruction can print. String IDs come from PUSH_STR,
+// or from a plain PUSH feeding PRINT_STR; if any PRINT_STR gets its ID from
+// somewhere else, all strings are kept.
+void BytecodeOptimizer::removeUnusedStrings() {
+    std::set<uint32_t> functions = reachableFunctions();
+    std::vector<uint32_t> id_sites;  // instructions whose operand is a string ID
+    for (uint32_t entry : functions) {
+        for (uint32_t offset : functionBody(entry)) {
+            const Instr& instr = instrs.at(offset);
+            VMOpcode op = static_cast<VMOpcode>(instr.op);
+            if (op == VMOpcode::PUSH_STR) {
+                id_sites.push_back(offset);
+            } else if (op == VMOpcode::PRINT_STR) {
+                if (jump_targets.count(offset)) return;
+                auto it = instrs.find(offset);
+                if (it == instrs.begin()) return;
+                auto prev = std::prev(it);
+                VMOpcode prev_op = static_cast<VMOpcode>(prev->second.op);
+                if (prev->first + prev->second.size != offset ||
+                    (prev_op != VMOpcode::PUSH && prev_op != VMOpcode::PUSH_STR)) return;
+                if (prev_op == VMOpcode::PUSH) id_sites.push_back(prev->first);
+            }
+        }
+    }
+
+    std::vector<bool> used(image.strings.size(), false);
+    for (uint32_t offset : id_sites) {
+        int32_t id = instrs.at(offset).operand;
+        if (id < 0 || static_cast<size_t>(id) >= image.strings.size()) return;
+        used[id] = true;
+    }
+
+    std::vector<int32_t> new_id(image.strings.size(), -1);
+    std::vector<std::string> kept;
+    for (size_t i = 0; i < image.strings.size(); i++) {
+        if (!used[i]) continue;
+        new_id[i] = kept.size();
+        kept.push_back(image.strings[i]);
+    }
+    // Rewrite each ID site once
+    std::sort(id_sites.begin(), id_sites.end());
+    id_sites.erase(std::unique(id_sites.begin(), id_sites.end()), id_sites.end());
+    for (uint32_t offset : id_sites) {
+        Instr& instr = instrs.at(offset);
+        instr.operand = new_id[instr.operand];
+    }
+    counters.strings_removed = image.strings.size() - kept.size();
+    image.strings = std::move(kept);
+}
+
+// Lay out the reachable instructions in their original order and relocate
+// jump/call targets, the profile site table and the function symbols
+void BytecodeOptimizer::compact() {
+    std::set<uint32_t> keep;
+    for (uint32_t entry : reachableFunctions()) {
+        std::vector<uint32_t> body = functionBody(entry);
+        keep.insert(body.begin(), body.end());
+    }
+
+    // Lay out in the wide encoding, then re-encode compactly
+    std::unordered_map<uint32_t, uint32_t> wide_offset;
+    uint32_t pos = 0;
+    for (uint32_t offset : keep) {
+        wide_offset[offset] = pos;
+        pos += hasOperand(static_cast<VMOpcode>(instrs.at(offset).op)) ? 5 : 1;
+    }
+
+    std::vector<uint8_t> wide;
+    wide.reserve(pos);
+    for (uint32_t offset : keep) {
+        const Instr& instr = instrs.at(offset);
+        VMOpcode op = static_cast<VMOpcode>(instr.op);
+        wide.push_back(instr.op);
+        if (hasOperand(op)) {
+            int32_t operand = instr.operand;
+            if (isJump(op) || op == VMOpcode::CALL) {
+                operand = static_cast<int32_t>(wide_offset.at(static_cast<uint32_t>(operand)));
+            }
+            uint8_t bytes[4];
+            std::memcpy(bytes, &operand, 4);
+            wide.insert(wide.end(), bytes, bytes + 4);
+        }
+    }
+
+    std::vector<uint8_t> code;
+    std::unordered_map<uint32_t, uint32_t> compact_offset;
+    ConstantPool pool;
+    std::string error;
+    if (!compactCode(wide, code, compact_offset, pool, error)) {
+        // Cannot happen for code laid out above; keep the wide encoding
+        code = wide;
+        compact_offset.clear();
+        for (const auto& [offset, wide_pos] : wide_offset) compact_offset[wide_pos] = wide_pos;
+        compact_offset[static_cast<uint32_t>(wide.size())] = static_cast<uint32_t>(wide.size());
+        image.compact_code = false;
+        pool.clear();
+    } else {
+        image.compact_code = true;
+    }
+    image.constants = pool.values();
+    // Original offset -> final offset
+    std::unordered_map<uint32_t, uint32_t> new_offset;
+    for (const auto& [offset, wide_pos] : wide_offset) new_offset[offset] = compact_offset.at(wide_pos);
+
+    std::vector<ProfileSite> sites;
+    for (ProfileSite site : image.profile_sites) {
+        auto it = new_offset.find(site.offset);
+        if (it == new_offset.end()) continue;
+        site.offset = it->second;
+        sites.push_back(site);
+    }
+    image.profile_sites = std::move(sites);
+
+    std::vector<FunctionSymbol> symbols;
+    for (FunctionSymbol symbol : image.symbols) {
+        auto it = new_offset.find(symbol.address);
+        if (it == new_offset.end()) continue;
+        symbol.address = it->second;
+        symbols.push_back(symbol);
+    }
+    image.symbols = std::move(symbols);
+
+    // Regions stay contiguous: whole functions are kept or dropped
+    std::vector<ExceptionRegion> regions;
+    for (ExceptionRegion region : image.exception_regions) {
+        auto handler = new_offset.find(region.handler);
+        auto first = keep.lower_bound(region.start);
+        if (handler == new_offset.end() || first == keep.end() || *first >= region.end) continue;
+        uint32_t last = *std::prev(keep.lower_bound(region.end));
+        uint32_t wide_end = wide_offset.at(last) + (hasOperand(static_cast<VMOpcode>(instrs.at(last).op)) ? 5 : 1);
+        region.start = new_offset.at(*first);
+        region.end = compact_offset.at(wide_end);
+        region.handler = handler->second;
+        regions.push_back(region);
+    }
+    image.exception_regions = std::move(regions);
+
+    // A line starts at its first kept instruction; lines with none are dropped
+    LineTable lines;
+    if (!image.debug_lines.empty() && parseLineTable(image.debug_lines, lines)) {
+        std::vector<LineEntry> entries;
+        for (size_t i = 0; i < lines.entries.size(); i++) {
+            auto first = keep.lower_bound(lines.entries[i].offset);
+            if (first == keep.end()) break;
+            if (i + 1 < lines.entries.size() && *first >= lines.entries[i + 1].offset) continue;
+            entries.push_back({new_offset.at(*first), lines.entries[i].line, lines.entries[i].file});
+        }
+        lines.entries = std::move(entries);
+        image.debug_lines = lines.entries.empty() ? std::vector<uint8_t>() : encodeLineTable(lines);
+    } else {
+        image.debug_lines.clear();
+    }
+    image.code = std::move(code);
+}
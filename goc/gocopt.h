@@ -0,0 +1,56 @@
+#ifndef GOCOPT_H
+#define GOCOPT_H
+
+#include "binfile.h"
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// Post-link optimizer for .bin files: rebuilds functions and their control
+// flow from CALL targets and jumps, so it works on bytecode from any producer
+// without the source.
+
+struct GocoptStats {
+    size_t functions = 0;             // Reachable functions before optimization
+    size_t functions_merged = 0;
+    size_t constants_propagated = 0;  // Parameter loads replaced by constants
+    size_t strings_removed = 0;
+    size_t bytes_before = 0;
+    size_t bytes_after = 0;
+};
+
+class BytecodeOptimizer {
+public:
+    explicit BytecodeOptimizer(BinaryImage& image);
+
+    // Run all passes and rewrite the image; false (with `error`) if the code
+    // could not be decoded, in which case the image is left untouched
+    bool run(std::string& error);
+
+    const GocoptStats& stats() const { return counters; }
+
+private:
+    struct Instr {
+        uint8_t op;
+        int32_t operand;
+        uint32_t size;
+    };
+
+    BinaryImage& image;
+    GocoptStats counters;
+    std::map<uint32_t, Instr> instrs;   // Decoded instructions by original offset
+    std::set<uint32_t> jump_targets;    // Starts of basic blocks (besides function entries)
+
+    bool decode(std::string& error);
+    std::set<uint32_t> reachableFunctions() const;
+    std::vector<uint32_t> functionBody(uint32_t entry) const;
+    bool findArgumentConstant(uint32_t call, int depth, int32_t& value) const;
+    bool propagateConstants();
+    bool mergeIdenticalFunctions();
+    void removeUnusedStrings();
+    void compact();
+};
+
+#endif // GOCOPT_H
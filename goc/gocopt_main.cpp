@@ -0,0 +1,86 @@
+#include "gocopt.h"
+#include <iostream>
+#include <string>
+
+void printGocoptHelp() {
+    std::cout << "Usage: gocopt [options] <input.bin>\n"
+              << "Options:\n"
+              << "  -h, --help            Show this help message\n"
+              << "  -o, --output <file>   Write optimized bytecode to file (default: overwrite input)\n"
+              << "  -s, --stats           Show optimization statistics\n"
+              << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    bool show_help = false;
+    bool show_stats = false;
+    std::string input_file;
+    std::string output_file;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            show_help = true;
+        } else if (arg == "-s" || arg == "--stats") {
+            show_stats = true;
+        } else if (arg == "-o" || arg == "--output") {
+            if (i + 1 < argc) {
+                output_file = argv[++i];
+            } else {
+                std::cerr << "Error: missing filename after -o option\n";
+                return 1;
+            }
+        } else if (arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << "\n";
+            printGocoptHelp();
+            return 1;
+        } else {
+            input_file = arg;
+        }
+    }
+
+    if (show_help) {
+        printGocoptHelp();
+        return 0;
+    }
+    if (input_file.empty()) {
+        std::cerr << "Error: No bytecode file specified\n";
+        printGocoptHelp();
+        return 1;
+    }
+    if (output_file.empty()) {
+        output_file = input_file;
+    }
+
+    BinaryImage image;
+    std::string error;
+    if (!readBinary(input_file, image, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+
+    BytecodeOptimizer optimizer(image);
+    if (!optimizer.run(error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+    if (image.dropped_blocks > 0) {
+        std::cerr << "Warning: dropped " << image.dropped_blocks << " unknown block(s)/section(s)\n";
+    }
+
+    if (!writeBinary(output_file, image)) {
+        std::cerr << "Error: could not write " << output_file << "\n";
+        return 1;
+    }
+
+    if (show_stats) {
+        const GocoptStats& stats = optimizer.stats();
+        std::cout << "=== gocopt Statistics ===\n"
+                  << "Reachable functions: " << stats.functions << "\n"
+                  << "Functions merged: " << stats.functions_merged << "\n"
+                  << "Constant parameters propagated: " << stats.constants_propagated << "\n"
+                  << "Strings removed: " << stats.strings_removed << "\n"
+                  << "Code size: " << stats.bytes_before << " -> " << stats.bytes_after << " bytes\n";
+    }
+    return 0;
+}
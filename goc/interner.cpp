@@ -0,0 +1,15 @@
+#include "interner.h"
+
+Interner& Interner::global() {
+    static Interner interner;
+    return interner;
+}
+
+SymbolId Interner::intern(std::string_view name) {
+    auto it = ids.find(name);
+    if (it != ids.end()) return it->second;
+    SymbolId id = static_cast<SymbolId>(names.size());
+    names.emplace_back(name);
+    ids.emplace(names.back(), id);
+    return id;
+}
@@ -0,0 +1,42 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Identifier interning. Every distinct name gets a dense 32-bit SymbolId the
+// first time it is seen, so symbol tables are keyed by integers and names are
+// compared by id instead of by their characters.
+//
+// The interner is process-wide and not synchronized: names are interned by the
+// parser and the code generators, which run on one thread. The lexer, which
+// may run on several (lexer.h), produces string_views and never interns.
+
+using SymbolId = uint32_t;
+
+class Interner {
+public:
+    static Interner& global();
+
+    // Id of `name`, assigning the next free one if it is new
+    SymbolId intern(std::string_view name);
+    const std::string& name(SymbolId id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+
+private:
+    std::deque<std::string> names;  // By id; a deque keeps the keys below valid
+    std::unordered_map<std::string_view, SymbolId> ids;
+};
+
+inline SymbolId internSymbol(std::string_view name) {
+    return Interner::global().intern(name);
+}
+
+inline const std::string& symbolName(SymbolId id) {
+    return Interner::global().name(id);
+}
+
+#endif // INTERNER_H
@@ -1,246 +1,577 @@
 #include "lexer.h"
 
-// Constructor
-Lexer::Lexer(const std::string& input, const std::string& file)
-    : source(input), position(0), line(1), column(1), error_flag(false), filename(file) {
-
-    // Initialize comprehensive C++98 keywords
-    keywords = {
-        // Control flow
-        {"if", TokenType::KEYWORD},
-        {"else", TokenType::KEYWORD},
-        {"while", TokenType::KEYWORD},
-        {"for", TokenType::KEYWORD},
-        {"do", TokenType::KEYWORD},
-        {"switch", TokenType::KEYWORD},
-        {"case", TokenType::KEYWORD},
-        {"default", TokenType::KEYWORD},
-        {"break", TokenType::KEYWORD},
-        {"continue", TokenType::KEYWORD},
-        {"return", TokenType::KEYWORD},
-        {"goto", TokenType::KEYWORD},
-
-        // Exception handling
-        {"try", TokenType::KEYWORD},
-        {"catch", TokenType::KEYWORD},
-        {"throw", TokenType::KEYWORD},
-
-        // OOP
-        {"this", TokenType::KEYWORD},
-        {"virtual", TokenType::KEYWORD},
-        {"explicit", TokenType::KEYWORD},
-        {"friend", TokenType::KEYWORD},
-        {"inline", TokenType::KEYWORD},
-        {"operator", TokenType::KEYWORD},
-        {"template", TokenType::KEYWORD},
-        {"typename", TokenType::KEYWORD},
-        {"mutable", TokenType::KEYWORD},
-
-        // Namespace
-        {"namespace", TokenType::KEYWORD},
-        {"using", TokenType::KEYWORD},
-
-        // Casting
-        {"dynamic_cast", TokenType::KEYWORD},
-        {"static_cast", TokenType::KEYWORD},
-        {"const_cast", TokenType::KEYWORD},
-        {"reinterpret_cast", TokenType::KEYWORD},
-        {"typeid", TokenType::KEYWORD},
-
-        // Memory management
-        {"new", TokenType::KEYWORD},
-        {"delete", TokenType::KEYWORD},
-        {"sizeof", TokenType::KEYWORD},
-
-        // Other
-        {"asm", TokenType::KEYWORD},
-        {"export", TokenType::KEYWORD},
-        {"wchar_t", TokenType::KEYWORD},
-        {"bool", TokenType::KEYWORD},
-        {"true", TokenType::KEYWORD},
-        {"false", TokenType::KEYWORD}
-    };
-
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <memory>
+#include <thread>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+namespace {
+
+// Keywords and multi-character operators, found through a perfect hash built
+// at compile time. Every identifier and operator pair is looked up here.
+struct Lexeme {
+    std::string_view text;
+    TokenType type;
+    TokenKind kind;
+};
+
+constexpr Lexeme kLexemes[] = {
+    // Control flow
+    {"if", TokenType::KEYWORD, TokenKind::KW_IF}, {"else", TokenType::KEYWORD, TokenKind::KW_ELSE},
+    {"while", TokenType::KEYWORD, TokenKind::KW_WHILE},
+    {"for", TokenType::KEYWORD, TokenKind::KW_FOR}, {"do", TokenType::KEYWORD, TokenKind::KW_DO},
+    {"switch", TokenType::KEYWORD, TokenKind::KW_SWITCH},
+    {"case", TokenType::KEYWORD, TokenKind::KW_CASE},
+    {"default", TokenType::KEYWORD, TokenKind::KW_DEFAULT},
+    {"break", TokenType::KEYWORD, TokenKind::KW_BREAK},
+    {"continue", TokenType::KEYWORD, TokenKind::KW_CONTINUE},
+    {"return", TokenType::KEYWORD, TokenKind::KW_RETURN},
+    {"goto", TokenType::KEYWORD, TokenKind::KW_GOTO},
+    // Exception handling
+    {"try", TokenType::KEYWORD, TokenKind::KW_TRY},
+    {"catch", TokenType::KEYWORD, TokenKind::KW_CATCH},
+    {"throw", TokenType::KEYWORD, TokenKind::KW_THROW},
+    // OOP
+    {"this", TokenType::KEYWORD, TokenKind::KW_THIS},
+    {"virtual", TokenType::KEYWORD, TokenKind::KW_VIRTUAL},
+    {"explicit", TokenType::KEYWORD, TokenKind::KW_EXPLICIT},
+    {"friend", TokenType::KEYWORD, TokenKind::KW_FRIEND},
+    {"inline", TokenType::KEYWORD, TokenKind::KW_INLINE},
+    {"operator", TokenType::KEYWORD, TokenKind::KW_OPERATOR},
+    {"template", TokenType::KEYWORD, TokenKind::KW_TEMPLATE},
+    {"typename", TokenType::KEYWORD, TokenKind::KW_TYPENAME},
+    {"mutable", TokenType::KEYWORD, TokenKind::KW_MUTABLE},
+    // Namespace
+    {"namespace", TokenType::KEYWORD, TokenKind::KW_NAMESPACE},
+    {"using", TokenType::KEYWORD, TokenKind::KW_USING},
+    // Casting
+    {"dynamic_cast", TokenType::KEYWORD, TokenKind::KW_DYNAMIC_CAST},
+    {"static_cast", TokenType::KEYWORD, TokenKind::KW_STATIC_CAST},
+    {"const_cast", TokenType::KEYWORD, TokenKind::KW_CONST_CAST},
+    {"reinterpret_cast", TokenType::KEYWORD, TokenKind::KW_REINTERPRET_CAST},
+    {"typeid", TokenType::KEYWORD, TokenKind::KW_TYPEID},
+    // Memory management
+    {"new", TokenType::KEYWORD, TokenKind::KW_NEW},
+    {"delete", TokenType::KEYWORD, TokenKind::KW_DELETE},
+    {"sizeof", TokenType::KEYWORD, TokenKind::KW_SIZEOF},
+    // Other
+    {"asm", TokenType::KEYWORD, TokenKind::KW_ASM},
+    {"export", TokenType::KEYWORD, TokenKind::KW_EXPORT},
+    {"wchar_t", TokenType::KEYWORD, TokenKind::KW_WCHAR_T},
+    {"bool", TokenType::KEYWORD, TokenKind::KW_BOOL},
+    {"true", TokenType::KEYWORD, TokenKind::KW_TRUE},
+    {"false", TokenType::KEYWORD, TokenKind::KW_FALSE},
+    // Storage class specifiers
+    {"static", TokenType::STORAGE_CLASS, TokenKind::KW_STATIC},
+    {"extern", TokenType::STORAGE_CLASS, TokenKind::KW_EXTERN},
+    {"auto", TokenType::STORAGE_CLASS, TokenKind::KW_AUTO},
+    {"register", TokenType::STORAGE_CLASS, TokenKind::KW_REGISTER},
+    // Type qualifiers
+    {"const", TokenType::TYPE_QUALIFIER, TokenKind::KW_CONST},
+    {"volatile", TokenType::TYPE_QUALIFIER, TokenKind::KW_VOLATILE},
     // Type keywords
-    type_keywords = {
-        {"void", TokenType::TYPE_SPECIFIER},
-        {"char", TokenType::TYPE_SPECIFIER},
-        {"short", TokenType::TYPE_SPECIFIER},
-        {"int", TokenType::TYPE_SPECIFIER},
-        {"long", TokenType::TYPE_SPECIFIER},
-        {"float", TokenType::TYPE_SPECIFIER},
-        {"double", TokenType::TYPE_SPECIFIER},
-        {"signed", TokenType::TYPE_SPECIFIER},
-        {"unsigned", TokenType::TYPE_SPECIFIER},
-        {"class", TokenType::TYPE_SPECIFIER},
-        {"struct", TokenType::TYPE_SPECIFIER},
-        {"union", TokenType::TYPE_SPECIFIER},
-        {"enum", TokenType::TYPE_SPECIFIER},
-        {"typedef", TokenType::TYPE_SPECIFIER}
-    };
-
+    {"void", TokenType::TYPE_SPECIFIER, TokenKind::KW_VOID},
+    {"char", TokenType::TYPE_SPECIFIER, TokenKind::KW_CHAR},
+    {"short", TokenType::TYPE_SPECIFIER, TokenKind::KW_SHORT},
+    {"int", TokenType::TYPE_SPECIFIER, TokenKind::KW_INT},
+    {"long", TokenType::TYPE_SPECIFIER, TokenKind::KW_LONG},
+    {"float", TokenType::TYPE_SPECIFIER, TokenKind::KW_FLOAT},
+    {"double", TokenType::TYPE_SPECIFIER, TokenKind::KW_DOUBLE},
+    {"signed", TokenType::TYPE_SPECIFIER, TokenKind::KW_SIGNED},
+    {"unsigned", TokenType::TYPE_SPECIFIER, TokenKind::KW_UNSIGNED},
+    {"class", TokenType::TYPE_SPECIFIER, TokenKind::KW_CLASS},
+    {"struct", TokenType::TYPE_SPECIFIER, TokenKind::KW_STRUCT},
+    {"union", TokenType::TYPE_SPECIFIER, TokenKind::KW_UNION},
+    {"enum", TokenType::TYPE_SPECIFIER, TokenKind::KW_ENUM},
+    {"typedef", TokenType::TYPE_SPECIFIER, TokenKind::KW_TYPEDEF},
     // Access specifiers
-    access_specifiers = {
-        {"public", TokenType::ACCESS_SPECIFIER},
-        {"private", TokenType::ACCESS_SPECIFIER},
-        {"protected", TokenType::ACCESS_SPECIFIER}
-    };
+    {"public", TokenType::ACCESS_SPECIFIER, TokenKind::KW_PUBLIC},
+    {"private", TokenType::ACCESS_SPECIFIER, TokenKind::KW_PRIVATE},
+    {"protected", TokenType::ACCESS_SPECIFIER, TokenKind::KW_PROTECTED},
+    // Multi-character operators and punctuators (readOperator scans the <, >, -, : and . forms)
+    {"++", TokenType::OPERATOR, TokenKind::INCREMENT},
+    {"--", TokenType::OPERATOR, TokenKind::DECREMENT},
+    {"+=", TokenType::OPERATOR, TokenKind::PLUS_ASSIGN},
+    {"-=", TokenType::OPERATOR, TokenKind::MINUS_ASSIGN},
+    {"*=", TokenType::OPERATOR, TokenKind::STAR_ASSIGN},
+    {"/=", TokenType::OPERATOR, TokenKind::SLASH_ASSIGN},
+    {"%=", TokenType::OPERATOR, TokenKind::PERCENT_ASSIGN},
+    {"==", TokenType::OPERATOR, TokenKind::EQUAL},
+    {"!=", TokenType::OPERATOR, TokenKind::NOT_EQUAL},
+    {"&&", TokenType::OPERATOR, TokenKind::AND_AND}, {"||", TokenType::OPERATOR, TokenKind::OR_OR},
+    {"&=", TokenType::OPERATOR, TokenKind::AMP_ASSIGN},
+    {"|=", TokenType::OPERATOR, TokenKind::PIPE_ASSIGN},
+    {"^=", TokenType::OPERATOR, TokenKind::CARET_ASSIGN},
+    {"<<", TokenType::OPERATOR, TokenKind::SHL}, {">>", TokenType::OPERATOR, TokenKind::SHR},
+    {"<<=", TokenType::OPERATOR, TokenKind::SHL_ASSIGN},
+    {">>=", TokenType::OPERATOR, TokenKind::SHR_ASSIGN},
+    {"<=", TokenType::LESS_EQUAL, TokenKind::LESS_EQUAL},
+    {">=", TokenType::GREATER_EQUAL, TokenKind::GREATER_EQUAL},
+    {"->", TokenType::ARROW, TokenKind::ARROW},
+    {"->*", TokenType::ARROW_STAR, TokenKind::ARROW_STAR},
+    {".*", TokenType::DOT_STAR, TokenKind::DOT_STAR},
+    {"...", TokenType::ELLIPSIS, TokenKind::ELLIPSIS},
+    {"::", TokenType::SCOPE_RESOLUTION, TokenKind::SCOPE}
+};
+
+constexpr size_t kLexemeSlots = 512;
+
+constexpr uint32_t lexemeHash(std::string_view text) {
+    uint32_t h = static_cast<uint32_t>(text.size());
+    for (char c : text) h = h * 237u + static_cast<unsigned char>(c);
+    return (h ^ (h >> 15)) & (kLexemeSlots - 1);
+}
 
-    // Storage class specifiers
-    keywords.insert({
-        {"static", TokenType::STORAGE_CLASS},
-        {"extern", TokenType::STORAGE_CLASS},
-        {"auto", TokenType::STORAGE_CLASS},
-        {"register", TokenType::STORAGE_CLASS}
-    });
+struct LexemeTable {
+    uint8_t slots[kLexemeSlots] = {};  // Index into kLexemes + 1, or 0
+    bool perfect = true;
+};
+
+constexpr LexemeTable buildLexemeTable() {
+    LexemeTable table{};
+    for (size_t i = 0; i < std::size(kLexemes); i++) {
+        uint8_t& slot = table.slots[lexemeHash(kLexemes[i].text)];
+        if (slot != 0) table.perfect = false;
+        slot = static_cast<uint8_t>(i + 1);
+    }
+    return table;
+}
 
-    // Type qualifiers
-    keywords.insert({
-        {"const", TokenType::TYPE_QUALIFIER},
-        {"volatile", TokenType::TYPE_QUALIFIER}
-    });
+constexpr LexemeTable kLexemeTable = buildLexemeTable();
+static_assert(std::size(kLexemes) < 256, "lexeme slots hold 8-bit indices");
+static_assert(kLexemeTable.perfect, "lexeme hash collides; pick another multiplier");
 
-    // Initialize operators (keeping for backward compatibility, but < > will be special-cased)
-    single_operators = "+-*/=!&|^%~?";  // REMOVED < > . from here
-    multi_char_operators = {
-        // Arithmetic
-        {"++", TokenType::OPERATOR},
-        {"--", TokenType::OPERATOR},
-        {"+=", TokenType::OPERATOR},
-        {"-=", TokenType::OPERATOR},
-        {"*=", TokenType::OPERATOR},
-        {"/=", TokenType::OPERATOR},
-        {"%=", TokenType::OPERATOR},
-
-        // Comparison
-        {"==", TokenType::OPERATOR},
-        {"!=", TokenType::OPERATOR},
-
-        // Logical
-        {"&&", TokenType::OPERATOR},
-        {"||", TokenType::OPERATOR},
-        {"!", TokenType::OPERATOR},
-
-        // Bitwise
-        {"&=", TokenType::OPERATOR},
-        {"|=", TokenType::OPERATOR},
-        {"^=", TokenType::OPERATOR},
-        {"<<", TokenType::OPERATOR},
-        {">>", TokenType::OPERATOR},
-        {"<<=", TokenType::OPERATOR},
-        {">>=", TokenType::OPERATOR}
-    };
+// The keyword or multi-character operator spelled `text`, or null
+const Lexeme* findLexeme(std::string_view text) {
+    uint8_t slot = kLexemeTable.slots[lexemeHash(text)];
+    if (slot != 0 && kLexemes[slot - 1].text == text) return &kLexemes[slot - 1];
+    return nullptr;
 }
 
-// Categorize keywords for better parsing
-Token Lexer::categorizeKeyword(const std::string& value, int line, int column) {
-    // Check access specifiers first
-    auto access_it = access_specifiers.find(value);
-    if (access_it != access_specifiers.end()) {
-        return Token(access_it->second, value, line, column);
+struct CharKindTable {
+    TokenKind kinds[256] = {};
+};
+
+constexpr CharKindTable buildCharKindTable() {
+    CharKindTable table{};
+    table.kinds['+'] = TokenKind::PLUS;
+    table.kinds['-'] = TokenKind::MINUS;
+    table.kinds['*'] = TokenKind::STAR;
+    table.kinds['/'] = TokenKind::SLASH;
+    table.kinds['%'] = TokenKind::PERCENT;
+    table.kinds['='] = TokenKind::ASSIGN;
+    table.kinds['!'] = TokenKind::NOT;
+    table.kinds['&'] = TokenKind::AMP;
+    table.kinds['|'] = TokenKind::PIPE;
+    table.kinds['^'] = TokenKind::CARET;
+    table.kinds['~'] = TokenKind::TILDE;
+    table.kinds['?'] = TokenKind::QUESTION;
+    table.kinds['<'] = TokenKind::LESS;
+    table.kinds['>'] = TokenKind::GREATER;
+    table.kinds['('] = TokenKind::LEFT_PAREN;
+    table.kinds[')'] = TokenKind::RIGHT_PAREN;
+    table.kinds['{'] = TokenKind::LEFT_BRACE;
+    table.kinds['}'] = TokenKind::RIGHT_BRACE;
+    table.kinds['['] = TokenKind::LEFT_BRACKET;
+    table.kinds[']'] = TokenKind::RIGHT_BRACKET;
+    table.kinds[','] = TokenKind::COMMA;
+    table.kinds[';'] = TokenKind::SEMICOLON;
+    table.kinds[':'] = TokenKind::COLON;
+    table.kinds['.'] = TokenKind::DOT;
+    return table;
+}
+
+// Kinds of the single-character operators and punctuators
+constexpr CharKindTable kCharKinds = buildCharKindTable();
+
+TokenKind operatorKind(std::string_view text) {
+    if (text.length() == 1) return kCharKinds.kinds[static_cast<unsigned char>(text[0])];
+    const Lexeme* lexeme = findLexeme(text);
+    return lexeme ? lexeme->kind : TokenKind::NONE;
+}
+
+// Character classes, indexed by byte. Bytes outside ASCII are OTHER.
+enum CharClass : uint8_t {
+    CC_OTHER,        // Punctuation and unknown symbols
+    CC_SPACE,        // ' ', '\t', '\r'
+    CC_NEWLINE,
+    CC_DIGIT,
+    CC_IDENT,        // Letters and '_'
+    CC_QUOTE,        // '"'
+    CC_APOSTROPHE,
+    CC_HASH,
+    CC_ANGLE,        // '<', '>'
+    CC_OPERATOR      // + - * / = ! & | ^ % ~ ?
+};
+
+struct CharClassTable {
+    CharClass classes[256] = {};
+};
+
+constexpr CharClassTable buildCharClassTable() {
+    CharClassTable table{};
+    for (int c = '0'; c <= '9'; c++) table.classes[c] = CC_DIGIT;
+    for (int c = 'a'; c <= 'z'; c++) table.classes[c] = CC_IDENT;
+    for (int c = 'A'; c <= 'Z'; c++) table.classes[c] = CC_IDENT;
+    table.classes['_'] = CC_IDENT;
+    table.classes[' '] = CC_SPACE;
+    table.classes['\t'] = CC_SPACE;
+    table.classes['\r'] = CC_SPACE;
+    table.classes['\n'] = CC_NEWLINE;
+    table.classes['"'] = CC_QUOTE;
+    table.classes['\''] = CC_APOSTROPHE;
+    table.classes['#'] = CC_HASH;
+    table.classes['<'] = CC_ANGLE;
+    table.classes['>'] = CC_ANGLE;
+    for (char c : std::string_view("+-*/=!&|^%~?")) table.classes[static_cast<unsigned char>(c)] = CC_OPERATOR;
+    return table;
+}
+
+constexpr CharClassTable kCharClasses = buildCharClassTable();
+
+inline CharClass charClass(char c) {
+    return kCharClasses.classes[static_cast<unsigned char>(c)];
+}
+
+inline bool isDigit(char c) {
+    return charClass(c) == CC_DIGIT;
+}
+
+inline bool isIdentChar(char c) {
+    CharClass cls = charClass(c);
+    return cls == CC_IDENT || cls == CC_DIGIT;
+}
+
+// Stage 1 of parallel lexing: a structural pass that follows only the bytes
+// that can open or close a string, character literal, comment or directive,
+// and records newlines outside of them where the file can be cut.
+struct SplitPoint {
+    size_t offset;  // First byte of a chunk; always just after a newline
+    size_t line;
+};
+
+constexpr bool isStructural(char c) {
+    return c == '"' || c == '\'' || c == '/' || c == '#' || c == '\n' || c == '\\' || c == '*';
+}
+
+// Structural bytes of block[0, 16) as a bitmask
+inline uint32_t structuralMask(const char* block) {
+#if defined(__SSE2__)
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+    __m128i hits = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"'));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\'')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('/')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('#')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('*')));
+    return static_cast<uint32_t>(_mm_movemask_epi8(hits));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < 16; i++) {
+        if (isStructural(block[i])) mask |= 1u << i;
     }
+    return mask;
+#endif
+}
 
-    // Check type keywords
-    auto type_it = type_keywords.find(value);
-    if (type_it != type_keywords.end()) {
-        return Token(type_it->second, value, line, column);
+inline size_t lowestBit(uint32_t mask) {
+#if defined(__GNUC__)
+    return static_cast<size_t>(__builtin_ctz(mask));
+#else
+    size_t bit = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        bit++;
     }
+    return bit;
+#endif
+}
 
-    // Check other keywords
-    auto keyword_it = keywords.find(value);
-    if (keyword_it != keywords.end()) {
-        return Token(keyword_it->second, value, line, column);
+} // namespace
+
+// Resumable stage-1 state. Offsets are absolute, so a stream can feed the
+// input a block at a time. Lines are counted the way the Lexer counts them:
+// not inside character literals, and not after a backslash inside a string.
+class StructuralScanner {
+public:
+    size_t line = 1;
+
+    // Visit the structural bytes at offsets [from, to) of `text`, which starts
+    // at offset `base`. A byte's successor must be in `text` unless it is the
+    // last byte of the input. `codeNewline(offset)` is called, after `line`
+    // is advanced, for each newline outside literals and comments.
+    template <typename OnNewline>
+    void scan(std::string_view text, size_t base, size_t from, size_t to, OnNewline&& codeNewline) {
+        size_t i = from;
+        for (; i + 16 <= to; i += 16) {
+            for (uint32_t mask = structuralMask(text.data() + i - base); mask != 0; mask &= mask - 1) {
+                visit(text, base, i + lowestBit(mask), codeNewline);
+            }
+        }
+        for (; i < to; i++) {
+            if (isStructural(text[i - base])) visit(text, base, i, codeNewline);
+        }
     }
 
-    // Not a keyword
-    return Token(TokenType::IDENTIFIER, value, line, column);
+private:
+    enum class State { CODE, STRING, CHARACTER, LINE, BLOCK_COMMENT };
+    State state = State::CODE;
+    size_t next = 0;  // Bytes before this were consumed by a two-byte sequence
+
+    template <typename OnNewline>
+    void visit(std::string_view text, size_t base, size_t i, OnNewline& codeNewline) {
+        if (i < next) return;
+        char c = text[i - base];
+        char following = i + 1 - base < text.length() ? text[i + 1 - base] : '\0';
+        switch (state) {
+            case State::CODE:
+                if (c == '"') state = State::STRING;
+                else if (c == '\'') state = State::CHARACTER;
+                else if (c == '#') state = State::LINE;  // Directives run to the end of the line
+                else if (c == '/' && following == '/') { state = State::LINE; next = i + 2; }
+                else if (c == '/' && following == '*') { state = State::BLOCK_COMMENT; next = i + 2; }
+                else if (c == '\n') { line++; codeNewline(i); }
+                break;
+            case State::STRING:
+                if (c == '\\') next = i + 2;
+                else if (c == '"') state = State::CODE;
+                else if (c == '\n') line++;
+                break;
+            case State::CHARACTER:
+                if (c == '\\') next = i + 2;
+                else if (c == '\'') state = State::CODE;
+                break;
+            case State::LINE:
+                if (c == '\n') {
+                    state = State::CODE;
+                    line++;
+                    codeNewline(i);
+                }
+                break;
+            case State::BLOCK_COMMENT:
+                if (c == '\n') line++;
+                else if (c == '*' && following == '/') { state = State::CODE; next = i + 2; }
+                break;
+        }
+    }
+};
+
+namespace {
+
+// Cut `source` into about `chunks` pieces, each starting at a token boundary
+std::vector<SplitPoint> findSplitPoints(std::string_view source, size_t chunks) {
+    StructuralScanner scanner;
+    std::vector<SplitPoint> splits{{0, 1}};
+    size_t target = source.length() / chunks;
+    scanner.scan(source, 0, 0, source.length(), [&](size_t i) {
+        if (i + 1 >= splits.size() * target && i + 1 < source.length() && splits.size() < chunks) {
+            splits.push_back({i + 1, scanner.line});
+        }
+    });
+    return splits;
 }
 
-// Main analysis method
-std::vector<Token> Lexer::tokenize() {
-    tokens.clear();
-    error_flag = false;
-    position = 0;
-    line = 1;
-    column = 1;
+} // namespace
 
-    while (position < source.length()) {
-        skipWhitespace();
+TokenStream::TokenStream(std::istream& input, const std::string& file)
+    : in(input), filename(file), scanner(std::make_unique<StructuralScanner>()) {}
 
-        if (position >= source.length()) {
-            break;
-        }
+TokenStream::~TokenStream() = default;
 
-        char current = source[position];
-        Token token = getNextToken();
+bool TokenStream::pull() {
+    if (finished) {
+        return false;
+    }
 
-        if (token.type != TokenType::UNKNOWN) {
-            tokens.push_back(token);
-        }
+    // Read until the pending text holds at least one complete line
+    size_t cut = 0;
+    while (cut == 0 && !input_done) {
+        size_t old_size = pending.size();
+        pending.resize(old_size + kStreamBlockBytes);
+        in.read(&pending[old_size], kStreamBlockBytes);
+        pending.resize(old_size + static_cast<size_t>(in.gcount()));
+        input_done = !in;
+        // A byte's successor decides `//` and `/*`, so the last one waits for more input
+        size_t end = pending_base + pending.size() - (input_done || pending.empty() ? 0 : 1);
+        scanner->scan(pending, pending_base, scanned, end, [&](size_t offset) {
+            cut = offset + 1 - pending_base;
+        });
+        scanned = end;
     }
 
-    tokens.push_back(Token(TokenType::END_OF_FILE, "", line, column));
-    return tokens;
+    size_t length = input_done ? pending.size() : cut;
+    auto text = std::make_unique<std::string>(pending, 0, length);
+    pending.erase(0, length);
+    pending_base += length;
+
+    Lexer lexer(*text, filename);
+    lexer.first_line = line;
+    lexer.first_column = column;
+    lexer.scanTokens();
+    error_flag = error_flag || lexer.error_flag;
+    line = lexer.line;
+    column = lexer.column;
+
+    // Only the last segment ends the input
+    const auto& tokens = lexer.tokens;
+    window.insert(window.end(), tokens.begin(), input_done ? tokens.end() : tokens.end() - 1);
+    segments.push_back({std::move(text), base + window.size()});
+    peak_window = std::max(peak_window, window.size());
+    finished = input_done;
+    return true;
 }
 
-// Get next token
-Token Lexer::getNextToken() {
-    char current = source[position];
-
-    // Preprocessor directives
-    if (current == '#') {
-        return readPreprocessor();
+const Token& TokenStream::at(size_t index) {
+    while (index >= base + window.size() && pull()) {}
+    if (index >= base + window.size()) {
+        return window.back();
     }
+    return window[index - base];
+}
 
-    // Numbers
-    if (std::isdigit(current)) {
-        return readNumber();
+bool TokenStream::has(size_t index) {
+    while (index >= base + window.size() && pull()) {}
+    return index < base + window.size();
+}
+
+void TokenStream::release(size_t index) {
+    // END_OF_FILE stays, so at() always has a token to return
+    while (base < index && window.size() > 1) {
+        window.pop_front();
+        base++;
     }
+    while (!segments.empty() && segments.front().end_token <= base) {
+        segments.pop_front();
+    }
+}
 
-    // Identifiers and keywords
-    if (std::isalpha(current) || current == '_') {
-        Token ident = readIdentifier();
+// Constructor
+Lexer::Lexer(std::string_view input, const std::string& file)
+    : source(input), position(0), line(1), column(1), error_flag(false), filename(file) {}
 
-        // Categorize if it's a keyword
-        if (ident.type == TokenType::IDENTIFIER) {
-            return categorizeKeyword(ident.value, ident.line, ident.column);
-        }
-        return ident;
+// Categorize keywords for better parsing
+Token Lexer::categorizeKeyword(Token token) {
+    if (const Lexeme* lexeme = findLexeme(token.value)) {
+        token.type = lexeme->type;
+        token.kind = lexeme->kind;
     }
+    return token;
+}
 
-    // Strings
-    if (current == '"') {
-        return readString();
+// Token for source[start, position)
+Token Lexer::makeToken(TokenType type, size_t start, size_t startLine, size_t startColumn) const {
+    return Token{type, TokenKind::NONE, static_cast<int>(startLine), static_cast<int>(startColumn), source.substr(start, position - start)};
+}
+
+// Token for an operator or punctuator at source[start, position), with its kind
+Token Lexer::makeOperator(TokenType type, size_t start, size_t startLine, size_t startColumn) const {
+    Token token = makeToken(type, start, startLine, startColumn);
+    token.kind = operatorKind(token.value);
+    return token;
+}
+
+// Main analysis method
+const std::vector<Token>& Lexer::tokenize() {
+    unsigned threads = std::thread::hardware_concurrency();
+    size_t chunks = std::min<size_t>(threads, source.length() / kMinLexChunkBytes);
+    if (source.length() < kParallelLexBytes || chunks < 2 || !tokenizeParallel(static_cast<unsigned>(chunks))) {
+        scanTokens();
     }
+    return tokens;
+}
 
-    // Character literals
-    if (current == '\'') {
-        return readCharacter();
+// Stage 2: lex each chunk on its own thread, then concatenate the tokens.
+// False if the file has no usable split points.
+bool Lexer::tokenizeParallel(unsigned threads) {
+    std::vector<SplitPoint> splits = findSplitPoints(source, threads);
+    if (splits.size() < 2) {
+        return false;
     }
 
-    // Comments
-    if (current == '/') {
-        if (position + 1 < source.length()) {
-            if (source[position + 1] == '/') {
-                return readSingleLineComment();
-            } else if (source[position + 1] == '*') {
-                return readMultiLineComment();
-            }
-        }
+    std::vector<std::unique_ptr<Lexer>> chunks;
+    std::vector<std::string> logs(splits.size());
+    for (size_t i = 0; i < splits.size(); i++) {
+        size_t end = i + 1 < splits.size() ? splits[i + 1].offset : source.length();
+        auto chunk = std::make_unique<Lexer>(source.substr(splits[i].offset, end - splits[i].offset), filename);
+        chunk->first_line = splits[i].line;
+        chunk->first_column = i == 0 ? 1 : 2;  // A newline is column 1 of its line
+        chunk->error_log = &logs[i];
+        chunks.push_back(std::move(chunk));
+    }
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < chunks.size(); i++) {
+        workers.emplace_back([chunk = chunks[i].get()] { chunk->scanTokens(); });
+    }
+    chunks[0]->scanTokens();
+    for (auto& worker : workers) {
+        worker.join();
     }
 
-    // Special handling for < and > (CRITICAL FIX)
-    if (current == '<' || current == '>') {
-        return readOperator();
+    // Every chunk but the last ends after a newline, so only its END_OF_FILE goes
+    size_t total = 0;
+    for (const auto& chunk : chunks) total += chunk->tokens.size();
+    tokens.clear();
+    tokens.reserve(total);
+    error_flag = false;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        const auto& part = chunks[i]->tokens;
+        tokens.insert(tokens.end(), part.begin(), i + 1 < chunks.size() ? part.end() - 1 : part.end());
+        error_flag = error_flag || chunks[i]->error_flag;
+        std::cerr << logs[i];
     }
+    line = chunks.back()->line;
+    column = chunks.back()->column;
+    position = source.length();
+    return true;
+}
+
+void Lexer::scanTokens() {
+    tokens.clear();
+    tokens.reserve(source.length() / 8);
+    error_flag = false;
+    position = 0;
+    line = first_line;
+    column = first_column;
+
+    while (position < source.length()) {
+        skipWhitespace();
 
-    // Other operators
-    if (single_operators.find(current) != std::string::npos) {
-        return readOperator();
+        if (position >= source.length()) {
+            break;
+        }
+
+        Token token = getNextToken();
+
+        if (token.type != TokenType::UNKNOWN) {
+            tokens.push_back(token);
+        }
     }
 
-    // Punctuation (includes . : , ; etc.)
-    return readPunctuation();
+    tokens.push_back(Token{TokenType::END_OF_FILE, TokenKind::NONE, static_cast<int>(line), static_cast<int>(column), source.substr(source.length())});
+}
+
+// Get next token
+Token Lexer::getNextToken() {
+    switch (charClass(source[position])) {
+        // Preprocessor directives
+        case CC_HASH: return readPreprocessor();
+        case CC_DIGIT: return readNumber();
+        // Identifiers and keywords
+        case CC_IDENT: return categorizeKeyword(readIdentifier());
+        case CC_QUOTE: return readString();
+        case CC_APOSTROPHE: return readCharacter();
+        // < and > have their own template/shift forms in readOperator
+        case CC_ANGLE:
+        case CC_OPERATOR: return readOperator();
+        // Punctuation (includes . : , ; etc.)
+        default: return readPunctuation();
+    }
 }
 
 // Error check
@@ -308,12 +639,17 @@ bool Lexer::saveTokensToFile(const std::string& output_filename) const {
 void Lexer::skipWhitespace() {
     while (position < source.length()) {
         char current = source[position];
-        if (current == ' ' || current == '\t' || current == '\r') {
+        CharClass cls = charClass(current);
+        if (cls == CC_SPACE) {
             advance();
-        } else if (current == '\n') {
+        } else if (cls == CC_NEWLINE) {
             line++;
             column = 1;
             advance();
+        } else if (current == '/' && position + 1 < source.length() && source[position + 1] == '/') {
+            skipSingleLineComment();
+        } else if (current == '/' && position + 1 < source.length() && source[position + 1] == '*') {
+            skipMultiLineComment();
         } else {
             break;
         }
@@ -331,7 +667,7 @@ Token Lexer::readNumber() {
     while (position < source.length()) {
         char current = source[position];
 
-        if (std::isdigit(current)) {
+        if (isDigit(current)) {
             advance();
         } else if (current == '.' && !has_dot && !has_exponent) {
             has_dot = true;
@@ -368,8 +704,7 @@ Token Lexer::readNumber() {
         }
     }
 
-    std::string value = source.substr(start, position - start);
-    return Token(TokenType::NUMBER, value, startLine, startColumn);
+    return makeToken(TokenType::NUMBER, start, startLine, startColumn);
 }
 
 Token Lexer::readIdentifier() {
@@ -378,12 +713,11 @@ Token Lexer::readIdentifier() {
     size_t startColumn = column;
 
     while (position < source.length() &&
-           (std::isalnum(source[position]) || source[position] == '_')) {
+           isIdentChar(source[position])) {
         advance();
     }
 
-    std::string value = source.substr(start, position - start);
-    return Token(TokenType::IDENTIFIER, value, startLine, startColumn);
+    return makeToken(TokenType::IDENTIFIER, start, startLine, startColumn);
 }
 
 Token Lexer::readString() {
@@ -421,8 +755,8 @@ Token Lexer::readString() {
         reportError("Unterminated string literal", startLine, startColumn);
     }
 
-    std::string value = source.substr(start + 1, position - start - 2);
-    return Token(TokenType::STRING, value, startLine, startColumn);
+    size_t end = position - (position > start + 1 && source[position - 1] == '"' ? 1 : 0);
+    return Token{TokenType::STRING, TokenKind::NONE, static_cast<int>(startLine), static_cast<int>(startColumn), source.substr(start + 1, end - start - 1)};
 }
 
 Token Lexer::readCharacter() {
@@ -457,15 +791,11 @@ Token Lexer::readCharacter() {
         reportError("Unterminated character literal", startLine, startColumn);
     }
 
-    std::string value = source.substr(start + 1, position - start - 2);
-    return Token(TokenType::CHARACTER, value, startLine, startColumn);
+    size_t end = position - (position > start + 1 && source[position - 1] == '\'' ? 1 : 0);
+    return Token{TokenType::CHARACTER, TokenKind::NONE, static_cast<int>(startLine), static_cast<int>(startColumn), source.substr(start + 1, end - start - 1)};
 }
 
-Token Lexer::readSingleLineComment() {
-    size_t start = position;
-    size_t startLine = line;
-    size_t startColumn = column;
-
+void Lexer::skipSingleLineComment() {
     // Skip "//"
     advance();
     advance();
@@ -473,13 +803,9 @@ Token Lexer::readSingleLineComment() {
     while (position < source.length() && source[position] != '\n') {
         advance();
     }
-
-    std::string value = source.substr(start + 2, position - start - 2);
-    return Token(TokenType::COMMENT, value, startLine, startColumn);
 }
 
-Token Lexer::readMultiLineComment() {
-    size_t start = position;
+void Lexer::skipMultiLineComment() {
     size_t startLine = line;
     size_t startColumn = column;
 
@@ -487,6 +813,7 @@ Token Lexer::readMultiLineComment() {
     advance();
     advance();
 
+    bool closed = false;
     while (position < source.length()) {
         if (source[position] == '\n') {
             line++;
@@ -496,21 +823,20 @@ Token Lexer::readMultiLineComment() {
                    source[position + 1] == '/') {
             advance(); // *
             advance(); // /
+            closed = true;
             break;
         }
         advance();
     }
 
-    if (position >= source.length()) {
+    if (!closed) {
         reportError("Unterminated multi-line comment", startLine, startColumn);
     }
-
-    std::string value = source.substr(start + 2, position - start - 4);
-    return Token(TokenType::COMMENT, value, startLine, startColumn);
 }
 
 // COMPLETELY REWRITTEN readOperator() - CRITICAL FIX
 Token Lexer::readOperator() {
+    size_t start = position;
     size_t startLine = line;
     size_t startColumn = column;
     char current = source[position];
@@ -520,21 +846,21 @@ Token Lexer::readOperator() {
         if (position + 2 < source.length() && source[position + 1] == '<' && source[position + 2] == '=') {
             // <<=
             advance(); advance(); advance();
-            return Token(TokenType::OPERATOR, "<<=", startLine, startColumn);
+            return makeOperator(TokenType::OPERATOR, start, startLine, startColumn);
         }
         if (position + 1 < source.length() && source[position + 1] == '<') {
             // << (left shift / stream output)
             advance(); advance();
-            return Token(TokenType::LEFT_SHIFT, "<<", startLine, startColumn);
+            return makeOperator(TokenType::LEFT_SHIFT, start, startLine, startColumn);
         }
         if (position + 1 < source.length() && source[position + 1] == '=') {
             // <=
             advance(); advance();
-            return Token(TokenType::LESS_EQUAL, "<=", startLine, startColumn);
+            return makeOperator(TokenType::LESS_EQUAL, start, startLine, startColumn);
         }
         // <
         advance();
-        return Token(TokenType::LESS, "<", startLine, startColumn);
+        return makeOperator(TokenType::LESS, start, startLine, startColumn);
     }
 
     // === HANDLE > OPERATOR AND VARIANTS ===
@@ -542,21 +868,21 @@ Token Lexer::readOperator() {
         if (position + 2 < source.length() && source[position + 1] == '>' && source[position + 2] == '=') {
             // >>=
             advance(); advance(); advance();
-            return Token(TokenType::OPERATOR, ">>=", startLine, startColumn);
+            return makeOperator(TokenType::OPERATOR, start, startLine, startColumn);
         }
         if (position + 1 < source.length() && source[position + 1] == '>') {
             // >> (right shift / stream input)
             advance(); advance();
-            return Token(TokenType::RIGHT_SHIFT, ">>", startLine, startColumn);
+            return makeOperator(TokenType::RIGHT_SHIFT, start, startLine, startColumn);
         }
         if (position + 1 < source.length() && source[position + 1] == '=') {
             // >=
             advance(); advance();
-            return Token(TokenType::GREATER_EQUAL, ">=", startLine, startColumn);
+            return makeOperator(TokenType::GREATER_EQUAL, start, startLine, startColumn);
         }
         // >
         advance();
-        return Token(TokenType::GREATER, ">", startLine, startColumn);
+        return makeOperator(TokenType::GREATER, start, startLine, startColumn);
     }
 
     // === HANDLE -> AND ->* ===
@@ -564,37 +890,37 @@ Token Lexer::readOperator() {
         if (position + 2 < source.length() && source[position + 1] == '>' && source[position + 2] == '*') {
             // ->*
             advance(); advance(); advance();
-            return Token(TokenType::ARROW_STAR, "->*", startLine, startColumn);
+            return makeOperator(TokenType::ARROW_STAR, start, startLine, startColumn);
         }
         if (position + 1 < source.length() && source[position + 1] == '>') {
             // ->
             advance(); advance();
-            return Token(TokenType::ARROW, "->", startLine, startColumn);
+            return makeOperator(TokenType::ARROW, start, startLine, startColumn);
         }
         if (position + 1 < source.length() && source[position + 1] == '-') {
             // --
             advance(); advance();
-            return Token(TokenType::OPERATOR, "--", startLine, startColumn);
+            return makeOperator(TokenType::OPERATOR, start, startLine, startColumn);
         }
         if (position + 1 < source.length() && source[position + 1] == '=') {
             // -=
             advance(); advance();
-            return Token(TokenType::OPERATOR, "-=", startLine, startColumn);
+            return makeOperator(TokenType::OPERATOR, start, startLine, startColumn);
         }
         // -
         advance();
-        return Token(TokenType::OPERATOR, "-", startLine, startColumn);
+        return makeOperator(TokenType::OPERATOR, start, startLine, startColumn);
     }
 
     // === HANDLE :: (SCOPE RESOLUTION) ===
     if (current == ':') {
         if (position + 1 < source.length() && source[position + 1] == ':') {
             advance(); advance();
-            return Token(TokenType::SCOPE_RESOLUTION, "::", startLine, startColumn);
+            return makeOperator(TokenType::SCOPE_RESOLUTION, start, startLine, startColumn);
         }
         // Single : is handled by readPunctuation
         advance();
-        return Token(TokenType::COLON, ":", startLine, startColumn);
+        return makeOperator(TokenType::COLON, start, startLine, startColumn);
     }
 
     // === HANDLE . AND .* ===
@@ -602,42 +928,39 @@ Token Lexer::readOperator() {
         if (position + 2 < source.length() && source[position + 1] == '.' && source[position + 2] == '.') {
             // ...
             advance(); advance(); advance();
-            return Token(TokenType::ELLIPSIS, "...", startLine, startColumn);
+            return makeOperator(TokenType::ELLIPSIS, start, startLine, startColumn);
         }
         if (position + 1 < source.length() && source[position + 1] == '*') {
             // .*
             advance(); advance();
-            return Token(TokenType::DOT_STAR, ".*", startLine, startColumn);
+            return makeOperator(TokenType::DOT_STAR, start, startLine, startColumn);
         }
         // Single . is handled by readPunctuation
         advance();
-        return Token(TokenType::DOT, ".", startLine, startColumn);
+        return makeOperator(TokenType::DOT, start, startLine, startColumn);
     }
 
     // === HANDLE OTHER MULTI-CHAR OPERATORS ===
     if (position + 1 < source.length()) {
-        std::string twoChar = source.substr(position, 2);
-
-        // Check multi_char_operators map
-        if (multi_char_operators.find(twoChar) != multi_char_operators.end()) {
+        // Two-character operators from the lexeme table
+        if (const Lexeme* lexeme = findLexeme(source.substr(position, 2))) {
             advance(); advance();
-            return Token(multi_char_operators[twoChar], twoChar, startLine, startColumn);
+            return makeOperator(lexeme->type, start, startLine, startColumn);
         }
     }
 
     // === SINGLE CHARACTER OPERATORS ===
-    std::string value = std::string(1, current);
     advance();
-    return Token(TokenType::OPERATOR, value, startLine, startColumn);
+    return makeOperator(TokenType::OPERATOR, start, startLine, startColumn);
 }
 
 Token Lexer::readPunctuation() {
+    size_t start = position;
     size_t startLine = line;
     size_t startColumn = column;
     char current = source[position];
 
     TokenType type = TokenType::UNKNOWN;
-    std::string value = std::string(1, current);
 
     switch (current) {
         case '(': type = TokenType::LEFT_PAREN; break;
@@ -652,7 +975,7 @@ Token Lexer::readPunctuation() {
             // Check for :: (should be handled in readOperator now)
             if (position + 1 < source.length() && source[position + 1] == ':') {
                 advance(); advance();
-                return Token(TokenType::SCOPE_RESOLUTION, "::", startLine, startColumn);
+                return makeOperator(TokenType::SCOPE_RESOLUTION, start, startLine, startColumn);
             }
             type = TokenType::COLON;
             break;
@@ -661,13 +984,13 @@ Token Lexer::readPunctuation() {
             type = TokenType::DOT;
             break;
         default:
-            reportError("Unknown symbol: " + value, startLine, startColumn);
+            reportError("Unknown symbol: " + std::string(1, current), startLine, startColumn);
             advance();
-            return Token(TokenType::UNKNOWN, value, startLine, startColumn);
+            return makeToken(TokenType::UNKNOWN, start, startLine, startColumn);
     }
 
     advance();
-    return Token(type, value, startLine, startColumn);
+    return makeOperator(type, start, startLine, startColumn);
 }
 
 Token Lexer::readPreprocessor() {
@@ -681,8 +1004,7 @@ Token Lexer::readPreprocessor() {
         advance();
     }
 
-    std::string value = source.substr(start, position - start);
-    return Token(TokenType::PREPROCESSOR, value, startLine, startColumn);
+    return makeToken(TokenType::PREPROCESSOR, start, startLine, startColumn);
 }
 
 void Lexer::advance() {
@@ -694,9 +1016,15 @@ void Lexer::advance() {
 
 void Lexer::reportError(const std::string& message, int errorLine, int errorColumn) {
     std::string file_info = filename.empty() ? "" : " file " + filename;
-    std::cerr << "Lexer error" << file_info
-              << " (line " << errorLine
-              << ", column " << errorColumn << "): " << message << std::endl;
+    std::ostringstream text;
+    text << "Lexer error" << file_info
+         << " (line " << errorLine
+         << ", column " << errorColumn << "): " << message << "\n";
+    if (error_log) {
+        *error_log += text.str();
+    } else {
+        std::cerr << text.str() << std::flush;
+    }
     error_flag = true;
 }
 
@@ -739,15 +1067,3 @@ std::string Lexer::tokenTypeToString(TokenType type) const {
         default: return "UNKNOWN";
     }
 }
-
-// Read file into string
-std::string readFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file) {
-        throw std::runtime_error("Failed to open file: " + filename);
-    }
-
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
-}
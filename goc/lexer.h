@@ -1,16 +1,19 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <cstdint>
+#include <deque>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cctype>
 #include <unordered_map>
-#include <sstream>
 #include <iomanip>
 #include <fstream>
 
-enum class TokenType {
+enum class TokenType : uint8_t {
     // Basic
     NUMBER,
     IDENTIFIER,
@@ -18,7 +21,7 @@ enum class TokenType {
     KEYWORD,
     STRING,
     CHARACTER,
-    COMMENT,
+    COMMENT,           // Skipped by the lexer; kept for token dumps
 
     // Brackets
     LEFT_PAREN,
@@ -64,57 +67,95 @@ enum class TokenType {
     ELLIPSIS          // ... (variadic)
 };
 
-// Token structure
+// Dense kind of every keyword, operator and punctuator, so the parser and
+// code generator can switch on it instead of comparing text. NONE for
+// identifiers, literals and directives.
+enum class TokenKind : uint8_t {
+    NONE,
+
+    // Keywords
+    KW_IF, KW_ELSE, KW_WHILE, KW_FOR, KW_DO, KW_SWITCH, KW_CASE, KW_DEFAULT, KW_BREAK,
+    KW_CONTINUE, KW_RETURN, KW_GOTO, KW_TRY, KW_CATCH, KW_THROW, KW_THIS, KW_VIRTUAL,
+    KW_EXPLICIT, KW_FRIEND, KW_INLINE, KW_OPERATOR, KW_TEMPLATE, KW_TYPENAME, KW_MUTABLE,
+    KW_NAMESPACE, KW_USING, KW_DYNAMIC_CAST, KW_STATIC_CAST, KW_CONST_CAST, KW_REINTERPRET_CAST,
+    KW_TYPEID, KW_NEW, KW_DELETE, KW_SIZEOF, KW_ASM, KW_EXPORT, KW_WCHAR_T, KW_BOOL, KW_TRUE,
+    KW_FALSE, KW_STATIC, KW_EXTERN, KW_AUTO, KW_REGISTER, KW_CONST, KW_VOLATILE, KW_VOID,
+    KW_CHAR, KW_SHORT, KW_INT, KW_LONG, KW_FLOAT, KW_DOUBLE, KW_SIGNED, KW_UNSIGNED, KW_CLASS,
+    KW_STRUCT, KW_UNION, KW_ENUM, KW_TYPEDEF, KW_PUBLIC, KW_PRIVATE, KW_PROTECTED,
+
+    // Operators and punctuators
+    PLUS, MINUS, STAR, SLASH, PERCENT, ASSIGN, NOT, AMP, PIPE, CARET, TILDE, QUESTION, LESS,
+    GREATER, LEFT_PAREN, RIGHT_PAREN, LEFT_BRACE, RIGHT_BRACE, LEFT_BRACKET, RIGHT_BRACKET,
+    COMMA, SEMICOLON, COLON, DOT, INCREMENT, DECREMENT, PLUS_ASSIGN, MINUS_ASSIGN, STAR_ASSIGN,
+    SLASH_ASSIGN, PERCENT_ASSIGN, EQUAL, NOT_EQUAL, AND_AND, OR_OR, AMP_ASSIGN, PIPE_ASSIGN,
+    CARET_ASSIGN, SHL, SHR, SHL_ASSIGN, SHR_ASSIGN, LESS_EQUAL, GREATER_EQUAL, ARROW,
+    ARROW_STAR, DOT_STAR, ELLIPSIS, SCOPE
+};
+
+// Token structure. `value` points into the source buffer given to the Lexer,
+// which must outlive the tokens (string and character literals exclude their
+// quotes).
 struct Token {
     TokenType type;
-    std::string value;
+    TokenKind kind;
     int line;
     int column;
+    std::string_view value;
 
-    Token(TokenType t, const std::string& v, int l, int c)
-        : type(t), value(v), line(l), column(c) {}
+    std::string text() const { return std::string(value); }
 };
 
+const size_t kParallelLexBytes = 1 << 20;
+const size_t kMinLexChunkBytes = 256 << 10;
+const size_t kStreamBlockBytes = 64 << 10;
+
+class StructuralScanner;
+
 class Lexer {
+    friend class TokenStream;  // Lexes one segment of a stream at a time
+
 private:
-    std::string source;
+    std::string_view source;
     size_t position;
     size_t line;
     size_t column;
     std::vector<Token> tokens;
     bool error_flag;
     std::string filename;
+    size_t first_line = 1;               // Position of source[0] when lexing one chunk of a file
+    size_t first_column = 1;
+    std::string* error_log = nullptr;    // Chunks collect their errors to print in order
 
-    // C++ keywords categorized
-    std::unordered_map<std::string, TokenType> keywords;
-    std::unordered_map<std::string, TokenType> type_keywords;
-    std::unordered_map<std::string, TokenType> access_specifiers;
-
-    // Operators (keeping for backward compatibility, but will use specific tokens)
-    std::string single_operators;
-    std::unordered_map<std::string, TokenType> multi_char_operators;
+    // Keywords, operators and character classes live in static tables in lexer.cpp
 
     // Private methods
-    void skipWhitespace();
+    void skipWhitespace();  // Also skips comments
     Token readNumber();
     Token readIdentifier();
     Token readString();
     Token readCharacter();
-    Token readSingleLineComment();
-    Token readMultiLineComment();
+    void skipSingleLineComment();
+    void skipMultiLineComment();
     Token readOperator();
     Token readPunctuation();
     Token readPreprocessor();
     void advance();
     void reportError(const std::string& message, int errorLine, int errorColumn);
+    void scanTokens();
+    bool tokenizeParallel(unsigned threads);
     std::string tokenTypeToString(TokenType type) const;
-    Token categorizeKeyword(const std::string& value, int line, int column);
+    Token categorizeKeyword(Token token);
+    Token makeToken(TokenType type, size_t start, size_t startLine, size_t startColumn) const;
+    Token makeOperator(TokenType type, size_t start, size_t startLine, size_t startColumn) const;
 
 public:
-    Lexer(const std::string& input, const std::string& file = "");
+    // `input` is not copied: it must outlive the lexer and its tokens
+    Lexer(std::string_view input, const std::string& file = "");
 
-    // Main method
-    std::vector<Token> tokenize();
+    // Main method; the tokens stay owned by the lexer. Sources of
+    // kParallelLexBytes or more are split at safe line boundaries and the
+    // chunks lexed on separate threads.
+    const std::vector<Token>& tokenize();
 
     // Get next token
     Token getNextToken();
@@ -132,7 +173,52 @@ public:
     bool saveTokensToFile(const std::string& output_filename) const;
 };
 
-// Read file into string
-std::string readFile(const std::string& filename);
+// Pull lexer for inputs that should not be held in memory whole (goc
+// --stream, or `-` for stdin). The input is read kStreamBlockBytes at a
+// time; complete lines up to a newline outside any literal or comment form
+// a segment, which is lexed like one chunk of tokenizeParallel. Tokens are
+// numbered from 0 over the whole input and kept from the last release()
+// onwards, along with the segments their values point into, so memory is
+// bounded by the parser's backtracking window instead of the input size.
+class TokenStream {
+public:
+    explicit TokenStream(std::istream& input, const std::string& file = "");
+    ~TokenStream();
+
+    // Token `index`, or END_OF_FILE past the end. Never below the release point.
+    const Token& at(size_t index);
+    // Whether the input has a token `index` (END_OF_FILE included)
+    bool has(size_t index);
+    // Tokens before `index` will not be asked for again
+    void release(size_t index);
+
+    bool hasErrors() const { return error_flag; }
+    size_t tokenCount() const { return base + window.size(); }  // Pulled so far
+    size_t peakWindow() const { return peak_window; }
+
+private:
+    struct Segment {
+        std::unique_ptr<std::string> text;  // Stable storage for token values
+        size_t end_token;                   // First token not pointing into it
+    };
+
+    std::istream& in;
+    std::string filename;
+    std::unique_ptr<StructuralScanner> scanner;
+    std::string pending;       // Read but not yet lexed
+    size_t pending_base = 0;   // Input offset of pending[0]
+    size_t scanned = 0;        // Input offset the scanner has reached
+    size_t line = 1;           // Lexer position at the start of `pending`
+    size_t column = 1;
+    bool input_done = false;
+    bool finished = false;
+    bool error_flag = false;
+    std::deque<Token> window;  // Tokens [base, base + window.size())
+    size_t base = 0;
+    std::deque<Segment> segments;
+    size_t peak_window = 0;
+
+    bool pull();  // Lex one more segment; false once END_OF_FILE is in the window
+};
 
 #endif // LEXER_H
\ No newline at end of file
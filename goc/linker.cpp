@@ -0,0 +1,210 @@
+#include "linker.h"
+#include "vm.h"
+#include "encoding.h"
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+// Static memory cells the VM provides at startup; unchecked accesses must stay below this
+static const uint32_t kStaticMemoryCells = 1024;
+
+static int32_t readOperand(const std::vector<uint8_t>& code, uint32_t pos) {
+    int32_t value;
+    std::memcpy(&value, code.data() + pos, 4);
+    return value;
+}
+
+static void writeOperand(std::vector<uint8_t>& code, uint32_t pos, int32_t value) {
+    std::memcpy(code.data() + pos, &value, 4);
+}
+
+bool Linker::addObject(const std::string& filename, std::string& error) {
+    Object object;
+    object.filename = filename;
+    if (!readBinary(filename, object.image, error)) {
+        error = filename + ": " + error;
+        return false;
+    }
+    if (!object.image.object || object.image.compact_code) {
+        error = filename + ": not an object file (compile it with goc -c)";
+        return false;
+    }
+    objects.push_back(std::move(object));
+    return true;
+}
+
+bool Linker::link(BinaryImage& program, std::string& error) {
+    counters = LinkStats();
+    counters.objects = objects.size();
+
+    // Entry stub, then each object's code and static cells after the previous one's
+    std::vector<uint8_t> wide = {static_cast<uint8_t>(VMOpcode::CALL), 0, 0, 0, 0,
+                                 static_cast<uint8_t>(VMOpcode::HALT)};
+    const uint32_t entry_operand = 1;
+    uint32_t data_cells = 0;
+    std::unordered_map<std::string, uint32_t> symbol_address;
+    std::unordered_map<std::string, const Object*> symbol_owner;
+    std::unordered_map<std::string, std::vector<int32_t>> param_cells;  // Float parameter cells, linked
+    std::unordered_set<uint32_t> checked;  // Unchecked accesses that need their bounds check back
+    for (Object& object : objects) {
+        object.code_base = static_cast<uint32_t>(wide.size());
+        object.data_base = data_cells;
+        wide.insert(wide.end(), object.image.code.begin(), object.image.code.end());
+        data_cells += object.image.data_cells;
+        for (const FunctionSymbol& symbol : object.image.symbols) {
+            auto owner = symbol_owner.find(symbol.name);
+            if (owner != symbol_owner.end()) {
+                error = "duplicate symbol '" + symbol.name + "' in " + owner->second->filename +
+                        " and " + object.filename;
+                return false;
+            }
+            symbol_owner[symbol.name] = &object;
+            symbol_address[symbol.name] = object.code_base + symbol.address;
+        }
+        for (const FloatParamCells& function : object.image.float_params) {
+            std::vector<int32_t>& cells = param_cells[function.symbol];
+            for (int32_t cell : function.cells) {
+                cells.push_back(cell >= 0 ? cell + static_cast<int32_t>(object.data_base) : -1);
+            }
+        }
+    }
+    counters.symbols = symbol_address.size();
+    counters.data_cells = data_cells;
+    counters.bytes_before = wide.size();
+
+    auto main_symbol = symbol_address.find("main");
+    if (main_symbol == symbol_address.end()) {
+        error = "undefined reference to 'main'";
+        return false;
+    }
+    writeOperand(wide, entry_operand, static_cast<int32_t>(main_symbol->second));
+
+    program = BinaryImage();
+    std::unordered_map<std::string, int32_t> string_ids;
+    LineTable lines;
+    std::unordered_map<std::string, uint32_t> file_ids;
+    for (const Object& object : objects) {
+        const BinaryImage& image = object.image;
+        std::vector<int32_t> string_map;
+        for (const std::string& str : image.strings) {
+            auto it = string_ids.emplace(str, static_cast<int32_t>(program.strings.size())).first;
+            if (it->second == static_cast<int32_t>(program.strings.size())) program.strings.push_back(str);
+            string_map.push_back(it->second);
+        }
+        counters.strings_before += image.strings.size();
+
+        for (const Relocation& reloc : image.relocations) {
+            if (reloc.offset < 1 || reloc.offset + 4 > image.code.size()) {
+                error = object.filename + ": relocation outside the code at offset " + std::to_string(reloc.offset);
+                return false;
+            }
+            uint32_t pos = object.code_base + reloc.offset;
+            int32_t value = readOperand(wide, pos);
+            switch (reloc.kind) {
+                case RelocationKind::CODE:
+                    value += static_cast<int32_t>(object.code_base);
+                    break;
+                case RelocationKind::SYMBOL: {
+                    auto it = symbol_address.find(reloc.symbol);
+                    if (it == symbol_address.end()) {
+                        error = object.filename + ": undefined reference to '" + reloc.symbol + "'";
+                        return false;
+                    }
+                    value = static_cast<int32_t>(it->second);
+                    break;
+                }
+                case RelocationKind::PARAM: {
+                    if (!symbol_address.count(reloc.symbol)) {
+                        error = object.filename + ": undefined reference to '" + reloc.symbol + "'";
+                        return false;
+                    }
+                    auto it = param_cells.find(reloc.symbol);
+                    if (it == param_cells.end() || value < 0 || static_cast<size_t>(value) >= it->second.size() ||
+                        it->second[value] < 0) {
+                        error = object.filename + ": '" + reloc.symbol + "' has no float parameter " +
+                                std::to_string(value) + " (is it defined with the same parameter types?)";
+                        return false;
+                    }
+                    value = it->second[value];
+                    break;
+                }
+                case RelocationKind::STRING:
+                    if (value < 0 || static_cast<size_t>(value) >= string_map.size()) {
+                        error = object.filename + ": invalid string index at offset " + std::to_string(reloc.offset);
+                        return false;
+                    }
+                    value = string_map[value];
+                    break;
+                case RelocationKind::DATA: {
+                    // Unchecked accesses were proven in range of the object's own cells only;
+                    // compactCode turns the ones that moved past static memory into checked ones
+                    VMOpcode op = static_cast<VMOpcode>(wide[pos - 1]);
+                    if ((op == VMOpcode::LOAD_IDX_NOCHECK || op == VMOpcode::STORE_IDX_NOCHECK) &&
+                        object.data_base + image.data_cells > kStaticMemoryCells) {
+                        checked.insert(pos - 1);
+                    }
+                    value += static_cast<int32_t>(object.data_base);
+                    break;
+                }
+            }
+            writeOperand(wide, pos, value);
+            counters.relocations++;
+        }
+
+        for (ProfileSite site : image.profile_sites) {
+            site.offset += object.code_base;
+            program.profile_sites.push_back(site);
+        }
+        for (ExceptionRegion region : image.exception_regions) {
+            region.start += object.code_base;
+            region.end += object.code_base;
+            region.handler += object.code_base;
+            program.exception_regions.push_back(region);
+        }
+        for (FunctionSymbol symbol : image.symbols) {
+            symbol.address += object.code_base;
+            program.symbols.push_back(symbol);
+        }
+
+        LineTable table;
+        if (!image.debug_lines.empty() && !parseLineTable(image.debug_lines, table)) {
+            error = object.filename + ": invalid line table";
+            return false;
+        }
+        std::vector<uint32_t> file_map;
+        for (const std::string& file : table.files) {
+            auto it = file_ids.emplace(file, static_cast<uint32_t>(lines.files.size())).first;
+            if (it->second == lines.files.size()) lines.files.push_back(file);
+            file_map.push_back(it->second);
+        }
+        for (LineEntry entry : table.entries) {
+            if (entry.file >= file_map.size()) {
+                error = object.filename + ": invalid line table";
+                return false;
+            }
+            entry.offset += object.code_base;
+            entry.file = file_map[entry.file];
+            lines.entries.push_back(entry);
+        }
+    }
+    counters.strings_after = program.strings.size();
+
+    // Relax the linked program like the compiler does a single file
+    std::unordered_map<uint32_t, uint32_t> new_offset;
+    ConstantPool pool;
+    if (!compactCode(wide, program.code, new_offset, pool, error, checked)) return false;
+    counters.checked_accesses = checked.size();
+    program.compact_code = true;
+    program.constants = pool.values();
+    for (auto& site : program.profile_sites) site.offset = new_offset.at(site.offset);
+    for (auto& symbol : program.symbols) symbol.address = new_offset.at(symbol.address);
+    for (auto& region : program.exception_regions) {
+        region.start = new_offset.at(region.start);
+        region.end = new_offset.at(region.end);
+        region.handler = new_offset.at(region.handler);
+    }
+    for (auto& entry : lines.entries) entry.offset = new_offset.at(entry.offset);
+    if (!lines.entries.empty()) program.debug_lines = encodeLineTable(lines);
+    counters.bytes_after = program.code.size();
+    return true;
+}
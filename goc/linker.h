@@ -0,0 +1,49 @@
+#ifndef LINKER_H
+#define LINKER_H
+
+#include "binfile.h"
+#include <string>
+#include <vector>
+
+// Static linker for objects from `goc -c` (object.h). Places each object's
+// code and static memory after the previous object's, resolves cross-object
+// calls by symbol name, merges the string tables and line tables, and writes
+// a runnable .bin: a `CALL main; HALT` stub followed by the objects, relaxed
+// into the compact encoding like the compiler's own output.
+
+struct LinkStats {
+    size_t objects = 0;
+    size_t symbols = 0;           // Functions defined by all objects
+    size_t relocations = 0;
+    size_t strings_before = 0;    // Sum of the objects' string tables
+    size_t strings_after = 0;     // Identical strings are shared
+    size_t data_cells = 0;        // Static memory cells of the whole program
+    size_t checked_accesses = 0;  // Unchecked array accesses moved past static memory
+    size_t bytes_before = 0;      // Wide code of all objects
+    size_t bytes_after = 0;
+};
+
+class Linker {
+public:
+    // Read an object; false with `error` if it cannot be read or is not an object
+    bool addObject(const std::string& filename, std::string& error);
+
+    // Link the objects added so far; false with `error` for duplicate or
+    // undefined symbols and objects that do not fit together
+    bool link(BinaryImage& program, std::string& error);
+
+    const LinkStats& stats() const { return counters; }
+
+private:
+    struct Object {
+        std::string filename;
+        BinaryImage image;
+        uint32_t code_base = 0;
+        uint32_t data_base = 0;
+    };
+
+    std::vector<Object> objects;
+    LinkStats counters;
+};
+
+#endif // LINKER_H
@@ -1,7 +1,12 @@
 #include "lexer.h"
 #include "parser.h"
 #include "codegen.h"
+#include "compilecache.h"
+#include "mappedfile.h"
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
 
 void printHelp() {
@@ -10,12 +15,21 @@ void printHelp() {
               << "  -h, --help            Show this help message\n"
               << "  -s, --stats           Show only statistics\n"
               << "  -o, --output <file>   Save bytecode to file\n"
+              << "  -c                    Compile to an object file for goclink (default <input>.o)\n"
               << "  -v, --verbose         Enable verbose output\n"
               << "  -q, --quiet           Suppress all verbose output\n"
               << "  --stage <name>        Stop at specific stage: lex | parse | codegen\n"
               << "  --dump-ast            Dump Abstract Syntax Tree\n"
               << "  --dump-tokens         Dump token list\n"
               << "  --dump-bytecode       Dump generated bytecode\n"
+              << "  -O0                   Disable optimization passes\n"
+              << "  --profile-use=<file>  Optimize using a profile from vm --profile-out\n"
+              << "  --lazy-parse          Parse and compile only the functions reachable from main\n"
+              << "                        (syntax errors in the others go unreported)\n"
+              << "  --stream              Lex while parsing with bounded token memory (implied by\n"
+              << "                        input file -, which reads stdin; no cache, no --dump-tokens)\n"
+              << "  --cache-dir=<dir>     Reuse outputs and function bodies from earlier builds\n"
+              << "                        (default $GOC_CACHE_DIR; no caching when unset)\n"
               << std::endl;
 }
 
@@ -26,6 +40,12 @@ struct CompilerFlags {
     bool dump_ast = false;
     bool dump_tokens = false;
     bool dump_bytecode = false;
+    bool optimize = true;
+    bool lazy_parse = false;
+    bool object = false;
+    bool stream = false;
+    std::string profile_file;
+    std::string cache_dir;
     std::string input_file;
     std::string output_file;
     std::string stage = "codegen";
@@ -71,6 +91,21 @@ bool parse_command_line(int argc, char** argv, CompilerFlags& flags) {
             flags.dump_tokens = true;
         } else if (arg == "--dump-bytecode") {
             flags.dump_bytecode = true;
+        } else if (arg == "-O0") {
+            flags.optimize = false;
+        } else if (arg == "--lazy-parse") {
+            flags.lazy_parse = true;
+        } else if (arg == "--stream") {
+            flags.stream = true;
+        } else if (arg == "-") {
+            flags.input_file = arg;
+            flags.stream = true;
+        } else if (arg == "-c") {
+            flags.object = true;
+        } else if (arg.rfind("--profile-use=", 0) == 0) {
+            flags.profile_file = arg.substr(14);
+        } else if (arg.rfind("--cache-dir=", 0) == 0) {
+            flags.cache_dir = arg.substr(12);
         } else if (arg[0] == '-') {
             std::cerr << "Undefined option: " << arg << "\n";
             printHelp();
@@ -80,19 +115,20 @@ bool parse_command_line(int argc, char** argv, CompilerFlags& flags) {
         }
     }
     
+    if (flags.cache_dir.empty()) {
+        if (const char* dir = std::getenv("GOC_CACHE_DIR")) flags.cache_dir = dir;
+    }
     return true;
 }
 
-Lexer performLexicalAnalysis(const std::string& input_file, const CompilerFlags& flags) {
+const std::vector<Token>& performLexicalAnalysis(Lexer& lexer, const CompilerFlags& flags) {
     if (flags.verbose) {
         std::cout << "=== C++ Compiler Frontend ===\n";
-        std::cout << "Input file: " << input_file << "\n";
+        std::cout << "Input file: " << flags.input_file << "\n";
         std::cout << "\n[1. Lexical Analysis]\n";
     }
 
-    std::string source_code = readFile(input_file);
-    Lexer lexer(source_code, input_file);
-    auto tokens = lexer.tokenize();
+    const auto& tokens = lexer.tokenize();
 
     if (lexer.hasErrors()) {
         std::cerr << "\nLexical errors detected. Stopping.\n";
@@ -109,16 +145,18 @@ Lexer performLexicalAnalysis(const std::string& input_file, const CompilerFlags&
         lexer.printStatistics();
     }
 
-    return lexer;
+    return tokens;
 }
 
-Program performParsing(const std::vector<Token>& tokens) {
+Program performParsing(Parser& parser) {
     std::cout << "Syntax analysis: building AST...\n";
-    Parser parser(tokens);
     Program ast = parser.parseProgram();
 
     std::cout << "✓ Parsing completed successfully!\n";
     std::cout << "Top-level declarations: " << ast.top.size() << "\n";
+    if (parser.skippedFunctions() > 0) {
+        std::cout << "Unreachable functions skipped: " << parser.skippedFunctions() << "\n";
+    }
 
     return ast;
 }
@@ -135,6 +173,174 @@ void saveBytecodeToFile(CodeGenerator& codegen, const std::string& output_file,
     }
 }
 
+// The -o file, or the input with its extension replaced (a.bin for stdin)
+std::string outputPath(const CompilerFlags& flags) {
+    if (!flags.output_file.empty()) {
+        return flags.output_file;
+    }
+    std::string default_output = flags.input_file == "-" ? "a" : flags.input_file;
+    size_t dot_pos = default_output.find_last_of('.');
+    if (dot_pos != std::string::npos) {
+        default_output = default_output.substr(0, dot_pos);
+    }
+    return default_output + (flags.object ? ".o" : ".bin");
+}
+
+// Save bytecode to the -o file, or next to the input when stopping after codegen
+void saveOutput(CodeGenerator& codegen, const CompilerFlags& flags) {
+    if (!flags.output_file.empty() || flags.stage == "codegen") {
+        saveBytecodeToFile(codegen, outputPath(flags), flags.verbose);
+    }
+}
+
+bool readBytes(const std::string& path, std::vector<uint8_t>& data) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// Key of the whole output: everything that can change the bytes goc writes
+uint64_t outputKey(const CompilerFlags& flags, std::string_view source) {
+    ContentHash hash;
+    hash.add(std::string("goc")).add(std::to_string(flags.version)).add(uint64_t(kCacheFormatVersion));
+    hash.add(uint64_t(flags.optimize)).add(uint64_t(flags.object));
+    hash.add(uint64_t(flags.lazy_parse));
+    hash.add(flags.input_file).add(source);
+    std::vector<uint8_t> profile;
+    if (!flags.profile_file.empty() && readBytes(flags.profile_file, profile)) {
+        hash.add(profile.data(), profile.size());
+    }
+    return hash.value();
+}
+
+// Copy a cached output into place; false on a miss
+bool restoreOutput(CompileCache& cache, uint64_t key, const CompilerFlags& flags) {
+    std::vector<uint8_t> data;
+    if (!cache.load(key, "bin", data)) return false;
+    std::string path = outputPath(flags);
+    if (!replaceFile(path, data.data(), data.size())) {
+        return false;
+    }
+    std::cout << "✓ Restored " << path << " from the compilation cache\n";
+    return true;
+}
+
+void storeOutput(CompileCache& cache, uint64_t key, const CompilerFlags& flags) {
+    std::vector<uint8_t> data;
+    if (readBytes(outputPath(flags), data)) cache.store(key, "bin", data);
+}
+
+// Steps after parsing, shared by the token-list and --stream pipelines.
+// `tokens` keys the function cache; streams have neither.
+int performCodeGeneration(Program& ast, const CompilerFlags& flags, size_t token_count,
+                          const std::vector<Token>* tokens, CompileCache* cache, uint64_t output_key) {
+    if (flags.dump_ast) {
+        std::cout << "\n[Abstract Syntax Tree]\n";
+        std::cout << "=======================\n";
+        ast.dump();
+        std::cout << "\n";
+    }
+
+    if (flags.stage == "parse") {
+        if (flags.verbose) {
+            std::cout << "\n✓ Stopping after parsing (--stage parse)\n";
+            std::cout << "✓ AST contains " << ast.top.size() << " top-level nodes\n";
+        }
+        return 0;
+    }
+
+    // --- STEP 3: CODE GENERATION ---
+    std::cout << "Code generation: generating bytecode...\n";
+    CodeGenerator codegen;
+    codegen.setOptimize(flags.optimize);
+    codegen.setSourceFile(flags.input_file == "-" ? "<stdin>" : flags.input_file);
+    codegen.setObjectMode(flags.object);
+    if (!flags.profile_file.empty()) {
+        ProfileData profile;
+        if (!loadProfile(flags.profile_file, profile)) {
+            std::cerr << "Error: could not read profile " << flags.profile_file << "\n";
+            return 1;
+        }
+        codegen.setProfile(profile);
+    }
+    if (cache && tokens) codegen.setCache(cache, tokens);
+    auto bytecode = codegen.generate(ast);
+
+    std::cout << "✓ Code generation completed!\n";
+    std::cout << "Generated " << bytecode.size() << " bytes of bytecode\n";
+
+    if (flags.dump_bytecode) {
+        codegen.dumpBytecode();
+    }
+
+    saveOutput(codegen, flags);
+    if (cache) {
+        storeOutput(*cache, output_key, flags);
+        if (codegen.cachedFunctions() > 0) {
+            std::cout << "Reused " << codegen.cachedFunctions() << " function(s) from the compilation cache\n";
+        }
+    }
+
+    if (flags.stage == "codegen") {
+        std::cout << "Stopping after code generation (--stage codegen)\n";
+        return 0;
+    }
+
+    // --- FINAL SUMMARY ---
+    std::cout << "\n=== Compilation Summary ===\n";
+    std::cout << "Lexical analysis: " << token_count << " tokens\n";
+    std::cout << "Syntax analysis: " << ast.top.size() << " top-level AST nodes\n";
+    std::cout << "Code generation: " << bytecode.size() << " bytes\n";
+    std::cout << "\nCompilation completed successfully!\n";
+
+    return 0;
+}
+
+// --stream: the parser pulls tokens from the file or stdin as it goes
+int compileStream(CompilerFlags& flags) {
+    if (flags.dump_tokens) {
+        std::cerr << "Error: --dump-tokens needs the whole token list; drop --stream\n";
+        return 1;
+    }
+    std::ifstream file;
+    if (flags.input_file != "-") {
+        file.open(flags.input_file, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Failed to open file: " + flags.input_file);
+        }
+    }
+    std::istream& input = flags.input_file == "-" ? std::cin : file;
+    TokenStream stream(input, flags.input_file == "-" ? "<stdin>" : flags.input_file);
+
+    auto checkLexErrors = [&stream]() {
+        if (stream.hasErrors()) {
+            std::cerr << "\nLexical errors detected. Stopping.\n";
+            exit(1);
+        }
+    };
+
+    if (flags.stage == "lex") {
+        size_t count = 0;
+        for (; stream.has(count); count++) {
+            stream.release(count);
+        }
+        checkLexErrors();
+        std::cout << "Tokens generated: " << count << "\n";
+        return 0;
+    }
+
+    Parser parser(stream);
+    Program ast = performParsing(parser);
+    checkLexErrors();
+    if (flags.verbose) {
+        std::cout << "Token window: at most " << stream.peakWindow() << " of " << stream.tokenCount() << " tokens\n";
+    }
+    int status = performCodeGeneration(ast, flags, stream.tokenCount(), nullptr, nullptr, 0);
+    ast.abandon();  // Exiting; no need to tear the tree down node by node
+    return status;
+}
+
 int main(int argc, char* argv[]) {
     CompilerFlags flags;
     
@@ -152,9 +358,33 @@ int main(int argc, char* argv[]) {
     }
 
     try {
+        if (flags.stream) {
+            return compileStream(flags);
+        }
+
+        // The source is read once; tokens point into the mapping
+        MappedFile source_file;
+        std::string error;
+        if (!source_file.open(flags.input_file, error)) {
+            throw std::runtime_error(error);
+        }
+        std::string_view source(reinterpret_cast<const char*>(source_file.data()), source_file.size());
+
+        // Dumps need the pipeline to run; otherwise an unchanged input is a copy
+        std::unique_ptr<CompileCache> cache;
+        uint64_t output_key = 0;
+        if (!flags.cache_dir.empty() && flags.stage == "codegen" && !flags.dump_tokens &&
+            !flags.dump_ast && !flags.dump_bytecode && !flags.show_stats_only) {
+            cache = std::make_unique<CompileCache>(flags.cache_dir);
+            output_key = outputKey(flags, source);
+            if (restoreOutput(*cache, output_key, flags)) {
+                return 0;
+            }
+        }
+
         // --- STEP 1: LEXICAL ANALYSIS ---
-        Lexer lexer = performLexicalAnalysis(flags.input_file, flags);
-        auto tokens = lexer.tokenize();
+        Lexer lexer(source, flags.input_file);
+        const auto& tokens = performLexicalAnalysis(lexer, flags);
 
         if (flags.stage == "lex") {
             if (flags.verbose) std::cout << "\nStopping after lexical analysis (--stage lex)\n";
@@ -170,62 +400,13 @@ int main(int argc, char* argv[]) {
         }
 
         // --- STEP 2: PARSING ---
-        Program ast = performParsing(tokens);
-
-        if (flags.dump_ast) {
-            std::cout << "\n[Abstract Syntax Tree]\n";
-            std::cout << "=======================\n";
-            ast.dump();
-            std::cout << "\n";
-        }
-
-        if (flags.stage == "parse") {
-            if (flags.verbose) {
-                std::cout << "\n✓ Stopping after parsing (--stage parse)\n";
-                std::cout << "✓ AST contains " << ast.top.size() << " top-level nodes\n";
-            }
-            return 0;
-        }
-
-        // --- STEP 3: CODE GENERATION ---
-        std::cout << "Code generation: generating bytecode...\n";
-        CodeGenerator codegen;
-        auto bytecode = codegen.generate(ast);
-
-        std::cout << "✓ Code generation completed!\n";
-        std::cout << "Generated " << bytecode.size() << " bytes of bytecode\n";
-
-        if (flags.dump_bytecode) {
-            codegen.dumpBytecode();
-        }
-
-        // Save bytecode to file
-        if (!flags.output_file.empty()) {
-            saveBytecodeToFile(codegen, flags.output_file, flags.verbose);
-        } else if (flags.stage == "codegen") {
-            std::string default_output = flags.input_file;
-            size_t dot_pos = default_output.find_last_of('.');
-            if (dot_pos != std::string::npos) {
-                default_output = default_output.substr(0, dot_pos);
-            }
-            default_output += ".bin";
-            
-            saveBytecodeToFile(codegen, default_output, flags.verbose);
-        }
-
-        if (flags.stage == "codegen") {
-            std::cout << "Stopping after code generation (--stage codegen)\n";
-            return 0;
-        }
-
-        // --- FINAL SUMMARY ---
-        std::cout << "\n=== Compilation Summary ===\n";
-        std::cout << "Lexical analysis: " << tokens.size() << " tokens\n";
-        std::cout << "Syntax analysis: " << ast.top.size() << " top-level AST nodes\n";
-        std::cout << "Code generation: " << bytecode.size() << " bytes\n";
-        std::cout << "\nCompilation completed successfully!\n";
-
-        return 0;
+        // Objects keep every function for the files they are linked with
+        Parser parser(tokens);
+        parser.setLazyBodies(flags.lazy_parse && !flags.object);
+        Program ast = performParsing(parser);
+        int status = performCodeGeneration(ast, flags, tokens.size(), &tokens, cache.get(), output_key);
+        ast.abandon();  // Exiting; no need to tear the tree down node by node
+        return status;
 
     } catch (const std::exception& e) {
         std::cerr << "\n❌ ERROR: " << e.what() << "\n";
@@ -0,0 +1,91 @@
+#include "mappedfile.h"
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+    #include <iterator>
+    #include <process.h>
+    #define getpid _getpid
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& filename, std::string& error) {
+    close();
+#ifndef _WIN32
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "Failed to open file: " + filename;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        error = "Failed to open file: " + filename;
+        return false;
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length > 0) {
+        void* addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            length = 0;
+            error = "Failed to map file: " + filename;
+            return false;
+        }
+        bytes = static_cast<const uint8_t*>(addr);
+        mapped = true;
+    }
+    ::close(fd);  // The mapping keeps the file referenced
+    return true;
+#else
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        error = "Failed to open file: " + filename;
+        return false;
+    }
+    buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    bytes = buffer.data();
+    length = buffer.size();
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+    if (mapped) munmap(const_cast<uint8_t*>(bytes), length);
+#endif
+    mapped = false;
+    bytes = nullptr;
+    length = 0;
+    buffer.clear();
+}
+
+bool replaceFile(const std::string& filename, const uint8_t* data, size_t size) {
+    std::string temp = filename + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream out(temp, std::ios::binary);
+        if (!out) return false;
+        out.write(reinterpret_cast<const char*>(data), size);
+        if (!out) {
+            out.close();
+            std::error_code ec;
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp, filename, ec);
+    if (ec) {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
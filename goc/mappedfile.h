@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. On POSIX systems the file is mapped shared
+// and read-only, so processes running the same .bin share its physical
+// pages; elsewhere it is read into memory.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // False with `error` if the file cannot be opened or mapped
+    bool open(const std::string& filename, std::string& error);
+    void close();
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::vector<uint8_t> buffer;  // Contents when not mapped
+};
+
+// Write `size` bytes to `filename` through a temporary file in the same
+// directory that is then renamed over it. Readers that have the old file
+// mapped keep their pages; truncating and rewriting it in place would pull
+// them out from under a running VM. False if the file cannot be written.
+bool replaceFile(const std::string& filename, const uint8_t* data, size_t size);
+
+#endif // MAPPEDFILE_H
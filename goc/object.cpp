@@ -0,0 +1,91 @@
+#include "object.h"
+#include <cstring>
+
+std::vector<uint8_t> encodeRelocations(const std::vector<Relocation>& relocations) {
+    std::vector<uint8_t> payload;
+    auto put32 = [&payload](uint32_t value) {
+        uint8_t bytes[4];
+        std::memcpy(bytes, &value, 4);
+        payload.insert(payload.end(), bytes, bytes + 4);
+    };
+    put32(relocations.size());
+    for (const auto& reloc : relocations) {
+        put32(reloc.offset);
+        payload.push_back(static_cast<uint8_t>(reloc.kind));
+        put32(reloc.symbol.size());
+        payload.insert(payload.end(), reloc.symbol.begin(), reloc.symbol.end());
+    }
+    return payload;
+}
+
+bool parseRelocations(const std::vector<uint8_t>& payload, std::vector<Relocation>& relocations) {
+    size_t pos = 0;
+    auto get32 = [&](uint32_t& value) {
+        if (payload.size() - pos < 4) return false;
+        std::memcpy(&value, payload.data() + pos, 4);
+        pos += 4;
+        return true;
+    };
+    uint32_t count = 0;
+    if (!get32(count)) return false;
+    relocations.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        Relocation reloc;
+        uint32_t length = 0;
+        if (!get32(reloc.offset) || pos >= payload.size()) return false;
+        uint8_t kind = payload[pos++];
+        if (kind > static_cast<uint8_t>(RelocationKind::PARAM) || !get32(length) || length > payload.size() - pos) {
+            return false;
+        }
+        reloc.kind = static_cast<RelocationKind>(kind);
+        reloc.symbol.assign(reinterpret_cast<const char*>(payload.data() + pos), length);
+        pos += length;
+        relocations.push_back(std::move(reloc));
+    }
+    return pos == payload.size();
+}
+
+std::vector<uint8_t> encodeFloatParams(const std::vector<FloatParamCells>& functions) {
+    std::vector<uint8_t> payload;
+    auto put32 = [&payload](uint32_t value) {
+        uint8_t bytes[4];
+        std::memcpy(bytes, &value, 4);
+        payload.insert(payload.end(), bytes, bytes + 4);
+    };
+    put32(functions.size());
+    for (const auto& function : functions) {
+        put32(function.symbol.size());
+        payload.insert(payload.end(), function.symbol.begin(), function.symbol.end());
+        put32(function.cells.size());
+        for (int32_t cell : function.cells) put32(static_cast<uint32_t>(cell));
+    }
+    return payload;
+}
+
+bool parseFloatParams(const std::vector<uint8_t>& payload, std::vector<FloatParamCells>& functions) {
+    size_t pos = 0;
+    auto get32 = [&](uint32_t& value) {
+        if (payload.size() - pos < 4) return false;
+        std::memcpy(&value, payload.data() + pos, 4);
+        pos += 4;
+        return true;
+    };
+    uint32_t count = 0;
+    if (!get32(count)) return false;
+    functions.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        FloatParamCells function;
+        uint32_t length = 0, params = 0;
+        if (!get32(length) || length > payload.size() - pos) return false;
+        function.symbol.assign(reinterpret_cast<const char*>(payload.data() + pos), length);
+        pos += length;
+        if (!get32(params) || params > (payload.size() - pos) / 4) return false;
+        for (uint32_t j = 0; j < params; j++) {
+            uint32_t cell = 0;
+            get32(cell);
+            function.cells.push_back(static_cast<int32_t>(cell));
+        }
+        functions.push_back(std::move(function));
+    }
+    return pos == payload.size();
+}
@@ -0,0 +1,54 @@
+#ifndef OBJECT_H
+#define OBJECT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Relocatable object files for separate compilation (goc -c, then goclink).
+//
+// An object is a v2 .bin (binfile.h) with kBinaryFlagObject set. Its code uses
+// the wide encoding and has no entry stub; code offsets, strings and static
+// memory cells are local to the object. The SYMBOLS section lists the
+// functions it defines, the DATA section holds the number of static memory
+// cells it uses (u32), and the RELOCATIONS section names every operand the
+// linker rewrites when it places the object in a program:
+//   CODE    jump or CALL target in this object      += the object's code base
+//   SYMBOL  CALL to a function defined elsewhere    =  the symbol's address
+//   STRING  index into this object's string table   =  the merged index
+//   DATA    static memory cell                      += the object's first cell
+//   PARAM   float argument to a function defined    =  the cell that function
+//           elsewhere; the operand is the parameter    reads the parameter from
+//           index
+// A function reads its float parameters from static cells of its own object
+// rather than from the stack. The FLOAT_PARAMS section lists those cells for
+// the functions the object defines, so PARAM can be resolved.
+
+enum class RelocationKind : uint8_t {
+    CODE   = 0,
+    SYMBOL = 1,
+    STRING = 2,
+    DATA   = 3,
+    PARAM  = 4
+};
+
+struct Relocation {
+    uint32_t offset;      // Position of the 4-byte operand
+    RelocationKind kind;
+    std::string symbol;   // SYMBOL only (mangled function name)
+};
+
+// Table payload: u32 count, then per record u32 offset, u8 kind, u32 length + symbol
+std::vector<uint8_t> encodeRelocations(const std::vector<Relocation>& relocations);
+bool parseRelocations(const std::vector<uint8_t>& payload, std::vector<Relocation>& relocations);
+
+struct FloatParamCells {
+    std::string symbol;          // Mangled function name
+    std::vector<int32_t> cells;  // Per parameter: the object's cell, or -1 for an int parameter
+};
+
+// Table payload: u32 count, then per function u32 length + symbol, u32 parameter count, i32 per parameter
+std::vector<uint8_t> encodeFloatParams(const std::vector<FloatParamCells>& functions);
+bool parseFloatParams(const std::vector<uint8_t>& payload, std::vector<FloatParamCells>& functions);
+
+#endif // OBJECT_H
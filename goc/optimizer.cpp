@@ -0,0 +1,709 @@
+#include "optimizer.h"
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <iterator>
+#include <limits>
+
+ASTNodePtr cloneNode(const ASTNode* node) {
+    if (!node) return nullptr;
+    switch (node->kind) {
+        case ASTNodeKind::LITERAL: {
+            auto n = static_cast<const Literal*>(node);
+            return makeNode<Literal>(n->value, n->line, n->column, n->litType);
+        }
+        case ASTNodeKind::IDENTIFIER: {
+            auto n = static_cast<const Identifier*>(node);
+            return makeNode<Identifier>(n->name, n->line, n->column);
+        }
+        case ASTNodeKind::UNARY_OP: {
+            auto n = static_cast<const UnaryOp*>(node);
+            return makeNode<UnaryOp>(n->op, cloneNode(n->operand.get()), n->line, n->column);
+        }
+        case ASTNodeKind::BINARY_OP: {
+            auto n = static_cast<const BinaryOp*>(node);
+            return makeNode<BinaryOp>(n->op, cloneNode(n->left.get()), cloneNode(n->right.get()),
+                                      n->line, n->column);
+        }
+        case ASTNodeKind::CALL: {
+            auto n = static_cast<const CallExpr*>(node);
+            std::vector<ASTNodePtr> args;
+            for (const auto& a : n->args) args.push_back(cloneNode(a.get()));
+            auto copy = makeNode<CallExpr>(cloneNode(n->callee.get()), std::move(args), n->line, n->column);
+            copy->templateArgs = n->templateArgs;
+            return copy;
+        }
+        case ASTNodeKind::MEMBER_ACCESS: {
+            auto n = static_cast<const MemberAccess*>(node);
+            return makeNode<MemberAccess>(cloneNode(n->object.get()), n->member, n->arrow,
+                                          n->line, n->column);
+        }
+        case ASTNodeKind::ARRAY_SUBSCRIPT: {
+            auto n = static_cast<const ArraySubscript*>(node);
+            return makeNode<ArraySubscript>(cloneNode(n->array.get()), cloneNode(n->index.get()),
+                                            n->line, n->column);
+        }
+        case ASTNodeKind::EXPR_STMT: {
+            auto n = static_cast<const ExprStmt*>(node);
+            return makeNode<ExprStmt>(cloneNode(n->expr.get()), n->line, n->column);
+        }
+        case ASTNodeKind::VAR_DECL: {
+            auto n = static_cast<const VarDecl*>(node);
+            auto copy = makeNode<VarDecl>(n->typeTokens, n->varName, cloneNode(n->init.get()),
+                                          n->line, n->column);
+            copy->isPointer = n->isPointer;
+            copy->isReference = n->isReference;
+            copy->isArray = n->isArray;
+            copy->arraySize = cloneNode(n->arraySize.get());
+            return copy;
+        }
+        case ASTNodeKind::BLOCK: {
+            auto n = static_cast<const BlockStmt*>(node);
+            auto copy = makeNode<BlockStmt>(n->line, n->column);
+            for (const auto& s : n->statements) copy->statements.push_back(cloneNode(s.get()));
+            return copy;
+        }
+        case ASTNodeKind::IF: {
+            auto n = static_cast<const IfStmt*>(node);
+            return makeNode<IfStmt>(cloneNode(n->cond.get()), cloneNode(n->thenBranch.get()),
+                                    cloneNode(n->elseBranch.get()), n->line, n->column);
+        }
+        case ASTNodeKind::WHILE: {
+            auto n = static_cast<const WhileStmt*>(node);
+            return makeNode<WhileStmt>(cloneNode(n->cond.get()), cloneNode(n->body.get()),
+                                       n->line, n->column);
+        }
+        case ASTNodeKind::FOR: {
+            auto n = static_cast<const ForStmt*>(node);
+            return makeNode<ForStmt>(cloneNode(n->init.get()), cloneNode(n->cond.get()),
+                                     cloneNode(n->post.get()), cloneNode(n->body.get()),
+                                     n->line, n->column);
+        }
+        case ASTNodeKind::RETURN: {
+            auto n = static_cast<const ReturnStmt*>(node);
+            return makeNode<ReturnStmt>(cloneNode(n->expr.get()), n->line, n->column);
+        }
+        case ASTNodeKind::TRY: {
+            auto n = static_cast<const TryStmt*>(node);
+            auto copy = makeNode<TryStmt>(cloneNode(n->body.get()), n->line, n->column);
+            for (const auto& h : n->handlers) {
+                copy->handlers.push_back({h.typeTokens, h.varName, cloneNode(h.body.get())});
+            }
+            return copy;
+        }
+        case ASTNodeKind::THROW: {
+            auto n = static_cast<const ThrowStmt*>(node);
+            return makeNode<ThrowStmt>(cloneNode(n->expr.get()), n->line, n->column);
+        }
+        case ASTNodeKind::CLASS_DECL: {
+            auto n = static_cast<const ClassDecl*>(node);
+            auto copy = makeNode<ClassDecl>(n->className, n->line, n->column);
+            copy->baseClasses = n->baseClasses;
+            for (const auto& m : n->members) copy->members.push_back(cloneNode(m.get()));
+            return copy;
+        }
+        case ASTNodeKind::STRUCT_DECL: {
+            auto n = static_cast<const StructDecl*>(node);
+            auto copy = makeNode<StructDecl>(n->structName, n->line, n->column);
+            for (const auto& m : n->members) copy->members.push_back(cloneNode(m.get()));
+            return copy;
+        }
+        case ASTNodeKind::NAMESPACE_DECL: {
+            auto n = static_cast<const NamespaceDecl*>(node);
+            return makeNode<NamespaceDecl>(n->name, cloneNode(n->body.get()), n->line, n->column);
+        }
+        case ASTNodeKind::TEMPLATE_DECL: {
+            auto n = static_cast<const TemplateDecl*>(node);
+            return makeNode<TemplateDecl>(n->params, cloneNode(n->declaration.get()),
+                                          n->line, n->column);
+        }
+        case ASTNodeKind::ACCESS_SPEC: {
+            auto n = static_cast<const AccessSpec*>(node);
+            return makeNode<AccessSpec>(n->access, n->line, n->column);
+        }
+        case ASTNodeKind::INCLUDE_DIRECTIVE: {
+            auto n = static_cast<const IncludeDirective*>(node);
+            return makeNode<IncludeDirective>(n->file, n->isSystem, n->line, n->column);
+        }
+        case ASTNodeKind::USING_DIRECTIVE: {
+            auto n = static_cast<const UsingDirective*>(node);
+            return makeNode<UsingDirective>(n->namespaceName, n->line, n->column);
+        }
+        case ASTNodeKind::FUNC_DECL: {
+            auto n = static_cast<const FunctionDecl*>(node);
+            auto copy = makeNode<FunctionDecl>(n->returnTypeTokens, n->funcName, n->params,
+                                               cloneNode(n->body.get()), n->line, n->column);
+            copy->isVirtual = n->isVirtual;
+            copy->isConst = n->isConst;
+            return copy;
+        }
+        default:
+            return nullptr;
+    }
+}
+
+// Only plain decimal literals are folded; hex, suffixed and float literals are left alone
+static bool parseDecimalLiteral(const Literal* lit, int32_t& value) {
+    if (lit->litType != TokenType::NUMBER || lit->value.empty()) return false;
+    size_t start = (lit->value[0] == '-') ? 1 : 0;
+    if (start == lit->value.size() || lit->value.size() - start > 10) return false;
+    for (size_t i = start; i < lit->value.size(); i++) {
+        if (!std::isdigit(static_cast<unsigned char>(lit->value[i]))) return false;
+    }
+    long long v = std::stoll(lit->value);
+    if (v < std::numeric_limits<int32_t>::min() || v > std::numeric_limits<int32_t>::max()) return false;
+    value = static_cast<int32_t>(v);
+    return true;
+}
+
+bool evaluateConstant(const ASTNode* node, int32_t& value) {
+    if (!node) return false;
+    switch (node->kind) {
+        case ASTNodeKind::LITERAL:
+            return parseDecimalLiteral(static_cast<const Literal*>(node), value);
+        case ASTNodeKind::UNARY_OP: {
+            auto un = static_cast<const UnaryOp*>(node);
+            int32_t v;
+            if (!evaluateConstant(un->operand.get(), v)) return false;
+            switch (un->opKind) {
+                case OpKind::MINUS: value = static_cast<int32_t>(0u - static_cast<uint32_t>(v)); return true;
+                case OpKind::PLUS: value = v; return true;
+                default: return false;
+            }
+        }
+        case ASTNodeKind::BINARY_OP: {
+            auto bin = static_cast<const BinaryOp*>(node);
+            int32_t a, b;
+            if (!evaluateConstant(bin->left.get(), a) || !evaluateConstant(bin->right.get(), b)) return false;
+            // Wrap like the VM's 32-bit arithmetic
+            uint32_t ua = static_cast<uint32_t>(a), ub = static_cast<uint32_t>(b);
+            switch (bin->opKind) {
+                case OpKind::PLUS: value = static_cast<int32_t>(ua + ub); return true;
+                case OpKind::MINUS: value = static_cast<int32_t>(ua - ub); return true;
+                case OpKind::STAR: value = static_cast<int32_t>(ua * ub); return true;
+                case OpKind::SLASH:
+                case OpKind::PERCENT:
+                    // Leave runtime errors (and INT_MIN / -1) to the VM
+                    if (b == 0 || (a == std::numeric_limits<int32_t>::min() && b == -1)) return false;
+                    value = (bin->opKind == OpKind::SLASH) ? a / b : a % b;
+                    return true;
+                case OpKind::LESS: value = a < b; return true;
+                case OpKind::GREATER: value = a > b; return true;
+                case OpKind::LESS_EQUAL: value = a <= b; return true;
+                case OpKind::GREATER_EQUAL: value = a >= b; return true;
+                case OpKind::EQUAL: value = a == b; return true;
+                case OpKind::NOT_EQUAL: value = a != b; return true;
+                default: return false;
+            }
+        }
+        default:
+            return false;
+    }
+}
+
+bool foldConstants(ASTNodePtr& node) {
+    if (!node) return false;
+    bool changed = false;
+    visitChildren(node.get(), [&](ASTNodePtr& child) {
+        if (foldConstants(child)) changed = true;
+    });
+    if (node->kind == ASTNodeKind::BINARY_OP || node->kind == ASTNodeKind::UNARY_OP) {
+        int32_t value;
+        if (evaluateConstant(node.get(), value)) {
+            node = makeNode<Literal>(std::to_string(value), node->line, node->column);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool eliminateDeadBranches(ASTNodePtr& node) {
+    if (!node) return false;
+    bool changed = false;
+    visitChildren(node.get(), [&](ASTNodePtr& child) {
+        if (eliminateDeadBranches(child)) changed = true;
+    });
+
+    int32_t cond;
+    switch (node->kind) {
+        case ASTNodeKind::IF: {
+            auto ifs = static_cast<IfStmt*>(node.get());
+            if (evaluateConstant(ifs->cond.get(), cond)) {
+                ASTNodePtr taken = cond ? std::move(ifs->thenBranch) : std::move(ifs->elseBranch);
+                if (!taken) taken = makeNode<BlockStmt>(node->line, node->column);
+                node = std::move(taken);
+                changed = true;
+            }
+            break;
+        }
+        case ASTNodeKind::WHILE: {
+            auto ws = static_cast<WhileStmt*>(node.get());
+            if (evaluateConstant(ws->cond.get(), cond) && cond == 0) {
+                node = makeNode<BlockStmt>(node->line, node->column);
+                changed = true;
+            }
+            break;
+        }
+        case ASTNodeKind::FOR: {
+            auto fs = static_cast<ForStmt*>(node.get());
+            if (fs->cond && evaluateConstant(fs->cond.get(), cond) && cond == 0) {
+                ASTNodePtr init = std::move(fs->init);
+                if (!init) init = makeNode<BlockStmt>(node->line, node->column);
+                node = std::move(init);
+                changed = true;
+            }
+            break;
+        }
+        case ASTNodeKind::BLOCK: {
+            auto& stmts = static_cast<BlockStmt*>(node.get())->statements;
+            for (size_t i = 0; i < stmts.size(); i++) {
+                if (stmts[i] && stmts[i]->kind == ASTNodeKind::RETURN && i + 1 < stmts.size()) {
+                    stmts.resize(i + 1);
+                    changed = true;
+                    break;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return changed;
+}
+
+void substituteIdentifier(ASTNodePtr& node, const std::string& name, int32_t value) {
+    if (!node) return;
+    if (node->kind == ASTNodeKind::IDENTIFIER && static_cast<Identifier*>(node.get())->name == name) {
+        node = makeNode<Literal>(std::to_string(value), node->line, node->column);
+        return;
+    }
+    if (node->kind == ASTNodeKind::CALL) {
+        // Callee names are never parameters
+        for (auto& a : static_cast<CallExpr*>(node.get())->args) substituteIdentifier(a, name, value);
+        return;
+    }
+    visitChildren(node.get(), [&](ASTNodePtr& child) { substituteIdentifier(child, name, value); });
+}
+
+static bool isIdentifierChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+static void substituteTypeTokens(std::vector<std::string>& tokens, const TemplateBindings& bindings) {
+    std::vector<std::string> result;
+    for (const auto& token : tokens) {
+        auto bound = bindings.find(token);
+        if (bound != bindings.end()) {
+            result.insert(result.end(), bound->second.begin(), bound->second.end());
+            continue;
+        }
+        if (token.find('<') == std::string::npos) {
+            result.push_back(token);
+            continue;
+        }
+        // Parameters nested in template argument text, e.g. Box<T>
+        std::string text;
+        for (size_t i = 0; i < token.size(); ) {
+            if (!isIdentifierChar(token[i])) {
+                text += token[i++];
+                continue;
+            }
+            size_t end = i;
+            while (end < token.size() && isIdentifierChar(token[end])) end++;
+            std::string word = token.substr(i, end - i);
+            auto arg = bindings.find(word);
+            if (arg == bindings.end()) {
+                text += word;
+            } else {
+                for (size_t k = 0; k < arg->second.size(); k++) text += (k ? " " : "") + arg->second[k];
+            }
+            i = end;
+        }
+        result.push_back(text);
+    }
+    tokens = std::move(result);
+}
+
+void substituteTypeNames(ASTNode* node, const TemplateBindings& bindings) {
+    if (!node) return;
+    switch (node->kind) {
+        case ASTNodeKind::FUNC_DECL: {
+            auto func = static_cast<FunctionDecl*>(node);
+            substituteTypeTokens(func->returnTypeTokens, bindings);
+            for (auto& p : func->params) substituteTypeTokens(p.first, bindings);
+            break;
+        }
+        case ASTNodeKind::VAR_DECL:
+            substituteTypeTokens(static_cast<VarDecl*>(node)->typeTokens, bindings);
+            break;
+        case ASTNodeKind::CALL:
+            for (auto& arg : static_cast<CallExpr*>(node)->templateArgs) substituteTypeTokens(arg, bindings);
+            break;
+        default:
+            break;
+    }
+    visitChildren(node, [&](ASTNodePtr& child) { substituteTypeNames(child.get(), bindings); });
+}
+
+static bool containsIdentifier(const ASTNode* node, const std::string& name) {
+    if (!node) return false;
+    if (node->kind == ASTNodeKind::IDENTIFIER) {
+        return static_cast<const Identifier*>(node)->name == name;
+    }
+    bool found = false;
+    visitChildren(node, [&](const ASTNode* child) {
+        if (!found && containsIdentifier(child, name)) found = true;
+    });
+    return found;
+}
+
+static bool isIdentifierNamed(const ASTNode* node, const std::string& name) {
+    return node && node->kind == ASTNodeKind::IDENTIFIER &&
+           static_cast<const Identifier*>(node)->name == name;
+}
+
+bool isModified(const ASTNode* node, const std::string& name) {
+    if (!node) return false;
+    switch (node->kind) {
+        case ASTNodeKind::BINARY_OP: {
+            auto bin = static_cast<const BinaryOp*>(node);
+            if (bin->opKind == OpKind::ASSIGN && isIdentifierNamed(bin->left.get(), name)) return true;
+            if (bin->opKind == OpKind::SHR && isIdentifierNamed(bin->right.get(), name)) return true;
+            break;
+        }
+        case ASTNodeKind::UNARY_OP: {
+            auto un = static_cast<const UnaryOp*>(node);
+            if ((un->opKind == OpKind::AMP || un->opKind == OpKind::INCREMENT || un->opKind == OpKind::DECREMENT ||
+                 un->opKind == OpKind::POST_INCREMENT || un->opKind == OpKind::POST_DECREMENT) &&
+                isIdentifierNamed(un->operand.get(), name)) return true;
+            break;
+        }
+        case ASTNodeKind::VAR_DECL:
+            // Redeclaring the name rebinds it in the (flat) symbol table
+            if (static_cast<const VarDecl*>(node)->varName == name) return true;
+            break;
+        default:
+            break;
+    }
+    bool modified = false;
+    visitChildren(node, [&](const ASTNode* child) {
+        if (!modified && isModified(child, name)) modified = true;
+    });
+    return modified;
+}
+
+bool isUsedInCondition(const ASTNode* node, const std::string& name) {
+    if (!node) return false;
+    switch (node->kind) {
+        case ASTNodeKind::IF:
+            if (containsIdentifier(static_cast<const IfStmt*>(node)->cond.get(), name)) return true;
+            break;
+        case ASTNodeKind::WHILE:
+            if (containsIdentifier(static_cast<const WhileStmt*>(node)->cond.get(), name)) return true;
+            break;
+        case ASTNodeKind::FOR:
+            if (containsIdentifier(static_cast<const ForStmt*>(node)->cond.get(), name)) return true;
+            break;
+        default:
+            break;
+    }
+    bool used = false;
+    visitChildren(node, [&](const ASTNode* child) {
+        if (!used && isUsedInCondition(child, name)) used = true;
+    });
+    return used;
+}
+
+void collectCalls(const ASTNode* node, std::vector<const CallExpr*>& calls) {
+    if (!node) return;
+    visitChildren(node, [&](const ASTNode* child) { collectCalls(child, calls); });
+    if (node->kind == ASTNodeKind::CALL) {
+        auto call = static_cast<const CallExpr*>(node);
+        if (call->callee && call->callee->kind == ASTNodeKind::IDENTIFIER) calls.push_back(call);
+    }
+}
+
+bool inductionVariableRange(const ForStmt* loop, std::string& var, int32_t& lo, int32_t& hi) {
+    // for (int i = c0; ...)
+    if (!loop->init || loop->init->kind != ASTNodeKind::VAR_DECL) return false;
+    auto decl = static_cast<const VarDecl*>(loop->init.get());
+    if (decl->isArray || decl->isPointer || decl->isReference) return false;
+    int32_t start;
+    if (!evaluateConstant(decl->init.get(), start)) return false;
+    var = decl->varName;
+
+    // ...; i < c1 / i <= c1 / c1 > i / c1 >= i; ...
+    if (!loop->cond || loop->cond->kind != ASTNodeKind::BINARY_OP) return false;
+    auto cond = static_cast<const BinaryOp*>(loop->cond.get());
+    int32_t bound;
+    bool inclusive;
+    if (isIdentifierNamed(cond->left.get(), var) && evaluateConstant(cond->right.get(), bound) &&
+        (cond->opKind == OpKind::LESS || cond->opKind == OpKind::LESS_EQUAL)) {
+        inclusive = cond->opKind == OpKind::LESS_EQUAL;
+    } else if (isIdentifierNamed(cond->right.get(), var) && evaluateConstant(cond->left.get(), bound) &&
+               (cond->opKind == OpKind::GREATER || cond->opKind == OpKind::GREATER_EQUAL)) {
+        inclusive = cond->opKind == OpKind::GREATER_EQUAL;
+    } else {
+        return false;
+    }
+
+    // ...; i = i + step) or i = step + i, step > 0
+    if (!loop->post || loop->post->kind != ASTNodeKind::BINARY_OP) return false;
+    auto post = static_cast<const BinaryOp*>(loop->post.get());
+    if (post->opKind != OpKind::ASSIGN || !isIdentifierNamed(post->left.get(), var) ||
+        !post->right || post->right->kind != ASTNodeKind::BINARY_OP) return false;
+    auto inc = static_cast<const BinaryOp*>(post->right.get());
+    int32_t step;
+    if (inc->opKind != OpKind::PLUS) return false;
+    if (!(isIdentifierNamed(inc->left.get(), var) && evaluateConstant(inc->right.get(), step)) &&
+        !(isIdentifierNamed(inc->right.get(), var) && evaluateConstant(inc->left.get(), step))) return false;
+    if (step <= 0) return false;
+
+    int64_t last = inclusive ? static_cast<int64_t>(bound) : static_cast<int64_t>(bound) - 1;
+    // The increment past the last value must not wrap around
+    if (last < start || last + step > std::numeric_limits<int32_t>::max()) return false;
+    lo = start;
+    hi = static_cast<int32_t>(last);
+    return true;
+}
+
+bool evaluateRange(const ASTNode* node, const RangeMap& ranges, ValueRange& range) {
+    if (!node) return false;
+    int32_t value;
+    if (evaluateConstant(node, value)) {
+        range = {value, value};
+        return true;
+    }
+    switch (node->kind) {
+        case ASTNodeKind::IDENTIFIER: {
+            auto it = ranges.find(static_cast<const Identifier*>(node)->name);
+            if (it == ranges.end()) return false;
+            range = it->second;
+            return true;
+        }
+        case ASTNodeKind::UNARY_OP: {
+            auto un = static_cast<const UnaryOp*>(node);
+            ValueRange r;
+            if (!evaluateRange(un->operand.get(), ranges, r)) return false;
+            if (un->opKind == OpKind::PLUS) { range = r; return true; }
+            if (un->opKind != OpKind::MINUS || r.lo == std::numeric_limits<int32_t>::min()) return false;
+            range = {-r.hi, -r.lo};
+            return true;
+        }
+        case ASTNodeKind::BINARY_OP: {
+            auto bin = static_cast<const BinaryOp*>(node);
+            ValueRange a, b;
+            if (!evaluateRange(bin->left.get(), ranges, a) || !evaluateRange(bin->right.get(), ranges, b)) return false;
+            int64_t lo, hi;
+            if (bin->opKind == OpKind::PLUS) {
+                lo = static_cast<int64_t>(a.lo) + b.lo;
+                hi = static_cast<int64_t>(a.hi) + b.hi;
+            } else if (bin->opKind == OpKind::MINUS) {
+                lo = static_cast<int64_t>(a.lo) - b.hi;
+                hi = static_cast<int64_t>(a.hi) - b.lo;
+            } else if (bin->opKind == OpKind::STAR) {
+                int64_t p[] = {static_cast<int64_t>(a.lo) * b.lo, static_cast<int64_t>(a.lo) * b.hi,
+                               static_cast<int64_t>(a.hi) * b.lo, static_cast<int64_t>(a.hi) * b.hi};
+                lo = *std::min_element(std::begin(p), std::end(p));
+                hi = *std::max_element(std::begin(p), std::end(p));
+            } else {
+                return false;
+            }
+            if (lo < std::numeric_limits<int32_t>::min() || hi > std::numeric_limits<int32_t>::max()) return false;
+            range = {static_cast<int32_t>(lo), static_cast<int32_t>(hi)};
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// Names of arrays stored into (arr[i] = ...) anywhere in a subtree
+static void collectStoredArrays(const ASTNode* node, std::vector<std::string>& names) {
+    if (!node) return;
+    if (node->kind == ASTNodeKind::BINARY_OP) {
+        auto bin = static_cast<const BinaryOp*>(node);
+        if (bin->opKind == OpKind::ASSIGN && bin->left && bin->left->kind == ASTNodeKind::ARRAY_SUBSCRIPT) {
+            auto array = static_cast<const ArraySubscript*>(bin->left.get())->array.get();
+            if (array && array->kind == ASTNodeKind::IDENTIFIER) {
+                names.push_back(static_cast<const Identifier*>(array)->name);
+            }
+        }
+    }
+    visitChildren(node, [&](const ASTNode* child) { collectStoredArrays(child, names); });
+}
+
+static bool preservesRangesImpl(const ASTNode* node, const RangeMap& ranges,
+                                const std::vector<std::string>& stored_arrays,
+                                const std::function<bool(const ArraySubscript*, const RangeMap&)>& isSafeStore) {
+    if (!node) return true;
+    auto tracked = [&](const ASTNode* n) {
+        return n && n->kind == ASTNodeKind::IDENTIFIER &&
+               ranges.count(static_cast<const Identifier*>(n)->name) > 0;
+    };
+    switch (node->kind) {
+        case ASTNodeKind::CALL: {
+            // Callees may share the variables' static addresses (e.g. through recursion)
+            auto call = static_cast<const CallExpr*>(node);
+            if (!isIdentifierNamed(call->callee.get(), "print") &&
+                !isIdentifierNamed(call->callee.get(), "println")) return false;
+            for (const auto& a : call->args) {
+                if (!preservesRangesImpl(a.get(), ranges, stored_arrays, isSafeStore)) return false;
+            }
+            return true;
+        }
+        case ASTNodeKind::BINARY_OP: {
+            auto bin = static_cast<const BinaryOp*>(node);
+            if (bin->opKind == OpKind::SHR) return false;
+            if (bin->opKind == OpKind::ASSIGN) {
+                if (tracked(bin->left.get())) return false;
+                if (bin->left && bin->left->kind == ASTNodeKind::UNARY_OP) return false;
+                // A store outside an array's bounds could land on a tracked variable
+                if (bin->left && bin->left->kind == ASTNodeKind::ARRAY_SUBSCRIPT &&
+                    !isSafeStore(static_cast<const ArraySubscript*>(bin->left.get()), ranges)) return false;
+            }
+            break;
+        }
+        case ASTNodeKind::UNARY_OP: {
+            auto un = static_cast<const UnaryOp*>(node);
+            if ((un->opKind == OpKind::AMP || un->opKind == OpKind::INCREMENT || un->opKind == OpKind::DECREMENT ||
+                 un->opKind == OpKind::POST_INCREMENT || un->opKind == OpKind::POST_DECREMENT) && tracked(un->operand.get())) return false;
+            break;
+        }
+        case ASTNodeKind::VAR_DECL: {
+            // Redeclaring a stored array would change what its stores were checked against
+            auto decl = static_cast<const VarDecl*>(node);
+            if (ranges.count(decl->varName) || decl->isArray ||
+                std::find(stored_arrays.begin(), stored_arrays.end(), decl->varName) != stored_arrays.end()) return false;
+            break;
+        }
+        case ASTNodeKind::TRY: {
+            // Catch parameters are declarations too
+            for (const auto& h : static_cast<const TryStmt*>(node)->handlers) {
+                if (ranges.count(h.varName)) return false;
+            }
+            break;
+        }
+        case ASTNodeKind::FOR: {
+            auto loop = static_cast<const ForStmt*>(node);
+            if (!preservesRangesImpl(loop->init.get(), ranges, stored_arrays, isSafeStore) ||
+                !preservesRangesImpl(loop->cond.get(), ranges, stored_arrays, isSafeStore) ||
+                !preservesRangesImpl(loop->post.get(), ranges, stored_arrays, isSafeStore)) return false;
+            // A nested counted loop adds its own induction variable for its body
+            std::string var;
+            ValueRange r;
+            if (inductionVariableRange(loop, var, r.lo, r.hi)) {
+                RangeMap nested = ranges;
+                nested[var] = r;
+                if (preservesRangesImpl(loop->body.get(), nested, stored_arrays, isSafeStore)) return true;
+            }
+            return preservesRangesImpl(loop->body.get(), ranges, stored_arrays, isSafeStore);
+        }
+        default:
+            break;
+    }
+    bool preserved = true;
+    visitChildren(node, [&](const ASTNode* child) {
+        if (preserved && !preservesRangesImpl(child, ranges, stored_arrays, isSafeStore)) preserved = false;
+    });
+    return preserved;
+}
+
+bool preservesRanges(const ASTNode* node, const RangeMap& ranges,
+                     const std::function<bool(const ArraySubscript*, const RangeMap&)>& isSafeStore) {
+    std::vector<std::string> stored_arrays;
+    collectStoredArrays(node, stored_arrays);
+    return preservesRangesImpl(node, ranges, stored_arrays, isSafeStore);
+}
+
+static bool isIntegerType(const std::vector<std::string>& typeTokens) {
+    if (typeTokens.empty()) return false;
+    for (const auto& t : typeTokens) {
+        if (t != "int" && t != "long" && t != "short" && t != "unsigned" &&
+            t != "signed" && t != "char" && t != "bool" && t != "const") return false;
+    }
+    return true;
+}
+
+static bool isPureExpression(const ASTNode* node, const std::vector<std::string>& params,
+                             std::vector<const CallExpr*>& calls) {
+    if (!node) return false;
+    switch (node->kind) {
+        case ASTNodeKind::LITERAL: {
+            int32_t value;
+            return evaluateConstant(node, value);
+        }
+        case ASTNodeKind::IDENTIFIER:
+            return std::find(params.begin(), params.end(),
+                             static_cast<const Identifier*>(node)->name) != params.end();
+        case ASTNodeKind::UNARY_OP: {
+            auto un = static_cast<const UnaryOp*>(node);
+            return (un->opKind == OpKind::MINUS || un->opKind == OpKind::PLUS) && isPureExpression(un->operand.get(), params, calls);
+        }
+        case ASTNodeKind::BINARY_OP: {
+            auto bin = static_cast<const BinaryOp*>(node);
+            switch (bin->opKind) {
+                case OpKind::PLUS: case OpKind::MINUS: case OpKind::STAR: case OpKind::SLASH: case OpKind::PERCENT:
+                case OpKind::LESS: case OpKind::GREATER: case OpKind::LESS_EQUAL: case OpKind::GREATER_EQUAL:
+                case OpKind::EQUAL: case OpKind::NOT_EQUAL:
+                    break;
+                default:
+                    return false;
+            }
+            return isPureExpression(bin->left.get(), params, calls) &&
+                   isPureExpression(bin->right.get(), params, calls);
+        }
+        case ASTNodeKind::CALL: {
+            auto call = static_cast<const CallExpr*>(node);
+            if (!call->callee || call->callee->kind != ASTNodeKind::IDENTIFIER) return false;
+            for (const auto& a : call->args) {
+                if (!isPureExpression(a.get(), params, calls)) return false;
+            }
+            calls.push_back(call);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static bool isPureStatement(const ASTNode* node, const std::vector<std::string>& params,
+                            std::vector<const CallExpr*>& calls) {
+    if (!node) return true;
+    switch (node->kind) {
+        case ASTNodeKind::BLOCK:
+            for (const auto& s : static_cast<const BlockStmt*>(node)->statements) {
+                if (!isPureStatement(s.get(), params, calls)) return false;
+            }
+            return true;
+        case ASTNodeKind::IF: {
+            auto ifs = static_cast<const IfStmt*>(node);
+            return isPureExpression(ifs->cond.get(), params, calls) &&
+                   isPureStatement(ifs->thenBranch.get(), params, calls) &&
+                   isPureStatement(ifs->elseBranch.get(), params, calls);
+        }
+        case ASTNodeKind::RETURN: {
+            auto ret = static_cast<const ReturnStmt*>(node);
+            return ret->expr && isPureExpression(ret->expr.get(), params, calls);
+        }
+        default:
+            return false;
+    }
+}
+
+bool isPureIntegerFunction(const FunctionDecl* func, std::vector<const CallExpr*>& calls) {
+    if (!func->body || !isIntegerType(func->returnTypeTokens)) return false;
+    std::vector<std::string> params;
+    for (const auto& p : func->params) {
+        if (p.second.empty() || !isIntegerType(p.first)) return false;
+        params.push_back(p.second);
+    }
+    return isPureStatement(func->body.get(), params, calls);
+}
+
+size_t countNodes(const ASTNode* node) {
+    if (!node) return 0;
+    size_t count = 1;
+    visitChildren(node, [&](const ASTNode* child) { count += countNodes(child); });
+    return count;
+}
@@ -0,0 +1,82 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "parser.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+// AST-level optimization helpers used by the code generator.
+// All passes work in place on owned subtrees (ASTNodePtr slots) so that a
+// node can be replaced by a simpler one (e.g. an `if` by one of its branches).
+
+// Deep copy of any AST subtree
+ASTNodePtr cloneNode(const ASTNode* node);
+
+// Evaluate an integer constant expression (decimal literals and integer
+// operators only). Returns false if the expression is not a compile-time constant.
+bool evaluateConstant(const ASTNode* node, int32_t& value);
+
+// Fold integer constant subexpressions into literals. Returns true if anything changed.
+bool foldConstants(ASTNodePtr& node);
+
+// Remove branches and loops whose conditions are constant, and statements
+// following a `return` in the same block. Returns true if anything changed.
+bool eliminateDeadBranches(ASTNodePtr& node);
+
+// Replace every read of identifier `name` with an integer literal
+void substituteIdentifier(ASTNodePtr& node, const std::string& name, int32_t value);
+
+// Type arguments of a template instantiation, by template parameter name
+using TemplateBindings = std::unordered_map<std::string, std::vector<std::string>>;
+
+// Replace template parameter names in every type written in a (cloned) subtree:
+// return, parameter and variable types and explicit template arguments of calls
+void substituteTypeNames(ASTNode* node, const TemplateBindings& bindings);
+
+// True if `name` is assigned, read into (cin >>), incremented or has its address taken
+bool isModified(const ASTNode* node, const std::string& name);
+
+// True if `name` is referenced from a branch or loop condition
+bool isUsedInCondition(const ASTNode* node, const std::string& name);
+
+// All calls with a plain identifier callee, in evaluation order
+void collectCalls(const ASTNode* node, std::vector<const CallExpr*>& calls);
+
+// Recognize `for (int i = c0; i < c1; i = i + step)` (also `<=` and the mirrored
+// comparisons) with constant bounds and a positive step. On success `var` is the
+// induction variable and [lo, hi] the values it takes inside the body, assuming
+// the body does not modify it.
+bool inductionVariableRange(const ForStmt* loop, std::string& var, int32_t& lo, int32_t& hi);
+
+// Closed interval of values an integer expression can take
+struct ValueRange {
+    int32_t lo;
+    int32_t hi;
+};
+using RangeMap = std::unordered_map<std::string, ValueRange>;
+
+// Range of an integer expression over constants and the variables in `ranges`
+// (+, -, * and unary -). Returns false if unknown or if it could overflow.
+bool evaluateRange(const ASTNode* node, const RangeMap& ranges, ValueRange& range);
+
+// True if executing `node` cannot change any variable in `ranges`: no assignment,
+// input, address-of or redeclaration of them (or of arrays stored into, or any new
+// array), no pointer stores, no calls other
+// than print/println, and every array store is accepted by `isSafeStore` (called
+// with the ranges in effect at the store, including those of nested loops).
+bool preservesRanges(const ASTNode* node, const RangeMap& ranges,
+                     const std::function<bool(const ArraySubscript*, const RangeMap&)>& isSafeStore);
+
+// True if `func` computes its result from its integer parameters alone: the body
+// is blocks, ifs and returns over integer arithmetic and calls, with no variables,
+// memory access or I/O. Calls are appended to `calls`; the caller decides whether
+// the callees are pure as well.
+bool isPureIntegerFunction(const FunctionDecl* func, std::vector<const CallExpr*>& calls);
+
+// Number of nodes in a subtree (used for code-size budgets)
+size_t countNodes(const ASTNode* node);
+
+#endif // OPTIMIZER_H
@@ -1,5 +1,7 @@
 #include "parser.h"
+#include <algorithm>
 #include <sstream>
+#include <unordered_set>
 
 // ---------- helpers ----------
 std::string indentStr(int n) {
@@ -21,6 +23,23 @@ void Identifier::dump(int indent) const {
     std::cout << indentStr(indent) << "Identifier(" << name << ") [" << line << ":" << column << "]\n";
 }
 
+OpKind opKindFromText(std::string_view op) {
+    static const std::pair<std::string_view, OpKind> kinds[] = {
+        {"=", OpKind::ASSIGN}, {"?:", OpKind::CONDITIONAL},
+        {"+", OpKind::PLUS}, {"-", OpKind::MINUS}, {"*", OpKind::STAR}, {"/", OpKind::SLASH}, {"%", OpKind::PERCENT},
+        {"<", OpKind::LESS}, {">", OpKind::GREATER}, {"<=", OpKind::LESS_EQUAL}, {">=", OpKind::GREATER_EQUAL},
+        {"==", OpKind::EQUAL}, {"!=", OpKind::NOT_EQUAL}, {"&&", OpKind::AND_AND}, {"||", OpKind::OR_OR},
+        {"<<", OpKind::SHL}, {">>", OpKind::SHR}, {"!", OpKind::NOT}, {"~", OpKind::TILDE}, {"&", OpKind::AMP},
+        {"++", OpKind::INCREMENT}, {"--", OpKind::DECREMENT},
+        {"++_post", OpKind::POST_INCREMENT}, {"--_post", OpKind::POST_DECREMENT},
+        {"new", OpKind::NEW}, {"delete", OpKind::DELETE}
+    };
+    for (const auto& kind : kinds) {
+        if (kind.first == op) return kind.second;
+    }
+    return OpKind::UNKNOWN;
+}
+
 void UnaryOp::dump(int indent) const {
     std::cout << indentStr(indent) << "UnaryOp(" << op << ") [" << line << ":" << column << "]\n";
     if (operand) operand->dump(indent+1);
@@ -35,6 +54,14 @@ void BinaryOp::dump(int indent) const {
 void CallExpr::dump(int indent) const {
     std::cout << indentStr(indent) << "CallExpr [" << line << ":" << column << "]\n";
     if (callee) callee->dump(indent+1);
+    if (!templateArgs.empty()) {
+        std::cout << indentStr(indent+1) << "TemplateArgs: ";
+        for (const auto &arg : templateArgs) {
+            for (const auto &t : arg) std::cout << t << " ";
+            std::cout << "; ";
+        }
+        std::cout << "\n";
+    }
     for (const auto &a : args) a->dump(indent+1);
 }
 
@@ -67,6 +94,10 @@ void VarDecl::dump(int indent) const {
         if (i < typeTokens.size() - 1) std::cout << " ";
     }
     std::cout << " " << varName << ") [" << line << ":" << column << "]\n";
+    if (arraySize) {
+        std::cout << indentStr(indent+1) << "ArraySize:\n";
+        arraySize->dump(indent+2);
+    }
     if (init) {
         std::cout << indentStr(indent+1) << "Initializer:\n";
         init->dump(indent+2);
@@ -111,6 +142,24 @@ void ReturnStmt::dump(int indent) const {
     if (expr) expr->dump(indent+1);
 }
 
+void TryStmt::dump(int indent) const {
+    std::cout << indentStr(indent) << "Try [" << line << ":" << column << "]\n";
+    if (body) body->dump(indent+1);
+    for (const auto &h : handlers) {
+        std::cout << indentStr(indent) << "Catch(";
+        if (h.typeTokens.empty()) std::cout << "...";
+        for (size_t i = 0; i < h.typeTokens.size(); i++) std::cout << (i ? " " : "") << h.typeTokens[i];
+        if (!h.varName.empty()) std::cout << " " << h.varName;
+        std::cout << ")\n";
+        if (h.body) h.body->dump(indent+1);
+    }
+}
+
+void ThrowStmt::dump(int indent) const {
+    std::cout << indentStr(indent) << "Throw [" << line << ":" << column << "]\n";
+    if (expr) expr->dump(indent+1);
+}
+
 // C++ specific dumps
 void ClassDecl::dump(int indent) const {
     std::cout << indentStr(indent) << "ClassDecl(" << className << ") [" << line << ":" << column << "]\n";
@@ -191,28 +240,142 @@ void Program::dump() const {
     }
 }
 
-// --------- Parser implementation ----------
-Parser::Parser(const std::vector<Token>& toks) : tokens(toks), idx(0), currentClassName("") {
-    // Skip any leading comments
-    while (idx < tokens.size() && tokens[idx].type == TokenType::COMMENT) {
-        idx++;
+void Program::abandon() {
+    for (auto &n : top) n.release();
+    top.clear();
+}
+
+// Apply fn to every child slot of node
+void visitChildren(ASTNode* node, const std::function<void(ASTNodePtr&)>& fn) {
+    if (!node) return;
+    switch (node->kind) {
+        case ASTNodeKind::UNARY_OP:
+            fn(static_cast<UnaryOp*>(node)->operand);
+            break;
+        case ASTNodeKind::BINARY_OP: {
+            auto bin = static_cast<BinaryOp*>(node);
+            fn(bin->left);
+            fn(bin->right);
+            break;
+        }
+        case ASTNodeKind::CALL: {
+            auto call = static_cast<CallExpr*>(node);
+            fn(call->callee);
+            for (auto& a : call->args) fn(a);
+            break;
+        }
+        case ASTNodeKind::MEMBER_ACCESS:
+            fn(static_cast<MemberAccess*>(node)->object);
+            break;
+        case ASTNodeKind::ARRAY_SUBSCRIPT: {
+            auto sub = static_cast<ArraySubscript*>(node);
+            fn(sub->array);
+            fn(sub->index);
+            break;
+        }
+        case ASTNodeKind::EXPR_STMT:
+            fn(static_cast<ExprStmt*>(node)->expr);
+            break;
+        case ASTNodeKind::VAR_DECL:
+            fn(static_cast<VarDecl*>(node)->arraySize);
+            fn(static_cast<VarDecl*>(node)->init);
+            break;
+        case ASTNodeKind::BLOCK:
+            for (auto& s : static_cast<BlockStmt*>(node)->statements) fn(s);
+            break;
+        case ASTNodeKind::IF: {
+            auto ifs = static_cast<IfStmt*>(node);
+            fn(ifs->cond);
+            fn(ifs->thenBranch);
+            fn(ifs->elseBranch);
+            break;
+        }
+        case ASTNodeKind::WHILE: {
+            auto ws = static_cast<WhileStmt*>(node);
+            fn(ws->cond);
+            fn(ws->body);
+            break;
+        }
+        case ASTNodeKind::FOR: {
+            auto fs = static_cast<ForStmt*>(node);
+            fn(fs->init);
+            fn(fs->cond);
+            fn(fs->post);
+            fn(fs->body);
+            break;
+        }
+        case ASTNodeKind::RETURN:
+            fn(static_cast<ReturnStmt*>(node)->expr);
+            break;
+        case ASTNodeKind::TRY: {
+            auto ts = static_cast<TryStmt*>(node);
+            fn(ts->body);
+            for (auto& h : ts->handlers) fn(h.body);
+            break;
+        }
+        case ASTNodeKind::THROW:
+            fn(static_cast<ThrowStmt*>(node)->expr);
+            break;
+        case ASTNodeKind::CLASS_DECL:
+            for (auto& m : static_cast<ClassDecl*>(node)->members) fn(m);
+            break;
+        case ASTNodeKind::STRUCT_DECL:
+            for (auto& m : static_cast<StructDecl*>(node)->members) fn(m);
+            break;
+        case ASTNodeKind::NAMESPACE_DECL:
+            fn(static_cast<NamespaceDecl*>(node)->body);
+            break;
+        case ASTNodeKind::TEMPLATE_DECL:
+            fn(static_cast<TemplateDecl*>(node)->declaration);
+            break;
+        case ASTNodeKind::FUNC_DECL:
+            fn(static_cast<FunctionDecl*>(node)->body);
+            break;
+        default:
+            break;
     }
 }
 
+void visitChildren(const ASTNode* node, const std::function<void(const ASTNode*)>& fn) {
+    visitChildren(const_cast<ASTNode*>(node), [&](ASTNodePtr& child) { fn(child.get()); });
+}
+
+// Every identifier in a subtree: callees, arguments, operands and so on
+static void collectIdentifiers(const ASTNode* node, std::vector<const Identifier*>& ids) {
+    if (!node) return;
+    if (node->kind == ASTNodeKind::IDENTIFIER) ids.push_back(static_cast<const Identifier*>(node));
+    visitChildren(node, [&](const ASTNode* child) { collectIdentifiers(child, ids); });
+}
+
+// --------- Parser implementation ----------
+Parser::Parser(const std::vector<Token>& toks) : tokens(&toks), stream(nullptr), idx(0), currentClassName("") {}
+
+Parser::Parser(TokenStream& tokenStream) : tokens(nullptr), stream(&tokenStream), idx(0), currentClassName("") {}
+
+const Token& Parser::tokenAt(size_t i) const {
+    return stream ? stream->at(i) : (*tokens)[i];
+}
+
+bool Parser::hasToken(size_t i) const {
+    return stream ? stream->has(i) : i < tokens->size();
+}
+
+// Statement boundary: a stream may drop tokens the parser cannot come back to
+void Parser::releaseTokens() {
+    type_spans.clear();
+    if (stream && idx > kParserBacktrack) stream->release(idx - kParserBacktrack);
+}
+
 const Token& Parser::peek() const {
-    return tokens[idx];
+    return tokenAt(idx);
 }
 
 const Token& Parser::previous() const {
-    return tokens[idx - 1];
+    return tokenAt(idx - 1);
 }
 
 const Token& Parser::advance() {
     if (!isAtEnd()) idx++;
-    // Skip comment tokens
-    while (!isAtEnd() && peek().type == TokenType::COMMENT) {
-        idx++;
-    }
     return previous();
 }
 
@@ -244,15 +407,12 @@ void Parser::error(const Token& tok, const std::string& message) const {
     std::cerr << ss.str() << std::endl;
     size_t start = (idx > 5) ? idx - 5 : 0;
     size_t end = idx + 5;
-    if (end >= tokens.size()) {
-        if (!tokens.empty()) end = tokens.size() - 1;
-        else end = 0;
-    }
     // DEBUG: // std::cerr << "DEBUG token context around idx=" << idx << ":\n";
-    for (size_t i = start; i <= end && i < tokens.size(); ++i) {
-        std::cerr << i << ": type=" << static_cast<int>(tokens[i].type)
-                  << " '" << tokens[i].value << "' (line " << tokens[i].line
-                  << "," << tokens[i].column << ")\n";
+    for (size_t i = start; i <= end && hasToken(i); ++i) {
+        const Token& context = tokenAt(i);
+        std::cerr << i << ": type=" << static_cast<int>(context.type)
+                  << " '" << context.value << "' (line " << context.line
+                  << "," << context.column << ")\n";
     }
     throw std::runtime_error(ss.str());
 }
@@ -269,177 +429,157 @@ bool Parser::isStorageClass() const {
     return check(TokenType::STORAGE_CLASS);
 }
 
-std::vector<std::string> Parser::parseType() {  // TODO: remove debug bullshit
-    std::vector<std::string> typeTokens;
+TypeId TypeTable::intern(const std::string& key) {
+    auto it = ids.find(key);
+    if (it != ids.end()) return it->second;
+    std::vector<std::string> tokens;
+    for (size_t start = 0, end; (end = key.find('\0', start)) != std::string::npos; start = end + 1) {
+        tokens.emplace_back(key, start, end - start);
+    }
+    TypeId id = static_cast<TypeId>(types.size());
+    types.push_back(std::move(tokens));
+    ids.emplace(key, id);
+    return id;
+}
 
-    // DEBUG: // std::cerr << "DEBUG parseType: Starting with token '" << peek().value
-// DEBUG_CONT:               << "' type: " << static_cast<int>(peek().type) << std::endl;
+Parser::TypeSpan& Parser::typeSpanAt(size_t pos) const {
+    for (auto it = type_spans.rbegin(); it != type_spans.rend(); ++it) {
+        if (it->begin == pos) return *it;
+    }
+    if (type_spans.size() == kTypeSpanLimit) type_spans.clear();
 
-    // Storage class (static, extern, etc.)
-    while (isStorageClass()) {
-        typeTokens.push_back(peek().value);
-        // DEBUG: // std::cerr << "DEBUG parseType: Consumed storage class '" << peek().value << "'" << std::endl;
-        advance();
+    // Lookahead grammar: also joins long/short/signed/unsigned sequences, and
+    // stops before a const after * or &
+    size_t tempPos = pos;
+    while (hasToken(tempPos) && tokenAt(tempPos).type == TokenType::STORAGE_CLASS) tempPos++;
+    while (hasToken(tempPos) && tokenAt(tempPos).type == TokenType::TYPE_QUALIFIER) tempPos++;
+
+    // Base type: qualified names and nested template args
+    while (hasToken(tempPos) &&
+           (tokenAt(tempPos).type == TokenType::TYPE_SPECIFIER ||
+            tokenAt(tempPos).type == TokenType::IDENTIFIER ||
+            (tokenAt(tempPos).type == TokenType::KEYWORD && (tokenAt(tempPos).kind == TokenKind::KW_TYPENAME || tokenAt(tempPos).kind == TokenKind::KW_CLASS)))) {
+        tempPos++;
+
+        // Qualified names ::A::B
+        while (hasToken(tempPos) && tokenAt(tempPos).type == TokenType::SCOPE_RESOLUTION) {
+            tempPos++; // consume ::
+            if (hasToken(tempPos) && tokenAt(tempPos).type == TokenType::IDENTIFIER) tempPos++;
+            else break;
+        }
+
+        // Template arguments
+        if (hasToken(tempPos) && tokenAt(tempPos).type == TokenType::LESS) {
+            int depth = 1;
+            tempPos++;
+            while (hasToken(tempPos) && depth > 0) {
+                if (tokenAt(tempPos).type == TokenType::LESS) depth++;
+                else if (tokenAt(tempPos).type == TokenType::GREATER) depth--;
+                tempPos++;
+            }
+        }
+
+        if (hasToken(tempPos) &&
+            tokenAt(tempPos).type == TokenType::TYPE_SPECIFIER &&
+            (tokenAt(tempPos).kind == TokenKind::KW_LONG || tokenAt(tempPos).kind == TokenKind::KW_SHORT ||
+             tokenAt(tempPos).kind == TokenKind::KW_SIGNED || tokenAt(tempPos).kind == TokenKind::KW_UNSIGNED)) {
+            continue;
+        }
+        break;
     }
 
-    // Type qualifiers (const, volatile)
-    while (isTypeQualifier()) {
-        typeTokens.push_back(peek().value);
-        // DEBUG: // std::cerr << "DEBUG parseType: Consumed type qualifier '" << peek().value << "'" << std::endl;
-        advance();
+    // Pointer/reference
+    while (hasToken(tempPos) &&
+           tokenAt(tempPos).type == TokenType::OPERATOR &&
+           (tokenAt(tempPos).kind == TokenKind::STAR || tokenAt(tempPos).kind == TokenKind::AMP)) {
+        tempPos++;
     }
 
+    type_spans.push_back({pos, tempPos});
+    return type_spans.back();
+}
+
+// parseType's grammar at `pos`, without consuming tokens
+TypeId Parser::scanType(size_t pos, size_t& end) {
+    std::string key;  // As TypeTable::intern takes it
+    auto at = [this, &pos](TokenType type) { return tokenAt(pos).type == type; };
+    auto take = [this, &pos, &key]() {
+        key += tokenAt(pos++).value;
+        key += '\0';
+    };
+
+    // Storage class (static, extern, etc.), then type qualifiers (const, volatile)
+    while (at(TokenType::STORAGE_CLASS)) take();
+    while (at(TokenType::TYPE_QUALIFIER)) take();
+
     // Base type - type specifier OR user-defined type (identifier)
-    if (isTypeSpecifier()) {
-        typeTokens.push_back(peek().value);
-        // DEBUG: // std::cerr << "DEBUG parseType: Consumed type specifier '" << peek().value << "'" << std::endl;
-        advance();
-    } else if (check(TokenType::IDENTIFIER) || (check(TokenType::KEYWORD) && (peek().value == "typename" || peek().value == "class"))) {
+    if (at(TokenType::TYPE_SPECIFIER)) {
+        take();
+    } else if (at(TokenType::IDENTIFIER) || (at(TokenType::KEYWORD) && (tokenAt(pos).kind == TokenKind::KW_TYPENAME || tokenAt(pos).kind == TokenKind::KW_CLASS))) {
         // Build qualified name and consume nested template arguments as part of the type
-        std::string fullname = peek().value;
-        // DEBUG: // std::cerr << "DEBUG parseType: Consumed user-defined type '" << peek().value << "'" << std::endl;
-        advance();
+        std::string fullname = tokenAt(pos++).text();
 
         // If we consumed a leading 'typename'/'class', attach the next identifier as the actual type name
-        if (fullname == "typename" || fullname == "class") {
-            if (check(TokenType::IDENTIFIER)) {
-                fullname += " ";
-                fullname += peek().value;
-                advance();
-            }
+        if ((fullname == "typename" || fullname == "class") && at(TokenType::IDENTIFIER)) {
+            fullname += " ";
+            fullname += tokenAt(pos++).value;
         }
 
         // Loop to collect ::qualifiers and <template args>
         while (true) {
-            if (check(TokenType::SCOPE_RESOLUTION)) {
-                advance(); // consume ::
-                if (check(TokenType::IDENTIFIER)) {
-                    fullname += "::" + peek().value;
-                    advance();
-                    continue;
-                } else {
-                    break;
-                }
+            if (at(TokenType::SCOPE_RESOLUTION)) {
+                pos++; // consume ::
+                if (!at(TokenType::IDENTIFIER)) break;
+                fullname += "::" + tokenAt(pos++).text();
+                continue;
             }
 
-            if (check(TokenType::LESS)) {
+            if (at(TokenType::LESS)) {
                 // collect template argument text until matching '>' (handle nesting)
-                int depth = 0;
-                std::string templ = "";
-                // consume '<'
-                templ += "<";
-                advance();
-                depth = 1;
-                while (!isAtEnd() && depth > 0) {
-                    if (check(TokenType::LESS)) { templ += "<"; advance(); depth++; continue; }
-                    if (check(TokenType::GREATER)) { templ += ">"; advance(); depth--; if (depth == 0) break; else continue; }
+                fullname += "<";
+                pos++;
+                int depth = 1;
+                while (!at(TokenType::END_OF_FILE) && depth > 0) {
+                    if (at(TokenType::LESS)) depth++;
+                    else if (at(TokenType::GREATER)) depth--;
                     // Append raw token value (including punctuation)
-                    templ += peek().value;
-                    advance();
+                    fullname += tokenAt(pos++).value;
                 }
-                fullname += templ;
                 continue;
             }
 
             break;
         }
 
-        typeTokens.push_back(fullname);
+        key += fullname;
+        key += '\0';
     }
 
-    // Pointer/reference markers
-    while (check(TokenType::OPERATOR) && (peek().value == "*" || peek().value == "&")) {
-        typeTokens.push_back(peek().value);
-        // DEBUG: // std::cerr << "DEBUG parseType: Consumed pointer/reference '" << peek().value << "'" << std::endl;
-        advance();
-
-        // const after pointer: int* const
-        while (isTypeQualifier()) {
-            typeTokens.push_back(peek().value);
-            // DEBUG: // std::cerr << "DEBUG parseType: Consumed qualifier after pointer '" << peek().value << "'" << std::endl;
-            advance();
-        }
+    // Pointer/reference markers, with const after pointer: int* const
+    while (at(TokenType::OPERATOR) && (tokenAt(pos).kind == TokenKind::STAR || tokenAt(pos).kind == TokenKind::AMP)) {
+        take();
+        while (at(TokenType::TYPE_QUALIFIER)) take();
     }
 
-    // DEBUG: // std::cerr << "DEBUG parseType: Ending with token '" << peek().value
-// DEBUG_CONT:               << "' type: " << static_cast<int>(peek().type) << std::endl;
-    return typeTokens;
+    end = pos;
+    return types.intern(key);
 }
 
-// Helper for lookahead type parsing without consuming tokens
-std::vector<std::string> Parser::parseTypeForLookahead(size_t& pos) const {
-    std::vector<std::string> typeTokens;
-    size_t tempPos = pos;
-
-    // Storage class
-    while (tempPos < tokens.size() &&
-           tokens[tempPos].type == TokenType::STORAGE_CLASS) {
-        typeTokens.push_back(tokens[tempPos].value);
-        tempPos++;
-    }
-
-    // Type qualifiers
-    while (tempPos < tokens.size() &&
-           tokens[tempPos].type == TokenType::TYPE_QUALIFIER) {
-        typeTokens.push_back(tokens[tempPos].value);
-        tempPos++;
-    }
-
-    // Base type: support qualified names and nested template args
-    bool hasType = false;
-    while (tempPos < tokens.size() &&
-           (tokens[tempPos].type == TokenType::TYPE_SPECIFIER ||
-            tokens[tempPos].type == TokenType::IDENTIFIER ||
-            (tokens[tempPos].type == TokenType::KEYWORD && (tokens[tempPos].value == "typename" || tokens[tempPos].value == "class")))) {
-        // Start with base identifier/specifier
-        std::string fullname = tokens[tempPos].value;
-        tempPos++;
-
-        // Qualified names ::A::B
-        while (tempPos < tokens.size() && tokens[tempPos].type == TokenType::SCOPE_RESOLUTION) {
-            tempPos++; // consume ::
-            if (tempPos < tokens.size() && tokens[tempPos].type == TokenType::IDENTIFIER) {
-                fullname += "::" + tokens[tempPos].value;
-                tempPos++;
-            } else break;
-        }
-
-        // Template arguments
-        if (tempPos < tokens.size() && tokens[tempPos].type == TokenType::LESS) {
-            int depth = 0;
-            std::string templ = "<";
-            tempPos++; depth = 1;
-            while (tempPos < tokens.size() && depth > 0) {
-                if (tokens[tempPos].type == TokenType::LESS) { templ += "<"; depth++; tempPos++; continue; }
-                if (tokens[tempPos].type == TokenType::GREATER) { templ += ">"; depth--; tempPos++; if (depth == 0) break; else continue; }
-                templ += tokens[tempPos].value;
-                tempPos++;
-            }
-            fullname += templ;
-        }
-
-        typeTokens.push_back(fullname);
-        hasType = true;
-
-        if (tempPos < tokens.size() &&
-            tokens[tempPos].type == TokenType::TYPE_SPECIFIER &&
-            (tokens[tempPos].value == "long" || tokens[tempPos].value == "short" ||
-             tokens[tempPos].value == "signed" || tokens[tempPos].value == "unsigned")) {
-            continue;
-        }
-        break;
-    }
-
-    // Pointer/reference
-    while (tempPos < tokens.size() &&
-           tokens[tempPos].type == TokenType::OPERATOR &&
-           (tokens[tempPos].value == "*" || tokens[tempPos].value == "&")) {
-        typeTokens.push_back(tokens[tempPos].value);
-        tempPos++;
+TypeId Parser::parseType() {
+    TypeSpan& span = typeSpanAt(idx);
+    if (!span.parsed) {
+        span.type = scanType(idx, span.end);
+        span.parsed = true;
     }
+    idx = span.end;
+    return span.type;
+}
 
-    pos = tempPos; // Update the position
-    return typeTokens;
+// Helper for lookahead type parsing without consuming tokens
+bool Parser::parseTypeForLookahead(size_t& pos) const {
+    size_t start = pos;
+    pos = typeSpanAt(pos).lookaheadEnd;
+    return pos != start;
 }
 
 // Top-level
@@ -447,24 +587,79 @@ Program Parser::parseProgram() {
     Program p;
     while (!isAtEnd()) {
         if (check(TokenType::END_OF_FILE)) break;
-        // Skip comments
-        if (check(TokenType::COMMENT)) {
-            advance();
-            continue;
-        }
+        releaseTokens();
+        declaration_start = idx;
         auto node = parseDeclarationOrStatement();
         if (node) p.top.push_back(std::move(node));
     }
+    if (!deferred_bodies.empty()) parseReachableBodies(p);
     return p;
 }
 
-ASTNodePtr Parser::parseDeclarationOrStatement() {
-    // Skip comments
-    while (check(TokenType::COMMENT)) {
-        advance();
+// Parses the skipped bodies that can run: main's, those of the functions named
+// in anything parsed in full (class members, templates, global initializers),
+// and transitively those named in the bodies parsed here. Any mention counts,
+// not just calls, so a function passed by name is kept. The functions still
+// skipped are removed from the program. Without a main there is no root and
+// every body is parsed.
+void Parser::parseReachableBodies(Program& program) {
+    std::unordered_map<SymbolId, std::vector<size_t>> byName;  // Overloads share a name
+    for (size_t i = 0; i < deferred_bodies.size(); i++) {
+        byName[internSymbol(deferred_bodies[i].first->funcName)].push_back(i);
+    }
+
+    size_t end = idx;
+    std::vector<bool> parsed(deferred_bodies.size(), false);
+    std::vector<const ASTNode*> worklist;
+    auto parseBodies = [&](const std::vector<size_t>& functions) {
+        for (size_t i : functions) {
+            if (parsed[i]) continue;
+            parsed[i] = true;
+            idx = deferred_bodies[i].second;
+            deferred_bodies[i].first->body = parseBlock();
+            worklist.push_back(deferred_bodies[i].first->body.get());
+        }
+    };
+
+    std::unordered_set<const ASTNode*> deferred;
+    for (const auto& entry : deferred_bodies) deferred.insert(entry.first);
+    for (const auto& node : program.top) {
+        if (!deferred.count(node.get())) worklist.push_back(node.get());
     }
-    
-    const Token &t = peek();
+    auto entry = byName.find(internSymbol("main"));
+    if (entry == byName.end()) {
+        for (const auto& functions : byName) parseBodies(functions.second);
+    } else {
+        parseBodies(entry->second);
+    }
+
+    std::vector<const Identifier*> ids;
+    while (!worklist.empty()) {
+        const ASTNode* node = worklist.back();
+        worklist.pop_back();
+        ids.clear();
+        collectIdentifiers(node, ids);
+        for (const Identifier* id : ids) {
+            auto it = byName.find(id->symbol);
+            if (it != byName.end()) parseBodies(it->second);
+        }
+    }
+    idx = end;
+    releaseTokens();
+
+    std::unordered_set<const ASTNode*> unreachable;
+    for (size_t i = 0; i < deferred_bodies.size(); i++) {
+        if (!parsed[i]) unreachable.insert(deferred_bodies[i].first);
+    }
+    program.top.erase(std::remove_if(program.top.begin(), program.top.end(),
+                                     [&](const ASTNodePtr& node) { return unreachable.count(node.get()) > 0; }),
+                      program.top.end());
+    skipped_functions = unreachable.size();
+    deferred_bodies.clear();
+}
+
+ASTNodePtr Parser::parseDeclarationOrStatement() {
+    Token t = peek();
 
     // Preprocessor directives
     if (t.type == TokenType::PREPROCESSOR) {
@@ -478,9 +673,9 @@ ASTNodePtr Parser::parseDeclarationOrStatement() {
 
     // STATEMENT keywords - handle these first!
     if (t.type == TokenType::KEYWORD) {
-        if (t.value == "return" || t.value == "if" || t.value == "while" ||
-            t.value == "for" || t.value == "break" || t.value == "continue" || 
-            t.value == "throw" || t.value == "delete" || t.value == "new") {
+        if (t.kind == TokenKind::KW_RETURN || t.kind == TokenKind::KW_IF || t.kind == TokenKind::KW_WHILE ||
+            t.kind == TokenKind::KW_FOR || t.kind == TokenKind::KW_BREAK || t.kind == TokenKind::KW_CONTINUE || 
+            t.kind == TokenKind::KW_THROW || t.kind == TokenKind::KW_TRY || t.kind == TokenKind::KW_DELETE || t.kind == TokenKind::KW_NEW) {
             return parseStatement();
         }
     }
@@ -490,32 +685,32 @@ ASTNodePtr Parser::parseDeclarationOrStatement() {
         t.type == TokenType::STORAGE_CLASS || t.type == TokenType::TYPE_QUALIFIER) {
 
         // Class declaration
-        if (t.value == "class") {
+        if (t.kind == TokenKind::KW_CLASS) {
             return parseClass();
         }
         // Struct declaration
-        if (t.value == "struct") {
+        if (t.kind == TokenKind::KW_STRUCT) {
             return parseStruct();
         }
         // Namespace declaration
-        if (t.value == "namespace") {
+        if (t.kind == TokenKind::KW_NAMESPACE) {
             return parseNamespace();
         }
         // Template declaration
-        if (t.value == "template") {
+        if (t.kind == TokenKind::KW_TEMPLATE) {
             return parseTemplate();
         }
         // Using directive
-        if (t.value == "using") {
+        if (t.kind == TokenKind::KW_USING) {
             return parseUsingDirective();
         }
 
         // Use parseTypeForLookahead to detect function declarations after complex types
         size_t lookahead = idx;
-        auto tt = parseTypeForLookahead(lookahead);
+        parseTypeForLookahead(lookahead);
         // After a type, expect IDENTIFIER then '('
-        if (lookahead < tokens.size() && tokens[lookahead].type == TokenType::IDENTIFIER) {
-            if (lookahead + 1 < tokens.size() && tokens[lookahead + 1].type == TokenType::LEFT_PAREN) {
+        if (hasToken(lookahead) && tokenAt(lookahead).type == TokenType::IDENTIFIER) {
+            if (hasToken(lookahead + 1) && tokenAt(lookahead + 1).type == TokenType::LEFT_PAREN) {
                 return parseFunctionDeclaration();
             }
         }
@@ -527,10 +722,23 @@ ASTNodePtr Parser::parseDeclarationOrStatement() {
     // Check for user-defined type declarations (qualified names or templates)
     if (t.type == TokenType::IDENTIFIER) {
         size_t la = idx;
-        auto tt = parseTypeForLookahead(la);
-        if (!tt.empty()) {
+        if (parseTypeForLookahead(la)) {
             // If parseTypeForLookahead consumed tokens and the next token is an identifier, treat as declaration
-            if (la < tokens.size() && tokens[la].type == TokenType::IDENTIFIER) {
+            if (hasToken(la) && tokenAt(la).type == TokenType::IDENTIFIER) {
+                // Function with a user-defined (or template parameter) return type: T get() { ... }
+                if (hasToken(la + 1) && tokenAt(la + 1).type == TokenType::LEFT_PAREN) {
+                    size_t k = la + 2;
+                    int depth = 1;
+                    while (hasToken(k) && depth > 0) {
+                        if (tokenAt(k).type == TokenType::LEFT_PAREN) depth++;
+                        else if (tokenAt(k).type == TokenType::RIGHT_PAREN) depth--;
+                        k++;
+                    }
+                    if (hasToken(k) && tokenAt(k).kind == TokenKind::KW_CONST) k++;
+                    if (hasToken(k) && tokenAt(k).type == TokenType::LEFT_BRACE) {
+                        return parseFunctionDeclaration();
+                    }
+                }
                 return parseVarDeclaration();
             }
         }
@@ -547,7 +755,7 @@ ASTNodePtr Parser::parseClass() {
         error(peek(), "Expected class name");
 
     Token nameTok = peek(); advance();
-    auto classDecl = std::make_unique<ClassDecl>(nameTok.value, classTok.line, classTok.column);
+    auto classDecl = makeNode<ClassDecl>(nameTok.text(), classTok.line, classTok.column);
 
     std::string oldClassName = currentClassName;
     currentClassName = nameTok.value;
@@ -562,7 +770,7 @@ ASTNodePtr Parser::parseClass() {
             }
             // Get base class name
             if (check(TokenType::IDENTIFIER)) {
-                classDecl->baseClasses.push_back(peek().value);
+                classDecl->baseClasses.push_back(peek().text());
                 advance();
             }
             // Skip comma
@@ -593,7 +801,7 @@ ASTNodePtr Parser::parseStruct() {
         error(peek(), "Expected struct name");
 
     Token nameTok = peek(); advance();
-    auto structDecl = std::make_unique<StructDecl>(nameTok.value, structTok.line, structTok.column);
+    auto structDecl = makeNode<StructDecl>(nameTok.text(), structTok.line, structTok.column);
 
     consume(TokenType::LEFT_BRACE, "Expected '{' after struct name");
 
@@ -619,7 +827,7 @@ ASTNodePtr Parser::parseNamespace() {
         while (check(TokenType::SCOPE_RESOLUTION)) {
             advance(); // consume ::
             if (check(TokenType::IDENTIFIER)) {
-                name += "::" + peek().value;
+                name += "::" + peek().text();
                 advance();
             } else {
                 break;
@@ -632,7 +840,7 @@ ASTNodePtr Parser::parseNamespace() {
     // DEBUG: // std::cerr << "DEBUG parseNamespace: name='" << name << "' peek='" << peek().value << "' type:" << static_cast<int>(peek().type) << std::endl;
     consume(TokenType::LEFT_BRACE, "Expected '{' after namespace");
 
-    auto body = std::make_unique<BlockStmt>(nsTok.line, nsTok.column);
+    auto body = makeNode<BlockStmt>(nsTok.line, nsTok.column);
     while (!check(TokenType::RIGHT_BRACE) && !isAtEnd()) {
         auto decl = parseDeclarationOrStatement();
         if (decl) body->statements.push_back(std::move(decl));
@@ -640,7 +848,7 @@ ASTNodePtr Parser::parseNamespace() {
 
     consume(TokenType::RIGHT_BRACE, "Expected '}' after namespace body");
 
-    return std::make_unique<NamespaceDecl>(name, std::move(body), nsTok.line, nsTok.column);
+    return makeNode<NamespaceDecl>(name, std::move(body), nsTok.line, nsTok.column);
 }
 
 // FIXED: Template parsing with new LESS/GREATER tokens
@@ -655,31 +863,32 @@ ASTNodePtr Parser::parseTemplate() {
     // Parse the templated declaration
     // First attempt: lookahead using parseTypeForLookahead
     size_t la = idx;
-    auto tt = parseTypeForLookahead(la);
-    if (la < tokens.size() && tokens[la].type == TokenType::IDENTIFIER && la + 1 < tokens.size() && tokens[la+1].type == TokenType::LEFT_PAREN) {
+    parseTypeForLookahead(la);
+    if (hasToken(la) && tokenAt(la).type == TokenType::IDENTIFIER && hasToken(la + 1) && tokenAt(la+1).type == TokenType::LEFT_PAREN) {
         ASTNodePtr declaration = parseFunctionDeclaration();
-        return std::make_unique<TemplateDecl>(std::move(params), std::move(declaration), templateTok.line, templateTok.column);
+        return makeNode<TemplateDecl>(std::move(params), std::move(declaration), templateTok.line, templateTok.column);
     }
 
     // Fallback: scan forward for IDENTIFIER + LEFT_PAREN before '{' or ';'
     size_t k = idx;
     bool foundFunc = false;
-    while (k + 1 < tokens.size()) {
-        if (tokens[k].type == TokenType::IDENTIFIER && tokens[k+1].type == TokenType::LEFT_PAREN) { foundFunc = true; break; }
-        if (tokens[k].type == TokenType::LEFT_BRACE || tokens[k].type == TokenType::SEMICOLON) break;
+    while (hasToken(k + 1)) {
+        if (tokenAt(k).type == TokenType::IDENTIFIER && tokenAt(k+1).type == TokenType::LEFT_PAREN) { foundFunc = true; break; }
+        if (tokenAt(k).type == TokenType::LEFT_BRACE || tokenAt(k).type == TokenType::SEMICOLON) break;
         k++;
     }
     if (foundFunc) {
         ASTNodePtr declaration = parseFunctionDeclaration();
-        return std::make_unique<TemplateDecl>(std::move(params), std::move(declaration), templateTok.line, templateTok.column);
+        return makeNode<TemplateDecl>(std::move(params), std::move(declaration), templateTok.line, templateTok.column);
     }
 
     ASTNodePtr declaration = parseDeclarationOrStatement();
-    return std::make_unique<TemplateDecl>(std::move(params), std::move(declaration),
-                                         templateTok.line, templateTok.column);
+    return makeNode<TemplateDecl>(std::move(params), std::move(declaration),
+                                 templateTok.line, templateTok.column);
 }
 
 ASTNodePtr Parser::parseFunctionDeclaration() {
+    size_t startIdx = idx;
     int startLine = peek().line;
     int startCol = peek().column;
 
@@ -690,16 +899,16 @@ ASTNodePtr Parser::parseFunctionDeclaration() {
     if (check(TokenType::IDENTIFIER) && peek().value == currentClassName) {
         funcName = peek().value;
         advance();
-    } else if (check(TokenType::OPERATOR) && peek().value == "~") {
+    } else if (check(TokenType::OPERATOR) && peek().kind == TokenKind::TILDE) {
         advance();
         if (!check(TokenType::IDENTIFIER) || peek().value != currentClassName) {
             error(peek(), "Expected class name after '~'");
         }
-        funcName = "~" + peek().value;
+        funcName = "~" + peek().text();
         advance();
     } else {
         // Regular function
-        returnType = parseType();
+        returnType = typeTokens(parseType());
         // If parseType consumed the function name (e.g., 'auto peek'), handle that
         if (check(TokenType::LEFT_PAREN) && !returnType.empty()) {
             // assume last token in returnType is the function name
@@ -717,29 +926,40 @@ ASTNodePtr Parser::parseFunctionDeclaration() {
 
     // Check for const member function
     bool isConst = false;
-    if (check(TokenType::TYPE_QUALIFIER) && peek().value == "const") {
+    if (check(TokenType::TYPE_QUALIFIER) && peek().kind == TokenKind::KW_CONST) {
         isConst = true;
         advance();
     }
 
     ASTNodePtr body = nullptr;
+    size_t bodyStart = idx;
+    // Operators are called without being named, so their bodies are always parsed
+    bool deferBody = lazy_bodies && startIdx == declaration_start && funcName.rfind("operator", 0) != 0;
     if (check(TokenType::LEFT_BRACE)) {
-        body = parseBlock();
+        if (deferBody) {
+            skipBlock();
+        } else {
+            body = parseBlock();
+        }
     } else {
+        deferBody = false;
         consume(TokenType::SEMICOLON, "Expected ';' or function body");
     }
 
-    auto funcDecl = std::make_unique<FunctionDecl>(returnType, funcName,
-                                                   std::move(params), std::move(body),
-                                                   startLine, startCol);
+    auto funcDecl = makeNode<FunctionDecl>(returnType, funcName,
+                                           std::move(params), std::move(body),
+                                           startLine, startCol);
     funcDecl->isConst = isConst;
+    funcDecl->tokenBegin = startIdx;
+    funcDecl->tokenEnd = idx;
+    if (deferBody) deferred_bodies.push_back({funcDecl.get(), bodyStart});
     return funcDecl;
 }
 
 ASTNodePtr Parser::parseAccessSpecifier() {
     Token accessTok = peek(); advance();
     consume(TokenType::COLON, "Expected ':' after access specifier");
-    return std::make_unique<AccessSpec>(accessTok.value, accessTok.line, accessTok.column);
+    return makeNode<AccessSpec>(accessTok.text(), accessTok.line, accessTok.column);
 }
 
 // FIXED: Include directive parsing with new LESS/GREATER tokens
@@ -747,7 +967,7 @@ ASTNodePtr Parser::parseIncludeDirective() {
     Token includeTok = peek(); advance(); // consume preprocessor token
 
     // Parse the preprocessor directive value
-    std::string directive = includeTok.value;
+    std::string directive = includeTok.text();
 
     // Extract filename from #include directive
     std::string file;
@@ -779,13 +999,13 @@ ASTNodePtr Parser::parseIncludeDirective() {
         }
     }
 
-    return std::make_unique<IncludeDirective>(file, isSystem, includeTok.line, includeTok.column);
+    return makeNode<IncludeDirective>(file, isSystem, includeTok.line, includeTok.column);
 }
 
 ASTNodePtr Parser::parseUsingDirective() {
     Token usingTok = peek(); advance(); // consume 'using'
 
-    if (check(TokenType::KEYWORD) && peek().value == "namespace") {
+    if (check(TokenType::KEYWORD) && peek().kind == TokenKind::KW_NAMESPACE) {
         advance(); // consume 'namespace'
         if (!check(TokenType::IDENTIFIER))
             error(peek(), "Expected namespace name");
@@ -793,7 +1013,7 @@ ASTNodePtr Parser::parseUsingDirective() {
         Token nsName = peek(); advance();
         consume(TokenType::SEMICOLON, "Expected ';' after using directive");
 
-        return std::make_unique<UsingDirective>(nsName.value, usingTok.line, usingTok.column);
+        return makeNode<UsingDirective>(nsName.text(), usingTok.line, usingTok.column);
     }
 
     // Handle using declarations (using std::cout;)
@@ -810,15 +1030,15 @@ ASTNodePtr Parser::parseClassMember() {
 
     // Check for constructor
     if (check(TokenType::IDENTIFIER) && peek().value == currentClassName) {
-        if (idx + 1 < tokens.size() && tokens[idx + 1].type == TokenType::LEFT_PAREN) {
+        if (hasToken(idx + 1) && tokenAt(idx + 1).type == TokenType::LEFT_PAREN) {
             return parseFunctionDeclaration();
         }
     }
 
     // Check for destructor
-    if (check(TokenType::OPERATOR) && peek().value == "~") {
-        if (idx + 1 < tokens.size() && tokens[idx + 1].type == TokenType::IDENTIFIER &&
-            tokens[idx + 1].value == currentClassName) {
+    if (check(TokenType::OPERATOR) && peek().kind == TokenKind::TILDE) {
+        if (hasToken(idx + 1) && tokenAt(idx + 1).type == TokenType::IDENTIFIER &&
+            tokenAt(idx + 1).value == currentClassName) {
             return parseFunctionDeclaration();
         }
     }
@@ -835,7 +1055,7 @@ std::vector<std::pair<std::vector<std::string>, std::string>> Parser::parseFunct
     while (!check(TokenType::RIGHT_PAREN) && !isAtEnd()) {
         // Parse parameter type
         // DEBUG: // std::cerr << "DEBUG parseFunctionParams: about to parse type at token '" << peek().value << "' (" << static_cast<int>(peek().type) << ")" << std::endl;
-        std::vector<std::string> paramType = parseType();
+        std::vector<std::string> paramType = typeTokens(parseType());
 
         if (paramType.empty()) {
             error(peek(), "Expected type in parameter list");
@@ -862,13 +1082,13 @@ std::vector<std::string> Parser::parseTemplateParams() {
     std::vector<std::string> params;
 
     while (!check(TokenType::GREATER) && !isAtEnd()) {
-        if (check(TokenType::KEYWORD) && (peek().value == "typename" || peek().value == "class")) {
+        if (check(TokenType::KEYWORD) && (peek().kind == TokenKind::KW_TYPENAME || peek().kind == TokenKind::KW_CLASS)) {
             advance(); // consume 'typename' or 'class'
             if (check(TokenType::IDENTIFIER)) {
-                params.push_back(peek().value);
+                params.push_back(peek().text());
                 advance();
                 // support default parameter: = T
-                if (check(TokenType::OPERATOR) && peek().value == "=") {
+                if (check(TokenType::OPERATOR) && peek().kind == TokenKind::ASSIGN) {
                     advance();
                     // consume a simple identifier or type specifier as default
                     if (check(TokenType::IDENTIFIER) || check(TokenType::TYPE_SPECIFIER)) {
@@ -876,6 +1096,13 @@ std::vector<std::string> Parser::parseTemplateParams() {
                     }
                 }
             }
+        } else if (isTypeSpecifier()) {
+            // Non-type parameter: int N
+            while (isTypeSpecifier()) advance();
+            if (check(TokenType::IDENTIFIER)) {
+                params.push_back(peek().text());
+                advance();
+            }
         }
 
         if (check(TokenType::COMMA)) {
@@ -888,6 +1115,44 @@ std::vector<std::string> Parser::parseTemplateParams() {
     return params;
 }
 
+// True if tokenAt(pos) starts `<args>(` of an explicit template call: types or
+// integer literals separated by commas, as opposed to a `<` comparison
+bool Parser::isTemplateArgumentList(size_t pos) const {
+    if (!hasToken(pos) || tokenAt(pos).type != TokenType::LESS) return false;
+    pos++;
+    while (hasToken(pos)) {
+        if (tokenAt(pos).type == TokenType::NUMBER) {
+            pos++;
+        } else {
+            size_t start = pos;
+            parseTypeForLookahead(pos);
+            if (pos == start) return false;
+        }
+        if (hasToken(pos) && tokenAt(pos).type == TokenType::COMMA) {
+            pos++;
+            continue;
+        }
+        return hasToken(pos + 1) && tokenAt(pos).type == TokenType::GREATER &&
+               tokenAt(pos + 1).type == TokenType::LEFT_PAREN;
+    }
+    return false;
+}
+
+std::vector<std::vector<std::string>> Parser::parseTemplateArguments() {
+    std::vector<std::vector<std::string>> args;
+    consume(TokenType::LESS, "Expected '<' before template arguments");
+    do {
+        if (check(TokenType::NUMBER)) {
+            args.push_back({peek().text()});
+            advance();
+        } else {
+            args.push_back(typeTokens(parseType()));
+        }
+    } while (match({TokenType::COMMA}));
+    consume(TokenType::GREATER, "Expected '>' after template arguments");
+    return args;
+}
+
 ASTNodePtr Parser::parseVarDeclaration() {
     int startLine = peek().line;
     int startCol = peek().column;
@@ -897,7 +1162,7 @@ ASTNodePtr Parser::parseVarDeclaration() {
 // DEBUG_CONT:               << "' type: " << static_cast<int>(peek().type) << std::endl;
 
     // Parse type (can be complex: const int*, unsigned long long, etc.)
-    std::vector<std::string> type = parseType();
+    std::vector<std::string> type = typeTokens(parseType());
 
     // DEBUG: Print after parseType
     // DEBUG: // std::cerr << "DEBUG parseVarDeclaration: After parseType, current token '" << peek().value
@@ -921,17 +1186,18 @@ ASTNodePtr Parser::parseVarDeclaration() {
         // DEBUG: // std::cerr << "DEBUG: Variable name: " << nameTok.value << std::endl;
 
         ASTNodePtr init = nullptr;
+        ASTNodePtr arraySize = nullptr;
         bool isArrayDecl = false;
         // Array declarator e.g. arr[5]
         if (check(TokenType::LEFT_BRACKET)) {
             isArrayDecl = true;
-            Token br = peek(); advance();
-            // For simplicity, capture the size expression
+            advance(); // consume '['
+            // Capture the size expression (codegen reserves that many cells)
             ASTNodePtr sizeExpr = parseExpression();
             consume(TokenType::RIGHT_BRACKET, "Expected ']' in array declarator");
-            (void)sizeExpr;
+            arraySize = std::move(sizeExpr);
             // If an initializer follows (e.g. = { ... }) handle it
-            if (check(TokenType::OPERATOR) && peek().value == "=") {
+            if (check(TokenType::OPERATOR) && peek().kind == TokenKind::ASSIGN) {
                 // DEBUG: // std::cerr << "DEBUG: Found = initializer after array declarator" << std::endl;
                 advance();
                 if (check(TokenType::LEFT_BRACE)) {
@@ -942,14 +1208,14 @@ ASTNodePtr Parser::parseVarDeclaration() {
                         advance();
                     }
                     consume(TokenType::RIGHT_BRACE, "Expected '}' after initializer list");
-                    init = std::make_unique<Literal>(contents, ob.line, ob.column, TokenType::LEFT_BRACE);
+                    init = makeNode<Literal>(contents, ob.line, ob.column, TokenType::LEFT_BRACE);
                 } else {
                     init = parseExpression();
                 }
             }
         }
         // Brace initializer list e.g. = {1,2,3}
-        else if (check(TokenType::OPERATOR) && peek().value == "=") {
+        else if (check(TokenType::OPERATOR) && peek().kind == TokenKind::ASSIGN) {
             // DEBUG: // std::cerr << "DEBUG: Found = initializer" << std::endl;
             advance();
             if (check(TokenType::LEFT_BRACE)) {
@@ -961,7 +1227,7 @@ ASTNodePtr Parser::parseVarDeclaration() {
                     advance();
                 }
                 consume(TokenType::RIGHT_BRACE, "Expected '}' after initializer list");
-                init = std::make_unique<Literal>(contents, ob.line, ob.column, TokenType::LEFT_BRACE);
+                init = makeNode<Literal>(contents, ob.line, ob.column, TokenType::LEFT_BRACE);
             } else {
                 init = parseExpression();
             }
@@ -974,16 +1240,17 @@ ASTNodePtr Parser::parseVarDeclaration() {
                 if (!match({TokenType::COMMA})) break;
             }
             consume(TokenType::RIGHT_PAREN, "Expected ')' after constructor arguments");
-            auto typeName = std::make_unique<Identifier>(type.empty() ? "" : type[0], startLine, startCol);
-            init = std::make_unique<CallExpr>(std::move(typeName), std::move(args), startLine, startCol);
+            auto typeName = makeNode<Identifier>(type.empty() ? "" : type[0], startLine, startCol);
+            init = makeNode<CallExpr>(std::move(typeName), std::move(args), startLine, startCol);
         }
 
-        auto varDecl = std::make_unique<VarDecl>(type, nameTok.value, std::move(init), startLine, startCol);
+        auto varDecl = makeNode<VarDecl>(type, nameTok.text(), std::move(init), startLine, startCol);
         for (const auto& token : type) {
             if (token == "*") varDecl->isPointer = true;
             if (token == "&") varDecl->isReference = true;
         }
         varDecl->isArray = isArrayDecl;
+        varDecl->arraySize = std::move(arraySize);
         decls.push_back(std::move(varDecl));
 
         if (!match({TokenType::COMMA})) break;
@@ -999,13 +1266,13 @@ ASTNodePtr Parser::parseVarDeclaration() {
         return std::move(decls[0]);
     }
 
-    auto block = std::make_unique<BlockStmt>(startLine, startCol);
+    auto block = makeNode<BlockStmt>(startLine, startCol);
     for (auto &d : decls) block->statements.push_back(std::move(d));
     return block;
 }
 
 ASTNodePtr Parser::parseStatement() {
-    const Token &t = peek();
+    Token t = peek();
 
     // Skip preprocessor (already handled in parseDeclarationOrStatement)
     if (t.type == TokenType::PREPROCESSOR) {
@@ -1014,7 +1281,7 @@ ASTNodePtr Parser::parseStatement() {
     }
 
     // Skip 'using namespace' (already handled)
-    if (check(TokenType::KEYWORD) && t.value == "using") {
+    if (check(TokenType::KEYWORD) && t.kind == TokenKind::KW_USING) {
         return parseDeclarationOrStatement();
     }
 
@@ -1023,11 +1290,12 @@ ASTNodePtr Parser::parseStatement() {
         idx--;
         return parseBlock();
     }
-    if (check(TokenType::KEYWORD) && peek().value == "if") return parseIf();
-    if (check(TokenType::KEYWORD) && peek().value == "while") return parseWhile();
-    if (check(TokenType::KEYWORD) && peek().value == "for") return parseFor();
-    if (check(TokenType::KEYWORD) && peek().value == "return") return parseReturn();
-    if (check(TokenType::KEYWORD) && peek().value == "throw") return parseThrow();
+    if (check(TokenType::KEYWORD) && peek().kind == TokenKind::KW_IF) return parseIf();
+    if (check(TokenType::KEYWORD) && peek().kind == TokenKind::KW_WHILE) return parseWhile();
+    if (check(TokenType::KEYWORD) && peek().kind == TokenKind::KW_FOR) return parseFor();
+    if (check(TokenType::KEYWORD) && peek().kind == TokenKind::KW_RETURN) return parseReturn();
+    if (check(TokenType::KEYWORD) && peek().kind == TokenKind::KW_THROW) return parseThrow();
+    if (check(TokenType::KEYWORD) && peek().kind == TokenKind::KW_TRY) return parseTry();
 
     return parseExpressionStatement();
 }
@@ -1035,8 +1303,9 @@ ASTNodePtr Parser::parseStatement() {
 ASTNodePtr Parser::parseBlock() {
     Token open = peek();
     consume(TokenType::LEFT_BRACE, "Expected '{' to start block");
-    auto block = std::make_unique<BlockStmt>(open.line, open.column);
+    auto block = makeNode<BlockStmt>(open.line, open.column);
     while (!check(TokenType::RIGHT_BRACE) && !isAtEnd()) {
+        releaseTokens();
         auto stmt = parseDeclarationOrStatement();
         if (stmt) block->statements.push_back(std::move(stmt));
     }
@@ -1044,10 +1313,24 @@ ASTNodePtr Parser::parseBlock() {
     return block;
 }
 
+// Past the block at idx without building it: only braces are matched
+void Parser::skipBlock() {
+    Token open = peek();
+    int depth = 0;
+    do {
+        if (isAtEnd()) error(open, "Expected '}' after block");
+        if (check(TokenType::LEFT_BRACE)) depth++;
+        else if (check(TokenType::RIGHT_BRACE)) depth--;
+        advance();
+    } while (depth > 0);
+}
+
 ASTNodePtr Parser::parseExpressionStatement() {
+    Token start = peek();
+    int line = start.line, column = start.column;
     ASTNodePtr expr = parseExpression();
     consume(TokenType::SEMICOLON, "Expected ';' after expression");
-    return std::make_unique<ExprStmt>(std::move(expr), peek().line, peek().column);
+    return makeNode<ExprStmt>(std::move(expr), line, column);
 }
 
 ASTNodePtr Parser::parseFor() {
@@ -1077,7 +1360,7 @@ ASTNodePtr Parser::parseFor() {
         consume(TokenType::RIGHT_PAREN, "Expected ')' after for range");
         ASTNodePtr body = parseStatement();
         // Represent range-for as a ForStmt with cond/post unused and init holding the decl
-        return std::make_unique<ForStmt>(std::move(init), nullptr, std::move(rangeExpr), std::move(body), tk.line, tk.column);
+        return makeNode<ForStmt>(std::move(init), nullptr, std::move(rangeExpr), std::move(body), tk.line, tk.column);
     }
 
     ASTNodePtr cond = nullptr;
@@ -1095,7 +1378,7 @@ ASTNodePtr Parser::parseFor() {
     consume(TokenType::RIGHT_PAREN, "Expected ')' after for clauses");
 
     ASTNodePtr body = parseStatement();
-    return std::make_unique<ForStmt>(std::move(init), std::move(cond), std::move(post), std::move(body), tk.line, tk.column);
+    return makeNode<ForStmt>(std::move(init), std::move(cond), std::move(post), std::move(body), tk.line, tk.column);
 }
 
 ASTNodePtr Parser::parseIf() {
@@ -1105,11 +1388,11 @@ ASTNodePtr Parser::parseIf() {
     consume(TokenType::RIGHT_PAREN, "Expected ')' after if condition");
     ASTNodePtr thenBranch = parseStatement();
     ASTNodePtr elseBranch = nullptr;
-    if (check(TokenType::KEYWORD) && peek().value == "else") {
+    if (check(TokenType::KEYWORD) && peek().kind == TokenKind::KW_ELSE) {
         advance();
         elseBranch = parseStatement();
     }
-    return std::make_unique<IfStmt>(std::move(cond), std::move(thenBranch), std::move(elseBranch), tk.line, tk.column);
+    return makeNode<IfStmt>(std::move(cond), std::move(thenBranch), std::move(elseBranch), tk.line, tk.column);
 }
 
 ASTNodePtr Parser::parseWhile() {
@@ -1118,7 +1401,7 @@ ASTNodePtr Parser::parseWhile() {
     ASTNodePtr cond = parseExpression();
     consume(TokenType::RIGHT_PAREN, "Expected ')' after while condition");
     ASTNodePtr body = parseStatement();
-    return std::make_unique<WhileStmt>(std::move(cond), std::move(body), tk.line, tk.column);
+    return makeNode<WhileStmt>(std::move(cond), std::move(body), tk.line, tk.column);
 }
 
 ASTNodePtr Parser::parseReturn() {
@@ -1128,7 +1411,7 @@ ASTNodePtr Parser::parseReturn() {
         expr = parseExpression();
     }
     consume(TokenType::SEMICOLON, "Expected ';' after return");
-    return std::make_unique<ReturnStmt>(std::move(expr), tk.line, tk.column);
+    return makeNode<ReturnStmt>(std::move(expr), tk.line, tk.column);
 }
 
 ASTNodePtr Parser::parseThrow() {
@@ -1138,134 +1421,127 @@ ASTNodePtr Parser::parseThrow() {
         expr = parseExpression();
     }
     consume(TokenType::SEMICOLON, "Expected ';' after throw");
-    // Represent throw as an ExprStmt with the exception expression
-    return std::make_unique<ExprStmt>(std::move(expr), tk.line, tk.column);
-}
-
-// Expression parsing
-// Expression parsing - NEW OPERATOR PRECEDENCE
-ASTNodePtr Parser::parseExpression() {
-    return parseAssignment();
-}
-
-ASTNodePtr Parser::parseAssignment() {
-    ASTNodePtr left = parseConditional();  // use conditional at assignment rhs
-    if (check(TokenType::OPERATOR) && peek().value == "=") {
-        Token op = peek(); advance();
-        ASTNodePtr right = parseAssignment();
-        return std::make_unique<BinaryOp>(op.value, std::move(left), std::move(right), op.line, op.column);
-    }
-    return left;
-}
-
-// Conditional (ternary) operator ?:
-ASTNodePtr Parser::parseConditional() {
-    ASTNodePtr cond = parseLogicalOr();
-    if (check(TokenType::OPERATOR) && peek().value == "?") {
-        Token q = peek(); advance();
-        ASTNodePtr thenExpr = parseExpression();
-        consume(TokenType::COLON, "Expected ':' in conditional expression");
-        ASTNodePtr elseExpr = parseExpression();
-        return std::make_unique<BinaryOp>("?:", std::move(thenExpr), std::move(elseExpr), q.line, q.column);
-    }
-    return cond;
-}
-
-// NEW: Add shift operators (<<, >>)
-ASTNodePtr Parser::parseShift() {
-    ASTNodePtr node = parseAdditive();
-    while ((check(TokenType::LEFT_SHIFT) || check(TokenType::RIGHT_SHIFT)) ||
-           (check(TokenType::OPERATOR) && (peek().value == "<<" || peek().value == ">>"))) {
-        Token op = peek(); advance();
-        ASTNodePtr right = parseAdditive();
-        node = std::make_unique<BinaryOp>(op.value, std::move(node), std::move(right), op.line, op.column);
-    }
-    return node;
-}
-// NEW: Additive operators (+, -)
-ASTNodePtr Parser::parseAdditive() {
-    ASTNodePtr node = parseMultiplicative();
-    while (check(TokenType::OPERATOR) && (peek().value == "+" || peek().value == "-")) {
-        Token op = peek(); advance();
-        ASTNodePtr right = parseMultiplicative();
-        node = std::make_unique<BinaryOp>(op.value, std::move(node), std::move(right), op.line, op.column);
-    }
-    return node;
-}
-
-// NEW: Multiplicative operators (*, /, %)
-ASTNodePtr Parser::parseMultiplicative() {
-    ASTNodePtr node = parseUnary();
-    while (check(TokenType::OPERATOR) && (peek().value == "*" || peek().value == "/" || peek().value == "%")) {
-        Token op = peek(); advance();
-        ASTNodePtr right = parseUnary();
-        node = std::make_unique<BinaryOp>(op.value, std::move(node), std::move(right), op.line, op.column);
-    }
-    return node;
+    return makeNode<ThrowStmt>(std::move(expr), tk.line, tk.column);
 }
 
-// Keep your existing parseUnary() method as is
+ASTNodePtr Parser::parseTry() {
+    Token tk = peek(); advance(); // consume 'try'
+    if (!check(TokenType::LEFT_BRACE)) error(peek(), "Expected '{' after try");
+    auto tryStmt = makeNode<TryStmt>(parseBlock(), tk.line, tk.column);
 
-ASTNodePtr Parser::parseLogicalOr() {
-    ASTNodePtr node = parseLogicalAnd();
-    while (check(TokenType::OPERATOR) && peek().value == "||") {
-        Token op = peek(); advance();
-        ASTNodePtr right = parseLogicalAnd();
-        node = std::make_unique<BinaryOp>(op.value, std::move(node), std::move(right), op.line, op.column);
-    }
-    return node;
-}
+    if (!(check(TokenType::KEYWORD) && peek().kind == TokenKind::KW_CATCH))
+        error(peek(), "Expected 'catch' after try block");
+    while (check(TokenType::KEYWORD) && peek().kind == TokenKind::KW_CATCH) {
+        advance(); // consume 'catch'
+        consume(TokenType::LEFT_PAREN, "Expected '(' after catch");
+        CatchClause clause;
+        if (check(TokenType::ELLIPSIS)) {
+            advance();
+        } else if (check(TokenType::DOT)) {
+            // '...' can also arrive as three DOT tokens
+            while (check(TokenType::DOT)) advance();
+        } else {
+            clause.typeTokens = typeTokens(parseType());
+            if (check(TokenType::IDENTIFIER)) {
+                clause.varName = peek().value;
+                advance();
+            }
+        }
+        consume(TokenType::RIGHT_PAREN, "Expected ')' after catch parameter");
+        if (!check(TokenType::LEFT_BRACE)) error(peek(), "Expected '{' after catch(...)");
+        clause.body = parseBlock();
+        tryStmt->handlers.push_back(std::move(clause));
+    }
+    return tryStmt;
+}
+
+// Expression parsing: precedence climbing over a binding-power table. A leaf
+// costs parseExpression -> parseBinary -> parseUnary -> parseCallAndPrimary,
+// and a chain of left-associative operators is a loop, not a recursion.
+namespace {
+
+// Binding power of each infix operator, weakest first
+enum Precedence : uint8_t {
+    PREC_NONE,            // Not an infix operator
+    PREC_ASSIGNMENT,      // =  (right-associative)
+    PREC_CONDITIONAL,     // ?:
+    PREC_LOGICAL_OR,      // ||
+    PREC_LOGICAL_AND,     // &&
+    PREC_EQUALITY,        // == !=
+    PREC_COMPARISON,      // < > <= >=
+    PREC_SHIFT,           // << >>
+    PREC_ADDITIVE,        // + -
+    PREC_MULTIPLICATIVE   // * / %
+};
+
+struct PrecedenceTable {
+    Precedence levels[256] = {};
+};
+
+constexpr PrecedenceTable buildPrecedenceTable() {
+    PrecedenceTable table{};
+    auto set = [&table](TokenKind kind, Precedence level) { table.levels[static_cast<uint8_t>(kind)] = level; };
+    set(TokenKind::ASSIGN, PREC_ASSIGNMENT);
+    set(TokenKind::QUESTION, PREC_CONDITIONAL);
+    set(TokenKind::OR_OR, PREC_LOGICAL_OR);
+    set(TokenKind::AND_AND, PREC_LOGICAL_AND);
+    set(TokenKind::EQUAL, PREC_EQUALITY);
+    set(TokenKind::NOT_EQUAL, PREC_EQUALITY);
+    set(TokenKind::LESS, PREC_COMPARISON);
+    set(TokenKind::GREATER, PREC_COMPARISON);
+    set(TokenKind::LESS_EQUAL, PREC_COMPARISON);
+    set(TokenKind::GREATER_EQUAL, PREC_COMPARISON);
+    set(TokenKind::SHL, PREC_SHIFT);
+    set(TokenKind::SHR, PREC_SHIFT);
+    set(TokenKind::PLUS, PREC_ADDITIVE);
+    set(TokenKind::MINUS, PREC_ADDITIVE);
+    set(TokenKind::STAR, PREC_MULTIPLICATIVE);
+    set(TokenKind::SLASH, PREC_MULTIPLICATIVE);
+    set(TokenKind::PERCENT, PREC_MULTIPLICATIVE);
+    return table;
+}
+
+constexpr PrecedenceTable kInfixPrecedence = buildPrecedenceTable();
+
+} // namespace
 
-ASTNodePtr Parser::parseLogicalAnd() {
-    ASTNodePtr node = parseEquality();
-    while (check(TokenType::OPERATOR) && peek().value == "&&") {
-        Token op = peek(); advance();
-        ASTNodePtr right = parseEquality();
-        node = std::make_unique<BinaryOp>(op.value, std::move(node), std::move(right), op.line, op.column);
-    }
-    return node;
+ASTNodePtr Parser::parseExpression() {
+    return parseBinary(PREC_ASSIGNMENT);
 }
 
-ASTNodePtr Parser::parseEquality() {
-    ASTNodePtr node = parseComparison();
-    while (check(TokenType::OPERATOR) && (peek().value == "==" || peek().value == "!=")) {
+// Operators binding at least as tightly as `minPrecedence`, over unary operands
+ASTNodePtr Parser::parseBinary(int minPrecedence) {
+    ASTNodePtr left = parseUnary();
+    while (true) {
+        Precedence precedence = kInfixPrecedence.levels[static_cast<uint8_t>(peek().kind)];
+        if (precedence == PREC_NONE || precedence < minPrecedence) break;
         Token op = peek(); advance();
-        ASTNodePtr right = parseComparison();
-        node = std::make_unique<BinaryOp>(op.value, std::move(node), std::move(right), op.line, op.column);
-    }
-    return node;
-}
 
-ASTNodePtr Parser::parseComparison() {
-    ASTNodePtr node = parseShift();  // CHANGED: from parseTerm() to parseShift()
-    while (true) {
-        if (check(TokenType::LESS) || check(TokenType::GREATER) ||
-            check(TokenType::LESS_EQUAL) || check(TokenType::GREATER_EQUAL)) {
-            Token op = peek(); advance();
-            ASTNodePtr right = parseShift();  // CHANGED: from parseTerm() to parseShift()
-            node = std::make_unique<BinaryOp>(op.value, std::move(node), std::move(right), op.line, op.column);
-        } else if (check(TokenType::OPERATOR) && (peek().value == "<" || peek().value == ">" ||
-                   peek().value == "<=" || peek().value == ">=")) {
-            Token op = peek(); advance();
-            ASTNodePtr right = parseShift();  // CHANGED: from parseTerm() to parseShift()
-            node = std::make_unique<BinaryOp>(op.value, std::move(node), std::move(right), op.line, op.column);
-        } else {
-            break;
+        // Conditional operator: both branches are full expressions
+        if (precedence == PREC_CONDITIONAL) {
+            ASTNodePtr thenExpr = parseExpression();
+            consume(TokenType::COLON, "Expected ':' in conditional expression");
+            ASTNodePtr elseExpr = parseExpression();
+            left = makeNode<BinaryOp>("?:", std::move(thenExpr), std::move(elseExpr), op.line, op.column);
+            continue;
         }
+
+        // The right operand takes tighter operators only, except after '='
+        int rightPrecedence = (precedence == PREC_ASSIGNMENT) ? precedence : precedence + 1;
+        ASTNodePtr right = parseBinary(rightPrecedence);
+        left = makeNode<BinaryOp>(op.text(), std::move(left), std::move(right), op.line, op.column);
     }
-    return node;
+    return left;
 }
 
-
-
 ASTNodePtr Parser::parseUnary() {
     // Handle 'new' operator
-    if (check(TokenType::KEYWORD) && peek().value == "new") {
+    if (check(TokenType::KEYWORD) && peek().kind == TokenKind::KW_NEW) {
         Token op = peek(); advance();
         
         // Skip type specifier (int, float, etc.)
         if (check(TokenType::TYPE_SPECIFIER)) {
-            std::string type_name = peek().value;
+            std::string type_name = peek().text();
             advance();
             
             // Check for array allocation: new int[size]
@@ -1278,43 +1554,43 @@ ASTNodePtr Parser::parseUnary() {
                 advance(); // consume ']'
                 
                 // Create array subscript node for new operator
-                auto dummy_array = std::make_unique<Identifier>(type_name, op.line, op.column);
-                return std::make_unique<UnaryOp>("new", 
-                    std::make_unique<ArraySubscript>(std::move(dummy_array), std::move(size_expr), op.line, op.column),
+                auto dummy_array = makeNode<Identifier>(type_name, op.line, op.column);
+                return makeNode<UnaryOp>("new", 
+                    makeNode<ArraySubscript>(std::move(dummy_array), std::move(size_expr), op.line, op.column),
                     op.line, op.column);
             }
             
             // Single allocation: new int
-            return std::make_unique<UnaryOp>("new", 
-                std::make_unique<Identifier>(type_name, op.line, op.column),
+            return makeNode<UnaryOp>("new", 
+                makeNode<Identifier>(type_name, op.line, op.column),
                 op.line, op.column);
         }
         
         // Fallback to expression
         ASTNodePtr operand = parseUnary();
-        return std::make_unique<UnaryOp>("new", std::move(operand), op.line, op.column);
+        return makeNode<UnaryOp>("new", std::move(operand), op.line, op.column);
     }
     
     // Handle 'delete' operator
-    if (check(TokenType::KEYWORD) && peek().value == "delete") {
+    if (check(TokenType::KEYWORD) && peek().kind == TokenKind::KW_DELETE) {
         Token op = peek(); advance();
         ASTNodePtr operand = parseUnary();
-        return std::make_unique<UnaryOp>("delete", std::move(operand), op.line, op.column);
+        return makeNode<UnaryOp>("delete", std::move(operand), op.line, op.column);
     }
     
-    if (check(TokenType::OPERATOR) && (peek().value == "!" || peek().value == "-" ||
-                                       peek().value == "+" || peek().value == "*" ||
-                                       peek().value == "&" || peek().value == "~")) {
+    if (check(TokenType::OPERATOR) && (peek().kind == TokenKind::NOT || peek().kind == TokenKind::MINUS ||
+                                       peek().kind == TokenKind::PLUS || peek().kind == TokenKind::STAR ||
+                                       peek().kind == TokenKind::AMP || peek().kind == TokenKind::TILDE)) {
         Token op = peek(); advance();
         ASTNodePtr operand = parseUnary();
-        return std::make_unique<UnaryOp>(op.value, std::move(operand), op.line, op.column);
+        return makeNode<UnaryOp>(op.text(), std::move(operand), op.line, op.column);
     }
     return parseCallAndPrimary();
 }
 
 // FIXED: parseCallAndPrimary with ARROW, DOT tokens and array subscript support
 ASTNodePtr Parser::parseCallAndPrimary() {
-    const Token &t = peek();
+    Token t = peek();
 
     // Lambda primary: start with '['
     if (t.type == TokenType::LEFT_BRACKET) {
@@ -1330,20 +1606,24 @@ ASTNodePtr Parser::parseCallAndPrimary() {
                 advance();
             }
         }
-        return std::make_unique<Literal>("<lambda>", lb.line, lb.column, TokenType::LEFT_BRACE);
+        return makeNode<Literal>("<lambda>", lb.line, lb.column, TokenType::LEFT_BRACE);
     }
 
     // Literals
     if (t.type == TokenType::NUMBER || t.type == TokenType::STRING || t.type == TokenType::CHARACTER) {
         TokenType litType = t.type;
         advance();
-        return std::make_unique<Literal>(t.value, t.line, t.column, litType);
+        return makeNode<Literal>(t.text(), t.line, t.column, litType);
     }
 
     // Identifiers
     if (t.type == TokenType::IDENTIFIER) {
         advance();
-        ASTNodePtr left = std::make_unique<Identifier>(t.value, t.line, t.column);
+        ASTNodePtr left = makeNode<Identifier>(t.text(), t.line, t.column);
+        std::vector<std::vector<std::string>> templateArgs;
+        if (isTemplateArgumentList(idx)) {
+            templateArgs = parseTemplateArguments();
+        }
 
         // Handle postfix operators: ->, ., [], (), lambdas
         while (true) {
@@ -1353,7 +1633,7 @@ ASTNodePtr Parser::parseCallAndPrimary() {
                 if (!check(TokenType::IDENTIFIER))
                     error(peek(), "Expected member name after '->'");
                 Token mem = peek(); advance();
-                left = std::make_unique<MemberAccess>(std::move(left), mem.value, true, op.line, op.column);
+                left = makeNode<MemberAccess>(std::move(left), mem.text(), true, op.line, op.column);
                 continue;
             }
             // Dot operator: .
@@ -1362,7 +1642,7 @@ ASTNodePtr Parser::parseCallAndPrimary() {
                 if (!check(TokenType::IDENTIFIER))
                     error(peek(), "Expected member name after '.'");
                 Token mem = peek(); advance();
-                left = std::make_unique<MemberAccess>(std::move(left), mem.value, false, op.line, op.column);
+                left = makeNode<MemberAccess>(std::move(left), mem.text(), false, op.line, op.column);
                 continue;
             }
             // Array subscript: []
@@ -1370,7 +1650,7 @@ ASTNodePtr Parser::parseCallAndPrimary() {
                 Token bracket = peek(); advance();
                 ASTNodePtr index = parseExpression();
                 consume(TokenType::RIGHT_BRACKET, "Expected ']' after array index");
-                left = std::make_unique<ArraySubscript>(std::move(left), std::move(index), bracket.line, bracket.column);
+                left = makeNode<ArraySubscript>(std::move(left), std::move(index), bracket.line, bracket.column);
                 continue;
             }
             // Function call: ()
@@ -1383,7 +1663,10 @@ ASTNodePtr Parser::parseCallAndPrimary() {
                     } while (match({TokenType::COMMA}));
                 }
                 consume(TokenType::RIGHT_PAREN, "Expected ')' after function call arguments");
-                left = std::make_unique<CallExpr>(std::move(left), std::move(args), open.line, open.column);
+                auto callExpr = makeNode<CallExpr>(std::move(left), std::move(args), open.line, open.column);
+                callExpr->templateArgs = std::move(templateArgs);
+                templateArgs.clear();
+                left = std::move(callExpr);
                 continue;
             }
             // Lambda literal: []() { ... }
@@ -1397,7 +1680,7 @@ ASTNodePtr Parser::parseCallAndPrimary() {
                     while (!check(TokenType::LEFT_BRACE) && !isAtEnd()) advance();
                 }
                 if (check(TokenType::LEFT_BRACE)) {
-                    Token ob = peek(); advance();
+                    advance(); // consume '{'
                     std::string contents;
                     int depth = 1;
                     while (!isAtEnd() && depth > 0) {
@@ -1406,15 +1689,15 @@ ASTNodePtr Parser::parseCallAndPrimary() {
                         contents += peek().value;
                         advance();
                     }
-                    left = std::make_unique<Literal>("<lambda>", lb.line, lb.column, TokenType::LEFT_BRACE);
+                    left = makeNode<Literal>("<lambda>", lb.line, lb.column, TokenType::LEFT_BRACE);
                     continue;
                 }
             }
             // Postfix increment/decrement: ++ --
-            else if (check(TokenType::OPERATOR) && (peek().value == "++" || peek().value == "--")) {
+            else if (check(TokenType::OPERATOR) && (peek().kind == TokenKind::INCREMENT || peek().kind == TokenKind::DECREMENT)) {
                 Token op = peek(); advance();
                 // Represent postfix as UnaryOp with '_post' suffix
-                left = std::make_unique<UnaryOp>(op.value + "_post", std::move(left), op.line, op.column);
+                left = makeNode<UnaryOp>(op.text() + "_post", std::move(left), op.line, op.column);
                 continue;
             }
             // Scope resolution: ::
@@ -1425,8 +1708,8 @@ ASTNodePtr Parser::parseCallAndPrimary() {
                 if (check(TokenType::IDENTIFIER)) {
                     Token nextId = peek(); advance();
                     // For simplicity, create a new identifier with qualified name
-                    std::string qualifiedName = dynamic_cast<Identifier*>(left.get())->name + "::" + nextId.value;
-                    left = std::make_unique<Identifier>(qualifiedName, nextId.line, nextId.column);
+                    std::string qualifiedName = dynamic_cast<Identifier*>(left.get())->name + "::" + nextId.text();
+                    left = makeNode<Identifier>(qualifiedName, nextId.line, nextId.column);
                     continue;
                 }
             }
@@ -1440,7 +1723,7 @@ ASTNodePtr Parser::parseCallAndPrimary() {
 
     // Parenthesized expressions
     if (check(TokenType::LEFT_PAREN)) {
-        Token open = peek(); advance();
+        advance(); // consume '('
         ASTNodePtr expr = parseExpression();
         consume(TokenType::RIGHT_PAREN, "Expected ')' after expression");
         return expr;
@@ -2,14 +2,26 @@
 #define DS_PROJECT_GREY0NE_DEV_PARSER_H
 
 #include "lexer.h"
+#include "interner.h"
+#include "arena.h"
+#include <functional>
 #include <memory>
+#include <new>
 #include <vector>
 #include <string>
 #include <iostream>
+#include <deque>
+#include <unordered_map>
 
 // Forward declarations
 struct ASTNode;
-using ASTNodePtr = std::unique_ptr<ASTNode>;
+
+// Nodes are allocated in the global arena (arena.h) by makeNode. Dropping one
+// runs its destructor; its memory is reclaimed with the arena.
+struct ASTNodeDeleter {
+    void operator()(ASTNode* node) const;
+};
+using ASTNodePtr = std::unique_ptr<ASTNode, ASTNodeDeleter>;
 
 enum class ASTNodeKind {
     PROGRAM,
@@ -17,6 +29,8 @@ enum class ASTNodeKind {
     VAR_DECL,
     FUNC_DECL,
     RETURN,
+    TRY,
+    THROW,
     IF,
     WHILE,
     FOR,
@@ -54,6 +68,16 @@ struct ASTNode {
     virtual void dump(int indent = 0) const = 0;
 };
 
+inline void ASTNodeDeleter::operator()(ASTNode* node) const {
+    node->~ASTNode();
+}
+
+template <typename T, typename... Args>
+std::unique_ptr<T, ASTNodeDeleter> makeNode(Args&&... args) {
+    void* memory = Arena::global().allocate(sizeof(T), alignof(T));
+    return std::unique_ptr<T, ASTNodeDeleter>(new (memory) T(std::forward<Args>(args)...));
+}
+
 // Helpers
 std::string indentStr(int n);
 
@@ -82,28 +106,49 @@ struct Literal : Expr {
 // Identifier
 struct Identifier : Expr {
     std::string name;
-    Identifier(const std::string &n, int l, int c) : Expr(ASTNodeKind::IDENTIFIER, l, c), name(n) {}
+    SymbolId symbol;  // `name`, interned
+    Identifier(const std::string &n, int l, int c) : Expr(ASTNodeKind::IDENTIFIER, l, c), name(n), symbol(internSymbol(n)) {}
     void dump(int indent = 0) const override;
 };
 
+// Operator of a UnaryOp or BinaryOp. The spelling stays in `op` for dumps;
+// code generation and folding switch on the kind.
+enum class OpKind : uint8_t {
+    UNKNOWN,
+    ASSIGN,         // =
+    CONDITIONAL,    // ?: (then/else in left/right)
+    PLUS, MINUS, STAR, SLASH, PERCENT,
+    LESS, GREATER, LESS_EQUAL, GREATER_EQUAL, EQUAL, NOT_EQUAL,
+    AND_AND, OR_OR,
+    SHL, SHR,       // Also stream insertion/extraction
+    NOT, TILDE, AMP,
+    INCREMENT, DECREMENT, POST_INCREMENT, POST_DECREMENT,
+    NEW, DELETE
+};
+
+OpKind opKindFromText(std::string_view op);
+
 struct UnaryOp : Expr {
     std::string op;
+    OpKind opKind;
     ASTNodePtr operand;
-    UnaryOp(const std::string &o, ASTNodePtr opd, int l, int c) : Expr(ASTNodeKind::UNARY_OP, l, c), op(o), operand(std::move(opd)) {}
+    UnaryOp(const std::string &o, ASTNodePtr opd, int l, int c) : Expr(ASTNodeKind::UNARY_OP, l, c), op(o), opKind(opKindFromText(o)), operand(std::move(opd)) {}
     void dump(int indent = 0) const override;
 };
 
 struct BinaryOp : Expr {
     std::string op;
+    OpKind opKind;
     ASTNodePtr left;
     ASTNodePtr right;
-    BinaryOp(const std::string &o, ASTNodePtr lft, ASTNodePtr rgt, int ln, int col) : Expr(ASTNodeKind::BINARY_OP, ln, col), op(o), left(std::move(lft)), right(std::move(rgt)) {}
+    BinaryOp(const std::string &o, ASTNodePtr lft, ASTNodePtr rgt, int ln, int col) : Expr(ASTNodeKind::BINARY_OP, ln, col), op(o), opKind(opKindFromText(o)), left(std::move(lft)), right(std::move(rgt)) {}
     void dump(int indent = 0) const override;
 };
 
 struct CallExpr : Expr {
     ASTNodePtr callee;
     std::vector<ASTNodePtr> args;
+    std::vector<std::vector<std::string>> templateArgs; // explicit f<T, 3>(...) arguments (type tokens or a number)
     CallExpr(ASTNodePtr cal, std::vector<ASTNodePtr> a, int l, int c) : Expr(ASTNodeKind::CALL, l, c), callee(std::move(cal)), args(std::move(a)) {}
     void dump(int indent = 0) const override;
 };
@@ -139,6 +184,7 @@ struct VarDecl : Statement {
     bool isPointer;  // NEW: track if it's a pointer
     bool isReference; // NEW: track if it's a reference
     bool isArray;    // NEW: track if it's an array declaration
+    ASTNodePtr arraySize; // optional: size expression of an array declarator
     VarDecl(std::vector<std::string> t, std::string n, ASTNodePtr i, int l, int c)
         : Statement(ASTNodeKind::VAR_DECL, l, c), typeTokens(std::move(t)), varName(std::move(n)),
           init(std::move(i)), isPointer(false), isReference(false), isArray(false) {}
@@ -181,6 +227,25 @@ struct ReturnStmt : Statement {
     void dump(int indent = 0) const override;
 };
 
+struct CatchClause {
+    std::vector<std::string> typeTokens; // empty for catch (...)
+    std::string varName;                 // optional
+    ASTNodePtr body;
+};
+
+struct TryStmt : Statement {
+    ASTNodePtr body;
+    std::vector<CatchClause> handlers;
+    TryStmt(ASTNodePtr b, int l, int c) : Statement(ASTNodeKind::TRY, l, c), body(std::move(b)) {}
+    void dump(int indent = 0) const override;
+};
+
+struct ThrowStmt : Statement {
+    ASTNodePtr expr; // optional: `throw;` rethrows the exception being handled
+    ThrowStmt(ASTNodePtr e, int l, int c) : Statement(ASTNodeKind::THROW, l, c), expr(std::move(e)) {}
+    void dump(int indent = 0) const override;
+};
+
 // C++ specific nodes
 struct ClassDecl : Declaration {
     std::string className;
@@ -237,6 +302,8 @@ struct FunctionDecl : Declaration {
     ASTNodePtr body;
     bool isVirtual;
     bool isConst;  // NEW: for const member functions
+    size_t tokenBegin = 0;  // Source tokens [tokenBegin, tokenEnd), keys the compilation cache
+    size_t tokenEnd = 0;
     FunctionDecl(const std::vector<std::string>& ret, const std::string& name,
                  std::vector<std::pair<std::vector<std::string>, std::string>> p, ASTNodePtr b, int l, int c)
         : Declaration(ASTNodeKind::FUNC_DECL, l, c), returnTypeTokens(ret), funcName(name),
@@ -244,22 +311,88 @@ struct FunctionDecl : Declaration {
     void dump(int indent = 0) const override;
 };
 
+// Apply fn to every child slot of node; the walk the AST passes share
+void visitChildren(ASTNode* node, const std::function<void(ASTNodePtr&)>& fn);
+void visitChildren(const ASTNode* node, const std::function<void(const ASTNode*)>& fn);
+
 struct Program {
     std::vector<ASTNodePtr> top;
     void dump() const;
+    // Lets go of the tree without destroying it, for a compiler about to exit:
+    // the nodes go with the arena and what they own with the process
+    void abandon();
+};
+
+// Types as parseType spells them (storage classes, qualifiers, the base type
+// with its scope and template arguments, then * and &), each distinct
+// spelling stored once and named by a dense TypeId. Id 0 is the empty type.
+using TypeId = uint32_t;
+const TypeId kNoType = 0;
+
+class TypeTable {
+public:
+    TypeTable() { intern(""); }
+    // `key` is the type's tokens, each followed by '\0'
+    TypeId intern(const std::string& key);
+    const std::vector<std::string>& tokens(TypeId id) const { return types[id]; }
+
+private:
+    std::deque<std::vector<std::string>> types;  // By id
+    std::unordered_map<std::string, TypeId> ids;
 };
 
 // Parser
+// Tokens a stream keeps behind the statement being parsed, for previous()
+// and the context printed with parse errors
+const size_t kParserBacktrack = 16;
+
 class Parser {
 public:
     Parser(const std::vector<Token>& tokens);
+    Parser(TokenStream& stream);  // Pulls tokens on demand (goc --stream)
     Program parseProgram();
 
+    // Only brace-match the bodies of top-level functions, then parse those
+    // reachable from main and leave the others out of the program (goc
+    // --lazy-parse). Needs every token at hand, so a stream ignores it.
+    void setLazyBodies(bool lazy) { lazy_bodies = lazy && !stream; }
+    size_t skippedFunctions() const { return skipped_functions; }
+
 private:
-    const std::vector<Token>& tokens;
+    const std::vector<Token>* tokens;  // Exactly one of tokens and stream is set
+    TokenStream* stream;
     size_t idx;
     std::string currentClassName; // for constructor parsing
 
+    // Lazy bodies: top-level functions whose body was skipped, with the index
+    // of its '{'. Only a function starting at declaration_start, the first
+    // token of the current top-level declaration, has its body skipped.
+    bool lazy_bodies = false;
+    size_t declaration_start = 0;
+    std::vector<std::pair<FunctionDecl*, size_t>> deferred_bodies;
+    size_t skipped_functions = 0;
+    void skipBlock();
+    void parseReachableBodies(Program& program);
+
+    // Types scanned at a token index, so the declaration lookahead and the
+    // parse that follows it scan each type once. Only recent positions are
+    // kept: the list is cleared at statement boundaries, which the parser
+    // never backs over, and when it fills up.
+    struct TypeSpan {
+        size_t begin;
+        size_t lookaheadEnd;       // After the lookahead grammar's type
+        bool parsed = false;       // end and type below are filled
+        size_t end = 0;            // After parseType's type
+        TypeId type = kNoType;
+    };
+    static const size_t kTypeSpanLimit = 32;
+    TypeTable types;
+    mutable std::vector<TypeSpan> type_spans;  // Most recent last
+    TypeSpan& typeSpanAt(size_t pos) const;
+
+    const Token& tokenAt(size_t i) const;
+    bool hasToken(size_t i) const;
+    void releaseTokens();
     const Token& peek() const;
     const Token& previous() const;
     const Token& advance();
@@ -271,8 +404,10 @@ private:
     bool isTypeSpecifier() const;
     bool isTypeQualifier() const;
     bool isStorageClass() const;
-    std::vector<std::string> parseType();  // NEW: parse complex types
-    std::vector<std::string> parseTypeForLookahead(size_t &pos) const;
+    TypeId parseType();  // NEW: parse complex types
+    TypeId scanType(size_t pos, size_t& end);
+    bool parseTypeForLookahead(size_t &pos) const;  // False if no type tokens at pos
+    const std::vector<std::string>& typeTokens(TypeId type) const { return types.tokens(type); }
 
     // Parsing primitives
     ASTNodePtr parseStatement();
@@ -285,6 +420,7 @@ private:
     ASTNodePtr parseFor();
     ASTNodePtr parseReturn();
     ASTNodePtr parseThrow();
+    ASTNodePtr parseTry();
 
     // C++ specific parsing
     ASTNodePtr parseClass();
@@ -298,23 +434,14 @@ private:
     ASTNodePtr parseClassMember();
 
     ASTNodePtr parseExpression();
-    ASTNodePtr parseAssignment();
-    ASTNodePtr parseConditional();
-    ASTNodePtr parseLogicalOr();
-    ASTNodePtr parseLogicalAnd();
-    ASTNodePtr parseEquality();
-    ASTNodePtr parseComparison();
-    ASTNodePtr parseTerm();
-    ASTNodePtr parseFactor();
+    ASTNodePtr parseBinary(int minPrecedence);
     ASTNodePtr parseUnary();
     ASTNodePtr parseCallAndPrimary();
 
-    ASTNodePtr parseShift();
-    ASTNodePtr parseAdditive();
-    ASTNodePtr parseMultiplicative();
-
     std::vector<std::pair<std::vector<std::string>, std::string>> parseFunctionParams();  // CHANGED signature
     std::vector<std::string> parseTemplateParams();
+    bool isTemplateArgumentList(size_t pos) const;
+    std::vector<std::vector<std::string>> parseTemplateArguments();
 
     bool isAtEnd() const;
     void error(const Token& tok, const std::string& message) const;
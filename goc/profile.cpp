@@ -0,0 +1,90 @@
+#include "profile.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+static const size_t kSiteRecordSize = 13;  // u32 offset, u8 kind, i32 line, i32 column
+
+std::vector<uint8_t> encodeProfileSites(const std::vector<ProfileSite>& sites) {
+    std::vector<uint8_t> payload(sizeof(uint32_t) + sites.size() * kSiteRecordSize);
+    uint32_t count = sites.size();
+    std::memcpy(payload.data(), &count, sizeof(count));
+    uint8_t* p = payload.data() + sizeof(count);
+    for (const auto& site : sites) {
+        std::memcpy(p, &site.offset, 4);
+        p[4] = static_cast<uint8_t>(site.kind);
+        std::memcpy(p + 5, &site.line, 4);
+        std::memcpy(p + 9, &site.column, 4);
+        p += kSiteRecordSize;
+    }
+    return payload;
+}
+
+bool parseProfileSites(const std::vector<uint8_t>& payload, std::vector<ProfileSite>& sites) {
+    uint32_t count = 0;
+    if (payload.size() < sizeof(count)) return false;
+    std::memcpy(&count, payload.data(), sizeof(count));
+    if (payload.size() != sizeof(count) + static_cast<size_t>(count) * kSiteRecordSize) return false;
+
+    sites.clear();
+    const uint8_t* p = payload.data() + sizeof(count);
+    for (uint32_t i = 0; i < count; i++, p += kSiteRecordSize) {
+        ProfileSite site;
+        std::memcpy(&site.offset, p, 4);
+        site.kind = static_cast<ProfileSiteKind>(p[4]);
+        std::memcpy(&site.line, p + 5, 4);
+        std::memcpy(&site.column, p + 9, 4);
+        if (site.kind > ProfileSiteKind::LOOP) return false;
+        sites.push_back(site);
+    }
+    return true;
+}
+
+static const char* kindName(ProfileSiteKind kind) {
+    switch (kind) {
+        case ProfileSiteKind::FUNCTION: return "function";
+        case ProfileSiteKind::BRANCH: return "branch";
+        case ProfileSiteKind::LOOP: return "loop";
+    }
+    return "unknown";
+}
+
+bool saveProfile(const std::string& filename, const ProfileData& data, const std::vector<std::string>& notes) {
+    std::ofstream file(filename);
+    if (!file) return false;
+    file << "# GOC profile v1\n";
+    for (const auto& note : notes) file << "# " << note << "\n";
+    for (const auto& [key, counts] : data) {
+        file << kindName(key.kind) << " " << key.line << " " << key.column << " " << counts.count;
+        if (key.kind != ProfileSiteKind::FUNCTION) file << " " << counts.false_count;
+        file << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+bool loadProfile(const std::string& filename, ProfileData& data) {
+    std::ifstream file(filename);
+    if (!file) return false;
+    data.clear();
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream in(line);
+        std::string kind;
+        ProfileKey key;
+        ProfileCounts counts;
+        if (!(in >> kind >> key.line >> key.column >> counts.count)) return false;
+        if (kind == "function") {
+            key.kind = ProfileSiteKind::FUNCTION;
+        } else if (kind == "branch" || kind == "loop") {
+            key.kind = (kind == "branch") ? ProfileSiteKind::BRANCH : ProfileSiteKind::LOOP;
+            if (!(in >> counts.false_count)) return false;
+        } else {
+            return false;
+        }
+        ProfileCounts& total = data[key];
+        total.count += counts.count;
+        total.false_count += counts.false_count;
+    }
+    return true;
+}
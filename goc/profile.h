@@ -0,0 +1,64 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Profile-guided optimization data shared by the compiler and the VM.
+//
+// The compiler records a profile site table (bytecode offset -> source position)
+// and stores it in its own section of the .bin file (binfile.h). v1 files carry
+// it as a tagged block after the code:
+//   u32 tag, u32 payload size, payload
+// Readers that do not know a tag skip the block; older readers stop after the code.
+// The VM counts events at those offsets (--profile-out) and writes them keyed by
+// source position, so the profile stays valid when the compiler lays out code
+// differently on the next build (--profile-use).
+
+const uint32_t kProfileSiteTag = 0x54495350;  // "PSIT"
+
+enum class ProfileSiteKind : uint8_t {
+    FUNCTION = 0,  // offset = function entry; counts calls
+    BRANCH   = 1,  // offset = conditional jump of an if
+    LOOP     = 2   // offset = conditional jump of a while/for condition
+};
+
+struct ProfileSite {
+    uint32_t offset;
+    ProfileSiteKind kind;
+    int32_t line;
+    int32_t column;
+};
+
+// FUNCTION: `count` is the number of calls.
+// BRANCH/LOOP: `count` is how often the condition was true, `false_count` false.
+struct ProfileCounts {
+    uint64_t count = 0;
+    uint64_t false_count = 0;
+};
+
+struct ProfileKey {
+    ProfileSiteKind kind;
+    int32_t line;
+    int32_t column;
+    bool operator<(const ProfileKey& other) const {
+        return std::tie(kind, line, column) < std::tie(other.kind, other.line, other.column);
+    }
+};
+
+using ProfileData = std::map<ProfileKey, ProfileCounts>;
+
+// Site table payload (u32 count, then 13-byte records)
+std::vector<uint8_t> encodeProfileSites(const std::vector<ProfileSite>& sites);
+bool parseProfileSites(const std::vector<uint8_t>& payload, std::vector<ProfileSite>& sites);
+
+// Text profile files: one "<kind> <line> <column> <count> [<false_count>]" line per site.
+// `notes` are written as comments after the header.
+bool saveProfile(const std::string& filename, const ProfileData& data,
+                 const std::vector<std::string>& notes = {});
+bool loadProfile(const std::string& filename, ProfileData& data);
+
+#endif // PROFILE_H
@@ -0,0 +1,114 @@
+#include "snapshot.h"
+#include <cstring>
+
+static const size_t kRegisterSize = 64;     // Fixed part of VM_STATE
+static const size_t kMemoryHeaderSize = 16;
+
+static void put32(std::vector<uint8_t>& out, uint32_t value) {
+    uint8_t bytes[4];
+    std::memcpy(bytes, &value, 4);
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+template <typename T>
+static void putArray(std::vector<uint8_t>& out, const std::vector<T>& values) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(values.data());
+    out.insert(out.end(), bytes, bytes + values.size() * sizeof(T));
+}
+
+std::vector<uint8_t> encodeSnapshotState(const SnapshotState& state) {
+    std::vector<uint8_t> payload(kRegisterSize, 0);
+    uint8_t* p = payload.data();
+    std::memcpy(p, &state.instruction_pointer, 4);
+    std::memcpy(p + 4, &state.base_pointer, 4);
+    std::memcpy(p + 8, &state.cmp_flag, 4);
+    std::memcpy(p + 12, &state.fpu_top, 4);
+    std::memcpy(p + 16, state.fpu_regs, 32);
+    std::memcpy(p + 48, &state.heap_start_addr, 4);  // 52..55 reserved
+    std::memcpy(p + 56, &state.instruction_count, 8);
+
+    put32(payload, state.stack.size());
+    putArray(payload, state.stack);
+    put32(payload, state.call_stack.size());
+    for (const auto& frame : state.call_stack) {
+        put32(payload, frame.return_address);
+        put32(payload, frame.base_pointer);
+    }
+    put32(payload, state.heap_blocks.size());
+    for (const auto& block : state.heap_blocks) {
+        put32(payload, block.start);
+        put32(payload, block.size);
+        put32(payload, block.allocated);
+    }
+    return payload;
+}
+
+bool parseSnapshotState(const uint8_t* data, size_t size, SnapshotState& state) {
+    if (size < kRegisterSize) return false;
+    state = SnapshotState();
+    std::memcpy(&state.instruction_pointer, data, 4);
+    std::memcpy(&state.base_pointer, data + 4, 4);
+    std::memcpy(&state.cmp_flag, data + 8, 4);
+    std::memcpy(&state.fpu_top, data + 12, 4);
+    std::memcpy(state.fpu_regs, data + 16, 32);
+    std::memcpy(&state.heap_start_addr, data + 48, 4);
+    std::memcpy(&state.instruction_count, data + 56, 8);
+    if (state.fpu_top < 0 || state.fpu_top >= 8) return false;
+
+    size_t pos = kRegisterSize;
+    auto get32 = [&](uint32_t& value) {
+        if (size - pos < 4) return false;
+        std::memcpy(&value, data + pos, 4);
+        pos += 4;
+        return true;
+    };
+    uint32_t count = 0;
+    if (!get32(count) || count > (size - pos) / 4) return false;
+    state.stack.resize(count);
+    std::memcpy(state.stack.data(), data + pos, count * 4);
+    pos += count * 4;
+
+    if (!get32(count) || count > (size - pos) / 8) return false;
+    state.call_stack.resize(count);
+    for (auto& frame : state.call_stack) {
+        get32(frame.return_address);
+        get32(frame.base_pointer);
+    }
+    if (!get32(count) || count > (size - pos) / 12) return false;
+    state.heap_blocks.resize(count);
+    for (auto& block : state.heap_blocks) {
+        get32(block.start);
+        get32(block.size);
+        get32(block.allocated);
+    }
+    return pos == size;
+}
+
+std::vector<uint8_t> encodeSnapshotMemory(const std::vector<int32_t>& memory, const std::vector<float>& float_memory,
+                                          const std::vector<int32_t>& heap) {
+    std::vector<uint8_t> payload;
+    payload.reserve(kMemoryHeaderSize + (memory.size() + float_memory.size() + heap.size()) * 4);
+    put32(payload, memory.size());
+    put32(payload, float_memory.size());
+    put32(payload, heap.size());
+    put32(payload, 0);
+    putArray(payload, memory);
+    putArray(payload, float_memory);
+    putArray(payload, heap);
+    return payload;
+}
+
+bool parseSnapshotMemory(const uint8_t* data, size_t size, SnapshotMemory& out) {
+    if (size < kMemoryHeaderSize) return false;
+    uint32_t counts[3];
+    std::memcpy(counts, data, sizeof(counts));
+    uint64_t cells = static_cast<uint64_t>(counts[0]) + counts[1] + counts[2];
+    if (cells * 4 != size - kMemoryHeaderSize) return false;
+    out.memory = data + kMemoryHeaderSize;
+    out.memory_cells = counts[0];
+    out.float_memory = out.memory + counts[0] * 4;
+    out.float_cells = counts[1];
+    out.heap = out.float_memory + counts[1] * 4;
+    out.heap_cells = counts[2];
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// VM snapshots for warm starts (vm --snapshot-at, vm --restore).
+//
+// A snapshot is a v2 .bin (binfile.h) with kBinaryFlagSnapshot set. It keeps
+// the program's own sections, with every string the run has created, and adds
+//   VM_STATE   registers, operand stack, call frames, heap blocks and the FPU
+//   VM_MEMORY  u32 static cells, u32 float cells, u32 heap cells, u32 reserved,
+//              then the three arrays of 4-byte cells
+// Restoring maps the file like any program: code and strings are used in
+// place, and each memory array is copied out of the mapping in one block.
+// Memo caches are not saved; they refill as the program runs.
+
+struct SnapshotFrame {
+    uint32_t return_address;
+    uint32_t base_pointer;
+};
+
+struct SnapshotHeapBlock {
+    uint32_t start;
+    uint32_t size;
+    uint32_t allocated;
+};
+
+struct SnapshotState {
+    uint32_t instruction_pointer = 0;
+    uint32_t base_pointer = 0;
+    int32_t cmp_flag = 0;
+    int32_t fpu_top = 0;
+    float fpu_regs[8] = {};
+    uint32_t heap_start_addr = 0;
+    uint64_t instruction_count = 0;
+    std::vector<int32_t> stack;
+    std::vector<SnapshotFrame> call_stack;
+    std::vector<SnapshotHeapBlock> heap_blocks;
+};
+
+// VM_STATE payload: the fixed registers (64 bytes), then u32 count + records
+// for the stack, the call frames and the heap blocks
+std::vector<uint8_t> encodeSnapshotState(const SnapshotState& state);
+bool parseSnapshotState(const uint8_t* data, size_t size, SnapshotState& state);
+
+// VM_MEMORY payload; the parsed arrays point into `data`
+struct SnapshotMemory {
+    const uint8_t* memory = nullptr;
+    size_t memory_cells = 0;
+    const uint8_t* float_memory = nullptr;
+    size_t float_cells = 0;
+    const uint8_t* heap = nullptr;
+    size_t heap_cells = 0;
+};
+
+std::vector<uint8_t> encodeSnapshotMemory(const std::vector<int32_t>& memory, const std::vector<float>& float_memory,
+                                          const std::vector<int32_t>& heap);
+bool parseSnapshotMemory(const uint8_t* data, size_t size, SnapshotMemory& out);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,15 @@
+// First build of cache_template_second.cpp: a() and b() both call twice<int>
+template <typename T>
+T twice(T x) {
+    return x + x;
+}
+int a(int k) {
+    return twice(k) + 1;
+}
+int b(int k) {
+    return twice(k) + 3;
+}
+int main() {
+    print(a(2) + b(3));
+    return 0;
+}
@@ -0,0 +1,16 @@
+// Rebuilt over cache_template_first.cpp: a() no longer calls twice<int>, so
+// a replayed b() must not rely on a() having instantiated it
+template <typename T>
+T twice(T x) {
+    return x + x;
+}
+int a(int k) {
+    return k + 1;
+}
+int b(int k) {
+    return twice(k) + 3;
+}
+int main() {
+    print(a(2) + b(3));
+    return 0;
+}
@@ -0,0 +1,29 @@
+// Float parameters live in static cells: the recursive call must not leave
+// its own x behind for the caller to read after it returns.
+float f(float x, int n) {
+    if (n == 0) {
+        return x;
+    }
+    float r = f(x * 2.0f, n - 1);
+    return r + x;
+}
+
+// The same through mutual recursion
+float g(float y, int n);
+float h(float x, int n) {
+    if (n == 0) {
+        return x;
+    }
+    float r = g(x + 1.0f, n - 1);
+    return r * x;
+}
+float g(float y, int n) {
+    float r = h(y * 2.0f, n);
+    return r + y;
+}
+
+int main() {
+    print(f(1.0f, 3));
+    print(h(1.0f, 2));
+    return 0;
+}
@@ -0,0 +1,10 @@
+// Linked first: its 1000 cells push the other object's array past the static
+// memory its unchecked accesses were proven against
+int big[1000];
+
+int fill(int n) {
+    for (int i = 0; i < 1000; i = i + 1) {
+        big[i] = n;
+    }
+    return big[999];
+}
@@ -0,0 +1,15 @@
+int fill(int n);
+
+int table[100];
+
+int main() {
+    for (int i = 0; i < 100; i = i + 1) {
+        table[i] = i;
+    }
+    int sum = 0;
+    for (int i = 0; i < 100; i = i + 1) {
+        sum = sum + table[i];
+    }
+    print(sum + fill(7));
+    return 0;
+}
@@ -0,0 +1,23 @@
+# Build FIRST with goc into a fresh cache, then SECOND in its place with the
+# same cache, and check that the second program prints EXPECTED.
+#   cmake -DGOC=... -DVM=... -DFIRST=... -DSECOND=... -DWORK=... -DEXPECTED=... -P run_cached_rebuild.cmake
+
+file(REMOVE_RECURSE ${WORK})
+file(MAKE_DIRECTORY ${WORK})
+foreach(source ${FIRST} ${SECOND})
+    configure_file(${source} ${WORK}/prog.cpp COPYONLY)
+    execute_process(COMMAND ${GOC} --cache-dir=${WORK}/cache ${WORK}/prog.cpp -o ${WORK}/prog.bin
+                    RESULT_VARIABLE status OUTPUT_VARIABLE log ERROR_VARIABLE log)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "goc failed on ${source} (${status}):\n${log}")
+    endif()
+endforeach()
+
+execute_process(COMMAND ${VM} ${WORK}/prog.bin
+                RESULT_VARIABLE status OUTPUT_VARIABLE printed ERROR_VARIABLE errors TIMEOUT 10)
+if(NOT status EQUAL 0)
+    message(FATAL_ERROR "vm failed (${status}):\n${printed}${errors}")
+endif()
+if(NOT printed STREQUAL EXPECTED)
+    message(FATAL_ERROR "expected '${EXPECTED}', got '${printed}'")
+endif()
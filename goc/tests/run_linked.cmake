@@ -0,0 +1,32 @@
+# Compile each of SOURCES (a ;-list) with goc -c, link the objects in that
+# order with goclink, run the program on the VM and check that it prints
+# EXPECTED.
+#   cmake -DGOC=... -DGOCLINK=... -DVM=... -DSOURCES=... -DWORK=... -DEXPECTED=... -P run_linked.cmake
+
+file(REMOVE_RECURSE ${WORK})
+file(MAKE_DIRECTORY ${WORK})
+set(objects)
+foreach(source ${SOURCES})
+    get_filename_component(stem ${source} NAME_WE)
+    execute_process(COMMAND ${GOC} -c ${source} -o ${WORK}/${stem}.o
+                    RESULT_VARIABLE status OUTPUT_VARIABLE log ERROR_VARIABLE log)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "goc -c failed on ${source} (${status}):\n${log}")
+    endif()
+    list(APPEND objects ${WORK}/${stem}.o)
+endforeach()
+
+execute_process(COMMAND ${GOCLINK} ${objects} -o ${WORK}/prog.bin
+                RESULT_VARIABLE status OUTPUT_VARIABLE log ERROR_VARIABLE log)
+if(NOT status EQUAL 0)
+    message(FATAL_ERROR "goclink failed (${status}):\n${log}")
+endif()
+
+execute_process(COMMAND ${VM} ${WORK}/prog.bin
+                RESULT_VARIABLE status OUTPUT_VARIABLE printed ERROR_VARIABLE errors TIMEOUT 10)
+if(NOT status EQUAL 0)
+    message(FATAL_ERROR "vm failed (${status}):\n${printed}${errors}")
+endif()
+if(NOT printed STREQUAL EXPECTED)
+    message(FATAL_ERROR "expected '${EXPECTED}', got '${printed}'")
+endif()
@@ -0,0 +1,18 @@
+# Compile SOURCE with goc and GOC_FLAGS (a ;-list), run it on the VM and
+# check that it prints EXPECTED.
+#   cmake -DGOC=... -DVM=... -DSOURCE=... -DOUTPUT=... -DEXPECTED=... [-DGOC_FLAGS=...] -P run_program.cmake
+
+execute_process(COMMAND ${GOC} ${GOC_FLAGS} ${SOURCE} -o ${OUTPUT}
+                RESULT_VARIABLE status OUTPUT_VARIABLE log ERROR_VARIABLE log)
+if(NOT status EQUAL 0)
+    message(FATAL_ERROR "goc failed (${status}):\n${log}")
+endif()
+
+execute_process(COMMAND ${VM} ${OUTPUT}
+                RESULT_VARIABLE status OUTPUT_VARIABLE printed ERROR_VARIABLE errors TIMEOUT 10)
+if(NOT status EQUAL 0)
+    message(FATAL_ERROR "vm failed (${status}):\n${printed}${errors}")
+endif()
+if(NOT printed STREQUAL EXPECTED)
+    message(FATAL_ERROR "expected '${EXPECTED}', got '${printed}'")
+endif()
@@ -0,0 +1,37 @@
+#include "unwind.h"
+#include <cstring>
+
+static const size_t kRegionRecordSize = 12;  // u32 start, u32 end, u32 handler
+
+std::vector<uint8_t> encodeExceptionTable(const std::vector<ExceptionRegion>& regions) {
+    std::vector<uint8_t> payload(sizeof(uint32_t) + regions.size() * kRegionRecordSize);
+    uint32_t count = regions.size();
+    std::memcpy(payload.data(), &count, sizeof(count));
+    uint8_t* p = payload.data() + sizeof(count);
+    for (const auto& region : regions) {
+        std::memcpy(p, &region.start, 4);
+        std::memcpy(p + 4, &region.end, 4);
+        std::memcpy(p + 8, &region.handler, 4);
+        p += kRegionRecordSize;
+    }
+    return payload;
+}
+
+bool parseExceptionTable(const std::vector<uint8_t>& payload, std::vector<ExceptionRegion>& regions) {
+    uint32_t count = 0;
+    if (payload.size() < sizeof(count)) return false;
+    std::memcpy(&count, payload.data(), sizeof(count));
+    if (payload.size() != sizeof(count) + static_cast<size_t>(count) * kRegionRecordSize) return false;
+
+    regions.clear();
+    const uint8_t* p = payload.data() + sizeof(count);
+    for (uint32_t i = 0; i < count; i++, p += kRegionRecordSize) {
+        ExceptionRegion region;
+        std::memcpy(&region.start, p, 4);
+        std::memcpy(&region.end, p + 4, 4);
+        std::memcpy(&region.handler, p + 8, 4);
+        if (region.start > region.end) return false;
+        regions.push_back(region);
+    }
+    return true;
+}
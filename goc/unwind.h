@@ -0,0 +1,35 @@
+#ifndef UNWIND_H
+#define UNWIND_H
+
+#include <cstdint>
+#include <vector>
+
+// Exception handling tables shared by the compiler, the VM and gocopt.
+//
+// try blocks cost nothing until something is thrown: their code runs exactly as
+// it would without the try, and catch handlers are placed after the function's
+// epilogue. The compiler stores a landing-pad table in its own section of the
+// .bin file (a tagged block after the code in v1 files, see profile.h). Only THROW reads it: the VM looks
+// up the throwing offset, then the call site of each frame on call_stack, and
+// jumps to the first handler whose region covers it.
+
+const uint32_t kExceptionTableTag = 0x42545845;  // "EXTB"
+
+// Type tags THROW carries along with the value
+const int32_t kExceptionInt = 0;     // integers (floats are truncated)
+const int32_t kExceptionString = 1;  // string table ID
+
+// [start, end) is protected by the handler at `handler`. Regions are listed
+// innermost first. A handler starts with the operand stack cut back to its
+// frame's base pointer, plus the thrown value and its type tag on top.
+struct ExceptionRegion {
+    uint32_t start;
+    uint32_t end;
+    uint32_t handler;
+};
+
+// Table payload (u32 count, then 12-byte records)
+std::vector<uint8_t> encodeExceptionTable(const std::vector<ExceptionRegion>& regions);
+bool parseExceptionTable(const std::vector<uint8_t>& payload, std::vector<ExceptionRegion>& regions);
+
+#endif // UNWIND_H
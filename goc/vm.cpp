@@ -1,16 +1,22 @@
 #include "vm.h"
-#include <fstream>
+#include "encoding.h"
+#include "snapshot.h"
 #include <iomanip>
 #include <cstring>
 #include <algorithm>
 #include <limits>
+#include <sstream>
+#include <tuple>
+#include <map>
 
 VirtualMachine::VirtualMachine() 
-    : instruction_pointer(0), halted(false), error_flag(false),
+    : instruction_pointer(0), current_instruction(0), halted(false), error_flag(false),
       debug_mode(false), base_pointer(0), next_object_id(1),
       cmp_flag(0), instruction_count(0), max_stack_size(0),
       fpu_top(0),
-      heap_start_addr(10000) {  // Heap starts at address 10000
+      heap_start_addr(10000),  // Heap starts at address 10000
+      memo_capacity(65536), memo_hits(0), memo_misses(0),
+      profiling(false) {
     memory.resize(1024, 0);  // 1KB initial static memory
     heap.resize(4096, 0);    // 4KB initial heap
     float_memory.resize(1024, 0.0f);
@@ -21,68 +27,158 @@ VirtualMachine::~VirtualMachine() {
 }
 
 bool VirtualMachine::loadBytecode(const std::vector<uint8_t>& code) {
-    bytecode = code;
+    owned_code = code;
+    bytecode = {owned_code.data(), owned_code.size()};
+    compact_code = false;
+    constants.clear();
+    debug_lines = nullptr;
+    debug_lines_size = 0;
+    line_table_loaded = false;
+    function_symbols.clear();
+    instruction_counts.clear();
     reset();
     return true;
 }
 
 bool VirtualMachine::loadFromFile(const std::string& filename) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) {
-        error("Failed to open file: " + filename);
+    return loadImage(filename, false);
+}
+
+bool VirtualMachine::restoreFromFile(const std::string& filename) {
+    return loadImage(filename, true);
+}
+
+// Run the file in place: code and strings stay in the read-only mapping
+bool VirtualMachine::loadImage(const std::string& filename, bool restore) {
+    auto file = std::make_unique<MappedFile>();
+    BinaryView image;
+    std::string message;
+    if (!file->open(filename, message) || !parseBinary(file->data(), file->size(), image, message)) {
+        error(message);
         return false;
     }
-    
-    // Read string table size
-    uint32_t str_count = 0;
-    file.read(reinterpret_cast<char*>(&str_count), sizeof(str_count));
-    
-    if (!file) {
-        error("Failed to read string table size");
+    if (image.object) {
+        error(filename + " is an object file; link it with goclink");
         return false;
     }
-    
-    // Read string table
-    string_table.clear();
-    for (uint32_t i = 0; i < str_count; i++) {
-        uint32_t len = 0;
-        file.read(reinterpret_cast<char*>(&len), sizeof(len));
-        if (!file) {
-            error("Failed to read string length");
-            return false;
-        }
-        
-        std::string str(len, '\0');
-        file.read(&str[0], len);
-        if (!file) {
-            error("Failed to read string data");
-            return false;
-        }
-        string_table.push_back(str);
+    if (image.snapshot != restore) {
+        error(filename + (restore ? " is not a snapshot" : " is a snapshot; resume it with vm --restore"));
+        return false;
     }
-    
-    // Read bytecode size
-    uint32_t code_size = 0;
-    file.read(reinterpret_cast<char*>(&code_size), sizeof(code_size));
-    
-    if (!file) {
-        error("Failed to read bytecode size");
+
+    image_file = std::move(file);
+    owned_code.clear();
+    input_strings.clear();
+    string_table = std::move(image.strings);
+    bytecode = {image.code, image.code_size};
+    compact_code = image.compact_code;
+    constants = std::move(image.constants);
+    debug_lines = image.debug_lines;
+    debug_lines_size = image.debug_lines_size;
+    line_table_loaded = false;
+    function_symbols = std::move(image.symbols);
+    std::sort(function_symbols.begin(), function_symbols.end(),
+              [](const FunctionSymbol& a, const FunctionSymbol& b) { return a.address < b.address; });
+    instruction_counts.clear();
+    profile_sites = std::move(image.profile_sites);
+    exception_regions = std::move(image.exception_regions);
+
+    reset();
+    if (restore && !restoreState(image)) {
+        error(filename + ": invalid snapshot state");
         return false;
     }
-    
-    // Read bytecode
-    bytecode.resize(code_size);
-    file.read(reinterpret_cast<char*>(bytecode.data()), code_size);
-    
-    if (!file) {
-        error("Failed to read bytecode");
+    return true;
+}
+
+// Registers, stack and frames from VM_STATE; the memory arrays are copied
+// straight out of the mapped VM_MEMORY section
+bool VirtualMachine::restoreState(const BinaryView& image) {
+    SnapshotState state;
+    SnapshotMemory saved;
+    if (!parseSnapshotState(image.vm_state, image.vm_state_size, state) ||
+        !parseSnapshotMemory(image.vm_memory, image.vm_memory_size, saved) ||
+        state.instruction_pointer >= bytecode.size()) {
         return false;
     }
-    
-    reset();
+    instruction_pointer = state.instruction_pointer;
+    base_pointer = state.base_pointer;
+    cmp_flag = state.cmp_flag;
+    fpu_top = state.fpu_top;
+    std::copy(state.fpu_regs, state.fpu_regs + 8, fpu_regs);
+    heap_start_addr = state.heap_start_addr;
+    instruction_count = state.instruction_count;
+    stack = std::move(state.stack);
+    max_stack_size = stack.size();
+    call_stack.clear();
+    for (const auto& frame : state.call_stack) call_stack.emplace_back(frame.return_address, frame.base_pointer);
+    heap_blocks.clear();
+    for (const auto& block : state.heap_blocks) heap_blocks.push_back({block.start, block.size, block.allocated != 0});
+
+    memory.resize(saved.memory_cells);
+    std::memcpy(memory.data(), saved.memory, saved.memory_cells * sizeof(int32_t));
+    float_memory.resize(saved.float_cells);
+    std::memcpy(float_memory.data(), saved.float_memory, saved.float_cells * sizeof(float));
+    heap.resize(saved.heap_cells);
+    std::memcpy(heap.data(), saved.heap, saved.heap_cells * sizeof(int32_t));
     return true;
 }
 
+// Pause before the first instruction at a function symbol, or after `at`
+// instructions when it is a number
+bool VirtualMachine::setSnapshot(const std::string& at, const std::string& filename) {
+    snapshot_file = filename;
+    snapshot_address = std::numeric_limits<size_t>::max();
+    snapshot_count = std::numeric_limits<size_t>::max();
+    if (!at.empty() && std::all_of(at.begin(), at.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        snapshot_count = std::stoull(at);
+        return true;
+    }
+    for (const auto& symbol : function_symbols) {
+        if (symbol.name == at) {
+            snapshot_address = symbol.address;
+            return true;
+        }
+    }
+    error("no function named '" + at + "' to snapshot at (the file has no symbol for it)");
+    snapshot_file.clear();
+    return false;
+}
+
+// The whole program plus the VM state, so the snapshot runs without the original file
+bool VirtualMachine::writeSnapshot(const std::string& filename) const {
+    BinaryImage image;
+    image.strings.assign(string_table.begin(), string_table.end());
+    image.code.assign(bytecode.data(), bytecode.data() + bytecode.size());
+    image.compact_code = compact_code;
+    image.constants = constants;
+    image.symbols = function_symbols;
+    image.profile_sites = profile_sites;
+    image.exception_regions = exception_regions;
+    if (debug_lines) image.debug_lines.assign(debug_lines, debug_lines + debug_lines_size);
+
+    SnapshotState state;
+    state.instruction_pointer = static_cast<uint32_t>(instruction_pointer);
+    state.base_pointer = static_cast<uint32_t>(base_pointer);
+    state.cmp_flag = cmp_flag;
+    state.fpu_top = fpu_top;
+    std::copy(fpu_regs, fpu_regs + 8, state.fpu_regs);
+    state.heap_start_addr = static_cast<uint32_t>(heap_start_addr);
+    state.instruction_count = instruction_count;
+    state.stack = stack;
+    for (const auto& frame : call_stack) {
+        state.call_stack.push_back({static_cast<uint32_t>(frame.return_address), static_cast<uint32_t>(frame.base_pointer)});
+    }
+    for (const auto& block : heap_blocks) {
+        state.heap_blocks.push_back({static_cast<uint32_t>(block.start), static_cast<uint32_t>(block.size),
+                                     block.allocated ? 1u : 0u});
+    }
+    image.snapshot = true;
+    image.vm_state = encodeSnapshotState(state);
+    image.vm_memory = encodeSnapshotMemory(memory, float_memory, heap);
+    return writeBinary(filename, image);
+}
+
 void VirtualMachine::reset() {
     instruction_pointer = 0;
     halted = false;
@@ -100,6 +196,13 @@ void VirtualMachine::reset() {
     std::fill(fpu_regs, fpu_regs + 8, 0.0f);
     std::fill(float_memory.begin(), float_memory.end(), 0.0f);
     std::fill(memory.begin(), memory.end(), 0);
+    memo_tables.clear();
+    pending_memos.clear();
+    memo_hits = 0;
+    memo_misses = 0;
+    call_counts.clear();
+    jump_counts.clear();
+    std::fill(instruction_counts.begin(), instruction_counts.end(), 0);
 }
 
 void VirtualMachine::run() {
@@ -113,6 +216,8 @@ void VirtualMachine::run() {
     }
     
     if (error_flag) {
+        std::string where = sourceLocation(current_instruction);
+        if (!where.empty()) error_message += " (at " + where + ")";
         std::cerr << "\n❌ VM Error: " << error_message << std::endl;
         std::cerr << "Instruction Pointer: " << instruction_pointer << std::endl;
     }
@@ -129,6 +234,20 @@ void VirtualMachine::step() {
     if (debug_mode) {
         std::cout << "[" << instruction_pointer << "] ";
     }
+    if (!snapshot_file.empty() &&
+        (instruction_pointer == snapshot_address || instruction_count == snapshot_count)) {
+        if (!writeSnapshot(snapshot_file)) {
+            error("Could not write snapshot " + snapshot_file);
+            return;
+        }
+        snapshot_file.clear();
+        snapshot_taken = true;
+        halted = true;
+        return;
+    }
+    if (!instruction_counts.empty()) {
+        instruction_counts[instruction_pointer]++;
+    }
     
     executeInstruction();
     instruction_count++;
@@ -139,6 +258,7 @@ void VirtualMachine::step() {
 }
 
 void VirtualMachine::executeInstruction() {
+    current_instruction = instruction_pointer;
     uint8_t opcode_byte = readByte();
     VMOpcode op = static_cast<VMOpcode>(opcode_byte);
     
@@ -148,7 +268,7 @@ void VirtualMachine::executeInstruction() {
     
     switch (op) {
         case VMOpcode::PUSH: {
-            int32_t value = readInt32();
+            int32_t value = readOperand();
             push(value);
             break;
         }
@@ -200,6 +320,20 @@ void VirtualMachine::executeInstruction() {
             break;
         }
         
+        case VMOpcode::DIV_NOCHECK: {
+            int32_t b = pop();
+            int32_t a = pop();
+            push(a / b);
+            break;
+        }
+        
+        case VMOpcode::MOD_NOCHECK: {
+            int32_t b = pop();
+            int32_t a = pop();
+            push(a % b);
+            break;
+        }
+        
         case VMOpcode::DUP:
             push(peek());
             break;
@@ -241,26 +375,38 @@ void VirtualMachine::executeInstruction() {
         case VMOpcode::INPUT_STR: {
             std::string str = inputString();
             // Store string in table and push ID
-            string_table.push_back(str);
+            input_strings.push_back(std::move(str));
+            string_table.push_back(input_strings.back());
             push(static_cast<int32_t>(string_table.size() - 1));
             break;
         }
         
         case VMOpcode::PUSH_STR: {
-            int32_t str_id = readInt32();
+            int32_t str_id = readOperand();
             push(str_id);
             break;
         }
         
+        case VMOpcode::LOAD_CONST: {
+            uint64_t bits;
+            if (readConstant(bits)) {
+                push(static_cast<int32_t>(constantAsInt(bits)));
+            }
+            break;
+        }
+        
         case VMOpcode::JMP: {
-            int32_t addr = readInt32();
+            int32_t addr = readOperand();
             instruction_pointer = addr;
             break;
         }
         
         case VMOpcode::JZ: {
-            int32_t addr = readInt32();
+            int32_t addr = readOperand();
             int32_t value = pop();
+            if (profiling) {
+                jump_counts[current_instruction][value == 0]++;
+            }
             if (value == 0) {
                 instruction_pointer = addr;
             }
@@ -268,14 +414,58 @@ void VirtualMachine::executeInstruction() {
         }
         
         case VMOpcode::JNZ: {
-            int32_t addr = readInt32();
+            int32_t addr = readOperand();
             int32_t value = pop();
+            if (profiling) {
+                jump_counts[current_instruction][value != 0]++;
+            }
             if (value != 0) {
                 instruction_pointer = addr;
             }
             break;
         }
         
+        // Compact short forms (encoding.h)
+        case VMOpcode::PUSH_I8:
+            push(static_cast<int8_t>(readByte()));
+            break;
+        
+        case VMOpcode::LOAD_U8:
+            push(loadMemory(readByte()));
+            break;
+        
+        case VMOpcode::JMP_S8:
+        case VMOpcode::JZ_S8:
+        case VMOpcode::JNZ_S8:
+        case VMOpcode::JL_S8:
+        case VMOpcode::JG_S8:
+        case VMOpcode::JLE_S8:
+        case VMOpcode::JGE_S8: {
+            int8_t delta = static_cast<int8_t>(readByte());
+            bool taken = true;
+            switch (op) {
+                case VMOpcode::JZ_S8:
+                case VMOpcode::JNZ_S8: {
+                    int32_t value = pop();
+                    bool branch = op == VMOpcode::JZ_S8 ? value == 0 : value != 0;
+                    if (profiling) {
+                        jump_counts[current_instruction][branch]++;
+                    }
+                    taken = branch;
+                    break;
+                }
+                case VMOpcode::JL_S8: taken = cmp_flag < 0; break;
+                case VMOpcode::JG_S8: taken = cmp_flag > 0; break;
+                case VMOpcode::JLE_S8: taken = cmp_flag <= 0; break;
+                case VMOpcode::JGE_S8: taken = cmp_flag >= 0; break;
+                default: break;
+            }
+            if (taken) {
+                instruction_pointer += delta;
+            }
+            break;
+        }
+        
         case VMOpcode::CMP: {
             int32_t b = pop();
             int32_t a = pop();
@@ -284,7 +474,7 @@ void VirtualMachine::executeInstruction() {
         }
         
         case VMOpcode::JL: {
-            int32_t addr = readInt32();
+            int32_t addr = readOperand();
             if (cmp_flag < 0) {
                 instruction_pointer = addr;
             }
@@ -292,7 +482,7 @@ void VirtualMachine::executeInstruction() {
         }
         
         case VMOpcode::JG: {
-            int32_t addr = readInt32();
+            int32_t addr = readOperand();
             if (cmp_flag > 0) {
                 instruction_pointer = addr;
             }
@@ -300,7 +490,7 @@ void VirtualMachine::executeInstruction() {
         }
         
         case VMOpcode::JLE: {
-            int32_t addr = readInt32();
+            int32_t addr = readOperand();
             if (cmp_flag <= 0) {
                 instruction_pointer = addr;
             }
@@ -308,7 +498,7 @@ void VirtualMachine::executeInstruction() {
         }
         
         case VMOpcode::JGE: {
-            int32_t addr = readInt32();
+            int32_t addr = readOperand();
             if (cmp_flag >= 0) {
                 instruction_pointer = addr;
             }
@@ -316,7 +506,10 @@ void VirtualMachine::executeInstruction() {
         }
         
         case VMOpcode::CALL: {
-            int32_t addr = readInt32();
+            int32_t addr = readOperand();
+            if (profiling) {
+                call_counts[static_cast<size_t>(addr)]++;
+            }
             call_stack.emplace_back(instruction_pointer, base_pointer);
             instruction_pointer = addr;
             break;
@@ -349,7 +542,7 @@ void VirtualMachine::executeInstruction() {
             break;
         
         case VMOpcode::LOAD: {
-            int32_t addr = readInt32();
+            int32_t addr = readOperand();
             int32_t value = loadMemory(addr);
             if (debug_mode) {
                 std::cerr << "LOAD addr=" << addr << " value=" << value << "\n";
@@ -369,7 +562,7 @@ void VirtualMachine::executeInstruction() {
         }
         
         case VMOpcode::LOAD_BP: {
-            int32_t offset = readInt32();
+            int32_t offset = readOperand();
             // Handle negative offsets correctly (for parameters)
             int64_t addr = static_cast<int64_t>(base_pointer) + static_cast<int64_t>(offset);
             if (addr < 0 || addr >= static_cast<int64_t>(stack.size())) {
@@ -388,7 +581,7 @@ void VirtualMachine::executeInstruction() {
         }
         
         case VMOpcode::STORE_BP: {
-            int32_t offset = readInt32();
+            int32_t offset = readOperand();
             int32_t value = pop();
             // Handle negative offsets correctly (for parameters)
             int64_t addr = static_cast<int64_t>(base_pointer) + static_cast<int64_t>(offset);
@@ -423,6 +616,21 @@ void VirtualMachine::executeInstruction() {
             break;
         }
         
+        case VMOpcode::LOAD_IDX_NOCHECK: {
+            int32_t base = readOperand();
+            int32_t index = pop();
+            push(memory[static_cast<size_t>(base + index)]);
+            break;
+        }
+        
+        case VMOpcode::STORE_IDX_NOCHECK: {
+            int32_t base = readOperand();
+            int32_t index = pop();
+            int32_t value = pop();
+            memory[static_cast<size_t>(base + index)] = value;
+            break;
+        }
+        
         case VMOpcode::ALLOC: {
             int32_t size = pop();
             if (size <= 0) {
@@ -448,6 +656,67 @@ void VirtualMachine::executeInstruction() {
             break;
         }
         
+        case VMOpcode::MEMO_ENTER: {
+            // Stack: [..., arg1, ..., argN, saved_BP] with BP just past saved_BP
+            size_t entry_addr = instruction_pointer - 1;
+            uint32_t argc = static_cast<uint32_t>(readOperand());
+            if (argc > kMaxMemoArgs || base_pointer < argc + 1 || call_stack.empty()) {
+                error("Invalid MEMO_ENTER");
+                return;
+            }
+            if (memo_capacity == 0) break;
+            
+            PendingMemo pending;
+            pending.argc = argc;
+            pending.call_depth = call_stack.size();
+            uint32_t hash = 2166136261u;
+            for (uint32_t i = 0; i < argc; i++) {
+                pending.args[i] = stack[base_pointer - 1 - argc + i];
+                hash = (hash ^ static_cast<uint32_t>(pending.args[i])) * 16777619u;
+            }
+            
+            auto& table = memo_tables[entry_addr];
+            if (table.empty()) table.resize(memo_capacity);
+            pending.table = &table;
+            pending.slot = hash % memo_capacity;
+            
+            const MemoEntry& entry = table[pending.slot];
+            if (entry.valid && std::equal(pending.args, pending.args + argc, entry.args)) {
+                // Hit: leave the cached result and return as RET would
+                memo_hits++;
+                push(entry.value);
+                CallFrame frame = call_stack.back();
+                call_stack.pop_back();
+                instruction_pointer = frame.return_address;
+                base_pointer = frame.base_pointer;
+                break;
+            }
+            memo_misses++;
+            pending_memos.push_back(pending);
+            break;
+        }
+        
+        case VMOpcode::MEMO_STORE: {
+            if (pending_memos.empty() || pending_memos.back().call_depth != call_stack.size()) {
+                // Caching was disabled when this frame was entered
+                break;
+            }
+            const PendingMemo& pending = pending_memos.back();
+            MemoEntry& entry = (*pending.table)[pending.slot];
+            entry.valid = true;
+            std::copy(pending.args, pending.args + pending.argc, entry.args);
+            entry.value = peek();
+            pending_memos.pop_back();
+            break;
+        }
+        
+        case VMOpcode::THROW: {
+            int32_t type = pop();
+            int32_t value = pop();
+            throwException(value, type);
+            break;
+        }
+        
         // --- FPU instructions ---
         case VMOpcode::FPUSH: {
             float val = readFloat32();
@@ -455,6 +724,14 @@ void VirtualMachine::executeInstruction() {
             break;
         }
         
+        case VMOpcode::FLOAD_CONST: {
+            uint64_t bits;
+            if (readConstant(bits)) {
+                fpush(static_cast<float>(constantAsFloat(bits)));
+            }
+            break;
+        }
+        
         case VMOpcode::FPOP:
             fpop();
             break;
@@ -491,8 +768,15 @@ void VirtualMachine::executeInstruction() {
             break;
         }
         
+        case VMOpcode::FDIV_NOCHECK: {
+            float b = fpop();
+            float a = fpop();
+            fpush(a / b);
+            break;
+        }
+        
         case VMOpcode::FLOAD: {
-            int32_t addr = readInt32();
+            int32_t addr = readOperand();
             if (addr < 0) { error("Negative FPU memory address"); return; }
             if (static_cast<size_t>(addr) >= float_memory.size()) {
                 error("FPU memory access out of bounds");
@@ -503,7 +787,7 @@ void VirtualMachine::executeInstruction() {
         }
         
         case VMOpcode::FSTORE: {
-            int32_t addr = readInt32();
+            int32_t addr = readOperand();
             float val = fpop();
             if (addr < 0) { error("Negative FPU memory address"); return; }
             if (static_cast<size_t>(addr) >= float_memory.size()) {
@@ -513,6 +797,27 @@ void VirtualMachine::executeInstruction() {
             break;
         }
         
+        case VMOpcode::FSAVE: {
+            int32_t addr = readOperand();
+            if (addr < 0) { error("Negative FPU memory address"); return; }
+            float val = static_cast<size_t>(addr) < float_memory.size() ? float_memory[static_cast<size_t>(addr)] : 0.0f;
+            int32_t bits;
+            std::memcpy(&bits, &val, sizeof(bits));
+            push(bits);
+            break;
+        }
+        
+        case VMOpcode::FRESTORE: {
+            int32_t addr = readOperand();
+            int32_t bits = pop();
+            if (addr < 0) { error("Negative FPU memory address"); return; }
+            if (static_cast<size_t>(addr) >= float_memory.size()) {
+                float_memory.resize(static_cast<size_t>(addr) + 256, 0.0f);
+            }
+            std::memcpy(&float_memory[static_cast<size_t>(addr)], &bits, sizeof(bits));
+            break;
+        }
+        
         case VMOpcode::FPRINT: {
             float val = fpop();
             std::cout << val;
@@ -723,11 +1028,31 @@ int32_t VirtualMachine::readInt32() {
     }
     
     int32_t value;
-    std::memcpy(&value, &bytecode[instruction_pointer], sizeof(int32_t));
+    std::memcpy(&value, bytecode.data() + instruction_pointer, sizeof(int32_t));
     instruction_pointer += 4;
     return value;
 }
 
+int32_t VirtualMachine::readOperand() {
+    if (!compact_code) return readInt32();
+    int32_t value = 0;
+    if (!readSLEB128(bytecode.data(), bytecode.size(), instruction_pointer, value)) {
+        error("Unexpected end of bytecode reading operand");
+        return 0;
+    }
+    return value;
+}
+
+bool VirtualMachine::readConstant(uint64_t& bits) {
+    int32_t index = readOperand();
+    if (index < 0 || static_cast<size_t>(index) >= constants.size()) {
+        error("Invalid constant pool index");
+        return false;
+    }
+    bits = constants[index];
+    return true;
+}
+
 int32_t VirtualMachine::createObject(const std::string& className) {
     int32_t id = next_object_id++;
     objects[id] = std::make_shared<VMObject>(className);
@@ -761,7 +1086,7 @@ void VirtualMachine::printValue(int32_t value) {
     std::cout << value;
 }
 
-void VirtualMachine::printString(const std::string& str) {
+void VirtualMachine::printString(std::string_view str) {
     std::cout << str;
 }
 
@@ -792,6 +1117,36 @@ void VirtualMachine::error(const std::string& msg) {
     halted = true;
 }
 
+// Unwind to the innermost handler covering the throw, popping call frames whose
+// call site is not covered. This is the only place the exception table is read.
+void VirtualMachine::throwException(int32_t value, int32_t type) {
+    size_t site = instruction_pointer - 1;  // The THROW itself
+    while (true) {
+        for (const auto& region : exception_regions) {
+            if (site < region.start || site >= region.end) continue;
+            // Statement-level code keeps the operand stack at the frame's base
+            stack.resize(base_pointer);
+            while (!pending_memos.empty() && pending_memos.back().call_depth > call_stack.size()) {
+                pending_memos.pop_back();
+            }
+            push(value);
+            push(type);
+            instruction_pointer = region.handler;
+            return;
+        }
+        if (call_stack.empty()) break;
+        CallFrame frame = call_stack.back();
+        call_stack.pop_back();
+        site = frame.return_address - 1;  // Last byte of the CALL instruction
+        base_pointer = frame.base_pointer;
+    }
+    if (type == kExceptionString && value >= 0 && static_cast<size_t>(value) < string_table.size()) {
+        error("Uncaught exception: \"" + std::string(string_table[static_cast<size_t>(value)]) + "\"");
+    } else {
+        error("Uncaught exception: " + std::to_string(value));
+    }
+}
+
 // FPU circular stack (x87-style, 8 slots)
 void VirtualMachine::fpush(float value) {
     fpu_top = (fpu_top - 1 + 8) % 8;
@@ -815,7 +1170,7 @@ float VirtualMachine::readFloat32() {
         return 0.0f;
     }
     float value;
-    std::memcpy(&value, &bytecode[instruction_pointer], sizeof(float));
+    std::memcpy(&value, bytecode.data() + instruction_pointer, sizeof(float));
     instruction_pointer += 4;
     return value;
 }
@@ -865,52 +1220,43 @@ void VirtualMachine::disassemble() const {
     }
     std::cout << std::dec << std::endl << std::endl;
     
+    const LineTable& table = lineTable();
+    size_t next_line = 0;
     size_t ip = 0;
     while (ip < bytecode.size()) {
+        while (next_line < table.entries.size() && table.entries[next_line].offset <= ip) {
+            const LineEntry& entry = table.entries[next_line];
+            std::cout << "; " << table.files[entry.file] << ":" << entry.line << std::endl;
+            next_line++;
+        }
         std::cout << std::setw(6) << ip << ": ";
         
-        uint8_t opcode = bytecode[ip++];
-        VMOpcode op = static_cast<VMOpcode>(opcode);
-        
-        std::cout << opcodeToString(op);
-        
-        // Print operands for instructions that have them
-        switch (op) {
-            case VMOpcode::PUSH:
-            case VMOpcode::JMP:
-            case VMOpcode::JZ:
-            case VMOpcode::JNZ:
-            case VMOpcode::JL:
-            case VMOpcode::JG:
-            case VMOpcode::JLE:
-            case VMOpcode::JGE:
-            case VMOpcode::CALL:
-            case VMOpcode::LOAD:
-            case VMOpcode::LOAD_BP:
-            case VMOpcode::STORE_BP:
-            case VMOpcode::PUSH_STR:
-            case VMOpcode::FLOAD:
-            case VMOpcode::FSTORE:
-                if (ip + 4 <= bytecode.size()) {
-                    int32_t value;
-                    std::memcpy(&value, &bytecode[ip], sizeof(int32_t));
-                    std::cout << " " << value;
-                    ip += 4;
-                }
-                break;
-            case VMOpcode::FPUSH:
-                if (ip + 4 <= bytecode.size()) {
-                    float fvalue;
-                    std::memcpy(&fvalue, &bytecode[ip], sizeof(float));
-                    std::cout << " " << fvalue;
-                    ip += 4;
-                }
-                break;
-            default:
-                break;
+        Instruction instr;
+        if (!decodeInstruction(bytecode.data(), bytecode.size(), ip, compact_code, instr)) {
+            std::cout << opcodeToString(static_cast<VMOpcode>(bytecode[ip])) << std::endl;
+            ip++;
+            continue;
+        }
+        std::cout << opcodeToString(static_cast<VMOpcode>(instr.op));
+        
+        // Print operands for instructions that have them (short jumps as absolute targets)
+        if (operandKind(instr.op) == OperandKind::FLOAT) {
+            float fvalue;
+            std::memcpy(&fvalue, &instr.operand, sizeof(float));
+            std::cout << " " << fvalue;
+        } else if (operandKind(instr.op) != OperandKind::NONE) {
+            std::cout << " " << instr.operand;
+        }
+        VMOpcode op = static_cast<VMOpcode>(instr.op);
+        if ((op == VMOpcode::LOAD_CONST || op == VMOpcode::FLOAD_CONST) &&
+            instr.operand >= 0 && static_cast<size_t>(instr.operand) < constants.size()) {
+            uint64_t bits = constants[instr.operand];
+            if (op == VMOpcode::LOAD_CONST) std::cout << " (" << constantAsInt(bits) << ")";
+            else std::cout << " (" << constantAsFloat(bits) << ")";
         }
         
         std::cout << std::endl;
+        ip += instr.size;
     }
 }
 
@@ -928,6 +1274,119 @@ void VirtualMachine::printStats() const {
     }
     std::cout << allocated_blocks << " allocated, " 
               << (heap_blocks.size() - allocated_blocks) << " free)" << std::endl;
+    if (memo_hits + memo_misses > 0) {
+        std::cout << "Memo cache: " << memo_hits << " hits, " << memo_misses << " misses ("
+                  << memo_tables.size() << " functions)" << std::endl;
+    }
+    for (const auto& line : hotSpots(5)) {
+        std::cout << line << std::endl;
+    }
+}
+
+bool VirtualMachine::writeProfile(const std::string& filename) const {
+    ProfileData data;
+    for (const auto& site : profile_sites) {
+        ProfileCounts& counts = data[{site.kind, site.line, site.column}];
+        if (site.kind == ProfileSiteKind::FUNCTION) {
+            auto it = call_counts.find(site.offset);
+            if (it != call_counts.end()) counts.count += it->second;
+            continue;
+        }
+        auto it = jump_counts.find(site.offset);
+        if (it == jump_counts.end() || site.offset >= bytecode.size()) continue;
+        // JZ is taken when the condition is false, JNZ when it is true
+        bool taken_is_true = static_cast<VMOpcode>(wideOpcode(bytecode[site.offset])) == VMOpcode::JNZ;
+        counts.count += it->second[taken_is_true ? 1 : 0];
+        counts.false_count += it->second[taken_is_true ? 0 : 1];
+    }
+    return saveProfile(filename, data, hotSpots(10));
+}
+
+void VirtualMachine::setLineProfiling(bool enabled) {
+    if (enabled && (debug_lines_size > 0 || !function_symbols.empty())) {
+        instruction_counts.assign(bytecode.size(), 0);
+    } else {
+        instruction_counts.clear();
+    }
+}
+
+const LineTable& VirtualMachine::lineTable() const {
+    if (!line_table_loaded) {
+        line_table_loaded = true;
+        std::vector<uint8_t> payload(debug_lines, debug_lines + debug_lines_size);
+        if (!payload.empty() && !parseLineTable(payload, line_table)) {
+            std::cerr << "Warning: ignoring malformed line table" << std::endl;
+            line_table = LineTable();
+        }
+    }
+    return line_table;
+}
+
+// Name of the function whose entry is the closest one at or before `offset`
+std::string VirtualMachine::functionAt(size_t offset) const {
+    auto it = std::upper_bound(function_symbols.begin(), function_symbols.end(), offset,
+                               [](size_t value, const FunctionSymbol& symbol) { return value < symbol.address; });
+    if (it == function_symbols.begin()) return "";
+    return std::prev(it)->name;
+}
+
+// "function (file:line)", or whichever part the debug info provides
+std::string VirtualMachine::sourceLocation(size_t offset) const {
+    std::string function = functionAt(offset);
+    const LineEntry* entry = findLine(lineTable(), static_cast<uint32_t>(offset));
+    if (!entry) return function;
+    std::string line = lineTable().files[entry->file] + ":" + std::to_string(entry->line);
+    return function.empty() ? line : function + " (" + line + ")";
+}
+
+// Most executed functions and source lines, one report line each
+std::vector<std::string> VirtualMachine::hotSpots(size_t limit) const {
+    std::vector<std::string> report;
+    if (instruction_counts.empty()) return report;
+    uint64_t total = 0;
+    std::map<std::string, uint64_t> by_function;
+    std::map<std::tuple<std::string, uint32_t, int32_t>, uint64_t> by_line;  // (function, file, line)
+    const LineTable& table = lineTable();
+    for (size_t offset = 0; offset < instruction_counts.size(); offset++) {
+        uint64_t count = instruction_counts[offset];
+        if (count == 0) continue;
+        total += count;
+        std::string function = functionAt(offset);
+        if (!function.empty()) by_function[function] += count;
+        if (const LineEntry* entry = findLine(table, static_cast<uint32_t>(offset))) {
+            by_line[{function, entry->file, entry->line}] += count;
+        }
+    }
+    if (total == 0) return report;
+
+    auto percent = [total](uint64_t count) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << 100.0 * count / total << "%";
+        return out.str();
+    };
+    auto hottest = [limit](const auto& counts) {
+        std::vector<std::pair<uint64_t, typename std::decay_t<decltype(counts)>::key_type>> sorted;
+        for (const auto& [key, count] : counts) sorted.push_back({count, key});
+        std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+        if (sorted.size() > limit) sorted.resize(limit);
+        return sorted;
+    };
+    if (!by_function.empty()) {
+        report.push_back("Hot functions (instructions executed):");
+        for (const auto& [count, function] : hottest(by_function)) {
+            report.push_back("  " + function + "  " + std::to_string(count) + " (" + percent(count) + ")");
+        }
+    }
+    if (!by_line.empty()) {
+        report.push_back("Hot lines (instructions executed):");
+        for (const auto& [count, key] : hottest(by_line)) {
+            const auto& [function, file, line] = key;
+            std::string where = table.files[file] + ":" + std::to_string(line);
+            if (!function.empty()) where += " in " + function;
+            report.push_back("  " + where + "  " + std::to_string(count) + " (" + percent(count) + ")");
+        }
+    }
+    return report;
 }
 
 std::string VirtualMachine::opcodeToString(VMOpcode op) const {
@@ -953,6 +1412,17 @@ std::string VirtualMachine::opcodeToString(VMOpcode op) const {
         case VMOpcode::JG: return "JG";
         case VMOpcode::JLE: return "JLE";
         case VMOpcode::JGE: return "JGE";
+        case VMOpcode::LOAD_CONST: return "LOAD_CONST";
+        case VMOpcode::FLOAD_CONST: return "FLOAD_CONST";
+        case VMOpcode::PUSH_I8: return "PUSH_I8";
+        case VMOpcode::LOAD_U8: return "LOAD_U8";
+        case VMOpcode::JMP_S8: return "JMP_S8";
+        case VMOpcode::JZ_S8: return "JZ_S8";
+        case VMOpcode::JNZ_S8: return "JNZ_S8";
+        case VMOpcode::JL_S8: return "JL_S8";
+        case VMOpcode::JG_S8: return "JG_S8";
+        case VMOpcode::JLE_S8: return "JLE_S8";
+        case VMOpcode::JGE_S8: return "JGE_S8";
         case VMOpcode::CALL: return "CALL";
         case VMOpcode::RET: return "RET";
         case VMOpcode::LOAD: return "LOAD";
@@ -966,6 +1436,16 @@ std::string VirtualMachine::opcodeToString(VMOpcode op) const {
         case VMOpcode::STORE_INDIRECT: return "STORE_INDIRECT";
         case VMOpcode::ALLOC: return "ALLOC";
         case VMOpcode::FREE: return "FREE";
+        case VMOpcode::MEMO_ENTER: return "MEMO_ENTER";
+        case VMOpcode::MEMO_STORE: return "MEMO_STORE";
+        case VMOpcode::THROW: return "THROW";
+        case VMOpcode::DIV_NOCHECK: return "DIV_NOCHECK";
+        case VMOpcode::MOD_NOCHECK: return "MOD_NOCHECK";
+        case VMOpcode::FDIV_NOCHECK: return "FDIV_NOCHECK";
+        case VMOpcode::LOAD_IDX_NOCHECK: return "LOAD_IDX_NOCHECK";
+        case VMOpcode::STORE_IDX_NOCHECK: return "STORE_IDX_NOCHECK";
+        case VMOpcode::FSAVE: return "FSAVE";
+        case VMOpcode::FRESTORE: return "FRESTORE";
         case VMOpcode::FPUSH: return "FPUSH";
         case VMOpcode::FPOP: return "FPOP";
         case VMOpcode::FADD: return "FADD";
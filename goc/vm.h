@@ -8,6 +8,11 @@
 #include <cstdint>
 #include <memory>
 #include <iostream>
+#include <array>
+#include <deque>
+#include <string_view>
+#include "binfile.h"
+#include "mappedfile.h"
 
 // Platform-specific includes
 #ifdef _WIN32
@@ -55,6 +60,21 @@ enum class VMOpcode : uint8_t {
     STORE_INDIRECT = 0x28,  // Pop addr, pop value, store mem[addr] = value
     ALLOC       = 0x29,     // Pop size, allocate heap memory, push address
     FREE        = 0x2A,     // Pop address, free heap memory
+    MEMO_ENTER  = 0x2B,     // read argc; on a cache hit push the result and return
+    MEMO_STORE  = 0x2C,     // cache top of stack for the pending MEMO_ENTER args
+    THROW       = 0x2D,     // pop type tag, pop value; unwind via the exception table
+    LOAD_CONST  = 0x2E,     // read pool index, push the constant as an int
+
+    // Unchecked variants (compiler proved the operands safe)
+    DIV_NOCHECK       = 0x40,
+    MOD_NOCHECK       = 0x41,
+    FDIV_NOCHECK      = 0x42,
+    LOAD_IDX_NOCHECK  = 0x43,  // read base, pop index, push memory[base+index]
+    STORE_IDX_NOCHECK = 0x44,  // read base, pop index, pop value, memory[base+index] = value
+
+    // Float parameter cells kept across calls
+    FSAVE       = 0x48,  // read addr, push the bits of float_memory[addr]
+    FRESTORE    = 0x49,  // read addr, pop bits into float_memory[addr]
 
     // FPU (x87-style circular register stack, 8 slots)
     FPUSH       = 0x30,
@@ -71,6 +91,18 @@ enum class VMOpcode : uint8_t {
     FDUP        = 0x3B,
     INT_TO_FP   = 0x3C,
     FP_TO_INT   = 0x3D,
+    FLOAD_CONST = 0x3E,
+
+    // Compact short forms with a one-byte operand (see encoding.h)
+    PUSH_I8     = 0x50,
+    LOAD_U8     = 0x51,
+    JMP_S8      = 0x58,
+    JZ_S8       = 0x59,
+    JNZ_S8      = 0x5A,
+    JL_S8       = 0x5B,
+    JG_S8       = 0x5C,
+    JLE_S8      = 0x5D,
+    JGE_S8      = 0x5E,
 
     HALT        = 0xFF
 };
@@ -101,6 +133,12 @@ public:
     bool loadBytecode(const std::vector<uint8_t>& code);
     bool loadFromFile(const std::string& filename);
     
+    // Snapshots (snapshot.h): stop at a function or instruction count and save
+    // the state, or resume a saved one in place of loadFromFile
+    bool setSnapshot(const std::string& at, const std::string& filename);
+    bool snapshotTaken() const { return snapshot_taken; }
+    bool restoreFromFile(const std::string& filename);
+    
     // Execution
     void run();
     void step();  // Execute single instruction
@@ -112,6 +150,18 @@ public:
     void dumpMemory() const;
     void disassemble() const;
     
+    // Profiling: count calls and conditional jumps at the compiler's profile sites
+    void setProfiling(bool enabled) { profiling = enabled; }
+    bool hasProfileSites() const { return !profile_sites.empty(); }
+    bool writeProfile(const std::string& filename) const;
+    
+    // Count executed instructions per offset, reported by source line and
+    // function in printStats and writeProfile (needs the line table or symbols)
+    void setLineProfiling(bool enabled);
+    
+    // Memoization cache size: entries per memoized function (0 disables caching)
+    void setMemoCapacity(size_t entries) { memo_capacity = entries; }
+    
     // Statistics
     void printStats() const;
     
@@ -121,9 +171,24 @@ public:
     std::string getError() const { return error_message; }
     
 private:
+    // Code being executed: a section of the mapped .bin (loadFromFile) or
+    // owned_code (loadBytecode)
+    struct CodeSpan {
+        const uint8_t* bytes = nullptr;
+        size_t length = 0;
+        const uint8_t* data() const { return bytes; }
+        size_t size() const { return length; }
+        uint8_t operator[](size_t i) const { return bytes[i]; }
+    };
+    std::unique_ptr<MappedFile> image_file;
+    std::vector<uint8_t> owned_code;
+    
     // Bytecode and execution state
-    std::vector<uint8_t> bytecode;
+    CodeSpan bytecode;
+    bool compact_code = false;   // Operand encoding of `bytecode` (encoding.h)
+    std::vector<uint64_t> constants;  // Pool for LOAD_CONST / FLOAD_CONST
     size_t instruction_pointer;
+    size_t current_instruction;  // Start of the executing instruction
     bool halted;
     bool error_flag;
     std::string error_message;
@@ -145,8 +210,9 @@ private:
     std::vector<HeapBlock> heap_blocks;      // Heap block metadata
     size_t heap_start_addr;                  // Base address for heap
     
-    // String table (loaded from bytecode header)
-    std::vector<std::string> string_table;
+    // String table: views into the mapped file, then strings read by INPUT_STR
+    std::vector<std::string_view> string_table;
+    std::deque<std::string> input_strings;   // Backing for the INPUT_STR entries
     
     // Object heap
     std::unordered_map<int32_t, std::shared_ptr<VMObject>> objects;
@@ -160,6 +226,59 @@ private:
     int fpu_top;              // index of current ST0
     std::vector<float> float_memory;  // separate float memory space
     
+    // Memoization of pure functions: a direct-mapped cache per function,
+    // keyed by the function's address. Colliding entries are simply replaced,
+    // so each table never grows beyond memo_capacity entries.
+    static const size_t kMaxMemoArgs = 4;
+    struct MemoEntry {
+        bool valid = false;
+        int32_t args[kMaxMemoArgs];
+        int32_t value;
+    };
+    struct PendingMemo {
+        std::vector<MemoEntry>* table;
+        size_t slot;
+        size_t call_depth;             // call_stack size of the frame that will store
+        int32_t args[kMaxMemoArgs];
+        uint32_t argc;
+    };
+    std::unordered_map<size_t, std::vector<MemoEntry>> memo_tables;
+    std::vector<PendingMemo> pending_memos;
+    size_t memo_capacity;
+    size_t memo_hits;
+    size_t memo_misses;
+    
+    // Exception handling: landing-pad table from the .bin, only read by THROW
+    std::vector<ExceptionRegion> exception_regions;
+    
+    // Profiling (--profile-out)
+    std::vector<ProfileSite> profile_sites;               // from the .bin site table
+    bool profiling;
+    std::unordered_map<size_t, uint64_t> call_counts;     // by call target
+    std::unordered_map<size_t, std::array<uint64_t, 2>> jump_counts;  // by jump offset: [not taken, taken]
+    
+    // Debug info: the DEBUG_LINES payload stays undecoded until a source
+    // position is needed
+    const uint8_t* debug_lines = nullptr;
+    size_t debug_lines_size = 0;
+    mutable LineTable line_table;
+    mutable bool line_table_loaded = false;
+    std::vector<FunctionSymbol> function_symbols;  // Ascending addresses
+    std::vector<uint64_t> instruction_counts;      // By offset while line profiling
+    const LineTable& lineTable() const;
+    std::string functionAt(size_t offset) const;
+    std::string sourceLocation(size_t offset) const;
+    std::vector<std::string> hotSpots(size_t limit) const;
+    
+    // Snapshot request (empty file: none)
+    std::string snapshot_file;
+    size_t snapshot_address = 0;
+    size_t snapshot_count = 0;
+    bool snapshot_taken = false;
+    bool loadImage(const std::string& filename, bool restore);
+    bool restoreState(const BinaryView& image);
+    bool writeSnapshot(const std::string& filename) const;
+    
     // Statistics
     size_t instruction_count;
     size_t max_stack_size;
@@ -184,6 +303,8 @@ private:
     // Reading from bytecode
     uint8_t readByte();
     int32_t readInt32();
+    int32_t readOperand();  // Integer or target operand in the loaded encoding
+    bool readConstant(uint64_t& bits);  // Pool entry named by the operand
     
     // Object operations
     int32_t createObject(const std::string& className);
@@ -192,12 +313,13 @@ private:
     
     // I/O operations (cross-platform)
     void printValue(int32_t value);
-    void printString(const std::string& str);
+    void printString(std::string_view str);
     int32_t inputNumber();
     std::string inputString();
     
     // Error handling
     void error(const std::string& msg);
+    void throwException(int32_t value, int32_t type);
     
     // FPU operations
     void fpush(float value);
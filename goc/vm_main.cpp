@@ -4,6 +4,7 @@
 
 void printVMHelp() {
     std::cout << "Usage: vm [options] <bytecode file>\n"
+              << "       vm [options] --restore <snapshot>\n"
               << "Options:\n"
               << "  -h, --help            Show this help message\n"
               << "  -d, --debug           Enable debug mode (trace execution)\n"
@@ -11,6 +12,12 @@ void printVMHelp() {
               << "  --disassemble         Disassemble bytecode and exit\n"
               << "  --dump-stack          Dump stack after execution\n"
               << "  --dump-memory         Dump memory after execution\n"
+              << "  --profile-out=<file>  Write an execution profile for goc --profile-use\n"
+              << "  --memo-cap=<N>        Memo cache entries per function (0 disables, default 65536)\n"
+              << "  --snapshot-at=<fn|N>  Stop on entering function fn (mangled name) or after N\n"
+              << "                        instructions and save the VM state to the -o file\n"
+              << "  -o, --output <file>   Snapshot file for --snapshot-at\n"
+              << "  --restore <snapshot>  Resume a saved snapshot instead of starting a program\n"
               << std::endl;
 }
 
@@ -22,7 +29,12 @@ int main(int argc, char* argv[]) {
     bool disassemble_only = false;
     bool dump_stack = false;
     bool dump_memory = false;
+    long memo_cap = -1;
+    std::string profile_file;
     std::string bytecode_file;
+    std::string snapshot_at;
+    std::string snapshot_file;
+    bool restore = false;
 
     // Command line parsing
     for (int i = 1; i < argc; i++) {
@@ -51,6 +63,35 @@ int main(int argc, char* argv[]) {
             dump_stack = true;
         } else if (arg == "--dump-memory") {
             dump_memory = true;
+        } else if (arg.rfind("--profile-out=", 0) == 0) {
+            profile_file = arg.substr(14);
+        } else if (arg.rfind("--memo-cap=", 0) == 0) {
+            try {
+                memo_cap = std::stol(arg.substr(11));
+            } catch (...) {
+                memo_cap = -1;
+            }
+            if (memo_cap < 0) {
+                std::cerr << "Error: invalid value for --memo-cap\n";
+                return 1;
+            }
+        } else if (arg.rfind("--snapshot-at=", 0) == 0) {
+            snapshot_at = arg.substr(14);
+        } else if (arg == "-o" || arg == "--output") {
+            if (i + 1 < argc) {
+                snapshot_file = argv[++i];
+            } else {
+                std::cerr << "Error: missing filename after -o option\n";
+                return 1;
+            }
+        } else if (arg == "--restore") {
+            if (i + 1 < argc) {
+                bytecode_file = argv[++i];
+                restore = true;
+            } else {
+                std::cerr << "Error: missing snapshot after --restore\n";
+                return 1;
+            }
         } else if (arg[0] == '-') {
             std::cerr << "Unknown option: " << arg << "\n";
             printVMHelp();
@@ -70,6 +111,10 @@ int main(int argc, char* argv[]) {
         printVMHelp();
         return 1;
     }
+    if (!snapshot_at.empty() && snapshot_file.empty()) {
+        std::cerr << "Error: --snapshot-at needs an output file (-o)\n";
+        return 1;
+    }
 
     try {
         VirtualMachine vm;
@@ -79,7 +124,11 @@ int main(int argc, char* argv[]) {
             std::cout << "Loading bytecode: " << bytecode_file << "\n\n";
         }
 
-        if (!vm.loadFromFile(bytecode_file)) {
+        if (!(restore ? vm.restoreFromFile(bytecode_file) : vm.loadFromFile(bytecode_file))) {
+            std::cerr << "Error: " << vm.getError() << "\n";
+            return 1;
+        }
+        if (!snapshot_at.empty() && !vm.setSnapshot(snapshot_at, snapshot_file)) {
             std::cerr << "Error: " << vm.getError() << "\n";
             return 1;
         }
@@ -90,6 +139,18 @@ int main(int argc, char* argv[]) {
         }
 
         vm.setDebugMode(debug_mode);
+        if (memo_cap >= 0) {
+            vm.setMemoCapacity(static_cast<size_t>(memo_cap));
+        }
+        if (!profile_file.empty()) {
+            if (!vm.hasProfileSites()) {
+                std::cerr << "Warning: bytecode has no profile site table; profile will be empty\n";
+            }
+            vm.setProfiling(true);
+        }
+        if (show_stats || !profile_file.empty()) {
+            vm.setLineProfiling(true);
+        }
 
         if (debug_mode) {
             std::cout << "[Starting execution]\n\n";
@@ -105,6 +166,16 @@ int main(int argc, char* argv[]) {
         if (debug_mode) {
             std::cout << "\n[Execution completed]\n";
         }
+        if (vm.snapshotTaken()) {
+            std::cerr << "Snapshot saved to " << snapshot_file << "\n";
+        } else if (!snapshot_at.empty()) {
+            std::cerr << "Warning: the program finished before " << snapshot_at << "; no snapshot written\n";
+        }
+
+        if (!profile_file.empty() && !vm.writeProfile(profile_file)) {
+            std::cerr << "Error: could not write profile " << profile_file << "\n";
+            return 1;
+        }
 
         if (dump_stack) {
             vm.dumpStack();